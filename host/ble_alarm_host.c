@@ -0,0 +1,289 @@
+#include "ble_alarm_host.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "ble_value.h"
+#include "host_trace.h"
+
+static const char *TAG = "BLE";
+
+static ble_alarm_callbacks_t s_cbs;
+static bool s_inited;
+static bool s_connected;
+static bool s_advertising;
+static char s_name[32] = "LightClock_001";
+static ble_alarm_host_stats_t s_stats;
+static int64_t s_adv_since_us;
+static int64_t s_conn_since_us;
+
+static void set_advertising(bool on)
+{
+    int64_t now_us = esp_timer_get_time();
+    if (on && !s_advertising) {
+        s_adv_since_us = now_us;
+        s_stats.adv_starts++;
+        host_trace("ble", "advertising on");
+    } else if (!on && s_advertising) {
+        s_stats.adv_us += now_us - s_adv_since_us;
+        host_trace("ble", "advertising off");
+    }
+    s_advertising = on;
+}
+
+static void set_connected(bool on)
+{
+    int64_t now_us = esp_timer_get_time();
+    if (on && !s_connected) {
+        s_conn_since_us = now_us;
+        s_stats.connects++;
+        host_trace("ble", "connected");
+    } else if (!on && s_connected) {
+        s_stats.conn_us += now_us - s_conn_since_us;
+        host_trace("ble", "disconnected");
+    }
+    s_connected = on;
+}
+
+esp_err_t ble_alarm_set_name_suffix(const char *suffix)
+{
+    if (s_inited) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (suffix && suffix[0]) {
+        snprintf(s_name, sizeof(s_name), "LightClock_%s", suffix);
+    }
+    return ESP_OK;
+}
+
+esp_err_t ble_alarm_init(const ble_alarm_callbacks_t *cbs)
+{
+    if (s_inited) {
+        return ESP_OK;
+    }
+    if (cbs) {
+        s_cbs = *cbs;
+    } else {
+        memset(&s_cbs, 0, sizeof(s_cbs));
+    }
+    s_inited = true;
+    ESP_LOGI(TAG, "host BLE up as \"%s\"", s_name);
+    return ESP_OK;
+}
+
+esp_err_t ble_alarm_start_advertising(void)
+{
+    if (!s_inited) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!s_connected) {
+        set_advertising(true);
+    }
+    return ESP_OK;
+}
+
+esp_err_t ble_alarm_stop_advertising(void)
+{
+    set_advertising(false);
+    return ESP_OK;
+}
+
+bool ble_alarm_is_connected(void)
+{
+    return s_connected;
+}
+
+bool ble_alarm_is_advertising(void)
+{
+    return s_advertising;
+}
+
+esp_err_t ble_alarm_disconnect(void)
+{
+    if (!s_connected) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    ble_alarm_host_disconnect();
+    return ESP_OK;
+}
+
+esp_err_t ble_alarm_notify_battery(uint8_t percent)
+{
+    if (!s_connected) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_stats.battery_notifies++;
+    s_stats.last_battery_percent = percent;
+    host_trace("ble", "notify 0xFF13 %u%%", (unsigned)percent);
+    return ESP_OK;
+}
+
+esp_err_t ble_alarm_deinit(void)
+{
+    set_advertising(false);
+    set_connected(false);
+    s_inited = false;
+    memset(&s_cbs, 0, sizeof(s_cbs));
+    return ESP_OK;
+}
+
+const ble_alarm_callbacks_t *ble_alarm_host_callbacks(void)
+{
+    return s_inited ? &s_cbs : NULL;
+}
+
+const char *ble_alarm_host_name(void)
+{
+    return s_name;
+}
+
+void ble_alarm_host_connect(void)
+{
+    if (!s_inited || s_connected) {
+        return;
+    }
+    set_advertising(false);
+    set_connected(true);
+    if (s_cbs.on_connect) {
+        s_cbs.on_connect(s_cbs.ctx);
+    }
+}
+
+void ble_alarm_host_disconnect(void)
+{
+    if (!s_connected) {
+        return;
+    }
+    set_connected(false);
+    if (s_cbs.on_disconnect) {
+        s_cbs.on_disconnect(s_cbs.ctx);
+    }
+}
+
+static bool write_u8(ble_alarm_on_write_u8_t cb, const uint8_t *data, size_t len)
+{
+    return cb && len == 1 && cb(data[0], s_cbs.ctx);
+}
+
+static bool write_bytes(ble_alarm_on_write_bytes_t cb, const uint8_t *data, size_t len)
+{
+    return cb && cb(data, len, s_cbs.ctx);
+}
+
+bool ble_alarm_host_write(uint16_t uuid, const uint8_t *data, size_t len)
+{
+    // GATT stamps the write before anything else (time sync t2).
+    const int64_t rx_us = esp_timer_get_time();
+    if (!s_inited || !s_connected || !data || len == 0) {
+        return false;
+    }
+    bool ok = false;
+    switch (uuid) {
+    case 0xFF11: {
+        uint8_t hhmme5[5];
+        ok = s_cbs.on_write && ble_value_normalize_hhmme5(data, (uint16_t)len, hhmme5) &&
+             s_cbs.on_write(hhmme5, s_cbs.ctx);
+        break;
+    }
+    case 0xFF12: {
+        uint8_t hhmmss6[6];
+        ok = s_cbs.on_time_sync && ble_value_normalize_hhmmss6(data, (uint16_t)len, hhmmss6) &&
+             s_cbs.on_time_sync(hhmmss6, s_cbs.ctx);
+        break;
+    }
+    case 0xFF14:
+        ok = write_u8(s_cbs.on_write_color_temp, data, len);
+        break;
+    case 0xFF15:
+        ok = write_u8(s_cbs.on_write_wake_bright, data, len);
+        break;
+    case 0xFF16:
+        ok = write_u8(s_cbs.on_write_sunrise_duration, data, len);
+        break;
+    case 0xFF17:
+        ok = write_bytes(s_cbs.on_write_alarm_record, data, len);
+        break;
+    case 0xFF18:
+        ok = write_bytes(s_cbs.on_write_preset, data, len);
+        break;
+    case 0xFF19:
+        ok = write_bytes(s_cbs.on_write_settings, data, len);
+        break;
+    case 0xFF1A:
+        ok = write_bytes(s_cbs.on_write_config_image, data, len);
+        break;
+    case 0xFF1C:
+        ok = s_cbs.on_write_time_exchange && s_cbs.on_write_time_exchange(data, len, rx_us, s_cbs.ctx);
+        break;
+    default:
+        break;
+    }
+    s_stats.writes++;
+    host_trace("ble", "write 0x%04X %u B -> %s", (unsigned)uuid, (unsigned)len, ok ? "ok" : "rejected");
+    return ok;
+}
+
+size_t ble_alarm_host_read(uint16_t uuid, uint8_t *out, size_t cap)
+{
+    const int64_t at_us = esp_timer_get_time();
+    if (!s_inited || !s_connected || !out) {
+        return 0;
+    }
+    size_t len = 0;
+    switch (uuid) {
+    case 0xFF11:
+        if (s_cbs.on_read && cap >= 5) {
+            s_cbs.on_read(out, s_cbs.ctx);
+            len = 5;
+        }
+        break;
+    case 0xFF13:
+        if (s_cbs.on_batt_read && cap >= 1) {
+            out[0] = s_cbs.on_batt_read(s_cbs.ctx);
+            len = 1;
+        }
+        break;
+    case 0xFF17:
+        len = s_cbs.on_read_alarm_table ? s_cbs.on_read_alarm_table(out, cap, s_cbs.ctx) : 0;
+        break;
+    case 0xFF18:
+        len = s_cbs.on_read_presets ? s_cbs.on_read_presets(out, cap, s_cbs.ctx) : 0;
+        break;
+    case 0xFF19:
+        len = s_cbs.on_read_settings ? s_cbs.on_read_settings(out, cap, s_cbs.ctx) : 0;
+        break;
+    case 0xFF1A:
+        len = s_cbs.on_read_config_image ? s_cbs.on_read_config_image(out, cap, s_cbs.ctx) : 0;
+        break;
+    case 0xFF1B:
+        len = s_cbs.on_read_storage_stats ? s_cbs.on_read_storage_stats(out, cap, s_cbs.ctx) : 0;
+        break;
+    case 0xFF1C:
+        len = s_cbs.on_read_time_exchange ? s_cbs.on_read_time_exchange(out, cap, at_us, s_cbs.ctx) : 0;
+        break;
+    default:
+        break;
+    }
+    s_stats.reads++;
+    host_trace("ble", "read 0x%04X -> %u B", (unsigned)uuid, (unsigned)len);
+    return len;
+}
+
+void ble_alarm_host_get_stats(ble_alarm_host_stats_t *out)
+{
+    if (!out) {
+        return;
+    }
+    *out = s_stats;
+    // Include the interval still open.
+    int64_t now_us = esp_timer_get_time();
+    if (s_advertising) {
+        out->adv_us += now_us - s_adv_since_us;
+    }
+    if (s_connected) {
+        out->conn_us += now_us - s_conn_since_us;
+    }
+}
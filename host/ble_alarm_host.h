@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ble_alarm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Host stand-in for main/ble_alarm.c: no radio, just the callbacks app_main registered, so a host
+// driver can play the phone. Each call runs the callback the GATT event would have.
+
+// NULL until ble_alarm_init().
+const ble_alarm_callbacks_t *ble_alarm_host_callbacks(void);
+const char *ble_alarm_host_name(void);
+
+// Central connects / drops (on_connect / on_disconnect). Connecting stops advertising, as on the device.
+void ble_alarm_host_connect(void);
+void ble_alarm_host_disconnect(void);
+
+// GATT write / read of a characteristic by its 16-bit UUID (0xFF11..0xFF1C) from the connected
+// central, through the callback ble_alarm.c would call. 0xFF11 and 0xFF12 go through the same
+// normalizers (ble_value.h) first, so looser encodings are accepted as on the device.
+// The write returns whether it was accepted, the read the value length (0: refused).
+bool ble_alarm_host_write(uint16_t uuid, const uint8_t *data, size_t len);
+size_t ble_alarm_host_read(uint16_t uuid, uint8_t *out, size_t cap);
+
+typedef struct {
+    uint32_t battery_notifies;
+    uint8_t last_battery_percent;
+    uint32_t adv_starts;
+    uint32_t connects;
+    uint32_t writes;
+    uint32_t reads;
+    int64_t adv_us;  // time spent advertising
+    int64_t conn_us; // time spent connected
+} ble_alarm_host_stats_t;
+
+void ble_alarm_host_get_stats(ble_alarm_host_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
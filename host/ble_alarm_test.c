@@ -0,0 +1,902 @@
+// Protocol tests of main/ble_alarm.c on the fake Bluedroid (fake_bluedroid.h): the real GATT service,
+// with a scripted central on one side and recording callbacks standing in for app_main on the other.
+//
+//   ./build-host/ble_alarm_test                 every case
+//   ./build-host/ble_alarm_test connect_storm   one case (ctest runs each as ble_<case>)
+//   ./build-host/ble_alarm_test -v ...          with the firmware's INFO log
+//
+// Time is the host's virtual clock: the adv self-heal timers run as the script advances it, and the
+// Bluedroid events queued meanwhile are delivered in order at the instant they were queued.
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "esp_gatt_defs.h"
+#include "esp_log.h"
+
+#include "ble_alarm.h"
+#include "fake_bluedroid.h"
+#include "host_clock.h"
+#include "host_idf.h"
+#include "timer_wheel.h"
+
+#define UUID_CCCD 0x2902
+
+// 115200 baud 8N1, the console UART.
+#define UART_BYTES_PER_S (11520.0)
+
+static int s_failed;
+
+#define CHECK(cond)                                                                  \
+    do {                                                                             \
+        if (!(cond)) {                                                               \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            s_failed++;                                                              \
+        }                                                                            \
+    } while (0)
+
+// --- the app side: recording callbacks ---------------------------------------------------------
+
+typedef struct {
+    uint32_t connects;
+    uint32_t disconnects;
+    uint32_t writes; // write callbacks run, accepted or not
+    uint64_t write_bytes;
+    bool refuse;     // every write callback returns false
+    uint8_t hhmme[5];
+    uint8_t hhmmss[6];
+    uint8_t color_temp;
+    uint8_t wake_bright;
+    uint8_t sunrise_min;
+    uint16_t last_uuid;
+    size_t last_len;
+    uint8_t last[ESP_GATT_MAX_ATTR_LEN];
+    int64_t rx_us;
+    int64_t read_at_us;
+} app_t;
+
+static app_t s_app;
+
+static const uint8_t s_alarm_read[5] = {'0', '6', '4', '5', '1'};
+
+// Read values: a per-characteristic pattern, long enough to need Read Blob at the default MTU.
+static size_t fill_value(uint16_t uuid, uint8_t *out, size_t cap)
+{
+    size_t len;
+    switch (uuid) {
+    case 0xFF17: len = 3 * 7; break;
+    case 0xFF18: len = 1 + 2 * 20; break;
+    case 0xFF19: len = 150; break;
+    case 0xFF1A: len = 392; break;
+    case 0xFF1B: len = 44; break;
+    default: len = 4; break;
+    }
+    if (len > cap) {
+        len = cap;
+    }
+    for (size_t i = 0; i < len; i++) {
+        out[i] = (uint8_t)(uuid + i * 7);
+    }
+    return len;
+}
+
+static void on_connect(void *ctx)
+{
+    s_app.connects++;
+}
+
+static void on_disconnect(void *ctx)
+{
+    s_app.disconnects++;
+}
+
+static bool on_write(const uint8_t hhmme5[5], void *ctx)
+{
+    s_app.writes++;
+    memcpy(s_app.hhmme, hhmme5, 5);
+    return !s_app.refuse;
+}
+
+static void on_read(uint8_t out[5], void *ctx)
+{
+    memcpy(out, s_alarm_read, 5);
+}
+
+static bool on_time_sync(const uint8_t hhmmss6[6], void *ctx)
+{
+    s_app.writes++;
+    memcpy(s_app.hhmmss, hhmmss6, 6);
+    return !s_app.refuse;
+}
+
+static uint8_t on_batt_read(void *ctx)
+{
+    return 87;
+}
+
+// The u8 characteristics range-check in the callback (config_schema.h); 0..100 here.
+static bool store_u8(uint8_t *dst, uint8_t v)
+{
+    s_app.writes++;
+    if (s_app.refuse || v > 100) {
+        return false;
+    }
+    *dst = v;
+    return true;
+}
+
+static bool on_color_temp(uint8_t v, void *ctx)
+{
+    return store_u8(&s_app.color_temp, v);
+}
+
+static bool on_wake_bright(uint8_t v, void *ctx)
+{
+    return store_u8(&s_app.wake_bright, v);
+}
+
+static bool on_sunrise_duration(uint8_t v, void *ctx)
+{
+    return store_u8(&s_app.sunrise_min, v);
+}
+
+static bool store_bytes(uint16_t uuid, const uint8_t *data, size_t len)
+{
+    s_app.writes++;
+    s_app.write_bytes += len;
+    s_app.last_uuid = uuid;
+    s_app.last_len = len;
+    memcpy(s_app.last, data, len);
+    return !s_app.refuse && len > 0;
+}
+
+static bool on_write_alarm_record(const uint8_t *data, size_t len, void *ctx)
+{
+    return store_bytes(0xFF17, data, len);
+}
+
+static bool on_write_preset(const uint8_t *data, size_t len, void *ctx)
+{
+    return store_bytes(0xFF18, data, len);
+}
+
+static bool on_write_settings(const uint8_t *data, size_t len, void *ctx)
+{
+    return store_bytes(0xFF19, data, len);
+}
+
+static bool on_write_config_image(const uint8_t *data, size_t len, void *ctx)
+{
+    return store_bytes(0xFF1A, data, len);
+}
+
+static bool on_write_time_exchange(const uint8_t *data, size_t len, int64_t rx_us, void *ctx)
+{
+    s_app.rx_us = rx_us;
+    return store_bytes(0xFF1C, data, len);
+}
+
+static size_t on_read_alarm_table(uint8_t *out, size_t cap, void *ctx)
+{
+    return fill_value(0xFF17, out, cap);
+}
+
+static size_t on_read_presets(uint8_t *out, size_t cap, void *ctx)
+{
+    return fill_value(0xFF18, out, cap);
+}
+
+static size_t on_read_settings(uint8_t *out, size_t cap, void *ctx)
+{
+    return fill_value(0xFF19, out, cap);
+}
+
+static size_t on_read_config_image(uint8_t *out, size_t cap, void *ctx)
+{
+    return fill_value(0xFF1A, out, cap);
+}
+
+static size_t on_read_storage_stats(uint8_t *out, size_t cap, void *ctx)
+{
+    return fill_value(0xFF1B, out, cap);
+}
+
+static size_t on_read_time_exchange(uint8_t *out, size_t cap, int64_t at_us, void *ctx)
+{
+    s_app.read_at_us = at_us;
+    return fill_value(0xFF1C, out, cap);
+}
+
+static const ble_alarm_callbacks_t s_cbs = {
+    .on_write = on_write,
+    .on_read = on_read,
+    .on_time_sync = on_time_sync,
+    .on_batt_read = on_batt_read,
+    .on_write_color_temp = on_color_temp,
+    .on_write_wake_bright = on_wake_bright,
+    .on_write_sunrise_duration = on_sunrise_duration,
+    .on_write_alarm_record = on_write_alarm_record,
+    .on_read_alarm_table = on_read_alarm_table,
+    .on_write_preset = on_write_preset,
+    .on_read_presets = on_read_presets,
+    .on_write_settings = on_write_settings,
+    .on_read_settings = on_read_settings,
+    .on_write_config_image = on_write_config_image,
+    .on_read_config_image = on_read_config_image,
+    .on_read_storage_stats = on_read_storage_stats,
+    .on_write_time_exchange = on_write_time_exchange,
+    .on_read_time_exchange = on_read_time_exchange,
+    .on_connect = on_connect,
+    .on_disconnect = on_disconnect,
+};
+
+// --- the central -------------------------------------------------------------------------------
+
+static const uint8_t s_phone[6] = {0x11, 0x22, 0x33, 0x44, 0x55, 0x66};
+
+static void settle(void)
+{
+    host_clock_run_until(host_clock_now_us());
+}
+
+static void advance_ms(uint32_t ms)
+{
+    host_clock_run_until(host_clock_now_us() + (int64_t)ms * 1000);
+}
+
+static fake_bluedroid_stats_t stack(void)
+{
+    fake_bluedroid_stats_t st;
+    fake_bluedroid_get_stats(&st);
+    return st;
+}
+
+static esp_gatt_status_t response_of(uint32_t trans_id, fake_bluedroid_rsp_t *out)
+{
+    fake_bluedroid_rsp_t rsp;
+    if (!trans_id || !fake_bluedroid_response(trans_id, &rsp) || !rsp.answered) {
+        return ESP_GATT_ERROR;
+    }
+    if (out) {
+        *out = rsp;
+    }
+    return rsp.status;
+}
+
+static esp_gatt_status_t write_handle(uint16_t handle, const void *data, size_t len, fake_bluedroid_rsp_t *rsp)
+{
+    uint32_t id = fake_bluedroid_write(handle, data, len, true);
+    settle();
+    return response_of(id, rsp);
+}
+
+static esp_gatt_status_t write_char(uint16_t uuid, const void *data, size_t len)
+{
+    return write_handle(fake_bluedroid_char_handle(uuid), data, len, NULL);
+}
+
+// As a central reads a long value: Read, then Read Blob from the end until a response is short.
+static esp_gatt_status_t read_long(uint16_t handle, uint8_t *out, size_t cap, size_t *out_len)
+{
+    const uint16_t chunk = (uint16_t)(stack().mtu - 1);
+    size_t len = 0;
+    for (;;) {
+        uint32_t id = fake_bluedroid_read(handle, (uint16_t)len);
+        settle();
+        fake_bluedroid_rsp_t rsp;
+        esp_gatt_status_t st = response_of(id, &rsp);
+        if (st != ESP_GATT_OK || len + rsp.len > cap) {
+            *out_len = len;
+            return st != ESP_GATT_OK ? st : ESP_GATT_INVALID_ATTR_LEN;
+        }
+        memcpy(&out[len], rsp.value, rsp.len);
+        len += rsp.len;
+        if (rsp.len < chunk) {
+            *out_len = len;
+            return ESP_GATT_OK;
+        }
+    }
+}
+
+// ble_alarm up on a fresh stack with every callback set; the registration chain has run.
+static void setup(const ble_alarm_callbacks_t *cbs)
+{
+    fake_bluedroid_reset();
+    memset(&s_app, 0, sizeof(s_app));
+    CHECK(ble_alarm_init(cbs) == ESP_OK);
+    settle();
+}
+
+static void connect_phone(uint16_t mtu)
+{
+    CHECK(ble_alarm_start_advertising() == ESP_OK);
+    settle();
+    CHECK(fake_bluedroid_connect(s_phone));
+    if (mtu != ESP_GATT_DEF_BLE_MTU_SIZE) {
+        CHECK(fake_bluedroid_set_mtu(mtu));
+    }
+    settle();
+    CHECK(ble_alarm_is_connected());
+}
+
+static void teardown(void)
+{
+    fake_bluedroid_stats_t st = stack();
+    CHECK(st.bad_responses == 0);
+    CHECK(st.unanswered == 0);
+    CHECK(ble_alarm_deinit() == ESP_OK);
+    // Runs what is still on the clock, so the next case starts clean.
+    advance_ms(5000);
+}
+
+// --- cases -------------------------------------------------------------------------------------
+
+typedef struct {
+    uint16_t uuid;
+    esp_gatt_char_prop_t prop;
+    esp_gatt_perm_t perm;
+} char_spec_t;
+
+#define R  ESP_GATT_CHAR_PROP_BIT_READ
+#define W  ESP_GATT_CHAR_PROP_BIT_WRITE
+#define N  ESP_GATT_CHAR_PROP_BIT_NOTIFY
+#define PR ESP_GATT_PERM_READ
+#define PW ESP_GATT_PERM_WRITE
+
+// The service as the phone app expects it (requirement.md §4).
+static const char_spec_t s_chars[] = {
+    {0xFF11, R | W, PR | PW}, {0xFF12, W, PW}, {0xFF13, R | N, PR},     {0xFF14, W, PW},
+    {0xFF15, W, PW},          {0xFF16, W, PW}, {0xFF17, R | W, PR | PW}, {0xFF18, R | W, PR | PW},
+    {0xFF19, R | W, PR | PW}, {0xFF1A, R | W, PR | PW}, {0xFF1B, R, PR}, {0xFF1C, R | W, PR | PW},
+};
+#define CHAR_COUNT (sizeof(s_chars) / sizeof(s_chars[0]))
+
+static void check_service(void)
+{
+    fake_bluedroid_stats_t st = stack();
+    CHECK(st.app_registered);
+    CHECK(st.service_started);
+
+    const fake_bluedroid_attr_t *attrs = NULL;
+    size_t n = fake_bluedroid_attrs(&attrs);
+    CHECK(n == CHAR_COUNT + 1);
+    for (size_t i = 0; i < CHAR_COUNT; i++) {
+        uint16_t h = fake_bluedroid_char_handle(s_chars[i].uuid);
+        CHECK(h != 0);
+        for (size_t a = 0; a < n; a++) {
+            if (attrs[a].handle == h) {
+                CHECK(attrs[a].prop == s_chars[i].prop);
+                CHECK(attrs[a].perm == s_chars[i].perm);
+            }
+        }
+    }
+    // Battery notifications: the CCCD sits on 0xFF13, readable and writable.
+    uint16_t cccd = fake_bluedroid_descr_handle(0xFF13, UUID_CCCD);
+    CHECK(cccd == fake_bluedroid_char_handle(0xFF13) + 1);
+    for (size_t a = 0; a < n; a++) {
+        for (size_t b = a + 1; b < n; b++) {
+            CHECK(attrs[a].handle != attrs[b].handle);
+        }
+        if (attrs[a].handle == cccd) {
+            CHECK(attrs[a].perm == (PR | PW));
+        }
+    }
+}
+
+// Service registration: the REG -> CREATE -> ADD_CHAR ... chain ends with every characteristic and
+// the CCCD in the service's handle budget, and runs the same again after a deinit.
+static void test_registration(void)
+{
+    setup(&s_cbs);
+    check_service();
+    CHECK(ble_alarm_set_name_suffix("X") == ESP_ERR_INVALID_STATE);
+
+    // Advertising is configured lazily, on the first start.
+    fake_bluedroid_stats_t st = stack();
+    CHECK(!st.advertising && st.adv_starts == 0 && st.adv_data_len == 0);
+    CHECK(!ble_alarm_is_advertising());
+
+    uint16_t handles[CHAR_COUNT];
+    for (size_t i = 0; i < CHAR_COUNT; i++) {
+        handles[i] = fake_bluedroid_char_handle(s_chars[i].uuid);
+    }
+    CHECK(ble_alarm_deinit() == ESP_OK);
+    CHECK(!stack().enabled);
+    CHECK(ble_alarm_init(&s_cbs) == ESP_OK);
+    settle();
+    check_service();
+    for (size_t i = 0; i < CHAR_COUNT; i++) {
+        CHECK(fake_bluedroid_char_handle(s_chars[i].uuid) == handles[i]);
+    }
+    teardown();
+}
+
+// Payloads, name suffix, start and stop.
+static void test_advertising(void)
+{
+    fake_bluedroid_reset();
+    CHECK(ble_alarm_set_name_suffix("0123456789ABCDEFGHIJ") == ESP_ERR_INVALID_SIZE);
+    CHECK(ble_alarm_set_name_suffix("A1B2") == ESP_OK);
+    setup(&s_cbs);
+
+    CHECK(ble_alarm_start_advertising() == ESP_OK);
+    settle();
+    fake_bluedroid_stats_t st = stack();
+    CHECK(st.advertising && ble_alarm_is_advertising());
+    CHECK(strcmp(st.device_name, "LightClock_A1B2") == 0);
+    static const uint8_t adv[] = {0x02, 0x01, 0x06, 0x03, 0x03, 0x10, 0xFF};
+    CHECK(st.adv_data_len == sizeof(adv) && memcmp(st.adv_data, adv, sizeof(adv)) == 0);
+    CHECK(st.scan_rsp_len == 2 + 15 && st.scan_rsp[0] == 16 && st.scan_rsp[1] == 0x09);
+    CHECK(memcmp(&st.scan_rsp[2], "LightClock_A1B2", 15) == 0);
+
+    CHECK(ble_alarm_stop_advertising() == ESP_OK);
+    settle();
+    CHECK(!stack().advertising && !ble_alarm_is_advertising());
+    // Stopped on purpose: the self-heal stays out of it.
+    uint32_t starts = stack().adv_starts;
+    advance_ms(10000);
+    CHECK(!stack().advertising && stack().adv_starts == starts);
+
+    CHECK(ble_alarm_start_advertising() == ESP_OK);
+    settle();
+    CHECK(stack().advertising && ble_alarm_is_advertising());
+    teardown();
+    CHECK(ble_alarm_set_name_suffix(NULL) == ESP_OK);
+}
+
+// Advertising comes back by itself after the stack stops it, a failed start and a disconnect, and
+// stays off while connected.
+static void test_adv_restart(void)
+{
+    setup(&s_cbs);
+    CHECK(ble_alarm_start_advertising() == ESP_OK);
+    settle();
+    CHECK(stack().advertising);
+
+    // Stopped under us: retried after 200 ms (+ up to 100 ms of timer slack).
+    fake_bluedroid_stop_adv();
+    settle();
+    CHECK(!stack().advertising && !ble_alarm_is_advertising());
+    advance_ms(300);
+    CHECK(stack().advertising && ble_alarm_is_advertising());
+
+    // A start that fails in its completion event: retried after 500 ms.
+    fake_bluedroid_fail_adv_starts(1);
+    fake_bluedroid_stop_adv();
+    advance_ms(300);
+    CHECK(!stack().advertising && !ble_alarm_is_advertising());
+    advance_ms(600);
+    CHECK(stack().advertising && ble_alarm_is_advertising());
+
+    // A stack that keeps failing is retried on the timer, not from the failure event.
+    uint32_t starts = stack().adv_starts;
+    fake_bluedroid_fail_adv_starts(UINT32_MAX);
+    fake_bluedroid_stop_adv();
+    advance_ms(5000);
+    CHECK(!stack().advertising && !ble_alarm_is_advertising());
+    CHECK(stack().adv_starts - starts <= 5000 / 500);
+    fake_bluedroid_fail_adv_starts(0);
+    advance_ms(600);
+    CHECK(stack().advertising && ble_alarm_is_advertising());
+
+    // Connected: no advertising, and no restart attempts.
+    CHECK(fake_bluedroid_connect(s_phone));
+    settle();
+    starts = stack().adv_starts;
+    advance_ms(10000);
+    CHECK(!stack().advertising && !ble_alarm_is_advertising());
+    CHECK(stack().adv_starts == starts);
+
+    // Dropped: back within 50 ms (+ slack).
+    CHECK(fake_bluedroid_disconnect(ESP_GATT_CONN_TIMEOUT));
+    settle();
+    advance_ms(150);
+    CHECK(stack().advertising && ble_alarm_is_advertising());
+
+    // Steady state: on throughout, app and controller agree.
+    starts = stack().adv_starts;
+    for (int s = 0; s < 60; s++) {
+        advance_ms(1000);
+        CHECK(stack().advertising && ble_alarm_is_advertising());
+    }
+    printf("adv_restart: %u starts in 60 s of steady advertising (2 s self-heal)\n",
+           (unsigned)(stack().adv_starts - starts));
+    teardown();
+}
+
+static uint32_t s_lcg = 12345;
+
+static uint32_t rnd(uint32_t n)
+{
+    s_lcg = s_lcg * 1103515245u + 12345u;
+    return (s_lcg >> 16) % n;
+}
+
+// Connects and drops in every order the BTC queue can deliver them: held, back-to-back, with a write
+// in flight, dropped by either side. Callbacks pair up, no request is lost, notifications only reach
+// a central that subscribed, and advertising always comes back.
+static void test_connect_storm(void)
+{
+    setup(&s_cbs);
+    CHECK(ble_alarm_start_advertising() == ESP_OK);
+    settle();
+
+    const uint16_t cccd = fake_bluedroid_descr_handle(0xFF13, UUID_CCCD);
+    const uint16_t bright = fake_bluedroid_char_handle(0xFF15);
+    const uint32_t rounds = 500;
+    uint32_t in_flight = 0;
+    for (uint32_t r = 0; r < rounds; r++) {
+        // The central can only connect once advertising is back.
+        for (int wait = 0; wait < 100 && !stack().advertising; wait++) {
+            advance_ms(10);
+        }
+        CHECK(stack().advertising);
+        uint8_t bda[6];
+        memcpy(bda, s_phone, sizeof(bda));
+        bda[5] = (uint8_t)r;
+        CHECK(fake_bluedroid_connect(bda));
+
+        switch (rnd(4)) {
+        case 0: {
+            // Held for a while, subscribed half the time; dropped by the central.
+            settle();
+            bool subscribe = rnd(2);
+            uint32_t before = stack().indications;
+            if (subscribe) {
+                static const uint8_t on[2] = {0x01, 0x00};
+                CHECK(write_handle(cccd, on, sizeof(on), NULL) == ESP_GATT_OK);
+            }
+            CHECK(ble_alarm_notify_battery(50) == ESP_OK);
+            settle();
+            CHECK(stack().indications == before + (subscribe ? 2 : 0));
+            advance_ms(rnd(2000));
+            CHECK(fake_bluedroid_disconnect(rnd(2) ? ESP_GATT_CONN_TIMEOUT : ESP_GATT_CONN_TERMINATE_PEER_USER));
+            break;
+        }
+        case 1:
+            // Gone before the app saw it arrive.
+            CHECK(fake_bluedroid_disconnect(ESP_GATT_CONN_FAIL_ESTABLISH));
+            break;
+        case 2: {
+            // A write queued between connect and drop is still delivered and answered, in order.
+            uint8_t v = (uint8_t)rnd(101);
+            uint32_t id = fake_bluedroid_write(bright, &v, 1, true);
+            CHECK(fake_bluedroid_disconnect(ESP_GATT_CONN_TIMEOUT));
+            settle();
+            CHECK(response_of(id, NULL) == ESP_GATT_OK && s_app.wake_bright == v);
+            in_flight++;
+            break;
+        }
+        default:
+            // Dropped by the device.
+            settle();
+            CHECK(ble_alarm_disconnect() == ESP_OK);
+            break;
+        }
+        settle();
+        CHECK(!ble_alarm_is_connected());
+        CHECK(s_app.connects == r + 1 && s_app.disconnects == r + 1);
+    }
+    advance_ms(150);
+    fake_bluedroid_stats_t st = stack();
+    CHECK(st.advertising && ble_alarm_is_advertising());
+    CHECK(st.connects == rounds);
+    printf("connect_storm: %u connections, %u writes in flight at the drop, %u events\n", (unsigned)rounds,
+           (unsigned)in_flight, (unsigned)st.events);
+    teardown();
+}
+
+// Every writable characteristic: accepted values reach the callback, refused ones are answered with
+// an error, and the stack refuses writes to read-only attributes without bothering the app.
+static void test_char_write(void)
+{
+    setup(&s_cbs);
+    connect_phone(185);
+
+    // 0xFF11 alarm HHMME, through the normalizer.
+    CHECK(write_char(0xFF11, "0630", 4) == ESP_GATT_OK && memcmp(s_app.hhmme, "06301", 5) == 0);
+    CHECK(write_char(0xFF11, "07150", 5) == ESP_GATT_OK && memcmp(s_app.hhmme, "07150", 5) == 0);
+    CHECK(write_char(0xFF11, "abc", 3) == ESP_GATT_INVALID_ATTR_LEN);
+    s_app.refuse = true;
+    CHECK(write_char(0xFF11, "0630", 4) == ESP_GATT_INVALID_ATTR_LEN);
+    s_app.refuse = false;
+
+    // 0xFF12 time sync HHMMSS.
+    CHECK(write_char(0xFF12, "22:30:15\r\n", 10) == ESP_GATT_OK && memcmp(s_app.hhmmss, "223015", 6) == 0);
+    CHECK(write_char(0xFF12, "abc", 3) == ESP_GATT_INVALID_ATTR_LEN);
+
+    // 0xFF14..0xFF16: one byte, range-checked by the callback.
+    static const uint16_t u8_chars[] = {0xFF14, 0xFF15, 0xFF16};
+    uint8_t *const u8_dst[] = {&s_app.color_temp, &s_app.wake_bright, &s_app.sunrise_min};
+    for (size_t i = 0; i < 3; i++) {
+        uint8_t v = (uint8_t)(40 + i);
+        CHECK(write_char(u8_chars[i], &v, 1) == ESP_GATT_OK && *u8_dst[i] == v);
+        v = 101;
+        CHECK(write_char(u8_chars[i], &v, 1) == ESP_GATT_INVALID_ATTR_LEN && *u8_dst[i] == 40 + i);
+        uint32_t writes = s_app.writes;
+        static const uint8_t two[2] = {1, 2};
+        CHECK(write_char(u8_chars[i], two, 2) == ESP_GATT_INVALID_ATTR_LEN);
+        CHECK(s_app.writes == writes);
+    }
+
+    // 0xFF17..0xFF1A and 0xFF1C: the bytes as written, up to MTU - 3.
+    static const uint16_t byte_chars[] = {0xFF17, 0xFF18, 0xFF19, 0xFF1A, 0xFF1C};
+    for (size_t i = 0; i < sizeof(byte_chars) / sizeof(byte_chars[0]); i++) {
+        uint8_t buf[182];
+        for (size_t k = 0; k < sizeof(buf); k++) {
+            buf[k] = (uint8_t)(byte_chars[i] ^ k);
+        }
+        advance_ms(7);
+        CHECK(write_char(byte_chars[i], buf, sizeof(buf)) == ESP_GATT_OK);
+        CHECK(s_app.last_uuid == byte_chars[i] && s_app.last_len == sizeof(buf));
+        CHECK(memcmp(s_app.last, buf, sizeof(buf)) == 0);
+        CHECK(write_char(byte_chars[i], buf, 0) == ESP_GATT_INVALID_ATTR_LEN);
+        // One byte too many takes a prepared write, which the central does not get to send.
+        CHECK(fake_bluedroid_write(fake_bluedroid_char_handle(byte_chars[i]), buf, sizeof(buf) + 1, true) == 0);
+    }
+    // The time exchange is stamped as the event arrives.
+    advance_ms(123);
+    CHECK(write_char(0xFF1C, "\x01\x02\x03\x04", 4) == ESP_GATT_OK && s_app.rx_us == host_clock_now_us());
+
+    // Read-only characteristics: refused by the stack.
+    static const uint16_t ro_chars[] = {0xFF13, 0xFF1B};
+    for (size_t i = 0; i < 2; i++) {
+        uint32_t writes = s_app.writes;
+        fake_bluedroid_rsp_t rsp = {0};
+        CHECK(write_handle(fake_bluedroid_char_handle(ro_chars[i]), "\x01", 1, &rsp) == ESP_GATT_WRITE_NOT_PERMIT);
+        CHECK(rsp.by_stack && s_app.writes == writes);
+    }
+    // A handle that is no characteristic value (0xFF15's declaration).
+    CHECK(write_handle((uint16_t)(fake_bluedroid_char_handle(0xFF15) - 1), "\x01", 1, NULL) == ESP_GATT_INVALID_HANDLE);
+
+    // Write Command: the callback runs, nothing is answered.
+    uint32_t id = fake_bluedroid_write(fake_bluedroid_char_handle(0xFF15), "\x21", 1, false);
+    settle();
+    fake_bluedroid_rsp_t rsp;
+    CHECK(fake_bluedroid_response(id, &rsp) && !rsp.answered && s_app.wake_bright == 0x21);
+
+    // CCCD: subscribing sends the level at once, then on each notify; unsubscribing stops them.
+    const uint16_t cccd = fake_bluedroid_descr_handle(0xFF13, UUID_CCCD);
+    uint32_t before = stack().indications;
+    CHECK(write_handle(cccd, "\x01\x00", 2, NULL) == ESP_GATT_OK);
+    fake_bluedroid_stats_t st = stack();
+    CHECK(st.indications == before + 1 && st.last_indication_handle == fake_bluedroid_char_handle(0xFF13));
+    CHECK(st.last_indication_len == 1 && st.last_indication[0] == 87);
+    CHECK(ble_alarm_notify_battery(55) == ESP_OK);
+    settle();
+    CHECK(stack().indications == before + 2 && stack().last_indication[0] == 55);
+    CHECK(write_handle(cccd, "\x00\x00", 2, NULL) == ESP_GATT_OK);
+    CHECK(ble_alarm_notify_battery(50) == ESP_OK);
+    settle();
+    CHECK(stack().indications == before + 2);
+    CHECK(write_handle(cccd, "\x01", 1, NULL) == ESP_GATT_INVALID_ATTR_LEN);
+
+    // A new central starts unsubscribed.
+    CHECK(write_handle(cccd, "\x01\x00", 2, NULL) == ESP_GATT_OK);
+    CHECK(fake_bluedroid_disconnect(ESP_GATT_CONN_TERMINATE_PEER_USER));
+    settle();
+    advance_ms(150);
+    CHECK(fake_bluedroid_connect(s_phone));
+    settle();
+    before = stack().indications;
+    CHECK(ble_alarm_notify_battery(60) == ESP_OK);
+    settle();
+    CHECK(stack().indications == before);
+    teardown();
+}
+
+// Every readable characteristic, whole, at the default and a large MTU; the stack refuses reads of
+// write-only ones.
+static void test_char_read(void)
+{
+    static const uint16_t mtus[] = {ESP_GATT_DEF_BLE_MTU_SIZE, 185};
+    for (size_t m = 0; m < 2; m++) {
+        setup(&s_cbs);
+        connect_phone(mtus[m]);
+        for (size_t i = 0; i < CHAR_COUNT; i++) {
+            const uint16_t uuid = s_chars[i].uuid;
+            const uint16_t h = fake_bluedroid_char_handle(uuid);
+            uint8_t got[1024];
+            size_t len = 0;
+            esp_gatt_status_t st = read_long(h, got, sizeof(got), &len);
+            if (!(s_chars[i].perm & ESP_GATT_PERM_READ)) {
+                CHECK(st == ESP_GATT_READ_NOT_PERMIT);
+                continue;
+            }
+            CHECK(st == ESP_GATT_OK);
+            uint8_t want[1024];
+            size_t want_len;
+            if (uuid == 0xFF11) {
+                want_len = 5;
+                memcpy(want, s_alarm_read, 5);
+            } else if (uuid == 0xFF13) {
+                want_len = 1;
+                want[0] = 87;
+            } else {
+                want_len = fill_value(uuid, want, sizeof(want));
+            }
+            CHECK(len == want_len && memcmp(got, want, want_len) == 0);
+        }
+        // Read Blob past the end.
+        uint32_t id = fake_bluedroid_read(fake_bluedroid_char_handle(0xFF17), 22);
+        settle();
+        CHECK(response_of(id, NULL) == ESP_GATT_INVALID_OFFSET);
+        // The time exchange is stamped as the event arrives.
+        advance_ms(321);
+        uint8_t got[8];
+        size_t len = 0;
+        CHECK(read_long(fake_bluedroid_char_handle(0xFF1C), got, sizeof(got), &len) == ESP_GATT_OK);
+        CHECK(s_app.read_at_us == host_clock_now_us());
+        teardown();
+    }
+}
+
+// No callbacks: every write is refused, reads come back empty (0xFF11: the last stored value).
+static void test_null_callbacks(void)
+{
+    static const ble_alarm_callbacks_t none;
+    setup(&none);
+    connect_phone(ESP_GATT_DEF_BLE_MTU_SIZE);
+    for (size_t i = 0; i < CHAR_COUNT; i++) {
+        const uint16_t h = fake_bluedroid_char_handle(s_chars[i].uuid);
+        if (s_chars[i].perm & ESP_GATT_PERM_WRITE) {
+            CHECK(write_handle(h, "0630", s_chars[i].uuid >= 0xFF14 && s_chars[i].uuid <= 0xFF16 ? 1 : 4, NULL) ==
+                  ESP_GATT_INVALID_ATTR_LEN);
+        }
+        if (s_chars[i].perm & ESP_GATT_PERM_READ) {
+            uint8_t got[64];
+            size_t len = 0;
+            CHECK(read_long(h, got, sizeof(got), &len) == ESP_GATT_OK);
+            CHECK(len == (s_chars[i].uuid == 0xFF11 ? 5u : s_chars[i].uuid == 0xFF13 ? 1u : 0u));
+        }
+    }
+    // Subscribing without a battery callback sends nothing.
+    CHECK(write_handle(fake_bluedroid_descr_handle(0xFF13, UUID_CCCD), "\x01\x00", 2, NULL) == ESP_GATT_OK);
+    CHECK(stack().indications == 0);
+    CHECK(s_app.connects == 0);
+    teardown();
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+typedef struct {
+    double seconds;
+    uint64_t log_bytes;
+} write_run_t;
+
+// n writes over the mix a phone sends during setup: config image chunks, alarm records, a brightness
+// and an alarm time. Queued 64 at a time, as a central pipelining Write Commands would.
+static write_run_t write_mix(uint32_t n, uint32_t *ok)
+{
+    const uint16_t h_image = fake_bluedroid_char_handle(0xFF1A);
+    const uint16_t h_record = fake_bluedroid_char_handle(0xFF17);
+    const uint16_t h_bright = fake_bluedroid_char_handle(0xFF15);
+    const uint16_t h_alarm = fake_bluedroid_char_handle(0xFF11);
+    uint8_t chunk[244];
+    for (size_t k = 0; k < sizeof(chunk); k++) {
+        chunk[k] = (uint8_t)k;
+    }
+    uint32_t ids[64];
+    uint64_t log0 = host_log_bytes();
+    double t0 = now_s();
+    for (uint32_t i = 0; i < n;) {
+        uint32_t batch = 0;
+        for (; batch < 64 && i < n; batch++, i++) {
+            switch (i % 4) {
+            case 0: ids[batch] = fake_bluedroid_write(h_image, chunk, sizeof(chunk), true); break;
+            case 1: ids[batch] = fake_bluedroid_write(h_record, chunk, 7, true); break;
+            case 2: ids[batch] = fake_bluedroid_write(h_bright, "\x32", 1, true); break;
+            default: ids[batch] = fake_bluedroid_write(h_alarm, "0630", 4, true); break;
+            }
+        }
+        fake_bluedroid_run();
+        for (uint32_t b = 0; b < batch; b++) {
+            *ok += (response_of(ids[b], NULL) == ESP_GATT_OK);
+        }
+    }
+    return (write_run_t){now_s() - t0, host_log_bytes() - log0};
+}
+
+// Write path throughput: GATTS_WRITE_EVT to response, through ble_alarm.c's dispatch. The host figure
+// bounds the code path (fake stack included); the log figure is what bounds it on the device, where
+// every write is logged at INFO to a 115200 baud console.
+static void test_write_throughput(void)
+{
+    const uint32_t n = 40000;
+    setup(&s_cbs);
+    connect_phone(247);
+
+    uint32_t ok = 0;
+    esp_log_level_set("*", ESP_LOG_WARN);
+    write_run_t quiet = write_mix(n, &ok);
+    CHECK(ok == n && s_app.writes == n);
+    CHECK(quiet.log_bytes == 0);
+
+    FILE *devnull = fopen("/dev/null", "w");
+    CHECK(devnull != NULL);
+    host_log_set_output(devnull);
+    esp_log_level_set("*", ESP_LOG_INFO);
+    ok = 0;
+    write_run_t logged = write_mix(n / 10, &ok);
+    esp_log_level_set("*", ESP_LOG_WARN);
+    host_log_set_output(NULL);
+    if (devnull) {
+        fclose(devnull);
+    }
+    CHECK(ok == n / 10);
+
+    const double payload = (244.0 + 7 + 1 + 4) / 4;
+    const double log_per_write = (double)logged.log_bytes / (n / 10);
+    printf("write_throughput: %u writes, %.0f writes/s, %.2f us/write, %.1f MB/s of payload (host, log off)\n",
+           (unsigned)n, n / quiet.seconds, quiet.seconds * 1e6 / n, n * payload / quiet.seconds / 1e6);
+    printf("write_throughput: %.2f us/write with the INFO log on\n", logged.seconds * 1e6 / (n / 10));
+    printf("write_throughput: %.0f log bytes/write at INFO -> at most %.0f writes/s (%.1f kB/s) over a 115200 "
+           "baud console\n",
+           log_per_write, UART_BYTES_PER_S / log_per_write, UART_BYTES_PER_S / log_per_write * payload / 1000);
+    teardown();
+}
+
+static const struct {
+    const char *name;
+    void (*run)(void);
+} s_cases[] = {
+    {"registration", test_registration},
+    {"advertising", test_advertising},
+    {"adv_restart", test_adv_restart},
+    {"connect_storm", test_connect_storm},
+    {"char_write", test_char_write},
+    {"char_read", test_char_read},
+    {"null_callbacks", test_null_callbacks},
+    {"write_throughput", test_write_throughput},
+};
+#define CASE_COUNT (sizeof(s_cases) / sizeof(s_cases[0]))
+
+static int run_case(size_t i)
+{
+    int before = s_failed;
+    s_cases[i].run();
+    printf("%s %s\n", s_failed == before ? "PASS" : "FAIL", s_cases[i].name);
+    return s_failed - before;
+}
+
+int main(int argc, char **argv)
+{
+    esp_log_level_set("*", ESP_LOG_WARN);
+    int first = 1;
+    if (argc > 1 && strcmp(argv[1], "-v") == 0) {
+        esp_log_level_set("*", ESP_LOG_INFO);
+        first = 2;
+    }
+    if (timer_wheel_init() != ESP_OK) {
+        fprintf(stderr, "timer_wheel_init failed\n");
+        return 1;
+    }
+
+    if (first == argc) {
+        for (size_t i = 0; i < CASE_COUNT; i++) {
+            run_case(i);
+        }
+    }
+    for (int a = first; a < argc; a++) {
+        size_t i = 0;
+        while (i < CASE_COUNT && strcmp(argv[a], s_cases[i].name) != 0) {
+            i++;
+        }
+        if (i == CASE_COUNT) {
+            fprintf(stderr, "unknown case %s; cases:", argv[a]);
+            for (size_t k = 0; k < CASE_COUNT; k++) {
+                fprintf(stderr, " %s", s_cases[k].name);
+            }
+            fprintf(stderr, "\n");
+            return 2;
+        }
+        run_case(i);
+    }
+    return s_failed ? 1 : 0;
+}
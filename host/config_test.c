@@ -0,0 +1,830 @@
+// Tests of the config storage stack on the in-memory NVS (fake_nvs.c): the write-behind service
+// (config_service.c) on the virtual clock, the A/B journal behind it (device_config.c) with faults and
+// power cuts injected into NVS writes, and the config blob both of them and the 0xFF1A image share.
+//
+//   ./build-host/config_test              every case
+//   ./build-host/config_test commit_retry one case (ctest runs each as cfg_<case>)
+//   ./build-host/config_test -v ...       with the firmware's INFO log
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+
+#include "sdkconfig.h"
+
+#include "config_service.h"
+#include "device_config.h"
+#include "host_clock.h"
+#include "host_idf.h"
+#include "timer_wheel.h"
+#include "tz.h"
+
+#define DELAY_MS ((int64_t)CONFIG_LIGHT_ALARM_CFG_COMMIT_DELAY_MS)
+// The commit may ride along with another wakeup up to a quarter of the delay later.
+#define DELAY_MAX_MS (DELAY_MS + DELAY_MS / 4)
+
+static int s_failed;
+
+#define CHECK(cond)                                                                  \
+    do {                                                                             \
+        if (!(cond)) {                                                               \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            s_failed++;                                                              \
+        }                                                                            \
+    } while (0)
+
+static void advance_ms(int64_t ms)
+{
+    host_clock_run_until(host_clock_now_us() + ms * 1000);
+}
+
+static int64_t now_ms(void)
+{
+    return host_clock_now_us() / 1000;
+}
+
+static host_nvs_stats_t nvs(void)
+{
+    host_nvs_stats_t st;
+    host_nvs_get_stats(&st);
+    return st;
+}
+
+static config_service_stats_t svc(void)
+{
+    config_service_stats_t st;
+    config_service_get_stats(&st);
+    return st;
+}
+
+// Blank flash, as on a new board.
+static void fresh_nvs(void)
+{
+    host_nvs_inject_faults(0, 0);
+    (void)nvs_flash_erase();
+    (void)nvs_flash_init();
+}
+
+// What a reboot would load now.
+static device_config_t reload(void)
+{
+    device_config_t cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    CHECK(device_config_load(&cfg) == ESP_OK);
+    return cfg;
+}
+
+static bool same(const device_config_t *a, const device_config_t *b)
+{
+    return memcmp(a, b, sizeof(*a)) == 0;
+}
+
+// The service on blank flash; out receives the defaults it starts from.
+static void start_service(device_config_t *out)
+{
+    fresh_nvs();
+    CHECK(config_service_init(out) == ESP_OK);
+    CHECK(!config_service_is_dirty());
+}
+
+// --- write-behind ------------------------------------------------------------------------------
+
+// A slider drag: 20 updates 100 ms apart reach NVS as one commit, DELAY_MS after the last.
+static void test_coalesce(void)
+{
+    device_config_t cfg;
+    start_service(&cfg);
+    config_service_stats_t s0 = svc();
+    uint32_t commits0 = nvs().commits;
+
+    for (uint8_t i = 0; i < 20; i++) {
+        cfg.wake_bright = (uint8_t)(5 * i);
+        CHECK(config_service_update(&cfg) == ESP_OK);
+        advance_ms(100);
+    }
+    CHECK(config_service_is_dirty());
+    CHECK(nvs().commits == commits0);
+
+    // Not before the debounce has run out after the last update, and not long after.
+    advance_ms(DELAY_MS - 200);
+    CHECK(nvs().commits == commits0);
+    advance_ms(DELAY_MAX_MS - DELAY_MS + 200);
+    CHECK(nvs().commits == commits0 + 1);
+    CHECK(!config_service_is_dirty());
+
+    config_service_stats_t s1 = svc();
+    CHECK(s1.updates - s0.updates == 20);
+    CHECK(s1.commits - s0.commits == 1);
+    CHECK(s1.coalesced - s0.coalesced == 19);
+    CHECK(s1.commit_errors == s0.commit_errors);
+
+    // The commit holds the last value, and an update back to it changes nothing.
+    device_config_t saved = reload();
+    CHECK(same(&saved, &cfg));
+    CHECK(config_service_update(&cfg) == ESP_OK);
+    CHECK(!config_service_is_dirty());
+}
+
+// A change every DELAY_MS / 2 never lets the debounce run out; the commit still happens within
+// 4 * DELAY_MS of the first unsaved change, and again for the changes after it.
+static void test_max_defer(void)
+{
+    device_config_t cfg;
+    start_service(&cfg);
+    uint32_t commits0 = nvs().commits;
+
+    int64_t dirty_since = -1;
+    int64_t longest = 0;
+    uint32_t commits = 0;
+    for (int64_t t = 0; t < 20 * DELAY_MS; t += 100) {
+        if (t % (DELAY_MS / 2) == 0) {
+            cfg.color_temp = (uint8_t)((cfg.color_temp + 1) % 101);
+            CHECK(config_service_update(&cfg) == ESP_OK);
+            if (dirty_since < 0) {
+                dirty_since = now_ms();
+            }
+        }
+        advance_ms(100);
+        if (nvs().commits - commits0 != commits) {
+            commits = nvs().commits - commits0;
+            if (now_ms() - dirty_since > longest) {
+                longest = now_ms() - dirty_since;
+            }
+            dirty_since = config_service_is_dirty() ? now_ms() : -1;
+        }
+    }
+    CHECK(commits >= 4);
+    CHECK(longest <= 4 * DELAY_MS + 100);
+    CHECK(longest >= 3 * DELAY_MS); // it does defer while changes keep coming
+
+    advance_ms(DELAY_MAX_MS);
+    CHECK(!config_service_is_dirty());
+    device_config_t saved = reload();
+    CHECK(same(&saved, &cfg));
+}
+
+// A failed commit leaves the config dirty and is retried on its own, backing off while NVS keeps
+// failing; nothing is lost once it recovers.
+static void test_commit_retry(void)
+{
+    device_config_t cfg;
+    start_service(&cfg);
+    config_service_stats_t s0 = svc();
+
+    // Two failures, then NVS works again: retried DELAY_MS and 2 * DELAY_MS after the failures.
+    host_nvs_inject_faults(0, 2);
+    cfg.wake_bright = 42;
+    CHECK(config_service_update(&cfg) == ESP_OK);
+    advance_ms(DELAY_MAX_MS);
+    CHECK(svc().commit_errors - s0.commit_errors == 1);
+    CHECK(config_service_is_dirty());
+    advance_ms(DELAY_MAX_MS);
+    CHECK(svc().commit_errors - s0.commit_errors == 2);
+    CHECK(config_service_is_dirty());
+    advance_ms(2 * DELAY_MAX_MS);
+    CHECK(!config_service_is_dirty());
+    CHECK(svc().commits - s0.commits == 1);
+    CHECK(nvs().faults == 2);
+    device_config_t saved = reload();
+    CHECK(same(&saved, &cfg));
+
+    // NVS failing for ten minutes: the retries back off to one a minute, and updates meanwhile wait
+    // for the retry rather than hit the failing flash again.
+    config_service_stats_t s1 = svc();
+    host_nvs_inject_faults(0, UINT32_MAX);
+    cfg.color_temp = 7;
+    CHECK(config_service_update(&cfg) == ESP_OK);
+    for (int i = 0; i < 600; i++) {
+        if (i % 10 == 0) {
+            cfg.color_temp = (uint8_t)(i / 10);
+            CHECK(config_service_update(&cfg) == ESP_OK);
+        }
+        advance_ms(1000);
+    }
+    uint32_t errors = svc().commit_errors - s1.commit_errors;
+    CHECK(errors >= 10 && errors <= 16);
+    CHECK(nvs().faults - 2 == errors);
+    CHECK(config_service_is_dirty());
+
+    host_nvs_inject_faults(0, 0);
+    advance_ms(61 * 1000);
+    CHECK(!config_service_is_dirty());
+    saved = reload();
+    CHECK(same(&saved, &cfg));
+}
+
+static bool edit_color_temp(device_config_t *cfg, void *arg)
+{
+    uint8_t v = *(const uint8_t *)arg;
+    if (v > 100) {
+        return false;
+    }
+    cfg->color_temp = v;
+    return true;
+}
+
+static bool edit_alarm0_hour(device_config_t *cfg, void *arg)
+{
+    cfg->alarms[0].hour = *(const uint8_t *)arg;
+    return true;
+}
+
+// Edits of different fields from different writers apply to the service's copy, so neither
+// overwrites the other with a stale config; a rejected edit changes nothing.
+static void test_edit(void)
+{
+    device_config_t cfg;
+    start_service(&cfg);
+    config_service_stats_t s0 = svc();
+
+    uint8_t ct = 33;
+    uint8_t hour = 5;
+    CHECK(config_service_edit(edit_color_temp, &ct) == ESP_OK);
+    CHECK(config_service_edit(edit_alarm0_hour, &hour) == ESP_OK);
+    uint8_t bad = 101;
+    CHECK(config_service_edit(edit_color_temp, &bad) == ESP_ERR_INVALID_ARG);
+    CHECK(svc().updates - s0.updates == 2);
+
+    device_config_t now;
+    config_service_get(&now);
+    cfg.color_temp = 33;
+    cfg.alarms[0].hour = 5;
+    CHECK(same(&now, &cfg));
+
+    // Committed like an update, and an edit to the same value is not a change.
+    advance_ms(DELAY_MAX_MS);
+    CHECK(!config_service_is_dirty());
+    device_config_t saved = reload();
+    CHECK(same(&saved, &cfg));
+    CHECK(config_service_edit(edit_color_temp, &ct) == ESP_OK);
+    CHECK(!config_service_is_dirty());
+}
+
+// --- power loss --------------------------------------------------------------------------------
+
+// More than the NVS writes of any save or migration (record, seven legacy erases, commit).
+#define MAX_WRITE_STEPS (16)
+
+// Blank flash and the defaults the first boot writes to it.
+static device_config_t first_boot(void)
+{
+    fresh_nvs();
+    return reload();
+}
+
+// A config that differs from the defaults in every part of the blob, and from sample(base, n + 1).
+static device_config_t sample(const device_config_t *base, uint8_t n)
+{
+    device_config_t cfg = *base;
+    cfg.color_temp = (uint8_t)(10 + n);
+    cfg.wake_bright = (uint8_t)(90 - n);
+    device_alarm_t *a = &cfg.alarms[0];
+    *a = device_config_alarm_default();
+    a->hour = (uint8_t)(5 + n % 10);
+    a->minute = 30;
+    a->weekdays = 0x3E;
+    a->enabled = 1;
+    a->sunrise_duration = 30;
+    a->wake_bright = 80;
+    a = &cfg.alarms[3];
+    *a = device_config_alarm_default();
+    a->hour = 9;
+    a->minute = (uint8_t)(n % 60);
+    a->weekdays = 0x41;
+    a->enabled = 1;
+    a->sunrise_duration = 45;
+    a->wake_bright = 60;
+    a->date_year = 27;
+    a->date_month = 2;
+    a->date_day = 28;
+    memset(&cfg.presets[1], 0, sizeof(cfg.presets[1]));
+    snprintf(cfg.presets[1].name, sizeof(cfg.presets[1].name), "read%u", (unsigned)n);
+    cfg.presets[1].brightness = 70;
+    cfg.presets[1].color_temp = 80;
+    cfg.presets[1].fade_ds = 5;
+    cfg.skips[0] = (device_skip_t){.year = 26, .month = 12, .day = 25, .slots_lo = 0xFF, .slots_hi = 0xFF};
+    CHECK(device_config_is_valid(&cfg));
+    return cfg;
+}
+
+static bool nvs_has(const char *key)
+{
+    nvs_handle_t h;
+    if (nvs_open("cfg", NVS_READONLY, &h) != ESP_OK) {
+        return false;
+    }
+    size_t len = 0;
+    uint8_t v = 0;
+    bool found = nvs_get_blob(h, key, NULL, &len) == ESP_OK || nvs_get_u8(h, key, &v) == ESP_OK;
+    nvs_close(h);
+    return found;
+}
+
+// A save cut off by power loss after each of its NVS writes in turn, with the journal head in
+// either slot: the next boot loads the old config or the new one, never the defaults, and the
+// journal carries on from there.
+static void test_journal_power_cut(void)
+{
+    for (uint8_t gens = 1; gens <= 3; gens++) {
+        bool completed = false;
+        for (uint32_t cut = 0; cut < MAX_WRITE_STEPS && !completed; cut++) {
+            device_config_t def = first_boot();
+            device_config_t old = def;
+            for (uint8_t g = 1; g <= gens; g++) {
+                old = sample(&def, g);
+                CHECK(device_config_save(&old) == ESP_OK);
+            }
+            device_config_t next = sample(&def, 50);
+            uint32_t faults0 = nvs().faults;
+
+            host_nvs_inject_faults(cut, UINT32_MAX);
+            esp_err_t err = device_config_save(&next);
+            completed = nvs().faults == faults0;
+            host_nvs_inject_faults(0, 0);
+
+            device_config_t got = reload();
+            CHECK(same(&got, &old) || same(&got, &next));
+            CHECK(err != ESP_OK || same(&got, &next));
+            CHECK(!completed || err == ESP_OK);
+
+            next.wake_bright = 3;
+            CHECK(device_config_save(&next) == ESP_OK);
+            got = reload();
+            CHECK(same(&got, &next));
+        }
+        CHECK(completed);
+    }
+
+    // A damaged newest record (bit rot, a page torn below NVS) falls back to the one before it.
+    device_config_t def = first_boot();
+    device_config_t old = sample(&def, 1);
+    device_config_t next = sample(&def, 2);
+    CHECK(device_config_save(&old) == ESP_OK);
+    CHECK(device_config_save(&next) == ESP_OK);
+    // The first boot wrote cfg_a, so old went to cfg_b and next to cfg_a.
+    nvs_handle_t h;
+    CHECK(nvs_open("cfg", NVS_READWRITE, &h) == ESP_OK);
+    uint8_t rec[8 + DEVICE_CONFIG_IMAGE_MAX_LEN];
+    size_t len = sizeof(rec);
+    CHECK(nvs_get_blob(h, "cfg_a", rec, &len) == ESP_OK);
+    rec[len - 1] ^= 0x01;
+    CHECK(nvs_set_blob(h, "cfg_a", rec, len) == ESP_OK);
+    nvs_close(h);
+    device_config_t got = reload();
+    CHECK(same(&got, &old));
+}
+
+// Migration from an older layout cut off after each write in turn: every boot loads the migrated
+// config (never the defaults) until one completes, which leaves only the journal behind.
+static void migrate_with_power_cuts(void (*seed)(void), const char *const *old_keys, size_t old_key_count,
+                                    bool (*expected)(const device_config_t *cfg))
+{
+    bool completed = false;
+    for (uint32_t cut = 0; cut < MAX_WRITE_STEPS && !completed; cut++) {
+        fresh_nvs();
+        seed();
+        uint32_t faults0 = nvs().faults;
+
+        host_nvs_inject_faults(cut, UINT32_MAX);
+        device_config_t cfg;
+        (void)device_config_load(&cfg);
+        completed = nvs().faults == faults0;
+        host_nvs_inject_faults(0, 0);
+        CHECK(expected(&cfg));
+
+        device_config_t got = reload();
+        CHECK(expected(&got));
+        for (size_t k = 0; k < old_key_count; k++) {
+            CHECK(!nvs_has(old_keys[k]));
+        }
+        got = reload();
+        CHECK(expected(&got));
+    }
+    CHECK(completed);
+}
+
+static const char *const s_legacy_keys[] = {"alarm_h", "alarm_m", "alarm_e", "color_t", "wake_b", "sunrise"};
+
+// The per-field keys of the first firmware: 06:45 enabled, colour 30, brightness 80, 20 min sunrise.
+static void seed_legacy(void)
+{
+    const uint8_t values[] = {6, 45, 1, 30, 80, 20};
+    nvs_handle_t h;
+    CHECK(nvs_open("cfg", NVS_READWRITE, &h) == ESP_OK);
+    for (size_t k = 0; k < sizeof(values); k++) {
+        CHECK(nvs_set_u8(h, s_legacy_keys[k], values[k]) == ESP_OK);
+    }
+    CHECK(nvs_commit(h) == ESP_OK);
+    nvs_close(h);
+}
+
+static bool is_legacy_alarm(const device_config_t *cfg)
+{
+    const device_alarm_t *a = &cfg->alarms[0];
+    return a->hour == 6 && a->minute == 45 && a->enabled == 1 && a->sunrise_duration == 20 && cfg->color_temp == 30 &&
+           cfg->wake_bright == 80 && device_config_is_valid(cfg);
+}
+
+static void test_migrate_legacy_power_cut(void)
+{
+    migrate_with_power_cuts(seed_legacy, s_legacy_keys, sizeof(s_legacy_keys) / sizeof(s_legacy_keys[0]),
+                            is_legacy_alarm);
+}
+
+// The single-copy blob that came before the journal, in its first (v1) layout: the same config as
+// the legacy keys, as header magic "LC", version, payload length and CRC over the payload.
+static void seed_blob_v1(void)
+{
+    uint8_t blob[8 + 6] = {0x4C, 0x43, 1, 6, 0, 0, 0, 0, 6, 45, 1, 30, 80, 20};
+    uint32_t crc = esp_rom_crc32_le(0, &blob[8], 6);
+    for (int b = 0; b < 4; b++) {
+        blob[4 + b] = (uint8_t)(crc >> (8 * b));
+    }
+    nvs_handle_t h;
+    CHECK(nvs_open("cfg", NVS_READWRITE, &h) == ESP_OK);
+    CHECK(nvs_set_blob(h, "cfg_blob", blob, sizeof(blob)) == ESP_OK);
+    CHECK(nvs_commit(h) == ESP_OK);
+    nvs_close(h);
+}
+
+static device_config_t s_blob_cfg;
+
+// The same blob in the current layout, next to a stale legacy key a half-done earlier upgrade left.
+static void seed_blob_current(void)
+{
+    uint8_t image[DEVICE_CONFIG_IMAGE_MAX_LEN];
+    size_t len = device_config_export_image(&s_blob_cfg, image, sizeof(image));
+    CHECK(len > 0);
+    nvs_handle_t h;
+    CHECK(nvs_open("cfg", NVS_READWRITE, &h) == ESP_OK);
+    CHECK(nvs_set_blob(h, "cfg_blob", image, len) == ESP_OK);
+    CHECK(nvs_set_u8(h, "alarm_h", 23) == ESP_OK);
+    CHECK(nvs_commit(h) == ESP_OK);
+    nvs_close(h);
+}
+
+static bool is_blob_cfg(const device_config_t *cfg)
+{
+    return same(cfg, &s_blob_cfg);
+}
+
+static void test_migrate_blob_power_cut(void)
+{
+    static const char *const keys[] = {"cfg_blob", "alarm_h"};
+    migrate_with_power_cuts(seed_blob_v1, keys, 1, is_legacy_alarm);
+
+    device_config_t def = first_boot();
+    s_blob_cfg = sample(&def, 7);
+    migrate_with_power_cuts(seed_blob_current, keys, 2, is_blob_cfg);
+}
+
+// --- the config blob ---------------------------------------------------------------------------
+
+#define HDR_LEN (8)
+
+// Blob of the given version around payload: magic "LC", version, payload length (v1/v2 only), CRC.
+static size_t make_image(uint8_t version, const uint8_t *payload, size_t len, uint8_t *out)
+{
+    out[0] = 0x4C;
+    out[1] = 0x43;
+    out[2] = version;
+    out[3] = (version < 3) ? (uint8_t)len : 0;
+    memmove(&out[HDR_LEN], payload, len);
+    uint32_t crc = esp_rom_crc32_le(0, &out[HDR_LEN], (uint32_t)len);
+    for (int b = 0; b < 4; b++) {
+        out[4 + b] = (uint8_t)(crc >> (8 * b));
+    }
+    return HDR_LEN + len;
+}
+
+static esp_err_t import(const uint8_t *image, size_t len, device_config_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    return device_config_import_image(image, len, out);
+}
+
+// Defaults with one dated alarm in slot 0 and nothing else, so the v5 payload is, by offset:
+//   0 color_temp, 1 wake_bright, 2-3 used alarms (1), 4-7 packed alarm 0, 8 used presets (0),
+//   9 tz_zone, 10-11 dated alarms (1), 12-14 date of alarm 0, 15-16 skip_next, 17 used skips (0).
+#define LAYOUT_LEN (18)
+
+static device_config_t layout_cfg(const device_config_t *def)
+{
+    device_config_t cfg = *def;
+    for (size_t i = 0; i < DEVICE_CONFIG_MAX_ALARMS; i++) {
+        cfg.alarms[i] = device_config_alarm_default();
+    }
+    memset(cfg.presets, 0, sizeof(cfg.presets));
+    device_alarm_t *a = &cfg.alarms[0];
+    a->hour = 6;
+    a->minute = 15;
+    a->weekdays = 0x3E;
+    a->enabled = 1;
+    a->sunrise_duration = 25;
+    a->wake_bright = 70;
+    a->date_year = 27;
+    a->date_month = 2;
+    a->date_day = 28;
+    cfg.color_temp = 33;
+    cfg.wake_bright = 66;
+    cfg.tz_zone = 1;
+    return cfg;
+}
+
+// Every part of the blob round-trips, from an empty table to a full one.
+static void test_blob_round_trip(void)
+{
+    device_config_t def = first_boot();
+    device_config_t full = sample(&def, 1);
+    for (uint8_t i = 0; i < DEVICE_CONFIG_MAX_ALARMS; i++) {
+        device_alarm_t *a = &full.alarms[i];
+        a->hour = (uint8_t)(i + 4);
+        a->minute = (uint8_t)(i * 3);
+        a->weekdays = (uint8_t)(1u << (i % 7));
+        a->enabled = (uint8_t)(i & 1);
+        a->sunrise_duration = (uint8_t)(60 - i);
+        a->wake_bright = (uint8_t)(100 - i);
+        a->skip_next = (uint8_t)(i % 3 == 0);
+    }
+    for (uint8_t i = 0; i < DEVICE_CONFIG_MAX_PRESETS; i++) {
+        device_preset_t *p = &full.presets[i];
+        memset(p, 0, sizeof(*p));
+        memset(p->name, 'a' + i, DEVICE_PRESET_NAME_MAX);
+        p->brightness = (uint8_t)(i * 10);
+        p->color_temp = (uint8_t)(100 - i * 10);
+        p->curve = (uint8_t)(i % DEVICE_PRESET_CURVE_COUNT);
+        p->fade_ds = (uint8_t)(255 - i);
+    }
+    for (uint8_t i = 0; i < DEVICE_CONFIG_MAX_SKIPS; i++) {
+        full.skips[i] = (device_skip_t){.year = (uint8_t)(26 + i), .month = (uint8_t)(1 + i), .day = 28,
+                                        .slots_lo = (uint8_t)(1u << i), .slots_hi = 0x80};
+    }
+    CHECK(device_config_is_valid(&full));
+
+    const device_config_t cases[] = {def, layout_cfg(&def), sample(&def, 3), full};
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        uint8_t image[DEVICE_CONFIG_IMAGE_MAX_LEN];
+        size_t len = device_config_export_image(&cases[c], image, sizeof(image));
+        CHECK(len > HDR_LEN && image[2] == 5);
+        device_config_t got;
+        CHECK(import(image, len, &got) == ESP_OK);
+        CHECK(same(&got, &cases[c]));
+        // Through the journal as well.
+        CHECK(device_config_save(&cases[c]) == ESP_OK);
+        got = reload();
+        CHECK(same(&got, &cases[c]));
+    }
+    uint8_t image[DEVICE_CONFIG_IMAGE_MAX_LEN];
+    CHECK(device_config_export_image(&full, image, sizeof(image)) > 0);
+    CHECK(device_config_export_image(&full, image, 32) == 0);
+}
+
+// Images of every older layout decode to the current config with the fields they lack at their
+// defaults, and re-encode as v5.
+static void test_blob_upgrade(void)
+{
+    device_config_t def = first_boot();
+    device_config_t cfg = layout_cfg(&def);
+    uint8_t v5[DEVICE_CONFIG_IMAGE_MAX_LEN];
+    CHECK(device_config_export_image(&cfg, v5, sizeof(v5)) == HDR_LEN + LAYOUT_LEN);
+    const uint8_t *payload = &v5[HDR_LEN];
+
+    for (uint8_t version = 2; version <= 5; version++) {
+        // v2: the fixed part and the alarms, v3: + presets, v4: + tz_zone, v5: + dates and skips.
+        static const size_t lens[] = {0, 0, 8, 9, 10, LAYOUT_LEN};
+        device_config_t want = cfg;
+        if (version < 3) {
+            memcpy(want.presets, def.presets, sizeof(want.presets));
+        }
+        if (version < 4) {
+            want.tz_zone = def.tz_zone;
+        }
+        if (version < 5) {
+            device_alarm_t d = device_config_alarm_default();
+            want.alarms[0].date_year = d.date_year;
+            want.alarms[0].date_month = d.date_month;
+            want.alarms[0].date_day = d.date_day;
+        }
+        uint8_t image[DEVICE_CONFIG_IMAGE_MAX_LEN];
+        size_t len = make_image(version, payload, lens[version], image);
+        device_config_t got;
+        CHECK(import(image, len, &got) == ESP_OK);
+        CHECK(same(&got, &want));
+
+        uint8_t again[DEVICE_CONFIG_IMAGE_MAX_LEN];
+        size_t again_len = device_config_export_image(&got, again, sizeof(again));
+        CHECK(again_len > 0 && again[2] == 5);
+        device_config_t back;
+        CHECK(import(again, again_len, &back) == ESP_OK);
+        CHECK(same(&back, &want));
+    }
+
+    // v1: the single alarm of the first firmware, onto slot 0 of the defaults.
+    const uint8_t v1_payload[] = {6, 45, 1, 30, 80, 20};
+    uint8_t image[DEVICE_CONFIG_IMAGE_MAX_LEN];
+    size_t len = make_image(1, v1_payload, sizeof(v1_payload), image);
+    device_config_t got;
+    CHECK(import(image, len, &got) == ESP_OK);
+    CHECK(is_legacy_alarm(&got));
+    device_config_t want = def;
+    want.alarms[0].hour = 6;
+    want.alarms[0].minute = 45;
+    want.alarms[0].sunrise_duration = 20;
+    want.alarms[0].wake_bright = 80;
+    want.color_temp = 30;
+    want.wake_bright = 80;
+    CHECK(same(&got, &want));
+
+    // A v4 journal record (seq, CRC over seq and blob, blob) is rewritten as v5 by the first load.
+    fresh_nvs();
+    uint8_t rec[8 + DEVICE_CONFIG_IMAGE_MAX_LEN] = {1, 0, 0, 0};
+    size_t blob_len = make_image(4, payload, 10, &rec[8]);
+    uint32_t crc = esp_rom_crc32_le(esp_rom_crc32_le(0, rec, 4), &rec[8], (uint32_t)blob_len);
+    for (int b = 0; b < 4; b++) {
+        rec[4 + b] = (uint8_t)(crc >> (8 * b));
+    }
+    nvs_handle_t h;
+    CHECK(nvs_open("cfg", NVS_READWRITE, &h) == ESP_OK);
+    CHECK(nvs_set_blob(h, "cfg_a", rec, 8 + blob_len) == ESP_OK);
+    device_config_t loaded = reload();
+    size_t rec_len = sizeof(rec);
+    CHECK(nvs_get_blob(h, "cfg_b", rec, &rec_len) == ESP_OK && rec[8 + 2] == 5);
+    nvs_close(h);
+    CHECK(loaded.tz_zone == cfg.tz_zone && loaded.alarms[0].date_year == 0);
+    device_config_t again = reload();
+    CHECK(same(&again, &loaded));
+}
+
+// Each layout has exactly one length for its content: a byte more or less is refused, CRC or not.
+static void test_blob_length(void)
+{
+    device_config_t def = first_boot();
+    device_config_t cfg = layout_cfg(&def);
+    uint8_t v5[DEVICE_CONFIG_IMAGE_MAX_LEN];
+    CHECK(device_config_export_image(&cfg, v5, sizeof(v5)) == HDR_LEN + LAYOUT_LEN);
+    const uint8_t v1_payload[] = {6, 45, 1, 30, 80, 20};
+
+    static const size_t lens[] = {0, 6, 8, 9, 10, LAYOUT_LEN};
+    for (uint8_t version = 1; version <= 5; version++) {
+        uint8_t payload[LAYOUT_LEN + 1];
+        memcpy(payload, (version == 1) ? v1_payload : &v5[HDR_LEN], lens[version]);
+        payload[lens[version]] = 0;
+        uint8_t image[DEVICE_CONFIG_IMAGE_MAX_LEN];
+        device_config_t got;
+        CHECK(import(image, make_image(version, payload, lens[version], image), &got) == ESP_OK);
+        CHECK(import(image, make_image(version, payload, lens[version] + 1, image), &got) == ESP_ERR_INVALID_SIZE);
+        CHECK(import(image, make_image(version, payload, lens[version] - 1, image), &got) != ESP_OK);
+    }
+
+    // Trailing bytes after a full table too (the decoders of the variable parts stop at their end).
+    device_config_t full = sample(&def, 4);
+    uint8_t image[DEVICE_CONFIG_IMAGE_MAX_LEN];
+    size_t len = device_config_export_image(&full, image, sizeof(image));
+    uint8_t payload[DEVICE_CONFIG_IMAGE_MAX_LEN];
+    memcpy(payload, &image[HDR_LEN], len - HDR_LEN);
+    payload[len - HDR_LEN] = 0xA5;
+    device_config_t got;
+    CHECK(import(image, make_image(5, payload, len - HDR_LEN + 1, image), &got) == ESP_ERR_INVALID_SIZE);
+    CHECK(import(image, HDR_LEN - 1, &got) != ESP_OK);
+}
+
+// A well-formed blob with one field out of its schema range is refused as a whole.
+static void test_blob_ranges(void)
+{
+    device_config_t def = first_boot();
+    device_config_t cfg = layout_cfg(&def);
+    uint8_t v5[DEVICE_CONFIG_IMAGE_MAX_LEN];
+    CHECK(device_config_export_image(&cfg, v5, sizeof(v5)) == HDR_LEN + LAYOUT_LEN);
+
+    // Packed alarm 0 (payload 4-7): minute of day in bits 0-10, sunrise minutes in bits 19-24.
+    uint32_t packed = (uint32_t)v5[HDR_LEN + 4] | ((uint32_t)v5[HDR_LEN + 5] << 8) | ((uint32_t)v5[HDR_LEN + 6] << 16) |
+                      ((uint32_t)v5[HDR_LEN + 7] << 24);
+    const uint32_t bad_alarms[] = {
+        (packed & ~0x7FFu) | 1440,          // 24:00
+        packed & ~(0x3Fu << 19),            // sunrise 0 min
+        (packed & ~(0x3Fu << 19)) | (61u << 19), // sunrise 61 min
+        (packed & ~(0x7Fu << 25)) | (101u << 25), // peak brightness 101
+    };
+    const struct {
+        uint8_t off;
+        uint8_t value;
+    } bad_bytes[] = {
+        {0, 101},              // color_temp
+        {1, 101},              // wake_bright
+        {9, TZ_ZONE_COUNT},    // tz_zone
+        {12, 0},               // date year 0 with the alarm marked dated
+        {13, 13},              // date month
+        {13, 0},               // date month
+        {14, 29},              // 29 Feb 2027
+        {14, 0},               // date day
+    };
+
+    uint8_t image[DEVICE_CONFIG_IMAGE_MAX_LEN];
+    device_config_t got;
+    CHECK(import(v5, HDR_LEN + LAYOUT_LEN, &got) == ESP_OK);
+    for (size_t i = 0; i < sizeof(bad_bytes) / sizeof(bad_bytes[0]); i++) {
+        uint8_t payload[LAYOUT_LEN];
+        memcpy(payload, &v5[HDR_LEN], LAYOUT_LEN);
+        payload[bad_bytes[i].off] = bad_bytes[i].value;
+        esp_err_t err = import(image, make_image(5, payload, LAYOUT_LEN, image), &got);
+        // Year 0 means "not dated", which is legal; the rest are not.
+        CHECK(bad_bytes[i].off == 12 ? err == ESP_OK && got.alarms[0].date_year == 0 : err == ESP_ERR_INVALID_ARG);
+    }
+    for (size_t i = 0; i < sizeof(bad_alarms) / sizeof(bad_alarms[0]); i++) {
+        uint8_t payload[LAYOUT_LEN];
+        memcpy(payload, &v5[HDR_LEN], LAYOUT_LEN);
+        for (int b = 0; b < 4; b++) {
+            payload[4 + b] = (uint8_t)(bad_alarms[i] >> (8 * b));
+        }
+        CHECK(import(image, make_image(5, payload, LAYOUT_LEN, image), &got) == ESP_ERR_INVALID_ARG);
+    }
+
+    // A preset with a curve past the last one, and a skip date in month 13.
+    device_config_t p = cfg;
+    strcpy(p.presets[0].name, "x");
+    p.presets[0].brightness = 50;
+    p.presets[0].color_temp = 50;
+    size_t len = device_config_export_image(&p, image, sizeof(image));
+    // used presets, then brightness, color_temp, curve: payload 8, 9, 10, 11.
+    uint8_t payload[DEVICE_CONFIG_IMAGE_MAX_LEN];
+    memcpy(payload, &image[HDR_LEN], len - HDR_LEN);
+    CHECK(payload[8] == 1 && payload[9] == 50);
+    payload[11] = DEVICE_PRESET_CURVE_COUNT;
+    CHECK(import(image, make_image(5, payload, len - HDR_LEN, image), &got) == ESP_ERR_INVALID_ARG);
+
+    device_config_t k = cfg;
+    k.skips[0] = (device_skip_t){.year = 26, .month = 6, .day = 1, .slots_lo = 0xFF, .slots_hi = 0xFF};
+    len = device_config_export_image(&k, image, sizeof(image));
+    memcpy(payload, &image[HDR_LEN], len - HDR_LEN);
+    // The skip entry is the last 5 bytes: year, month, day, slots.
+    CHECK(payload[len - HDR_LEN - 4] == 6);
+    payload[len - HDR_LEN - 4] = 13;
+    CHECK(import(image, make_image(5, payload, len - HDR_LEN, image), &got) == ESP_ERR_INVALID_ARG);
+}
+
+static const struct {
+    const char *name;
+    void (*run)(void);
+} s_cases[] = {
+    {"coalesce", test_coalesce},
+    {"max_defer", test_max_defer},
+    {"commit_retry", test_commit_retry},
+    {"edit", test_edit},
+    {"journal_power_cut", test_journal_power_cut},
+    {"migrate_legacy_power_cut", test_migrate_legacy_power_cut},
+    {"migrate_blob_power_cut", test_migrate_blob_power_cut},
+    {"blob_round_trip", test_blob_round_trip},
+    {"blob_upgrade", test_blob_upgrade},
+    {"blob_length", test_blob_length},
+    {"blob_ranges", test_blob_ranges},
+};
+#define CASE_COUNT (sizeof(s_cases) / sizeof(s_cases[0]))
+
+static int run_case(size_t i)
+{
+    int before = s_failed;
+    s_cases[i].run();
+    printf("%s %s\n", s_failed == before ? "PASS" : "FAIL", s_cases[i].name);
+    return s_failed - before;
+}
+
+int main(int argc, char **argv)
+{
+    esp_log_level_set("*", ESP_LOG_NONE);
+    int first = 1;
+    if (argc > 1 && strcmp(argv[1], "-v") == 0) {
+        esp_log_level_set("*", ESP_LOG_INFO);
+        first = 2;
+    }
+    if (timer_wheel_init() != ESP_OK) {
+        fprintf(stderr, "timer_wheel_init failed\n");
+        return 1;
+    }
+
+    if (first == argc) {
+        for (size_t i = 0; i < CASE_COUNT; i++) {
+            run_case(i);
+        }
+    }
+    for (int a = first; a < argc; a++) {
+        size_t i = 0;
+        while (i < CASE_COUNT && strcmp(argv[a], s_cases[i].name) != 0) {
+            i++;
+        }
+        if (i == CASE_COUNT) {
+            fprintf(stderr, "unknown case %s; cases:", argv[a]);
+            for (size_t k = 0; k < CASE_COUNT; k++) {
+                fprintf(stderr, " %s", s_cases[k].name);
+            }
+            fprintf(stderr, "\n");
+            return 2;
+        }
+        run_case(i);
+    }
+    return s_failed ? 1 : 0;
+}
@@ -0,0 +1,833 @@
+#include "fake_bluedroid.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_bt.h"
+#include "esp_bt_main.h"
+#include "esp_gap_ble_api.h"
+#include "esp_gatt_common_api.h"
+#include "esp_gatts_api.h"
+
+#include "host_clock.h"
+
+// First handle of an app's service: the stack's GAP and GATT services sit below it.
+#define FAKE_FIRST_SERVICE_HANDLE (40)
+// gatts_if handed to the first registered app, as Bluedroid does.
+#define FAKE_FIRST_GATTS_IF       (3)
+#define FAKE_MAX_SERVICES         (4)
+
+typedef enum {
+    STATE_OFF = 0,
+    STATE_INITED,
+    STATE_ENABLED,
+} fake_state_t;
+
+typedef struct {
+    bool gap;
+    int event; // esp_gap_ble_cb_event_t or esp_gatts_cb_event_t
+    union {
+        esp_ble_gap_cb_param_t gap;
+        esp_ble_gatts_cb_param_t gatts;
+    } param;
+    uint8_t value[ESP_GATT_MAX_ATTR_LEN]; // write payload; param.gatts.write.value points here when run
+} fake_event_t;
+
+typedef struct {
+    uint32_t trans_id;
+    uint16_t conn_id;
+    bool need_rsp;
+    bool delivered;
+    fake_bluedroid_rsp_t rsp;
+} fake_request_t;
+
+typedef struct {
+    uint16_t handle;
+    uint16_t end;  // last handle of the num_handle budget
+    uint16_t next; // next free handle
+} fake_service_t;
+
+static fake_state_t s_ctrl;
+static fake_state_t s_host;
+static esp_gap_ble_cb_t s_gap_cb;
+static esp_gatts_cb_t s_gatts_cb;
+static esp_gatt_if_t s_gatts_if = ESP_GATT_IF_NONE;
+
+static fake_event_t s_queue[FAKE_BLUEDROID_QUEUE_LEN];
+static size_t s_head;
+static size_t s_count;
+static bool s_pump_scheduled;
+
+static fake_request_t s_requests[FAKE_BLUEDROID_QUEUE_LEN];
+static uint32_t s_next_trans_id = 1;
+
+static fake_service_t s_services[FAKE_MAX_SERVICES];
+static size_t s_service_count;
+static uint16_t s_next_handle = FAKE_FIRST_SERVICE_HANDLE;
+static fake_bluedroid_attr_t s_attrs[FAKE_BLUEDROID_MAX_ATTRS];
+static size_t s_attr_count;
+
+static esp_bd_addr_t s_peer;
+static uint16_t s_next_conn_id;
+static uint32_t s_adv_fails;
+static fake_bluedroid_stats_t s_stats = {.mtu = ESP_GATT_DEF_BLE_MTU_SIZE};
+
+// --- event queue -------------------------------------------------------------------------------
+
+static bool pump_stimulus(void *arg)
+{
+    (void)arg;
+    s_pump_scheduled = false;
+    // The BTC task runs: the CPU is awake for it.
+    (void)fake_bluedroid_run();
+    return true;
+}
+
+static fake_event_t *push(bool gap, int event)
+{
+    if (s_count == FAKE_BLUEDROID_QUEUE_LEN) {
+        fprintf(stderr, "fake_bluedroid: event queue full\n");
+        return NULL;
+    }
+    fake_event_t *e = &s_queue[(s_head + s_count) % FAKE_BLUEDROID_QUEUE_LEN];
+    s_count++;
+    memset(e, 0, offsetof(fake_event_t, value));
+    e->gap = gap;
+    e->event = event;
+    if (!s_pump_scheduled) {
+        s_pump_scheduled = host_clock_at(host_clock_now_us(), pump_stimulus, NULL);
+    }
+    return e;
+}
+
+static void push_gap_status(esp_gap_ble_cb_event_t event, esp_bt_status_t status)
+{
+    fake_event_t *e = push(true, event);
+    if (e) {
+        // Every *_cmpl parameter is a lone status.
+        e->param.gap.adv_start_cmpl.status = status;
+    }
+}
+
+size_t fake_bluedroid_run(void)
+{
+    size_t n = 0;
+    while (s_count > 0) {
+        // Copied out: the callback may queue more, and reuse this slot.
+        fake_event_t ev = s_queue[s_head];
+        s_head = (s_head + 1) % FAKE_BLUEDROID_QUEUE_LEN;
+        s_count--;
+        if (s_host != STATE_ENABLED) {
+            continue;
+        }
+        if (ev.gap) {
+            if (s_gap_cb) {
+                s_gap_cb((esp_gap_ble_cb_event_t)ev.event, &ev.param.gap);
+                n++;
+            }
+        } else if (s_gatts_cb) {
+            if (ev.event == ESP_GATTS_WRITE_EVT) {
+                ev.param.gatts.write.value = ev.value;
+                fake_request_t *r = &s_requests[ev.param.gatts.write.trans_id % FAKE_BLUEDROID_QUEUE_LEN];
+                r->delivered = (r->trans_id == ev.param.gatts.write.trans_id);
+            } else if (ev.event == ESP_GATTS_READ_EVT) {
+                fake_request_t *r = &s_requests[ev.param.gatts.read.trans_id % FAKE_BLUEDROID_QUEUE_LEN];
+                r->delivered = (r->trans_id == ev.param.gatts.read.trans_id);
+            }
+            s_gatts_cb((esp_gatts_cb_event_t)ev.event, s_gatts_if, &ev.param.gatts);
+            n++;
+        }
+    }
+    s_stats.events += (uint32_t)n;
+    return n;
+}
+
+void fake_bluedroid_reset(void)
+{
+    s_ctrl = STATE_OFF;
+    s_host = STATE_OFF;
+    s_gap_cb = NULL;
+    s_gatts_cb = NULL;
+    s_gatts_if = ESP_GATT_IF_NONE;
+    s_head = 0;
+    s_count = 0;
+    // A pump already on the clock stays there and finds the queue empty.
+    memset(s_requests, 0, sizeof(s_requests));
+    s_next_trans_id = 1;
+    s_service_count = 0;
+    s_next_handle = FAKE_FIRST_SERVICE_HANDLE;
+    s_attr_count = 0;
+    memset(s_peer, 0, sizeof(s_peer));
+    s_next_conn_id = 0;
+    s_adv_fails = 0;
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_stats.mtu = ESP_GATT_DEF_BLE_MTU_SIZE;
+}
+
+// Bluedroid down: the link, advertising, the apps and their attribute tables go with it.
+static void host_down(void)
+{
+    s_head = 0;
+    s_count = 0;
+    s_gatts_if = ESP_GATT_IF_NONE;
+    s_service_count = 0;
+    s_next_handle = FAKE_FIRST_SERVICE_HANDLE;
+    s_attr_count = 0;
+    s_stats.app_registered = false;
+    s_stats.service_started = false;
+    s_stats.advertising = false;
+    s_stats.connected = false;
+    s_stats.enabled = false;
+    s_stats.mtu = ESP_GATT_DEF_BLE_MTU_SIZE;
+}
+
+// --- controller and host bring-up --------------------------------------------------------------
+
+esp_err_t esp_bt_controller_mem_release(esp_bt_mode_t mode)
+{
+    (void)mode;
+    return s_ctrl == STATE_OFF ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t esp_bt_controller_init(esp_bt_controller_config_t *cfg)
+{
+    if (!cfg) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_ctrl != STATE_OFF) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_ctrl = STATE_INITED;
+    return ESP_OK;
+}
+
+esp_err_t esp_bt_controller_deinit(void)
+{
+    if (s_ctrl != STATE_INITED) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_ctrl = STATE_OFF;
+    return ESP_OK;
+}
+
+esp_err_t esp_bt_controller_enable(esp_bt_mode_t mode)
+{
+    if (s_ctrl != STATE_INITED || !(mode & ESP_BT_MODE_BLE)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_ctrl = STATE_ENABLED;
+    return ESP_OK;
+}
+
+esp_err_t esp_bt_controller_disable(void)
+{
+    if (s_ctrl != STATE_ENABLED || s_host != STATE_OFF) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_ctrl = STATE_INITED;
+    return ESP_OK;
+}
+
+esp_err_t esp_bluedroid_init(void)
+{
+    if (s_ctrl != STATE_ENABLED || s_host != STATE_OFF) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_host = STATE_INITED;
+    return ESP_OK;
+}
+
+esp_err_t esp_bluedroid_deinit(void)
+{
+    if (s_host != STATE_INITED) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_host = STATE_OFF;
+    s_gap_cb = NULL;
+    s_gatts_cb = NULL;
+    return ESP_OK;
+}
+
+esp_err_t esp_bluedroid_enable(void)
+{
+    if (s_host != STATE_INITED) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_host = STATE_ENABLED;
+    s_stats.enabled = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_bluedroid_disable(void)
+{
+    if (s_host != STATE_ENABLED) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_host = STATE_INITED;
+    host_down();
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gatt_set_local_mtu(uint16_t mtu)
+{
+    if (s_host != STATE_ENABLED) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return (mtu < ESP_GATT_DEF_BLE_MTU_SIZE || mtu > ESP_GATT_MAX_MTU_SIZE) ? ESP_ERR_INVALID_ARG : ESP_OK;
+}
+
+// --- GAP ---------------------------------------------------------------------------------------
+
+esp_err_t esp_ble_gap_register_callback(esp_gap_ble_cb_t callback)
+{
+    if (s_host != STATE_ENABLED) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_gap_cb = callback;
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_set_device_name(const char *name)
+{
+    if (s_host != STATE_ENABLED) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!name || strlen(name) >= sizeof(s_stats.device_name)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    strcpy(s_stats.device_name, name);
+    return ESP_OK;
+}
+
+static esp_err_t config_raw(uint8_t *raw, uint32_t len, uint8_t *dst, uint8_t *dst_len, esp_gap_ble_cb_event_t done)
+{
+    if (s_host != STATE_ENABLED) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (len != 0 && !raw) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_bt_status_t status = ESP_BT_STATUS_PARM_INVALID;
+    if (len <= ESP_BLE_ADV_DATA_LEN_MAX) {
+        memcpy(dst, raw, len);
+        *dst_len = (uint8_t)len;
+        status = ESP_BT_STATUS_SUCCESS;
+    }
+    push_gap_status(done, status);
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_config_adv_data_raw(uint8_t *raw_data, uint32_t raw_data_len)
+{
+    return config_raw(raw_data, raw_data_len, s_stats.adv_data, &s_stats.adv_data_len,
+                      ESP_GAP_BLE_ADV_DATA_RAW_SET_COMPLETE_EVT);
+}
+
+esp_err_t esp_ble_gap_config_scan_rsp_data_raw(uint8_t *raw_data, uint32_t raw_data_len)
+{
+    return config_raw(raw_data, raw_data_len, s_stats.scan_rsp, &s_stats.scan_rsp_len,
+                      ESP_GAP_BLE_SCAN_RSP_DATA_RAW_SET_COMPLETE_EVT);
+}
+
+esp_err_t esp_ble_gap_start_advertising(esp_ble_adv_params_t *adv_params)
+{
+    if (s_host != STATE_ENABLED) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!adv_params) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_stats.adv_starts++;
+    // Starting while advertising restarts with the new parameters.
+    esp_bt_status_t status = ESP_BT_STATUS_SUCCESS;
+    if (adv_params->adv_int_min < 0x20 || adv_params->adv_int_max > 0x4000 ||
+        adv_params->adv_int_min > adv_params->adv_int_max || adv_params->channel_map == 0) {
+        status = ESP_BT_STATUS_PARM_INVALID;
+    } else if (s_adv_fails > 0) {
+        s_adv_fails--;
+        status = ESP_BT_STATUS_FAIL;
+    }
+    s_stats.advertising = (status == ESP_BT_STATUS_SUCCESS);
+    push_gap_status(ESP_GAP_BLE_ADV_START_COMPLETE_EVT, status);
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_stop_advertising(void)
+{
+    if (s_host != STATE_ENABLED) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_stats.adv_stops++;
+    s_stats.advertising = false;
+    push_gap_status(ESP_GAP_BLE_ADV_STOP_COMPLETE_EVT, ESP_BT_STATUS_SUCCESS);
+    return ESP_OK;
+}
+
+static void drop_link(esp_gatt_conn_reason_t reason)
+{
+    s_stats.connected = false;
+    s_stats.mtu = ESP_GATT_DEF_BLE_MTU_SIZE;
+    fake_event_t *e = push(false, ESP_GATTS_DISCONNECT_EVT);
+    if (e) {
+        e->param.gatts.disconnect.conn_id = s_stats.conn_id;
+        memcpy(e->param.gatts.disconnect.remote_bda, s_peer, sizeof(esp_bd_addr_t));
+        e->param.gatts.disconnect.reason = reason;
+    }
+}
+
+esp_err_t esp_ble_gap_disconnect(esp_bd_addr_t remote_device)
+{
+    if (s_host != STATE_ENABLED) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (s_stats.connected && memcmp(remote_device, s_peer, sizeof(esp_bd_addr_t)) == 0) {
+        drop_link(ESP_GATT_CONN_TERMINATE_LOCAL_HOST);
+    }
+    return ESP_OK;
+}
+
+void fake_bluedroid_fail_adv_starts(uint32_t n)
+{
+    s_adv_fails = n;
+}
+
+void fake_bluedroid_stop_adv(void)
+{
+    if (s_host == STATE_ENABLED && s_stats.advertising) {
+        s_stats.advertising = false;
+        push_gap_status(ESP_GAP_BLE_ADV_STOP_COMPLETE_EVT, ESP_BT_STATUS_SUCCESS);
+    }
+}
+
+// --- GATT server -------------------------------------------------------------------------------
+
+esp_err_t esp_ble_gatts_register_callback(esp_gatts_cb_t callback)
+{
+    if (s_host != STATE_ENABLED) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_gatts_cb = callback;
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gatts_app_register(uint16_t app_id)
+{
+    if (s_host != STATE_ENABLED) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (app_id > 0x7fff) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    // One app: a second registration fails in its event.
+    fake_event_t *e = push(false, ESP_GATTS_REG_EVT);
+    if (!e) {
+        return ESP_FAIL;
+    }
+    e->param.gatts.reg.app_id = app_id;
+    if (s_stats.app_registered) {
+        e->param.gatts.reg.status = ESP_GATT_NO_RESOURCES;
+    } else {
+        e->param.gatts.reg.status = ESP_GATT_OK;
+        s_gatts_if = FAKE_FIRST_GATTS_IF;
+        s_stats.app_registered = true;
+    }
+    return ESP_OK;
+}
+
+static fake_service_t *find_service(uint16_t handle)
+{
+    for (size_t i = 0; i < s_service_count; i++) {
+        if (s_services[i].handle == handle) {
+            return &s_services[i];
+        }
+    }
+    return NULL;
+}
+
+esp_err_t esp_ble_gatts_create_service(esp_gatt_if_t gatts_if, esp_gatt_srvc_id_t *service_id, uint16_t num_handle)
+{
+    if (s_host != STATE_ENABLED) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!service_id) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    fake_event_t *e = push(false, ESP_GATTS_CREATE_EVT);
+    if (!e) {
+        return ESP_FAIL;
+    }
+    e->param.gatts.create.service_id = *service_id;
+    if (gatts_if != s_gatts_if || num_handle == 0 || s_service_count == FAKE_MAX_SERVICES) {
+        e->param.gatts.create.status = ESP_GATT_ERROR;
+        return ESP_OK;
+    }
+    fake_service_t *svc = &s_services[s_service_count++];
+    svc->handle = s_next_handle;
+    svc->end = (uint16_t)(s_next_handle + num_handle - 1);
+    svc->next = (uint16_t)(s_next_handle + 1);
+    s_next_handle = (uint16_t)(svc->end + 1);
+    e->param.gatts.create.status = ESP_GATT_OK;
+    e->param.gatts.create.service_handle = svc->handle;
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gatts_start_service(uint16_t service_handle)
+{
+    if (s_host != STATE_ENABLED) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    fake_event_t *e = push(false, ESP_GATTS_START_EVT);
+    if (!e) {
+        return ESP_FAIL;
+    }
+    e->param.gatts.start.service_handle = service_handle;
+    if (find_service(service_handle)) {
+        e->param.gatts.start.status = ESP_GATT_OK;
+        s_stats.service_started = true;
+    } else {
+        e->param.gatts.start.status = ESP_GATT_INVALID_HANDLE;
+    }
+    return ESP_OK;
+}
+
+// Takes n handles from the service's budget; 0 if it has run out.
+static uint16_t alloc_handles(fake_service_t *svc, uint16_t n)
+{
+    if (!svc || (uint32_t)svc->next + n - 1 > svc->end || s_attr_count == FAKE_BLUEDROID_MAX_ATTRS) {
+        return 0;
+    }
+    uint16_t first = svc->next;
+    svc->next = (uint16_t)(svc->next + n);
+    return first;
+}
+
+static uint16_t uuid16_of(const esp_bt_uuid_t *uuid)
+{
+    return uuid->len == ESP_UUID_LEN_16 ? uuid->uuid.uuid16 : 0;
+}
+
+esp_err_t esp_ble_gatts_add_char(uint16_t service_handle, esp_bt_uuid_t *char_uuid, esp_gatt_perm_t perm,
+                                 esp_gatt_char_prop_t property, esp_attr_value_t *char_val,
+                                 esp_attr_control_t *control)
+{
+    (void)control; // only ESP_GATT_RSP_BY_APP attributes are modelled
+    if (s_host != STATE_ENABLED) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!char_uuid || (char_val && char_val->attr_len > char_val->attr_max_len)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    fake_event_t *e = push(false, ESP_GATTS_ADD_CHAR_EVT);
+    if (!e) {
+        return ESP_FAIL;
+    }
+    e->param.gatts.add_char.service_handle = service_handle;
+    e->param.gatts.add_char.char_uuid = *char_uuid;
+    fake_service_t *svc = find_service(service_handle);
+    // Declaration, then value.
+    uint16_t decl = alloc_handles(svc, 2);
+    if (!decl) {
+        e->param.gatts.add_char.status = svc ? ESP_GATT_NO_RESOURCES : ESP_GATT_INVALID_HANDLE;
+        return ESP_OK;
+    }
+    fake_bluedroid_attr_t *a = &s_attrs[s_attr_count++];
+    *a = (fake_bluedroid_attr_t){
+        .handle = (uint16_t)(decl + 1),
+        .uuid16 = uuid16_of(char_uuid),
+        .char_uuid16 = uuid16_of(char_uuid),
+        .perm = perm,
+        .prop = property,
+    };
+    e->param.gatts.add_char.status = ESP_GATT_OK;
+    e->param.gatts.add_char.attr_handle = a->handle;
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gatts_add_char_descr(uint16_t service_handle, esp_bt_uuid_t *descr_uuid, esp_gatt_perm_t perm,
+                                       esp_attr_value_t *char_descr_val, esp_attr_control_t *control)
+{
+    (void)control;
+    if (s_host != STATE_ENABLED) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!descr_uuid || (char_descr_val && char_descr_val->attr_len > char_descr_val->attr_max_len)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    fake_event_t *e = push(false, ESP_GATTS_ADD_CHAR_DESCR_EVT);
+    if (!e) {
+        return ESP_FAIL;
+    }
+    e->param.gatts.add_char_descr.service_handle = service_handle;
+    e->param.gatts.add_char_descr.descr_uuid = *descr_uuid;
+    // A descriptor belongs to the characteristic added last.
+    const fake_bluedroid_attr_t *owner = NULL;
+    for (size_t i = s_attr_count; i-- > 0 && !owner;) {
+        if (!s_attrs[i].is_descr) {
+            owner = &s_attrs[i];
+        }
+    }
+    fake_service_t *svc = find_service(service_handle);
+    uint16_t handle = owner ? alloc_handles(svc, 1) : 0;
+    if (!handle) {
+        e->param.gatts.add_char_descr.status = !svc ? ESP_GATT_INVALID_HANDLE : owner ? ESP_GATT_NO_RESOURCES : ESP_GATT_ERROR;
+        return ESP_OK;
+    }
+    fake_bluedroid_attr_t *a = &s_attrs[s_attr_count++];
+    *a = (fake_bluedroid_attr_t){
+        .handle = handle,
+        .uuid16 = uuid16_of(descr_uuid),
+        .char_uuid16 = owner->char_uuid16,
+        .perm = perm,
+        .is_descr = true,
+    };
+    e->param.gatts.add_char_descr.status = ESP_GATT_OK;
+    e->param.gatts.add_char_descr.attr_handle = handle;
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gatts_send_response(esp_gatt_if_t gatts_if, uint16_t conn_id, uint32_t trans_id,
+                                      esp_gatt_status_t status, esp_gatt_rsp_t *rsp)
+{
+    if (s_host != STATE_ENABLED) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    fake_request_t *r = &s_requests[trans_id % FAKE_BLUEDROID_QUEUE_LEN];
+    if (r->trans_id != trans_id || !r->delivered || !r->need_rsp || r->rsp.answered || r->conn_id != conn_id ||
+        gatts_if != s_gatts_if) {
+        s_stats.bad_responses++;
+        return ESP_OK;
+    }
+    r->rsp.answered = true;
+    r->rsp.status = status;
+    if (rsp && status == ESP_GATT_OK) {
+        uint16_t len = rsp->attr_value.len;
+        if (len > ESP_GATT_MAX_ATTR_LEN) {
+            len = ESP_GATT_MAX_ATTR_LEN;
+        }
+        if (len > s_stats.mtu - 1) {
+            len = (uint16_t)(s_stats.mtu - 1);
+        }
+        memcpy(r->rsp.value, rsp->attr_value.value, len);
+        r->rsp.len = len;
+    }
+    s_stats.responses++;
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gatts_send_indicate(esp_gatt_if_t gatts_if, uint16_t conn_id, uint16_t attr_handle,
+                                      uint16_t value_len, uint8_t *value, bool need_confirm)
+{
+    (void)need_confirm;
+    if (s_host != STATE_ENABLED) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (value_len > 0 && !value) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    fake_event_t *e = push(false, ESP_GATTS_CONF_EVT);
+    if (!e) {
+        return ESP_FAIL;
+    }
+    e->param.gatts.conf.conn_id = conn_id;
+    e->param.gatts.conf.handle = attr_handle;
+    if (!s_stats.connected || conn_id != s_stats.conn_id || gatts_if != s_gatts_if) {
+        e->param.gatts.conf.status = ESP_GATT_ERROR;
+        return ESP_OK;
+    }
+    if (value_len > s_stats.mtu - 3) {
+        value_len = (uint16_t)(s_stats.mtu - 3);
+    }
+    e->param.gatts.conf.status = ESP_GATT_OK;
+    s_stats.indications++;
+    s_stats.last_indication_handle = attr_handle;
+    s_stats.last_indication_len = value_len;
+    memcpy(s_stats.last_indication, value, value_len);
+    return ESP_OK;
+}
+
+// --- the central -------------------------------------------------------------------------------
+
+bool fake_bluedroid_connect(const uint8_t bda[6])
+{
+    if (s_host != STATE_ENABLED || !s_stats.app_registered || s_stats.connected || !s_stats.advertising) {
+        return false;
+    }
+    fake_event_t *e = push(false, ESP_GATTS_CONNECT_EVT);
+    if (!e) {
+        return false;
+    }
+    memcpy(s_peer, bda, sizeof(esp_bd_addr_t));
+    s_stats.advertising = false;
+    s_stats.connected = true;
+    s_stats.conn_id = s_next_conn_id++;
+    s_stats.connects++;
+    e->param.gatts.connect.conn_id = s_stats.conn_id;
+    e->param.gatts.connect.link_role = 1; // peripheral
+    memcpy(e->param.gatts.connect.remote_bda, bda, sizeof(esp_bd_addr_t));
+    return true;
+}
+
+bool fake_bluedroid_disconnect(esp_gatt_conn_reason_t reason)
+{
+    if (s_host != STATE_ENABLED || !s_stats.connected) {
+        return false;
+    }
+    drop_link(reason);
+    return true;
+}
+
+bool fake_bluedroid_set_mtu(uint16_t mtu)
+{
+    if (!s_stats.connected || mtu < ESP_GATT_DEF_BLE_MTU_SIZE || mtu > ESP_GATT_MAX_MTU_SIZE) {
+        return false;
+    }
+    fake_event_t *e = push(false, ESP_GATTS_MTU_EVT);
+    if (!e) {
+        return false;
+    }
+    s_stats.mtu = mtu;
+    e->param.gatts.mtu.conn_id = s_stats.conn_id;
+    e->param.gatts.mtu.mtu = mtu;
+    return true;
+}
+
+static const fake_bluedroid_attr_t *find_attr(uint16_t handle)
+{
+    for (size_t i = 0; i < s_attr_count; i++) {
+        if (s_attrs[i].handle == handle) {
+            return &s_attrs[i];
+        }
+    }
+    return NULL;
+}
+
+static fake_request_t *new_request(bool need_rsp)
+{
+    uint32_t id = s_next_trans_id++;
+    fake_request_t *r = &s_requests[id % FAKE_BLUEDROID_QUEUE_LEN];
+    memset(r, 0, sizeof(*r));
+    r->trans_id = id;
+    r->conn_id = s_stats.conn_id;
+    r->need_rsp = need_rsp;
+    s_stats.requests++;
+    return r;
+}
+
+// Permission checks the stack does before the app sees the request. True if it answered.
+static bool refused_by_stack(fake_request_t *r, const fake_bluedroid_attr_t *a, esp_gatt_perm_t need,
+                             esp_gatt_status_t refusal)
+{
+    esp_gatt_status_t st = !a ? ESP_GATT_INVALID_HANDLE : !(a->perm & need) ? refusal : ESP_GATT_OK;
+    if (st == ESP_GATT_OK) {
+        return false;
+    }
+    r->rsp.answered = r->need_rsp;
+    r->rsp.by_stack = true;
+    r->rsp.status = st;
+    return true;
+}
+
+uint32_t fake_bluedroid_write(uint16_t handle, const void *data, size_t len, bool need_rsp)
+{
+    if (!s_stats.connected || len > (size_t)(s_stats.mtu - 3) || (len > 0 && !data)) {
+        return 0;
+    }
+    fake_request_t *r = new_request(need_rsp);
+    if (refused_by_stack(r, find_attr(handle), ESP_GATT_PERM_WRITE, ESP_GATT_WRITE_NOT_PERMIT)) {
+        return r->trans_id;
+    }
+    fake_event_t *e = push(false, ESP_GATTS_WRITE_EVT);
+    if (!e) {
+        return 0;
+    }
+    e->param.gatts.write.conn_id = s_stats.conn_id;
+    e->param.gatts.write.trans_id = r->trans_id;
+    memcpy(e->param.gatts.write.bda, s_peer, sizeof(esp_bd_addr_t));
+    e->param.gatts.write.handle = handle;
+    e->param.gatts.write.need_rsp = need_rsp;
+    e->param.gatts.write.len = (uint16_t)len;
+    if (len > 0) {
+        memcpy(e->value, data, len);
+    }
+    return r->trans_id;
+}
+
+uint32_t fake_bluedroid_read(uint16_t handle, uint16_t offset)
+{
+    if (!s_stats.connected) {
+        return 0;
+    }
+    fake_request_t *r = new_request(true);
+    if (refused_by_stack(r, find_attr(handle), ESP_GATT_PERM_READ, ESP_GATT_READ_NOT_PERMIT)) {
+        return r->trans_id;
+    }
+    fake_event_t *e = push(false, ESP_GATTS_READ_EVT);
+    if (!e) {
+        return 0;
+    }
+    e->param.gatts.read.conn_id = s_stats.conn_id;
+    e->param.gatts.read.trans_id = r->trans_id;
+    memcpy(e->param.gatts.read.bda, s_peer, sizeof(esp_bd_addr_t));
+    e->param.gatts.read.handle = handle;
+    e->param.gatts.read.offset = offset;
+    e->param.gatts.read.is_long = (offset > 0);
+    e->param.gatts.read.need_rsp = true;
+    return r->trans_id;
+}
+
+bool fake_bluedroid_response(uint32_t trans_id, fake_bluedroid_rsp_t *out)
+{
+    const fake_request_t *r = &s_requests[trans_id % FAKE_BLUEDROID_QUEUE_LEN];
+    if (trans_id == 0 || r->trans_id != trans_id) {
+        return false;
+    }
+    if (out) {
+        *out = r->rsp;
+    }
+    return true;
+}
+
+// --- lookups and stats -------------------------------------------------------------------------
+
+size_t fake_bluedroid_attrs(const fake_bluedroid_attr_t **out)
+{
+    if (out) {
+        *out = s_attrs;
+    }
+    return s_attr_count;
+}
+
+uint16_t fake_bluedroid_char_handle(uint16_t uuid16)
+{
+    for (size_t i = 0; i < s_attr_count; i++) {
+        if (!s_attrs[i].is_descr && s_attrs[i].uuid16 == uuid16) {
+            return s_attrs[i].handle;
+        }
+    }
+    return 0;
+}
+
+uint16_t fake_bluedroid_descr_handle(uint16_t char_uuid16, uint16_t descr_uuid16)
+{
+    for (size_t i = 0; i < s_attr_count; i++) {
+        if (s_attrs[i].is_descr && s_attrs[i].char_uuid16 == char_uuid16 && s_attrs[i].uuid16 == descr_uuid16) {
+            return s_attrs[i].handle;
+        }
+    }
+    return 0;
+}
+
+void fake_bluedroid_get_stats(fake_bluedroid_stats_t *out)
+{
+    if (!out) {
+        return;
+    }
+    *out = s_stats;
+    out->unanswered = 0;
+    for (size_t i = 0; i < FAKE_BLUEDROID_QUEUE_LEN; i++) {
+        const fake_request_t *r = &s_requests[i];
+        if (r->trans_id && r->delivered && r->need_rsp && !r->rsp.answered) {
+            out->unanswered++;
+        }
+    }
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_gatt_defs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Host stand-in for Bluedroid behind esp_bt.h, esp_bt_main.h, esp_gap_ble_api.h and esp_gatts_api.h
+// (host/include), so the real main/ble_alarm.c runs on the host against a scripted central.
+//
+// Calls complete as on the stack: the call returns at once and its completion event
+// (ESP_GATTS_CREATE_EVT, ESP_GAP_BLE_ADV_START_COMPLETE_EVT, ...) is queued for the BTC task. The
+// central's side below (connect, write, read) queues events the same way. The queue is FIFO and one
+// callback runs at a time; events queued from a callback go to the back. It drains on
+// fake_bluedroid_run() or, as the BTC task would, when the virtual clock (host_clock.h) passes the
+// instant the first of them was queued. Which callback runs when is therefore fixed by the script.
+//
+// The stack's own checks are kept where the firmware relies on them: handles come out of the
+// service's num_handle budget, a request on an attribute without the permission is answered by the
+// stack (no event), a value too long for the MTU is not sent, read responses are cut to MTU - 1 (the
+// central continues with Read Blob), a central can only connect while advertising, and each request
+// wants exactly one response.
+
+#define FAKE_BLUEDROID_QUEUE_LEN (256)
+#define FAKE_BLUEDROID_MAX_ATTRS (64)
+
+// Back to power-on: controller off, no callbacks, no attributes, nothing queued, stats cleared.
+void fake_bluedroid_reset(void);
+
+// Runs queued callbacks until the queue is empty; returns how many ran.
+size_t fake_bluedroid_run(void);
+
+// --- the central -------------------------------------------------------------------------------
+
+// Connects (only while advertising; the controller stops advertising without an event) or drops the
+// link. False if that is not possible in the current state.
+bool fake_bluedroid_connect(const uint8_t bda[6]);
+bool fake_bluedroid_disconnect(esp_gatt_conn_reason_t reason);
+
+// MTU exchange (23..517), ESP_GATTS_MTU_EVT. Lasts until the link drops.
+bool fake_bluedroid_set_mtu(uint16_t mtu);
+
+// Write Request (need_rsp) or Write Command, and Read / Read Blob (offset > 0) of an attribute handle.
+// Returns the transaction id to look the response up by, 0 if nothing was sent (no link, or a value
+// longer than MTU - 3, which would take a prepared write). Requests the stack refuses itself get an
+// id too.
+uint32_t fake_bluedroid_write(uint16_t handle, const void *data, size_t len, bool need_rsp);
+uint32_t fake_bluedroid_read(uint16_t handle, uint16_t offset);
+
+typedef struct {
+    bool answered;
+    bool by_stack; // refused by the stack, the app never saw it
+    esp_gatt_status_t status;
+    uint16_t len; // read: value bytes as sent (at most MTU - 1)
+    uint8_t value[ESP_GATT_MAX_ATTR_LEN];
+} fake_bluedroid_rsp_t;
+
+// Response to one of the last FAKE_BLUEDROID_QUEUE_LEN requests; false if the id is not among them.
+bool fake_bluedroid_response(uint32_t trans_id, fake_bluedroid_rsp_t *out);
+
+// --- the controller ----------------------------------------------------------------------------
+
+// The next n advertising starts complete with ESP_BT_STATUS_FAIL.
+void fake_bluedroid_fail_adv_starts(uint32_t n);
+
+// Advertising stops without being asked (ESP_GAP_BLE_ADV_STOP_COMPLETE_EVT).
+void fake_bluedroid_stop_adv(void);
+
+// --- the attribute table -----------------------------------------------------------------------
+
+typedef struct {
+    uint16_t handle;      // characteristic value or descriptor
+    uint16_t uuid16;      // 0 for 32/128-bit UUIDs
+    uint16_t char_uuid16; // descriptor: its characteristic; characteristic: uuid16
+    esp_gatt_perm_t perm;
+    esp_gatt_char_prop_t prop; // 0 for descriptors
+    bool is_descr;
+} fake_bluedroid_attr_t;
+
+// Attributes in the order they were added; returns the count.
+size_t fake_bluedroid_attrs(const fake_bluedroid_attr_t **out);
+// Handle of a characteristic's value / one of its descriptors, 0 if not registered.
+uint16_t fake_bluedroid_char_handle(uint16_t uuid16);
+uint16_t fake_bluedroid_descr_handle(uint16_t char_uuid16, uint16_t descr_uuid16);
+
+// --- what the stack saw ------------------------------------------------------------------------
+
+typedef struct {
+    bool enabled;         // Bluedroid up
+    bool app_registered;
+    bool service_started;
+    bool advertising;     // controller state, not what the app believes
+    bool connected;
+    uint16_t conn_id;     // current or last link
+    uint16_t mtu;
+    uint32_t events;      // callbacks run
+    uint32_t adv_starts;  // esp_ble_gap_start_advertising() calls
+    uint32_t adv_stops;   // esp_ble_gap_stop_advertising() calls
+    uint32_t connects;
+    uint32_t requests;    // reads and writes from the central
+    uint32_t responses;   // esp_ble_gatts_send_response() calls matched to a request
+    uint32_t bad_responses; // unknown, already answered or unwanted trans_id, or the wrong conn_id/gatts_if
+    uint32_t unanswered;  // requests wanting a response the app saw and did not answer (recent ones)
+    uint32_t indications; // notifications/indications sent on the link
+    uint16_t last_indication_handle;
+    uint16_t last_indication_len;
+    uint8_t last_indication[ESP_GATT_MAX_ATTR_LEN];
+    char device_name[32];
+    uint8_t adv_data_len;
+    uint8_t adv_data[31];
+    uint8_t scan_rsp_len;
+    uint8_t scan_rsp[31];
+} fake_bluedroid_stats_t;
+
+void fake_bluedroid_get_stats(fake_bluedroid_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,103 @@
+#include <stdlib.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include "host_clock.h"
+
+// The one task: app_main. Timer callbacks run inside its blocking calls (host_clock.h).
+struct host_task {
+    volatile uint32_t notify;
+};
+
+struct host_semaphore {
+    int held;
+};
+
+static struct host_task s_main_task;
+
+static int64_t ticks_to_deadline(TickType_t ticks)
+{
+    if (ticks == portMAX_DELAY) {
+        return INT64_MAX;
+    }
+    return host_clock_now_us() + (int64_t)ticks * portTICK_PERIOD_MS * 1000;
+}
+
+void vPortEnterCritical(portMUX_TYPE *mux)
+{
+    mux->depth++;
+}
+
+void vPortExitCritical(portMUX_TYPE *mux)
+{
+    if (mux->depth <= 0) {
+        abort();
+    }
+    mux->depth--;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    host_clock_run_until(ticks_to_deadline(ticks));
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(host_clock_now_us() / (1000 * portTICK_PERIOD_MS));
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return &s_main_task;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    if (task) {
+        task->notify++;
+    }
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait)
+{
+    struct host_task *task = &s_main_task;
+    (void)host_clock_run_until_woken(ticks_to_deadline(ticks_to_wait), &task->notify);
+    uint32_t count = task->notify;
+    if (count) {
+        task->notify = clear_on_exit ? 0 : count - 1;
+    }
+    return count;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return calloc(1, sizeof(struct host_semaphore));
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks_to_wait)
+{
+    (void)ticks_to_wait;
+    if (!sem) {
+        return pdFALSE;
+    }
+    // No other task can hold it: a callback run from a blocking call nests inside the holder.
+    sem->held++;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    if (!sem || sem->held <= 0) {
+        return pdFALSE;
+    }
+    sem->held--;
+    return pdTRUE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+    free(sem);
+}
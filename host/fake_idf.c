@@ -0,0 +1,201 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "esp_system.h"
+
+#include "host_clock.h"
+#include "host_idf.h"
+
+#define HOST_MAX_SHUTDOWN_HANDLERS 8
+#define HOST_MAX_PARTITIONS        4
+
+static esp_log_level_t s_log_level = ESP_LOG_INFO;
+static FILE *s_log_out;
+static uint64_t s_log_bytes;
+static shutdown_handler_t s_shutdown[HOST_MAX_SHUTDOWN_HANDLERS];
+static esp_partition_t s_parts[HOST_MAX_PARTITIONS];
+static size_t s_part_count;
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+    case ESP_OK: return "ESP_OK";
+    case ESP_FAIL: return "ESP_FAIL";
+    case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_INVALID_RESPONSE: return "ESP_ERR_INVALID_RESPONSE";
+    case ESP_ERR_INVALID_CRC: return "ESP_ERR_INVALID_CRC";
+    case ESP_ERR_INVALID_VERSION: return "ESP_ERR_INVALID_VERSION";
+    case ESP_ERR_INVALID_MAC: return "ESP_ERR_INVALID_MAC";
+    case ESP_ERR_NOT_FINISHED: return "ESP_ERR_NOT_FINISHED";
+    case ESP_ERR_NVS_NOT_INITIALIZED: return "ESP_ERR_NVS_NOT_INITIALIZED";
+    case ESP_ERR_NVS_NOT_FOUND: return "ESP_ERR_NVS_NOT_FOUND";
+    case ESP_ERR_NVS_TYPE_MISMATCH: return "ESP_ERR_NVS_TYPE_MISMATCH";
+    case ESP_ERR_NVS_READ_ONLY: return "ESP_ERR_NVS_READ_ONLY";
+    case ESP_ERR_NVS_NOT_ENOUGH_SPACE: return "ESP_ERR_NVS_NOT_ENOUGH_SPACE";
+    case ESP_ERR_NVS_INVALID_NAME: return "ESP_ERR_NVS_INVALID_NAME";
+    case ESP_ERR_NVS_INVALID_HANDLE: return "ESP_ERR_NVS_INVALID_HANDLE";
+    case ESP_ERR_NVS_INVALID_LENGTH: return "ESP_ERR_NVS_INVALID_LENGTH";
+    case ESP_ERR_NVS_NO_FREE_PAGES: return "ESP_ERR_NVS_NO_FREE_PAGES";
+    case ESP_ERR_NVS_NEW_VERSION_FOUND: return "ESP_ERR_NVS_NEW_VERSION_FOUND";
+    default: return "UNKNOWN ERROR";
+    }
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+    if (tag && strcmp(tag, "*") == 0) {
+        s_log_level = level;
+    }
+}
+
+uint32_t esp_log_timestamp(void)
+{
+    return (uint32_t)(host_clock_now_us() / 1000);
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    (void)tag;
+    if (level > s_log_level) {
+        return;
+    }
+    va_list ap;
+    va_start(ap, format);
+    int n = vfprintf(s_log_out ? s_log_out : stdout, format, ap);
+    va_end(ap);
+    if (n > 0) {
+        s_log_bytes += (uint64_t)n;
+    }
+}
+
+void esp_log_buffer_hex_internal(const char *tag, const void *buffer, uint16_t buff_len, esp_log_level_t level)
+{
+    static const char letters[] = "NEWIDV";
+    if (level > s_log_level || level == ESP_LOG_NONE) {
+        return;
+    }
+    const uint8_t *p = buffer;
+    for (uint16_t off = 0; off < buff_len; off += 16) {
+        char line[16 * 3 + 1];
+        size_t n = 0;
+        for (uint16_t i = off; i < buff_len && i < off + 16; i++) {
+            n += (size_t)snprintf(&line[n], sizeof(line) - n, "%02x ", p[i]);
+        }
+        line[n ? n - 1 : 0] = 0;
+        esp_log_write(level, tag, "%c (%lu) %s: %s\n", letters[level], (unsigned long)esp_log_timestamp(), tag, line);
+    }
+}
+
+void host_log_set_output(FILE *out)
+{
+    s_log_out = out;
+}
+
+uint64_t host_log_bytes(void)
+{
+    return s_log_bytes;
+}
+
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len)
+{
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; i++) {
+        crc ^= buf[i];
+        for (int b = 0; b < 8; b++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
+
+esp_err_t esp_register_shutdown_handler(shutdown_handler_t handle)
+{
+    for (size_t i = 0; i < HOST_MAX_SHUTDOWN_HANDLERS; i++) {
+        if (s_shutdown[i] == handle) {
+            return ESP_ERR_INVALID_STATE;
+        }
+        if (!s_shutdown[i]) {
+            s_shutdown[i] = handle;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+esp_err_t esp_unregister_shutdown_handler(shutdown_handler_t handle)
+{
+    for (size_t i = 0; i < HOST_MAX_SHUTDOWN_HANDLERS; i++) {
+        if (s_shutdown[i] == handle) {
+            memmove(&s_shutdown[i], &s_shutdown[i + 1], (HOST_MAX_SHUTDOWN_HANDLERS - i - 1) * sizeof(s_shutdown[0]));
+            s_shutdown[HOST_MAX_SHUTDOWN_HANDLERS - 1] = NULL;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_INVALID_STATE;
+}
+
+void esp_restart(void)
+{
+    // Last registered runs first, as in IDF.
+    for (size_t i = HOST_MAX_SHUTDOWN_HANDLERS; i-- > 0;) {
+        if (s_shutdown[i]) {
+            s_shutdown[i]();
+        }
+    }
+    host_clock_stop("esp_restart");
+}
+
+esp_err_t host_partition_add(esp_partition_type_t type, esp_partition_subtype_t subtype, const char *label,
+                             const uint8_t *data, size_t size)
+{
+    if (!label || !data || s_part_count >= HOST_MAX_PARTITIONS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_partition_t *p = &s_parts[s_part_count++];
+    *p = (esp_partition_t){.type = type, .subtype = subtype, .size = (uint32_t)size, .host_data = data};
+    strncpy(p->label, label, sizeof(p->label) - 1);
+    return ESP_OK;
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label)
+{
+    for (size_t i = 0; i < s_part_count && i < HOST_MAX_PARTITIONS; i++) {
+        const esp_partition_t *p = &s_parts[i];
+        if ((type == ESP_PARTITION_TYPE_ANY || p->type == type) &&
+            (subtype == ESP_PARTITION_SUBTYPE_ANY || p->subtype == subtype) &&
+            (!label || strcmp(p->label, label) == 0)) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+esp_err_t esp_partition_mmap(const esp_partition_t *partition, size_t offset, size_t size,
+                             esp_partition_mmap_memory_t memory, const void **out_ptr,
+                             esp_partition_mmap_handle_t *out_handle)
+{
+    (void)memory;
+    if (!partition || !out_ptr || !out_handle || offset + size > partition->size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out_ptr = partition->host_data + offset;
+    *out_handle = 1;
+    return ESP_OK;
+}
+
+void esp_partition_munmap(esp_partition_mmap_handle_t handle)
+{
+    (void)handle;
+}
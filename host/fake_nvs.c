@@ -0,0 +1,480 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nvs.h"
+#include "nvs_flash.h"
+
+#include "host_idf.h"
+#include "host_trace.h"
+
+// In-memory NVS. Entry accounting follows the flash layout closely enough for storage_telemetry:
+// a value takes one 32-byte entry plus one per 32 data bytes, an overwrite or erase leaves the old
+// entries erased until a full page of them is reclaimed, and total_entries matches the 0x6000 "nvs"
+// partition in partitions.csv.
+#define HOST_NVS_PAGES            6
+#define HOST_NVS_ENTRIES_PER_PAGE 126
+#define HOST_NVS_TOTAL_ENTRIES    (HOST_NVS_PAGES * HOST_NVS_ENTRIES_PER_PAGE)
+#define HOST_NVS_KEY_MAX          16 // including NUL, as NVS_KEY_NAME_MAX_SIZE
+#define HOST_NVS_MAX_ITEMS        64
+#define HOST_NVS_MAX_NAMESPACES   16
+#define HOST_NVS_MAX_HANDLES      16
+
+typedef enum {
+    ITEM_U8 = 1,
+    ITEM_BLOB,
+} item_type_t;
+
+typedef struct {
+    bool used;
+    uint8_t ns;
+    item_type_t type;
+    char key[HOST_NVS_KEY_MAX];
+    uint8_t *data;
+    size_t len;
+} item_t;
+
+typedef struct {
+    bool open;
+    bool writable;
+    uint8_t ns;
+} handle_t;
+
+static bool s_inited;
+static char s_ns[HOST_NVS_MAX_NAMESPACES][HOST_NVS_KEY_MAX];
+static size_t s_ns_count;
+static item_t s_items[HOST_NVS_MAX_ITEMS];
+static handle_t s_handles[HOST_NVS_MAX_HANDLES];
+static size_t s_used_entries;
+static size_t s_erased_entries;
+static host_nvs_stats_t s_stats;
+static uint32_t s_fault_after; // writes still to succeed before the faults start
+static uint32_t s_fault_count; // writes to fail once they do; UINT32_MAX: all of them
+
+static size_t span_of(size_t len)
+{
+    return 1 + (len + 31) / 32;
+}
+
+static size_t free_entries(void)
+{
+    return HOST_NVS_TOTAL_ENTRIES - s_used_entries - s_erased_entries;
+}
+
+// Takes n entries, reclaiming erased ones a page at a time when the free space runs out.
+static esp_err_t alloc_entries(size_t n)
+{
+    while (free_entries() < n) {
+        if (s_erased_entries == 0) {
+            return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+        }
+        s_erased_entries -= (s_erased_entries < HOST_NVS_ENTRIES_PER_PAGE) ? s_erased_entries : HOST_NVS_ENTRIES_PER_PAGE;
+    }
+    s_used_entries += n;
+    return ESP_OK;
+}
+
+static void release_entries(size_t n)
+{
+    s_used_entries -= n;
+    s_erased_entries += n;
+}
+
+// Consumes one write from the fault plan; true if this one fails.
+static bool write_faults(void)
+{
+    if (s_fault_count == 0) {
+        return false;
+    }
+    if (s_fault_after > 0) {
+        s_fault_after--;
+        return false;
+    }
+    if (s_fault_count != UINT32_MAX) {
+        s_fault_count--;
+    }
+    s_stats.faults++;
+    return true;
+}
+
+static bool key_ok(const char *key)
+{
+    return key && key[0] && strlen(key) < HOST_NVS_KEY_MAX;
+}
+
+static handle_t *get_handle(nvs_handle_t h)
+{
+    if (h == 0 || h > HOST_NVS_MAX_HANDLES || !s_handles[h - 1].open) {
+        return NULL;
+    }
+    return &s_handles[h - 1];
+}
+
+static item_t *find(uint8_t ns, const char *key)
+{
+    for (size_t i = 0; i < HOST_NVS_MAX_ITEMS; i++) {
+        if (s_items[i].used && s_items[i].ns == ns && strcmp(s_items[i].key, key) == 0) {
+            return &s_items[i];
+        }
+    }
+    return NULL;
+}
+
+static void drop(item_t *it)
+{
+    release_entries(span_of(it->len));
+    free(it->data);
+    memset(it, 0, sizeof(*it));
+}
+
+static esp_err_t put(nvs_handle_t h, const char *key, item_type_t type, const void *value, size_t len)
+{
+    handle_t *hd = get_handle(h);
+    if (!hd) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    if (!hd->writable) {
+        return ESP_ERR_NVS_READ_ONLY;
+    }
+    if (!key_ok(key)) {
+        return ESP_ERR_NVS_INVALID_NAME;
+    }
+    item_t *old = find(hd->ns, key);
+    if (old && old->type == type && old->len == len && memcmp(old->data, value, len) == 0) {
+        return ESP_OK; // NVS skips rewriting an identical value
+    }
+    if (write_faults()) {
+        return ESP_FAIL;
+    }
+    uint8_t *copy = malloc(len ? len : 1);
+    if (!copy) {
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(copy, value, len);
+    if (old) {
+        drop(old);
+    }
+    item_t *slot = NULL;
+    for (size_t i = 0; i < HOST_NVS_MAX_ITEMS && !slot; i++) {
+        if (!s_items[i].used) {
+            slot = &s_items[i];
+        }
+    }
+    esp_err_t err = slot ? alloc_entries(span_of(len)) : ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    if (err != ESP_OK) {
+        free(copy);
+        return err;
+    }
+    *slot = (item_t){.used = true, .ns = hd->ns, .type = type, .data = copy, .len = len};
+    strcpy(slot->key, key);
+    s_stats.writes++;
+    s_stats.bytes += (uint32_t)len;
+    host_trace("nvs", "set %s/%s %u B", s_ns[hd->ns], key, (unsigned)len);
+    return ESP_OK;
+}
+
+static esp_err_t get(nvs_handle_t h, const char *key, item_type_t type, item_t **out)
+{
+    handle_t *hd = get_handle(h);
+    if (!hd) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    if (!key_ok(key)) {
+        return ESP_ERR_NVS_INVALID_NAME;
+    }
+    item_t *it = find(hd->ns, key);
+    if (!it) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (it->type != type) {
+        return ESP_ERR_NVS_TYPE_MISMATCH;
+    }
+    *out = it;
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_init(void)
+{
+    s_inited = true;
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void)
+{
+    for (size_t i = 0; i < HOST_NVS_MAX_ITEMS; i++) {
+        free(s_items[i].data);
+    }
+    memset(s_items, 0, sizeof(s_items));
+    memset(s_ns, 0, sizeof(s_ns));
+    s_ns_count = 0;
+    s_used_entries = 0;
+    s_erased_entries = 0;
+    s_inited = false;
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *namespace_name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    if (!s_inited) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+    if (!key_ok(namespace_name) || !out_handle) {
+        return ESP_ERR_NVS_INVALID_NAME;
+    }
+    size_t ns = 0;
+    while (ns < s_ns_count && strcmp(s_ns[ns], namespace_name) != 0) {
+        ns++;
+    }
+    if (ns == s_ns_count) {
+        if (open_mode == NVS_READONLY) {
+            return ESP_ERR_NVS_NOT_FOUND;
+        }
+        if (s_ns_count >= HOST_NVS_MAX_NAMESPACES || alloc_entries(1) != ESP_OK) {
+            return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+        }
+        strcpy(s_ns[s_ns_count++], namespace_name);
+    }
+    for (size_t i = 0; i < HOST_NVS_MAX_HANDLES; i++) {
+        if (!s_handles[i].open) {
+            s_handles[i] = (handle_t){.open = true, .writable = (open_mode == NVS_READWRITE), .ns = (uint8_t)ns};
+            *out_handle = (nvs_handle_t)(i + 1);
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+    handle_t *hd = get_handle(handle);
+    if (hd) {
+        hd->open = false;
+    }
+}
+
+esp_err_t nvs_set_u8(nvs_handle_t handle, const char *key, uint8_t value)
+{
+    return put(handle, key, ITEM_U8, &value, 1);
+}
+
+esp_err_t nvs_get_u8(nvs_handle_t handle, const char *key, uint8_t *out_value)
+{
+    item_t *it = NULL;
+    esp_err_t err = get(handle, key, ITEM_U8, &it);
+    if (err == ESP_OK && out_value) {
+        *out_value = it->data[0];
+    }
+    return err;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    if (!value && length) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return put(handle, key, ITEM_BLOB, value, length);
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length)
+{
+    if (!length) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    item_t *it = NULL;
+    esp_err_t err = get(handle, key, ITEM_BLOB, &it);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (!out_value) {
+        *length = it->len;
+        return ESP_OK;
+    }
+    if (*length < it->len) {
+        *length = it->len;
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    memcpy(out_value, it->data, it->len);
+    *length = it->len;
+    return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+    handle_t *hd = get_handle(handle);
+    if (!hd) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    if (!hd->writable) {
+        return ESP_ERR_NVS_READ_ONLY;
+    }
+    item_t *it = key_ok(key) ? find(hd->ns, key) : NULL;
+    if (!it) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (write_faults()) {
+        return ESP_FAIL;
+    }
+    drop(it);
+    s_stats.writes++;
+    host_trace("nvs", "erase %s/%s", s_ns[hd->ns], key);
+    return ESP_OK;
+}
+
+esp_err_t nvs_erase_all(nvs_handle_t handle)
+{
+    handle_t *hd = get_handle(handle);
+    if (!hd) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    if (!hd->writable) {
+        return ESP_ERR_NVS_READ_ONLY;
+    }
+    if (write_faults()) {
+        return ESP_FAIL;
+    }
+    for (size_t i = 0; i < HOST_NVS_MAX_ITEMS; i++) {
+        if (s_items[i].used && s_items[i].ns == hd->ns) {
+            host_trace("nvs", "erase %s/%s", s_ns[hd->ns], s_items[i].key);
+            drop(&s_items[i]);
+            s_stats.writes++;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    if (!get_handle(handle)) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    if (write_faults()) {
+        return ESP_FAIL;
+    }
+    s_stats.commits++;
+    host_trace("nvs", "commit");
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_stats(const char *part_name, nvs_stats_t *nvs_stats)
+{
+    (void)part_name;
+    if (!nvs_stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_inited) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+    *nvs_stats = (nvs_stats_t){
+        .used_entries = s_used_entries,
+        .free_entries = free_entries(),
+        .available_entries = free_entries() > HOST_NVS_ENTRIES_PER_PAGE ? free_entries() - HOST_NVS_ENTRIES_PER_PAGE : 0,
+        .total_entries = HOST_NVS_TOTAL_ENTRIES,
+        .namespace_count = s_ns_count,
+    };
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_used_entry_count(nvs_handle_t handle, size_t *used_entries)
+{
+    handle_t *hd = get_handle(handle);
+    if (!hd || !used_entries) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    size_t n = 0;
+    for (size_t i = 0; i < HOST_NVS_MAX_ITEMS; i++) {
+        if (s_items[i].used && s_items[i].ns == hd->ns) {
+            n += span_of(s_items[i].len);
+        }
+    }
+    *used_entries = n;
+    return ESP_OK;
+}
+
+void host_nvs_inject_faults(uint32_t after, uint32_t count)
+{
+    s_fault_after = after;
+    s_fault_count = count;
+}
+
+void host_nvs_get_stats(host_nvs_stats_t *out)
+{
+    if (!out) {
+        return;
+    }
+    *out = s_stats;
+    out->entries = 0;
+    for (size_t i = 0; i < HOST_NVS_MAX_ITEMS; i++) {
+        out->entries += s_items[i].used ? 1 : 0;
+    }
+}
+
+// File format: per item "namespace\0key\0" type(u8) len(u32 LE) data.
+esp_err_t host_nvs_save(const char *path)
+{
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        return ESP_FAIL;
+    }
+    for (size_t i = 0; i < HOST_NVS_MAX_ITEMS; i++) {
+        const item_t *it = &s_items[i];
+        if (!it->used) {
+            continue;
+        }
+        uint8_t hdr[5] = {(uint8_t)it->type, (uint8_t)it->len, (uint8_t)(it->len >> 8), (uint8_t)(it->len >> 16),
+                          (uint8_t)(it->len >> 24)};
+        fwrite(s_ns[it->ns], 1, strlen(s_ns[it->ns]) + 1, f);
+        fwrite(it->key, 1, strlen(it->key) + 1, f);
+        fwrite(hdr, 1, sizeof(hdr), f);
+        fwrite(it->data, 1, it->len, f);
+    }
+    return fclose(f) == 0 ? ESP_OK : ESP_FAIL;
+}
+
+static bool read_str(FILE *f, char *out)
+{
+    for (size_t i = 0; i < HOST_NVS_KEY_MAX; i++) {
+        int c = fgetc(f);
+        if (c == EOF) {
+            return false;
+        }
+        out[i] = (char)c;
+        if (c == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+esp_err_t host_nvs_load(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    (void)nvs_flash_erase();
+    (void)nvs_flash_init();
+    esp_err_t err = ESP_OK;
+    char ns[HOST_NVS_KEY_MAX];
+    char key[HOST_NVS_KEY_MAX];
+    while (err == ESP_OK && read_str(f, ns)) {
+        uint8_t hdr[5];
+        if (!read_str(f, key) || fread(hdr, 1, sizeof(hdr), f) != sizeof(hdr)) {
+            err = ESP_ERR_INVALID_SIZE;
+            break;
+        }
+        size_t len = (size_t)hdr[1] | ((size_t)hdr[2] << 8) | ((size_t)hdr[3] << 16) | ((size_t)hdr[4] << 24);
+        uint8_t *buf = malloc(len ? len : 1);
+        nvs_handle_t h;
+        if (!buf || fread(buf, 1, len, f) != len) {
+            err = ESP_ERR_INVALID_SIZE;
+        } else if ((err = nvs_open(ns, NVS_READWRITE, &h)) == ESP_OK) {
+            err = put(h, key, (item_type_t)hdr[0], buf, len);
+            nvs_close(h);
+        }
+        free(buf);
+    }
+    fclose(f);
+    s_stats = (host_nvs_stats_t){0};
+    return err;
+}
@@ -0,0 +1,598 @@
+#include "hal_host.h"
+
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "esp_log.h"
+
+#include "host_clock.h"
+#include "host_trace.h"
+
+static const char *TAG = "HAL";
+
+// LEDC on the APB clock: 80 MHz divided by a Q8 divider of at least 1.0 per duty step.
+#define HAL_HOST_APB_HZ      80000000ULL
+#define HAL_HOST_ADC_FULL_MV 3100 // 11 dB, 12-bit
+#define HAL_HOST_ADC_MAX_RAW 4095
+
+typedef struct {
+    bool configured;
+    hal_gpio_mode_t mode;
+    hal_gpio_pull_t pull;
+    int out;
+    int drive; // -1: not driven externally
+    uint32_t edges;
+    // Time spent reading high, accounted up to since_us at every change.
+    int level;
+    int64_t since_us;
+    int64_t high_us;
+} pin_t;
+
+typedef struct {
+    hal_gpio_t pin;
+    uint32_t duty;
+    // Fade programmed by hal_pwm_set_fade(), taken over by hal_pwm_fade_start().
+    uint32_t prog_target;
+    uint32_t prog_fade_ms;
+    // Fade running.
+    uint32_t target;
+    uint32_t fade_ms;
+    uint32_t from;
+    int64_t start_us;
+    bool fading;
+    uint32_t fades;
+    // Output integrated up to acc_us.
+    int64_t acc_us;
+    int64_t on_us;
+    double full_s; // full-duty-equivalent seconds
+} pwm_ch_t;
+
+typedef struct {
+    int mv;
+    hal_gpio_t en_pin;
+    int en_level;
+} adc_in_t;
+
+static pin_t s_pins[HAL_HOST_GPIO_COUNT];
+static bool s_pins_init;
+static uint32_t s_pwm_freq;
+static uint32_t s_pwm_bits;
+static pwm_ch_t s_pwm[HAL_HOST_PWM_CHANNELS];
+static adc_in_t s_adc[HAL_HOST_GPIO_COUNT];
+static bool s_adc_calibrated = true;
+static int64_t s_rtc_base_ms;
+static int64_t s_rtc_base_mono_us;
+static int32_t s_rtc_ppm;
+static uint32_t s_adc_reads;
+static uint32_t s_pwm_calls;
+static hal_host_pwm_observer_t s_pwm_observer;
+
+// Bit-banged I2C on a watched pin pair, decoded back into transfers.
+static struct {
+    hal_gpio_t sda;
+    hal_gpio_t scl;
+    hal_host_i2c_cb_t cb;
+    int last_sda;
+    int last_scl;
+    bool active;
+    int bits;
+    uint8_t cur;
+    uint8_t buf[HAL_HOST_I2C_MAX_XFER];
+    size_t len;
+} s_i2c = {.sda = -1, .scl = -1};
+
+static const char *const s_mode_names[] = {"in", "out", "out_od", "inout_od"};
+static const char *const s_pull_names[] = {"none", "up", "down"};
+
+static pin_t *pin_at(hal_gpio_t pin)
+{
+    if (!s_pins_init) {
+        for (int i = 0; i < HAL_HOST_GPIO_COUNT; i++) {
+            s_pins[i].drive = -1;
+            s_adc[i].en_pin = -1;
+        }
+        s_pins_init = true;
+    }
+    return (pin >= 0 && pin < HAL_HOST_GPIO_COUNT) ? &s_pins[pin] : NULL;
+}
+
+static bool is_i2c_pin(hal_gpio_t pin)
+{
+    return pin == s_i2c.sda || pin == s_i2c.scl;
+}
+
+static void i2c_sample(void)
+{
+    int sda = hal_host_gpio_level(s_i2c.sda);
+    int scl = hal_host_gpio_level(s_i2c.scl);
+    if (scl && s_i2c.last_scl && sda != s_i2c.last_sda) {
+        if (!sda) {
+            // START (or repeated START)
+            s_i2c.active = true;
+            s_i2c.bits = 0;
+            s_i2c.len = 0;
+        } else if (s_i2c.active) {
+            // STOP
+            s_i2c.active = false;
+            if (host_trace_enabled()) {
+                char hex[HAL_HOST_I2C_MAX_XFER * 3 + 1] = "";
+                for (size_t i = 0; i < s_i2c.len; i++) {
+                    snprintf(&hex[i * 3], 4, " %02x", s_i2c.buf[i]);
+                }
+                host_trace("i2c", "write%s", hex);
+            }
+            if (s_i2c.cb) {
+                s_i2c.cb(s_i2c.buf, s_i2c.len);
+            }
+        }
+    } else if (s_i2c.active && scl && !s_i2c.last_scl) {
+        // Data is sampled on the rising clock; the 9th bit is the (fixed) ACK.
+        if (s_i2c.bits < 8) {
+            s_i2c.cur = (uint8_t)((s_i2c.cur << 1) | (sda ? 1 : 0));
+        }
+        if (++s_i2c.bits == 9) {
+            if (s_i2c.len < HAL_HOST_I2C_MAX_XFER) {
+                s_i2c.buf[s_i2c.len++] = s_i2c.cur;
+            }
+            s_i2c.bits = 0;
+        }
+    }
+    s_i2c.last_sda = sda;
+    s_i2c.last_scl = scl;
+}
+
+// Re-reads the level after anything that can change it (latch, mode, pull, external drive).
+static void pin_update(hal_gpio_t pin)
+{
+    pin_t *p = pin_at(pin);
+    int level = hal_host_gpio_level(pin);
+    int64_t now_us = host_clock_now_us();
+    if (p->level) {
+        p->high_us += now_us - p->since_us;
+    }
+    p->since_us = now_us;
+    if (level != p->level) {
+        p->level = level;
+        if (is_i2c_pin(pin)) {
+            i2c_sample();
+        } else {
+            host_trace("gpio", "%d -> %d", (int)pin, level);
+        }
+    }
+}
+
+esp_err_t hal_gpio_config(hal_gpio_t pin, hal_gpio_mode_t mode, hal_gpio_pull_t pull)
+{
+    pin_t *p = pin_at(pin);
+    if (!p) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    p->configured = true;
+    p->mode = mode;
+    p->pull = pull;
+    host_trace("gpio", "%d config %s pull=%s", (int)pin, s_mode_names[mode], s_pull_names[pull]);
+    pin_update(pin);
+    return ESP_OK;
+}
+
+void hal_gpio_set(hal_gpio_t pin, int level)
+{
+    pin_t *p = pin_at(pin);
+    if (!p) {
+        return;
+    }
+    level = level ? 1 : 0;
+    if (p->out != level) {
+        p->edges++;
+    }
+    p->out = level;
+    pin_update(pin);
+}
+
+int hal_host_gpio_level(hal_gpio_t pin)
+{
+    const pin_t *p = pin_at(pin);
+    if (!p) {
+        return 0;
+    }
+    if (p->configured && p->mode == HAL_GPIO_OUTPUT) {
+        return p->out;
+    }
+    bool od = p->configured && (p->mode == HAL_GPIO_OUTPUT_OD || p->mode == HAL_GPIO_INPUT_OUTPUT_OD);
+    if (od && p->out == 0) {
+        return 0;
+    }
+    if (p->drive >= 0) {
+        return p->drive;
+    }
+    return (p->pull == HAL_GPIO_PULL_UP || od) ? 1 : 0;
+}
+
+int hal_gpio_get(hal_gpio_t pin)
+{
+    return hal_host_gpio_level(pin);
+}
+
+void hal_host_gpio_drive(hal_gpio_t pin, int level)
+{
+    pin_t *p = pin_at(pin);
+    if (p) {
+        p->drive = (level < 0) ? -1 : (level ? 1 : 0);
+        pin_update(pin);
+    }
+}
+
+uint32_t hal_host_gpio_edges(hal_gpio_t pin)
+{
+    const pin_t *p = pin_at(pin);
+    return p ? p->edges : 0;
+}
+
+int64_t hal_host_gpio_high_us(hal_gpio_t pin)
+{
+    pin_t *p = pin_at(pin);
+    if (!p) {
+        return 0;
+    }
+    pin_update(pin);
+    return p->high_us;
+}
+
+void hal_host_i2c_watch(hal_gpio_t sda, hal_gpio_t scl, hal_host_i2c_cb_t cb)
+{
+    if (!pin_at(sda) || !pin_at(scl)) {
+        return;
+    }
+    s_i2c.sda = sda;
+    s_i2c.scl = scl;
+    s_i2c.cb = cb;
+    s_i2c.last_sda = hal_host_gpio_level(sda);
+    s_i2c.last_scl = hal_host_gpio_level(scl);
+    s_i2c.active = false;
+}
+
+void hal_delay_us(uint32_t us)
+{
+    host_clock_busy_us(us);
+}
+
+// The machine's counter, not virtual time: this times the host's own execution of the code.
+uint32_t hal_cycle_count(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return (uint32_t)__rdtsc();
+#elif defined(__aarch64__)
+    uint64_t v;
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r"(v));
+    return (uint32_t)v;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+#endif
+}
+
+esp_err_t hal_pwm_timer_config(uint32_t freq_hz, uint32_t duty_bits)
+{
+    if (freq_hz == 0 || duty_bits == 0 || duty_bits > 14) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint64_t div_q8 = (HAL_HOST_APB_HZ << 8) / ((uint64_t)freq_hz << duty_bits);
+    if (div_q8 < 256) {
+        ESP_LOGE(TAG, "requested frequency %lu and duty resolution %lu can not be achieved", (unsigned long)freq_hz,
+                 (unsigned long)duty_bits);
+        return ESP_FAIL;
+    }
+    s_pwm_bits = duty_bits;
+    s_pwm_freq = (uint32_t)((HAL_HOST_APB_HZ << 8) / (div_q8 << duty_bits));
+    host_trace("pwm", "timer %lu Hz %lu-bit (asked %lu Hz)", (unsigned long)s_pwm_freq, (unsigned long)s_pwm_bits,
+               (unsigned long)freq_hz);
+    return ESP_OK;
+}
+
+uint32_t hal_pwm_get_freq(void)
+{
+    return s_pwm_freq;
+}
+
+esp_err_t hal_pwm_channel_config(uint8_t channel, hal_gpio_t pin)
+{
+    if (channel >= HAL_HOST_PWM_CHANNELS || !pin_at(pin) || s_pwm_bits == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pwm_ch_t *ch = &s_pwm[channel];
+    // Totals survive a reconfiguration; the output restarts at 0.
+    *ch = (pwm_ch_t){
+        .pin = pin,
+        .fades = ch->fades,
+        .acc_us = host_clock_now_us(),
+        .on_us = ch->on_us,
+        .full_s = ch->full_s,
+    };
+    host_trace("pwm", "ch%u on gpio %d", (unsigned)channel, (int)pin);
+    return ESP_OK;
+}
+
+esp_err_t hal_pwm_fade_install(void)
+{
+    return ESP_OK;
+}
+
+static void observe(pwm_ch_t *ch, int64_t at_us)
+{
+    if (s_pwm_observer) {
+        s_pwm_observer(at_us, (uint8_t)(ch - s_pwm), ch->duty);
+    }
+}
+
+// Continuous value of the running fade at t_us (start_us <= t_us <= its end).
+static double fade_value(const pwm_ch_t *ch, int64_t t_us)
+{
+    if (ch->fade_ms == 0) {
+        return (double)ch->target;
+    }
+    double frac = (double)(t_us - ch->start_us) / ((double)ch->fade_ms * 1000.0);
+    return (double)ch->from + ((double)ch->target - (double)ch->from) * frac;
+}
+
+static void add_segment(pwm_ch_t *ch, double from, double to, int64_t dt_us)
+{
+    if (from > 0 || to > 0) {
+        ch->on_us += dt_us;
+    }
+    if (s_pwm_bits) {
+        ch->full_s += (from + to) / 2.0 / (double)(1u << s_pwm_bits) * (double)dt_us / 1e6;
+    }
+}
+
+// Integrates the output (linear within a fade) up to now; called before every change.
+static void account(pwm_ch_t *ch)
+{
+    int64_t now_us = host_clock_now_us();
+    int64_t t_us = ch->acc_us;
+    if (now_us <= t_us) {
+        return;
+    }
+    if (ch->fading) {
+        int64_t end_us = ch->start_us + (int64_t)ch->fade_ms * 1000;
+        int64_t mid_us = (now_us < end_us) ? now_us : end_us;
+        if (mid_us > t_us) {
+            add_segment(ch, fade_value(ch, t_us), fade_value(ch, mid_us), mid_us - t_us);
+            t_us = mid_us;
+        }
+        if (now_us > t_us) {
+            add_segment(ch, ch->target, ch->target, now_us - t_us);
+        }
+    } else {
+        add_segment(ch, ch->duty, ch->duty, now_us - t_us);
+    }
+    ch->acc_us = now_us;
+}
+
+static void settle(pwm_ch_t *ch)
+{
+    if (!ch->fading) {
+        return;
+    }
+    account(ch);
+    int64_t elapsed_ms = (host_clock_now_us() - ch->start_us) / 1000;
+    if (elapsed_ms >= (int64_t)ch->fade_ms) {
+        ch->duty = ch->target;
+        ch->fading = false;
+        observe(ch, ch->start_us + (int64_t)ch->fade_ms * 1000);
+        return;
+    }
+    int64_t span = (int64_t)ch->target - (int64_t)ch->from;
+    ch->duty = (uint32_t)((int64_t)ch->from + span * elapsed_ms / (int64_t)ch->fade_ms);
+}
+
+esp_err_t hal_pwm_set_duty(uint8_t channel, uint32_t duty)
+{
+    s_pwm_calls++;
+    if (channel >= HAL_HOST_PWM_CHANNELS || duty > (1u << s_pwm_bits)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pwm_ch_t *ch = &s_pwm[channel];
+    settle(ch);
+    account(ch);
+    ch->fading = false;
+    if (ch->duty != duty) {
+        observe(ch, host_clock_now_us()); // a step: the value just before it
+        ch->duty = duty;
+    }
+    host_trace("pwm", "ch%u duty %lu", (unsigned)channel, (unsigned long)duty);
+    observe(ch, host_clock_now_us());
+    return ESP_OK;
+}
+
+esp_err_t hal_pwm_set_fade(uint8_t channel, uint32_t duty, uint32_t time_ms)
+{
+    s_pwm_calls++;
+    if (channel >= HAL_HOST_PWM_CHANNELS || duty > (1u << s_pwm_bits)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pwm_ch_t *ch = &s_pwm[channel];
+    ch->prog_target = duty;
+    ch->prog_fade_ms = time_ms;
+    return ESP_OK;
+}
+
+esp_err_t hal_pwm_fade_start(uint8_t channel)
+{
+    s_pwm_calls++;
+    if (channel >= HAL_HOST_PWM_CHANNELS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pwm_ch_t *ch = &s_pwm[channel];
+    settle(ch);
+    account(ch);
+    ch->from = ch->duty;
+    ch->target = ch->prog_target;
+    ch->fade_ms = ch->prog_fade_ms;
+    ch->start_us = host_clock_now_us();
+    ch->fading = true;
+    ch->fades++;
+    host_trace("pwm", "ch%u fade %lu -> %lu in %lu ms", (unsigned)channel, (unsigned long)ch->from,
+               (unsigned long)ch->target, (unsigned long)ch->fade_ms);
+    observe(ch, ch->start_us);
+    settle(ch);
+    return ESP_OK;
+}
+
+uint32_t hal_host_pwm_freq(void)
+{
+    return s_pwm_freq;
+}
+
+uint32_t hal_host_pwm_duty_bits(void)
+{
+    return s_pwm_bits;
+}
+
+uint32_t hal_host_pwm_duty(uint8_t channel)
+{
+    if (channel >= HAL_HOST_PWM_CHANNELS) {
+        return 0;
+    }
+    settle(&s_pwm[channel]);
+    return s_pwm[channel].duty;
+}
+
+bool hal_host_pwm_fading(uint8_t channel)
+{
+    if (channel >= HAL_HOST_PWM_CHANNELS) {
+        return false;
+    }
+    settle(&s_pwm[channel]);
+    return s_pwm[channel].fading;
+}
+
+uint32_t hal_host_pwm_calls(void)
+{
+    return s_pwm_calls;
+}
+
+uint32_t hal_host_pwm_fades(uint8_t channel)
+{
+    return (channel < HAL_HOST_PWM_CHANNELS) ? s_pwm[channel].fades : 0;
+}
+
+int64_t hal_host_pwm_on_us(uint8_t channel)
+{
+    if (channel >= HAL_HOST_PWM_CHANNELS) {
+        return 0;
+    }
+    settle(&s_pwm[channel]);
+    account(&s_pwm[channel]);
+    return s_pwm[channel].on_us;
+}
+
+double hal_host_pwm_full_s(uint8_t channel)
+{
+    if (channel >= HAL_HOST_PWM_CHANNELS) {
+        return 0;
+    }
+    settle(&s_pwm[channel]);
+    account(&s_pwm[channel]);
+    return s_pwm[channel].full_s;
+}
+
+void hal_host_pwm_set_observer(hal_host_pwm_observer_t observer)
+{
+    s_pwm_observer = observer;
+}
+
+esp_err_t hal_adc_open(hal_adc_t *adc, hal_gpio_t pin)
+{
+    if (!adc || !pin_at(pin)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    // The ADC state is the pin itself; unit is just non-NULL while open.
+    *adc = (hal_adc_t){
+        .unit = &s_adc[pin],
+        .cali = s_adc_calibrated ? &s_adc[pin] : NULL,
+        .unit_id = 0,
+        .channel = pin,
+    };
+    return ESP_OK;
+}
+
+esp_err_t hal_adc_read_raw(hal_adc_t *adc, int *out_raw)
+{
+    if (!adc || !adc->unit || !out_raw) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    const adc_in_t *in = (const adc_in_t *)adc->unit;
+    int mv = in->mv;
+    if (in->en_pin >= 0 && hal_host_gpio_level(in->en_pin) != in->en_level) {
+        mv = 0;
+    }
+    int raw = (int)(((int64_t)mv * HAL_HOST_ADC_MAX_RAW + HAL_HOST_ADC_FULL_MV / 2) / HAL_HOST_ADC_FULL_MV);
+    *out_raw = raw < 0 ? 0 : (raw > HAL_HOST_ADC_MAX_RAW ? HAL_HOST_ADC_MAX_RAW : raw);
+    s_adc_reads++;
+    host_trace("adc", "ch%d raw %d", adc->channel, *out_raw);
+    return ESP_OK;
+}
+
+bool hal_adc_raw_to_mv(const hal_adc_t *adc, int raw, int *out_mv)
+{
+    if (!adc || !adc->cali || !out_mv) {
+        return false;
+    }
+    *out_mv = (int)(((int64_t)raw * HAL_HOST_ADC_FULL_MV + HAL_HOST_ADC_MAX_RAW / 2) / HAL_HOST_ADC_MAX_RAW);
+    return true;
+}
+
+void hal_adc_close(hal_adc_t *adc)
+{
+    if (adc) {
+        *adc = (hal_adc_t){0};
+    }
+}
+
+void hal_host_adc_set_mv(hal_gpio_t pin, int mv, hal_gpio_t en_pin, int en_level)
+{
+    if (!pin_at(pin)) {
+        return;
+    }
+    s_adc[pin] = (adc_in_t){.mv = mv, .en_pin = en_pin, .en_level = en_level ? 1 : 0};
+}
+
+void hal_host_adc_set_calibrated(bool calibrated)
+{
+    s_adc_calibrated = calibrated;
+}
+
+uint32_t hal_host_adc_reads(void)
+{
+    return s_adc_reads;
+}
+
+void hal_deep_sleep(uint64_t wake_us, hal_gpio_t wake_pin)
+{
+    ESP_LOGI(TAG, "deep sleep (timer %llu us, wake pin %d)", (unsigned long long)wake_us, (int)wake_pin);
+    host_trace("sleep", "deep sleep, timer %llu us, wake pin %d", (unsigned long long)wake_us, (int)wake_pin);
+    host_clock_stop("deep sleep");
+}
+
+int64_t hal_rtc_get_ms(void)
+{
+    int64_t elapsed_us = host_clock_now_us() - s_rtc_base_mono_us;
+    return s_rtc_base_ms + (elapsed_us + elapsed_us * s_rtc_ppm / 1000000) / 1000;
+}
+
+void hal_rtc_set_ms(int64_t ms)
+{
+    host_trace("rtc", "set %lld ms", (long long)ms);
+    s_rtc_base_ms = ms;
+    s_rtc_base_mono_us = host_clock_now_us();
+}
+
+void hal_host_rtc_set_drift_ppm(int32_t ppm)
+{
+    hal_rtc_set_ms(hal_rtc_get_ms());
+    s_rtc_ppm = ppm;
+}
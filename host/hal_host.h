@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Host side of main/hal.h: pins, PWM channels, ADC inputs and the RTC as plain state on the virtual
+// clock (host_clock.h), for host_main and tests to drive and inspect.
+
+#define HAL_HOST_GPIO_COUNT 32
+#define HAL_HOST_PWM_CHANNELS 2
+#define HAL_HOST_I2C_MAX_XFER 8
+
+// Every interaction is also written to the peripheral trace (host_trace.h) when one is open.
+
+// External drive on a pin (a button, a divider); -1 releases it to its pull.
+void hal_host_gpio_drive(hal_gpio_t pin, int level);
+// Level the pin reads: output latch, else external drive, else pull (floating reads 0).
+int hal_host_gpio_level(hal_gpio_t pin);
+// Level changes written by the firmware since boot (bit-banging shows up here).
+uint32_t hal_host_gpio_edges(hal_gpio_t pin);
+// Time the pin has read high since boot.
+int64_t hal_host_gpio_high_us(hal_gpio_t pin);
+
+// Decodes bit-banged I2C on sda/scl into transfers (address/command byte first, ACK bits dropped),
+// passed to cb on STOP; the pins' individual edges then stay out of the trace.
+typedef void (*hal_host_i2c_cb_t)(const uint8_t *bytes, size_t len);
+void hal_host_i2c_watch(hal_gpio_t sda, hal_gpio_t scl, hal_host_i2c_cb_t cb);
+
+uint32_t hal_host_pwm_freq(void);
+uint32_t hal_host_pwm_duty_bits(void);
+// Duty at the current virtual time, with a running fade interpolated linearly.
+uint32_t hal_host_pwm_duty(uint8_t channel);
+bool hal_host_pwm_fading(uint8_t channel);
+uint32_t hal_host_pwm_fades(uint8_t channel); // fades started since boot
+uint32_t hal_host_pwm_calls(void);            // hal_pwm_set_duty/set_fade/fade_start calls since boot
+// Time the channel's duty was non-zero, and its output integrated as seconds at full duty.
+int64_t hal_host_pwm_on_us(uint8_t channel);
+double hal_host_pwm_full_s(uint8_t channel);
+// Called at every breakpoint of a channel's duty: set, fade start, fade end (reported when next
+// looked at, stamped with the time it ended). Linear between breakpoints.
+typedef void (*hal_host_pwm_observer_t)(int64_t at_us, uint8_t channel, uint32_t duty);
+void hal_host_pwm_set_observer(hal_host_pwm_observer_t observer);
+
+// Pin voltage seen by the ADC; with en_pin >= 0 it only appears while en_pin is at en_level
+// (a gated divider, like BAT_ADC_EN), else the pin reads 0 mV.
+void hal_host_adc_set_mv(hal_gpio_t pin, int mv, hal_gpio_t en_pin, int en_level);
+void hal_host_adc_set_calibrated(bool calibrated);
+uint32_t hal_host_adc_reads(void);
+
+// RTC rate error against the virtual monotonic clock, in ppm (positive runs fast).
+void hal_host_rtc_set_drift_ppm(int32_t ppm);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,284 @@
+#include "host_clock.h"
+
+#include <setjmp.h>
+#include <stdlib.h>
+
+#include "esp_timer.h"
+
+struct esp_timer {
+    struct esp_timer *next;
+    esp_timer_cb_t cb;
+    void *arg;
+    const char *name;
+    bool (*stimulus)(void *arg); // host_clock_at() event: runs once, then freed
+    int64_t due_us;
+    uint64_t period_us;
+    uint64_t seq; // arming order breaks ties, like the esp_timer list
+    bool armed;
+};
+
+static int64_t s_now_us;
+static int64_t s_stop_us = INT64_MAX;
+static uint64_t s_seq;
+static struct esp_timer *s_timers;
+static jmp_buf s_exit;
+static bool s_running;
+static const char *s_stop_reason = "";
+static void (*s_on_end)(void);
+static int64_t s_awake_us = -1; // last instant the CPU is known to have been running
+static host_clock_stats_t s_stats;
+static void (*s_wake_hook)(int64_t at_us, host_clock_wake_t source);
+
+int64_t host_clock_now_us(void)
+{
+    return s_now_us;
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return s_now_us;
+}
+
+static struct esp_timer *next_due(void)
+{
+    struct esp_timer *best = NULL;
+    for (struct esp_timer *t = s_timers; t; t = t->next) {
+        if (t->armed && (!best || t->due_us < best->due_us || (t->due_us == best->due_us && t->seq < best->seq))) {
+            best = t;
+        }
+    }
+    return best;
+}
+
+static void note_wake(int64_t at_us, host_clock_wake_t source)
+{
+    if (at_us > s_awake_us) {
+        s_stats.wakeups++;
+        s_stats.by_source[source]++;
+        if (s_wake_hook) {
+            s_wake_hook(at_us, source);
+        }
+    }
+    if (s_now_us > s_awake_us) {
+        s_awake_us = s_now_us;
+    }
+}
+
+static void remove_timer(struct esp_timer *timer)
+{
+    for (struct esp_timer **pp = &s_timers; *pp; pp = &(*pp)->next) {
+        if (*pp == timer) {
+            *pp = timer->next;
+            break;
+        }
+    }
+}
+
+static void end_run(const char *reason, host_clock_end_t end)
+{
+    s_stop_reason = reason;
+    s_running = false;
+    if (s_on_end) {
+        s_on_end();
+    }
+    if (end != HOST_CLOCK_RETURNED) {
+        longjmp(s_exit, end);
+    }
+}
+
+static void time_up(void)
+{
+    s_now_us = s_stop_us;
+    end_run("time up", HOST_CLOCK_TIME_UP);
+}
+
+bool host_clock_run_until_woken(int64_t t_us, const volatile uint32_t *wake)
+{
+    for (;;) {
+        if (wake && *wake) {
+            note_wake(s_now_us, HOST_CLOCK_WAKE_TASK);
+            return true;
+        }
+        struct esp_timer *t = next_due();
+        int64_t at = (t && t->due_us < t_us) ? t->due_us : t_us;
+        if (at > s_stop_us && s_running) {
+            time_up();
+        }
+        if (at > s_now_us) {
+            s_now_us = at;
+        }
+        if (!t || t->due_us > t_us) {
+            note_wake(s_now_us, HOST_CLOCK_WAKE_TASK);
+            return wake && *wake;
+        }
+        int64_t fired_at = s_now_us;
+        if (t->stimulus) {
+            remove_timer(t);
+            bool (*fn)(void *) = t->stimulus;
+            void *arg = t->arg;
+            free(t);
+            if (fn(arg)) {
+                note_wake(fired_at, HOST_CLOCK_WAKE_STIMULUS);
+            }
+            continue;
+        }
+        if (t->period_us) {
+            t->due_us += (int64_t)t->period_us;
+            t->seq = s_seq++;
+        } else {
+            t->armed = false;
+        }
+        s_stats.callbacks++;
+        t->cb(t->arg);
+        note_wake(fired_at, HOST_CLOCK_WAKE_TIMER);
+    }
+}
+
+void host_clock_run_until(int64_t t_us)
+{
+    (void)host_clock_run_until_woken(t_us, NULL);
+}
+
+void host_clock_busy_us(uint32_t us)
+{
+    if (s_now_us > s_awake_us) {
+        s_awake_us = s_now_us;
+    }
+    s_now_us += us;
+    s_awake_us = s_now_us;
+    s_stats.busy_us += us;
+}
+
+bool host_clock_at(int64_t t_us, bool (*fn)(void *arg), void *arg)
+{
+    if (!fn) {
+        return false;
+    }
+    struct esp_timer *t = calloc(1, sizeof(*t));
+    if (!t) {
+        return false;
+    }
+    t->stimulus = fn;
+    t->arg = arg;
+    t->name = "stimulus";
+    t->due_us = (t_us > s_now_us) ? t_us : s_now_us;
+    t->seq = s_seq++;
+    t->armed = true;
+    t->next = s_timers;
+    s_timers = t;
+    return true;
+}
+
+void host_clock_get_stats(host_clock_stats_t *out)
+{
+    if (out) {
+        *out = s_stats;
+    }
+}
+
+void host_clock_set_wake_hook(void (*hook)(int64_t at_us, host_clock_wake_t source))
+{
+    s_wake_hook = hook;
+}
+
+host_clock_end_t host_clock_run(void (*entry)(void), int64_t stop_us, void (*on_end)(void))
+{
+    s_stop_us = stop_us;
+    s_on_end = on_end;
+    int rc = setjmp(s_exit);
+    if (rc == 0) {
+        s_running = true;
+        s_awake_us = s_now_us; // boot
+        entry();
+        end_run("returned", HOST_CLOCK_RETURNED);
+        return HOST_CLOCK_RETURNED;
+    }
+    return (host_clock_end_t)rc;
+}
+
+void host_clock_stop(const char *reason)
+{
+    if (!s_running) {
+        abort();
+    }
+    end_run(reason, HOST_CLOCK_STOPPED);
+    abort(); // not reached
+}
+
+const char *host_clock_stop_reason(void)
+{
+    return s_stop_reason;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle)
+{
+    if (!create_args || !create_args->callback || !out_handle) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    struct esp_timer *t = calloc(1, sizeof(*t));
+    if (!t) {
+        return ESP_ERR_NO_MEM;
+    }
+    t->cb = create_args->callback;
+    t->arg = create_args->arg;
+    t->name = create_args->name;
+    t->next = s_timers;
+    s_timers = t;
+    *out_handle = t;
+    return ESP_OK;
+}
+
+static esp_err_t arm(esp_timer_handle_t t, uint64_t timeout_us, uint64_t period_us)
+{
+    if (!t) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (t->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    t->due_us = s_now_us + (int64_t)timeout_us;
+    t->period_us = period_us;
+    t->seq = s_seq++;
+    t->armed = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    return arm(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period)
+{
+    return arm(timer, period, period);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    if (!timer) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->armed = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    if (!timer) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    remove_timer(timer);
+    free(timer);
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+    return timer && timer->armed;
+}
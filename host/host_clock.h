@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Virtual monotonic clock behind esp_timer_get_time() in the host build.
+//
+// Time only moves when the firmware blocks (vTaskDelay, ulTaskNotifyTake) or busy-waits
+// (hal_delay_us). Blocking runs every esp_timer callback that falls due on the way, in deadline order,
+// as the esp_timer task would; a simulated day therefore takes as long as the work done in it.
+
+int64_t host_clock_now_us(void);
+
+// Advances to t_us, running due timer callbacks. Ends the run (see host_clock_run()) rather than pass
+// the stop time.
+void host_clock_run_until(int64_t t_us);
+
+// As host_clock_run_until(), but returns early, right after the callback that made *wake non-zero.
+// Returns true if woken.
+bool host_clock_run_until_woken(int64_t t_us, const volatile uint32_t *wake);
+
+// Busy-wait: time passes, no callback runs. The CPU counts as awake throughout.
+void host_clock_busy_us(uint32_t us);
+
+// Host-side event (a scenario step: a button edge, a GATT write) at t_us. It runs from the same loop as
+// the timer callbacks, after those due at the same instant that were armed before it. fn returns true
+// if the CPU has to wake for it (a radio event), false if the firmware only notices by polling (a pin
+// level).
+bool host_clock_at(int64_t t_us, bool (*fn)(void *arg), void *arg);
+
+typedef enum {
+    HOST_CLOCK_WAKE_TIMER = 0, // esp_timer callback
+    HOST_CLOCK_WAKE_TASK,      // app_main's vTaskDelay/ulTaskNotifyTake timing out
+    HOST_CLOCK_WAKE_STIMULUS,  // host_clock_at() event that wakes the CPU
+    HOST_CLOCK_WAKE_SOURCES,
+} host_clock_wake_t;
+
+// Wakeups are distinct instants at which firmware runs after idling; work at an instant the CPU is
+// already awake for (a busy-wait, a second callback due with the first) does not count again.
+typedef struct {
+    uint32_t wakeups;
+    uint32_t by_source[HOST_CLOCK_WAKE_SOURCES]; // source that woke the CPU
+    uint32_t callbacks;                          // esp_timer callbacks run
+    int64_t busy_us;                             // time spent in busy-waits
+} host_clock_stats_t;
+
+void host_clock_get_stats(host_clock_stats_t *out);
+// Called for every counted wakeup, e.g. to log it (NULL: none).
+void host_clock_set_wake_hook(void (*hook)(int64_t at_us, host_clock_wake_t source));
+
+typedef enum {
+    HOST_CLOCK_RETURNED = 0, // entry() returned
+    HOST_CLOCK_TIME_UP,      // virtual time reached stop_us
+    HOST_CLOCK_STOPPED,      // host_clock_stop(): restart, deep sleep, ...
+} host_clock_end_t;
+
+// Runs entry() (app_main) on the virtual clock until it returns, stop_us is reached or
+// host_clock_stop() is called. on_end (optional) runs first in every case, while the firmware's stack
+// is still live: the run ends with a longjmp, so anything pointing into app_main's frame (its
+// context, timer_wheel timers) is only valid until then.
+host_clock_end_t host_clock_run(void (*entry)(void), int64_t stop_us, void (*on_end)(void));
+
+// Ends the current run from anywhere below host_clock_run().
+void host_clock_stop(const char *reason) __attribute__((noreturn));
+const char *host_clock_stop_reason(void);
+
+#ifdef __cplusplus
+}
+#endif
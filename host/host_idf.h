@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "esp_err.h"
+#include "esp_partition.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Host-only hooks into the IDF stand-ins (host/include).
+
+// Registers a partition for esp_partition_find_first()/mmap(); data must outlive the run.
+esp_err_t host_partition_add(esp_partition_type_t type, esp_partition_subtype_t subtype, const char *label,
+                             const uint8_t *data, size_t size);
+
+// NVS contents survive nvs_flash_erase() only through these: they persist the whole store to a file.
+esp_err_t host_nvs_load(const char *path);
+esp_err_t host_nvs_save(const char *path);
+
+typedef struct {
+    uint32_t commits;    // nvs_commit() calls with something to write
+    uint32_t writes;     // set/erase calls that changed a value
+    uint32_t bytes;      // value bytes written by those
+    uint32_t entries;    // keys currently stored
+    uint32_t faults;     // writes failed by host_nvs_inject_faults()
+} host_nvs_stats_t;
+
+void host_nvs_get_stats(host_nvs_stats_t *out);
+
+// Fault injection: after `after` more writes (a set or erase that changes flash, or a commit) succeed,
+// the next `count` fail with ESP_FAIL and change nothing. Each write is atomic, as on flash, so
+// count UINT32_MAX is the power going off between two of them: the store keeps exactly what had
+// been written. host_nvs_inject_faults(0, 0) clears it.
+void host_nvs_inject_faults(uint32_t after, uint32_t count);
+
+// esp_log output goes to stdout unless sent elsewhere here (NULL: back to stdout). host_log_bytes()
+// counts what passed the level filter either way: on the device those bytes go out over the UART.
+void host_log_set_output(FILE *out);
+uint64_t host_log_bytes(void);
+
+#ifdef __cplusplus
+}
+#endif
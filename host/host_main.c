@@ -0,0 +1,223 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_partition.h"
+
+#include "ble_alarm_host.h"
+#include "hal_host.h"
+#include "host_clock.h"
+#include "host_idf.h"
+#include "host_trace.h"
+#include "power_model.h"
+#include "provisioning.h"
+#include "sim.h"
+#include "timer_wheel.h"
+
+// Board pins, as in main/app_main.c.
+#define HOST_PIN_BAT_ADC    3
+#define HOST_PIN_BAT_ADC_EN 21
+#define HOST_PIN_PWM_WARM   6
+#define HOST_PIN_PWM_COOL   7
+
+// Divider on the battery sense pin: 10k over 5.1k (battery.c).
+#define HOST_BATT_DIV_NUM 5100
+#define HOST_BATT_DIV_DEN 15100
+
+void app_main(void);
+
+static timer_wheel_stats_t s_wheel;
+
+static void on_end(void)
+{
+    timer_wheel_get_stats(&s_wheel);
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --seconds N     virtual seconds to run (default 60)\n"
+            "  --rtc-ms MS     RTC wall clock at boot, UTC ms (default 0: unset, as after power loss)\n"
+            "  --drift-ppm P   RTC rate error against the monotonic clock\n"
+            "  --batt-mv MV    battery voltage (default 8000)\n"
+            "  --prov FILE     provisioning image from tools/mkprov.py\n"
+            "  --nvs FILE      load NVS from FILE at boot and save it back at the end\n"
+            "  --scenario FILE play a scenario (host/sim.h) against the firmware\n"
+            "  --trace FILE    record every peripheral interaction to FILE ('-': stdout)\n"
+            "  --light FILE    write the LED duty breakpoints to FILE as CSV\n"
+            "  --power-model FILE  current figures for the power budget (host/power_model.txt)\n"
+            "  --budget-mah N  fail (exit 4) if the run draws more than N mAh from the pack\n"
+            "  --log N         log level 0..5 (default 3: info)\n",
+            argv0);
+}
+
+static uint8_t *read_file(const char *path, size_t *out_len)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return NULL;
+    }
+    uint8_t *buf = NULL;
+    size_t len = 0;
+    size_t cap = 0;
+    for (;;) {
+        if (len == cap) {
+            cap = cap ? cap * 2 : 4096;
+            uint8_t *grown = realloc(buf, cap);
+            if (!grown) {
+                free(buf);
+                fclose(f);
+                return NULL;
+            }
+            buf = grown;
+        }
+        size_t n = fread(buf + len, 1, cap - len, f);
+        if (n == 0) {
+            break;
+        }
+        len += n;
+    }
+    fclose(f);
+    *out_len = len;
+    return buf;
+}
+
+int main(int argc, char **argv)
+{
+    int64_t seconds = 60;
+    int64_t rtc_ms = 0;
+    int32_t drift_ppm = 0;
+    int batt_mv = 8000;
+    const char *prov_path = NULL;
+    const char *nvs_path = NULL;
+    const char *scenario_path = NULL;
+    const char *trace_path = NULL;
+    const char *light_path = NULL;
+    const char *power_path = NULL;
+    double budget_mah = 0;
+    int log_level = ESP_LOG_INFO;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *val = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (!val) {
+            usage(argv[0]);
+            return 2;
+        }
+        if (strcmp(arg, "--seconds") == 0) {
+            seconds = strtoll(val, NULL, 0);
+        } else if (strcmp(arg, "--rtc-ms") == 0) {
+            rtc_ms = strtoll(val, NULL, 0);
+        } else if (strcmp(arg, "--drift-ppm") == 0) {
+            drift_ppm = (int32_t)strtol(val, NULL, 0);
+        } else if (strcmp(arg, "--batt-mv") == 0) {
+            batt_mv = (int)strtol(val, NULL, 0);
+        } else if (strcmp(arg, "--prov") == 0) {
+            prov_path = val;
+        } else if (strcmp(arg, "--nvs") == 0) {
+            nvs_path = val;
+        } else if (strcmp(arg, "--scenario") == 0) {
+            scenario_path = val;
+        } else if (strcmp(arg, "--trace") == 0) {
+            trace_path = val;
+        } else if (strcmp(arg, "--light") == 0) {
+            light_path = val;
+        } else if (strcmp(arg, "--power-model") == 0) {
+            power_path = val;
+        } else if (strcmp(arg, "--budget-mah") == 0) {
+            budget_mah = strtod(val, NULL);
+        } else if (strcmp(arg, "--log") == 0) {
+            log_level = (int)strtol(val, NULL, 0);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+        i++;
+    }
+
+    esp_log_level_set("*", (esp_log_level_t)log_level);
+    hal_rtc_set_ms(rtc_ms);
+    sim_set_phone_ms(rtc_ms);
+    hal_host_rtc_set_drift_ppm(drift_ppm);
+    hal_host_adc_set_mv(HOST_PIN_BAT_ADC, batt_mv * HOST_BATT_DIV_NUM / HOST_BATT_DIV_DEN, HOST_PIN_BAT_ADC_EN, 1);
+
+    if (prov_path) {
+        size_t len = 0;
+        uint8_t *img = read_file(prov_path, &len);
+        if (!img) {
+            fprintf(stderr, "cannot read %s\n", prov_path);
+            return 1;
+        }
+        (void)host_partition_add(ESP_PARTITION_TYPE_DATA, PROVISIONING_PARTITION_SUBTYPE, PROVISIONING_PARTITION_LABEL,
+                                 img, len);
+    }
+    if (nvs_path && host_nvs_load(nvs_path) == ESP_ERR_INVALID_SIZE) {
+        fprintf(stderr, "%s: truncated NVS image\n", nvs_path);
+        return 1;
+    }
+
+    power_model_t model;
+    power_model_defaults(&model);
+    if (power_path) {
+        char err[160];
+        if (power_model_load(&model, power_path, err, sizeof(err)) != ESP_OK) {
+            fprintf(stderr, "%s: %s\n", power_path, err);
+            return 1;
+        }
+    }
+
+    FILE *trace = NULL;
+    FILE *light = NULL;
+    if (trace_path) {
+        trace = (strcmp(trace_path, "-") == 0) ? stdout : fopen(trace_path, "w");
+        if (!trace) {
+            fprintf(stderr, "cannot write %s\n", trace_path);
+            return 1;
+        }
+        host_trace_set_sink(trace);
+    }
+    if (light_path && !(light = fopen(light_path, "w"))) {
+        fprintf(stderr, "cannot write %s\n", light_path);
+        return 1;
+    }
+    sim_attach(light);
+    if (scenario_path) {
+        char err[160];
+        if (sim_load(scenario_path, err, sizeof(err)) != ESP_OK) {
+            fprintf(stderr, "%s: %s\n", scenario_path, err);
+            return 1;
+        }
+    }
+
+    host_clock_end_t end = host_clock_run(app_main, seconds * 1000000, on_end);
+
+    if (nvs_path && host_nvs_save(nvs_path) != ESP_OK) {
+        fprintf(stderr, "cannot write %s\n", nvs_path);
+    }
+
+    sim_report(stdout, &s_wheel);
+    power_usage_t run;
+    sim_power_usage(&run);
+    double used_mah = power_model_report(stdout, &model, &run);
+    host_trace_set_sink(NULL);
+    if (trace && trace != stdout) {
+        fclose(trace);
+    }
+    if (light) {
+        fclose(light);
+    }
+    if (end == HOST_CLOCK_STOPPED && strcmp(host_clock_stop_reason(), "esp_restart") == 0) {
+        return 3;
+    }
+    if (sim_failures()) {
+        return 1;
+    }
+    if (budget_mah > 0 && used_mah > budget_mah) {
+        fprintf(stderr, "power budget exceeded: %.3f mAh > %.3f mAh\n", used_mah, budget_mah);
+        return 4;
+    }
+    return 0;
+}
+
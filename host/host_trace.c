@@ -0,0 +1,31 @@
+#include "host_trace.h"
+
+#include <stdarg.h>
+
+#include "host_clock.h"
+
+static FILE *s_sink;
+
+void host_trace_set_sink(FILE *f)
+{
+    s_sink = f;
+}
+
+bool host_trace_enabled(void)
+{
+    return s_sink != NULL;
+}
+
+void host_trace(const char *dev, const char *fmt, ...)
+{
+    if (!s_sink) {
+        return;
+    }
+    int64_t now_us = host_clock_now_us();
+    fprintf(s_sink, "%lld.%06lld %-5s ", (long long)(now_us / 1000000), (long long)(now_us % 1000000), dev);
+    va_list ap;
+    va_start(ap, fmt);
+    vfprintf(s_sink, fmt, ap);
+    va_end(ap);
+    fputc('\n', s_sink);
+}
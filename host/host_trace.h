@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Peripheral trace for the host build: one line per interaction with the outside world (pin, PWM,
+// ADC, I2C transfer, radio, flash), stamped with virtual seconds since boot. The stand-ins call
+// host_trace(); nothing is recorded until a sink is set.
+
+void host_trace_set_sink(FILE *f);
+bool host_trace_enabled(void);
+void host_trace(const char *dev, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+#ifdef __cplusplus
+}
+#endif
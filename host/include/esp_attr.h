@@ -0,0 +1,8 @@
+#pragma once
+
+// Host stand-in for ESP-IDF esp_attr.h: no memory sections off-target. RTC_NOINIT_ATTR data is
+// zero-initialised, as after a power loss.
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
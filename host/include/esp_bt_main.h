@@ -0,0 +1,17 @@
+#pragma once
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Host stand-in for ESP-IDF esp_bt_main.h (fake Bluedroid, host/fake_bluedroid.h).
+esp_err_t esp_bluedroid_init(void);
+esp_err_t esp_bluedroid_deinit(void);
+esp_err_t esp_bluedroid_enable(void);
+esp_err_t esp_bluedroid_disable(void);
+
+#ifdef __cplusplus
+}
+#endif
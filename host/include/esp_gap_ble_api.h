@@ -0,0 +1,96 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "esp_bt_defs.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Host stand-in for ESP-IDF esp_gap_ble_api.h (fake Bluedroid, host/fake_bluedroid.h): the legacy
+// advertising calls the firmware uses, with IDF's event numbering.
+#define ESP_BLE_ADV_DATA_LEN_MAX 31
+#define ESP_BLE_SCAN_RSP_DATA_LEN_MAX 31
+
+typedef enum {
+    ESP_GAP_BLE_ADV_DATA_SET_COMPLETE_EVT = 0,
+    ESP_GAP_BLE_SCAN_RSP_DATA_SET_COMPLETE_EVT = 1,
+    ESP_GAP_BLE_SCAN_PARAM_SET_COMPLETE_EVT = 2,
+    ESP_GAP_BLE_SCAN_RESULT_EVT = 3,
+    ESP_GAP_BLE_ADV_DATA_RAW_SET_COMPLETE_EVT = 4,
+    ESP_GAP_BLE_SCAN_RSP_DATA_RAW_SET_COMPLETE_EVT = 5,
+    ESP_GAP_BLE_ADV_START_COMPLETE_EVT = 6,
+    ESP_GAP_BLE_SCAN_START_COMPLETE_EVT = 7,
+    ESP_GAP_BLE_ADV_STOP_COMPLETE_EVT = 17,
+} esp_gap_ble_cb_event_t;
+
+typedef enum {
+    ADV_TYPE_IND = 0x00,
+    ADV_TYPE_DIRECT_IND_HIGH = 0x01,
+    ADV_TYPE_SCAN_IND = 0x02,
+    ADV_TYPE_NONCONN_IND = 0x03,
+    ADV_TYPE_DIRECT_IND_LOW = 0x04,
+} esp_ble_adv_type_t;
+
+typedef enum {
+    BLE_ADDR_TYPE_PUBLIC = 0x00,
+    BLE_ADDR_TYPE_RANDOM = 0x01,
+    BLE_ADDR_TYPE_RPA_PUBLIC = 0x02,
+    BLE_ADDR_TYPE_RPA_RANDOM = 0x03,
+} esp_ble_addr_type_t;
+
+typedef enum {
+    ADV_CHNL_37 = 0x01,
+    ADV_CHNL_38 = 0x02,
+    ADV_CHNL_39 = 0x04,
+    ADV_CHNL_ALL = 0x07,
+} esp_ble_adv_channel_t;
+
+typedef enum {
+    ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY = 0x00,
+    ADV_FILTER_ALLOW_SCAN_WLST_CON_ANY,
+    ADV_FILTER_ALLOW_SCAN_ANY_CON_WLST,
+    ADV_FILTER_ALLOW_SCAN_WLST_CON_WLST,
+} esp_ble_adv_filter_t;
+
+typedef struct {
+    uint16_t adv_int_min; // 0.625 ms units
+    uint16_t adv_int_max;
+    esp_ble_adv_type_t adv_type;
+    esp_ble_addr_type_t own_addr_type;
+    esp_bd_addr_t peer_addr;
+    esp_ble_addr_type_t peer_addr_type;
+    esp_ble_adv_channel_t channel_map;
+    esp_ble_adv_filter_t adv_filter_policy;
+} esp_ble_adv_params_t;
+
+typedef union {
+    struct ble_adv_data_raw_cmpl_evt_param {
+        esp_bt_status_t status;
+    } adv_data_raw_cmpl;
+    struct ble_scan_rsp_data_raw_cmpl_evt_param {
+        esp_bt_status_t status;
+    } scan_rsp_data_raw_cmpl;
+    struct ble_adv_start_cmpl_evt_param {
+        esp_bt_status_t status;
+    } adv_start_cmpl;
+    struct ble_adv_stop_cmpl_evt_param {
+        esp_bt_status_t status;
+    } adv_stop_cmpl;
+} esp_ble_gap_cb_param_t;
+
+typedef void (*esp_gap_ble_cb_t)(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param);
+
+esp_err_t esp_ble_gap_register_callback(esp_gap_ble_cb_t callback);
+esp_err_t esp_ble_gap_set_device_name(const char *name);
+esp_err_t esp_ble_gap_config_adv_data_raw(uint8_t *raw_data, uint32_t raw_data_len);
+esp_err_t esp_ble_gap_config_scan_rsp_data_raw(uint8_t *raw_data, uint32_t raw_data_len);
+esp_err_t esp_ble_gap_start_advertising(esp_ble_adv_params_t *adv_params);
+esp_err_t esp_ble_gap_stop_advertising(void);
+esp_err_t esp_ble_gap_disconnect(esp_bd_addr_t remote_device);
+
+#ifdef __cplusplus
+}
+#endif
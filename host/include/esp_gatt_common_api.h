@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_gatt_defs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Host stand-in for ESP-IDF esp_gatt_common_api.h (fake Bluedroid, host/fake_bluedroid.h).
+esp_err_t esp_ble_gatt_set_local_mtu(uint16_t mtu);
+
+#ifdef __cplusplus
+}
+#endif
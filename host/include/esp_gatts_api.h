@@ -0,0 +1,122 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_bt_defs.h"
+#include "esp_err.h"
+#include "esp_gatt_defs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Host stand-in for ESP-IDF esp_gatts_api.h (fake Bluedroid, host/fake_bluedroid.h): the GATT server
+// calls the firmware uses, with IDF's event numbering and parameter layouts.
+typedef enum {
+    ESP_GATTS_REG_EVT = 0,
+    ESP_GATTS_READ_EVT = 1,
+    ESP_GATTS_WRITE_EVT = 2,
+    ESP_GATTS_EXEC_WRITE_EVT = 3,
+    ESP_GATTS_MTU_EVT = 4,
+    ESP_GATTS_CONF_EVT = 5,
+    ESP_GATTS_UNREG_EVT = 6,
+    ESP_GATTS_CREATE_EVT = 7,
+    ESP_GATTS_ADD_INCL_SRVC_EVT = 8,
+    ESP_GATTS_ADD_CHAR_EVT = 9,
+    ESP_GATTS_ADD_CHAR_DESCR_EVT = 10,
+    ESP_GATTS_DELETE_EVT = 11,
+    ESP_GATTS_START_EVT = 12,
+    ESP_GATTS_STOP_EVT = 13,
+    ESP_GATTS_CONNECT_EVT = 14,
+    ESP_GATTS_DISCONNECT_EVT = 15,
+} esp_gatts_cb_event_t;
+
+typedef union {
+    struct gatts_reg_evt_param {
+        esp_gatt_status_t status;
+        uint16_t app_id;
+    } reg;
+    struct gatts_read_evt_param {
+        uint16_t conn_id;
+        uint32_t trans_id;
+        esp_bd_addr_t bda;
+        uint16_t handle;
+        uint16_t offset;
+        bool is_long;
+        bool need_rsp;
+    } read;
+    struct gatts_write_evt_param {
+        uint16_t conn_id;
+        uint32_t trans_id;
+        esp_bd_addr_t bda;
+        uint16_t handle;
+        uint16_t offset;
+        bool need_rsp;
+        bool is_prep;
+        uint16_t len;
+        uint8_t *value;
+    } write;
+    struct gatts_mtu_evt_param {
+        uint16_t conn_id;
+        uint16_t mtu;
+    } mtu;
+    struct gatts_conf_evt_param {
+        esp_gatt_status_t status;
+        uint16_t conn_id;
+        uint16_t handle;
+        uint16_t len;
+        uint8_t *value;
+    } conf;
+    struct gatts_create_evt_param {
+        esp_gatt_status_t status;
+        uint16_t service_handle;
+        esp_gatt_srvc_id_t service_id;
+    } create;
+    struct gatts_add_char_evt_param {
+        esp_gatt_status_t status;
+        uint16_t attr_handle;
+        uint16_t service_handle;
+        esp_bt_uuid_t char_uuid;
+    } add_char;
+    struct gatts_add_char_descr_evt_param {
+        esp_gatt_status_t status;
+        uint16_t attr_handle;
+        uint16_t service_handle;
+        esp_bt_uuid_t descr_uuid;
+    } add_char_descr;
+    struct gatts_start_evt_param {
+        esp_gatt_status_t status;
+        uint16_t service_handle;
+    } start;
+    struct gatts_connect_evt_param {
+        uint16_t conn_id;
+        uint8_t link_role;
+        esp_bd_addr_t remote_bda;
+    } connect;
+    struct gatts_disconnect_evt_param {
+        uint16_t conn_id;
+        esp_bd_addr_t remote_bda;
+        esp_gatt_conn_reason_t reason;
+    } disconnect;
+} esp_ble_gatts_cb_param_t;
+
+typedef void (*esp_gatts_cb_t)(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param);
+
+esp_err_t esp_ble_gatts_register_callback(esp_gatts_cb_t callback);
+esp_err_t esp_ble_gatts_app_register(uint16_t app_id);
+esp_err_t esp_ble_gatts_create_service(esp_gatt_if_t gatts_if, esp_gatt_srvc_id_t *service_id, uint16_t num_handle);
+esp_err_t esp_ble_gatts_start_service(uint16_t service_handle);
+esp_err_t esp_ble_gatts_add_char(uint16_t service_handle, esp_bt_uuid_t *char_uuid, esp_gatt_perm_t perm,
+                                 esp_gatt_char_prop_t property, esp_attr_value_t *char_val,
+                                 esp_attr_control_t *control);
+esp_err_t esp_ble_gatts_add_char_descr(uint16_t service_handle, esp_bt_uuid_t *descr_uuid, esp_gatt_perm_t perm,
+                                       esp_attr_value_t *char_descr_val, esp_attr_control_t *control);
+esp_err_t esp_ble_gatts_send_response(esp_gatt_if_t gatts_if, uint16_t conn_id, uint32_t trans_id,
+                                      esp_gatt_status_t status, esp_gatt_rsp_t *rsp);
+esp_err_t esp_ble_gatts_send_indicate(esp_gatt_if_t gatts_if, uint16_t conn_id, uint16_t attr_handle,
+                                      uint16_t value_len, uint8_t *value, bool need_confirm);
+
+#ifdef __cplusplus
+}
+#endif
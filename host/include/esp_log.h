@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Host stand-in for ESP-IDF esp_log.h. Lines carry the virtual boot time in ms, as on the device.
+typedef enum {
+    ESP_LOG_NONE = 0,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE,
+} esp_log_level_t;
+
+// Only "*" is honoured: one level for every tag.
+void esp_log_level_set(const char *tag, esp_log_level_t level);
+uint32_t esp_log_timestamp(void);
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+    __attribute__((format(printf, 3, 4)));
+
+#define ESP_HOST_LOG(level_, letter_, tag_, fmt_, ...) \
+    esp_log_write(level_, tag_, letter_ " (%lu) %s: " fmt_ "\n", (unsigned long)esp_log_timestamp(), tag_, ##__VA_ARGS__)
+
+#define ESP_LOGE(tag, fmt, ...) ESP_HOST_LOG(ESP_LOG_ERROR, "E", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) ESP_HOST_LOG(ESP_LOG_WARN, "W", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) ESP_HOST_LOG(ESP_LOG_INFO, "I", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) ESP_HOST_LOG(ESP_LOG_DEBUG, "D", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGV(tag, fmt, ...) ESP_HOST_LOG(ESP_LOG_VERBOSE, "V", tag, fmt, ##__VA_ARGS__)
+
+// 16 bytes per line, as IDF prints them.
+void esp_log_buffer_hex_internal(const char *tag, const void *buffer, uint16_t buff_len, esp_log_level_t level);
+#define ESP_LOG_BUFFER_HEX_LEVEL(tag, buffer, buff_len, level) esp_log_buffer_hex_internal(tag, buffer, buff_len, level)
+
+#ifdef __cplusplus
+}
+#endif
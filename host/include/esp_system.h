@@ -0,0 +1,18 @@
+#pragma once
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*shutdown_handler_t)(void);
+
+esp_err_t esp_register_shutdown_handler(shutdown_handler_t handle);
+esp_err_t esp_unregister_shutdown_handler(shutdown_handler_t handle);
+// Runs the shutdown handlers and ends the host run (host_clock_stop()).
+void esp_restart(void) __attribute__((noreturn));
+
+#ifdef __cplusplus
+}
+#endif
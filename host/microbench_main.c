@@ -0,0 +1,79 @@
+// Host runner for the microbenchmarks in main/microbench.h: prints the same report as the chip does at
+// boot with CONFIG_LIGHT_ALARM_MICROBENCH, timed with the host's counter.
+//
+//   ./build-host/microbench > before.txt
+//   (change the code, rebuild)
+//   ./build-host/microbench --baseline before.txt
+//
+// With --baseline, each line also shows the change against the same case in a saved report. Build
+// with optimization (-DCMAKE_BUILD_TYPE=Release) for numbers worth comparing.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_log.h"
+
+#include "microbench.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MICROBENCH_COUNTER "TSC ticks"
+#elif defined(__aarch64__)
+#define MICROBENCH_COUNTER "cntvct ticks"
+#else
+#define MICROBENCH_COUNTER "ns"
+#endif
+
+#define BASELINE_LINE_MAX 160
+
+// Min cycles/call of name in a saved report, or < 0 if it has no such line.
+static double baseline_min(FILE *f, const char *name)
+{
+    char line[BASELINE_LINE_MAX];
+    rewind(f);
+    while (fgets(line, sizeof(line), f)) {
+        char case_name[64];
+        double min = 0;
+        if (sscanf(line, "microbench %63s %lf", case_name, &min) == 2 && strcmp(case_name, name) == 0) {
+            return min;
+        }
+    }
+    return -1;
+}
+
+int main(int argc, char **argv)
+{
+    const char *baseline_path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baseline_path = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--baseline REPORT]\n", argv[0]);
+            return 2;
+        }
+    }
+    FILE *baseline = NULL;
+    if (baseline_path && !(baseline = fopen(baseline_path, "r"))) {
+        fprintf(stderr, "cannot read %s\n", baseline_path);
+        return 1;
+    }
+
+    esp_log_level_set("*", ESP_LOG_WARN);
+    microbench_result_t results[MICROBENCH_MAX_CASES];
+    size_t n = microbench_run_all(results, MICROBENCH_MAX_CASES);
+    microbench_print(stdout, MICROBENCH_COUNTER, results, n);
+
+    if (baseline) {
+        printf("against %s (min):\n", baseline_path);
+        for (size_t i = 0; i < n; i++) {
+            double now = (double)results[i].min_cycles / MICROBENCH_CALLS;
+            double before = baseline_min(baseline, results[i].name);
+            if (before > 0) {
+                printf("  %-36s %10.1f -> %10.1f  %+6.1f%%\n", results[i].name, before, now, (now - before) / before * 100);
+            } else {
+                printf("  %-36s %10s -> %10.1f  (new)\n", results[i].name, "", now);
+            }
+        }
+        fclose(baseline);
+    }
+    return 0;
+}
@@ -0,0 +1,200 @@
+#include "power_model.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define POWER_LINE_MAX 160
+#define POWER_UC_PER_MAH 3.6e6
+
+typedef struct {
+    const char *key;
+    size_t offset;
+} model_key_t;
+
+#define MODEL_KEY(field) {#field, offsetof(power_model_t, field)}
+
+static const model_key_t s_keys[] = {
+    MODEL_KEY(battery_mah),
+    MODEL_KEY(battery_v),
+    MODEL_KEY(rail_v),
+    MODEL_KEY(rail_efficiency),
+    MODEL_KEY(cpu_active_ma),
+    MODEL_KEY(cpu_idle_ma),
+    MODEL_KEY(cpu_sleep_ma),
+    MODEL_KEY(wake_active_ms),
+    MODEL_KEY(adv_interval_ms),
+    MODEL_KEY(adv_event_uc),
+    MODEL_KEY(conn_interval_ms),
+    MODEL_KEY(conn_event_uc),
+    MODEL_KEY(led_warm_ma),
+    MODEL_KEY(led_cool_ma),
+    MODEL_KEY(display_ma),
+    MODEL_KEY(divider_ma),
+};
+
+void power_model_defaults(power_model_t *m)
+{
+    *m = (power_model_t){
+        .battery_mah = 2000,
+        .battery_v = 7.4,
+        .rail_v = 3.3,
+        .rail_efficiency = 0.85,
+        // ESP32-C3 datasheet, modem-sleep at 160 MHz: CPU running / idle; light sleep.
+        .cpu_active_ma = 23,
+        .cpu_idle_ma = 16,
+        .cpu_sleep_ma = 0.13,
+        .idle_light_sleep = false,
+        .wake_active_ms = 0.3,
+        // ble_alarm.c: adv_int 0x20..0x40 (20..40 ms) plus the 0..10 ms advDelay.
+        .adv_interval_ms = 35,
+        .adv_event_uc = 150,
+        .conn_interval_ms = 30,
+        .conn_event_uc = 60,
+        .led_warm_ma = 300,
+        .led_cool_ma = 300,
+        .display_ma = 12,
+        // 7.4 V across 10k + 5.1k.
+        .divider_ma = 0.49,
+    };
+}
+
+static char *trim(char *s)
+{
+    while (isspace((unsigned char)*s)) {
+        s++;
+    }
+    char *end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1])) {
+        *--end = 0;
+    }
+    return s;
+}
+
+esp_err_t power_model_load(power_model_t *m, const char *path, char *err, size_t err_len)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        snprintf(err, err_len, "cannot open %s", path);
+        return ESP_ERR_NOT_FOUND;
+    }
+    char line[POWER_LINE_MAX];
+    int lineno = 0;
+    esp_err_t ret = ESP_OK;
+    while (ret == ESP_OK && fgets(line, sizeof(line), f)) {
+        lineno++;
+        char *hash = strchr(line, '#');
+        if (hash) {
+            *hash = 0;
+        }
+        char *eq = strchr(line, '=');
+        char *key = trim(line);
+        if (!*key) {
+            continue;
+        }
+        if (!eq) {
+            snprintf(err, err_len, "line %d: expected key = value", lineno);
+            ret = ESP_ERR_INVALID_ARG;
+            break;
+        }
+        *eq = 0;
+        key = trim(line);
+        char *val = trim(eq + 1);
+
+        if (strcmp(key, "idle") == 0) {
+            if (strcmp(val, "wfi") == 0 || strcmp(val, "light_sleep") == 0) {
+                m->idle_light_sleep = (val[0] == 'l');
+                continue;
+            }
+            snprintf(err, err_len, "line %d: idle is wfi or light_sleep", lineno);
+            ret = ESP_ERR_INVALID_ARG;
+            break;
+        }
+        const model_key_t *k = NULL;
+        for (size_t i = 0; i < sizeof(s_keys) / sizeof(s_keys[0]) && !k; i++) {
+            if (strcmp(key, s_keys[i].key) == 0) {
+                k = &s_keys[i];
+            }
+        }
+        char *end = NULL;
+        double v = strtod(val, &end);
+        if (!k || end == val || *end || v < 0) {
+            snprintf(err, err_len, "line %d: %s \"%s\"", lineno, k ? "bad value for" : "unknown key", key);
+            ret = ESP_ERR_INVALID_ARG;
+            break;
+        }
+        *(double *)((char *)m + k->offset) = v;
+    }
+    fclose(f);
+    if (ret == ESP_OK && (m->battery_v <= 0 || m->rail_efficiency <= 0 || m->adv_interval_ms <= 0 ||
+                          m->conn_interval_ms <= 0)) {
+        snprintf(err, err_len, "battery_v, rail_efficiency and the intervals must be > 0");
+        ret = ESP_ERR_INVALID_ARG;
+    }
+    return ret;
+}
+
+typedef struct {
+    const char *name;
+    double seconds;
+    double events; // < 0: not an event count
+    double mah;    // from the pack
+} row_t;
+
+static row_t rail_row(const char *name, double seconds, double ma, double rail_to_pack)
+{
+    return (row_t){name, seconds, -1, seconds * ma / 3600.0 * rail_to_pack};
+}
+
+double power_model_report(FILE *out, const power_model_t *m, const power_usage_t *u)
+{
+    const double run_s = (double)u->run_us / 1e6;
+    // Rail current as seen at the pack.
+    const double rail_to_pack = m->rail_v / (m->battery_v * m->rail_efficiency);
+
+    double active_s = (double)u->wakeups * m->wake_active_ms / 1000.0 + (double)u->busy_us / 1e6;
+    if (active_s > run_s) {
+        active_s = run_s;
+    }
+    const double adv_s = (double)u->adv_us / 1e6;
+    const double conn_s = (double)u->conn_us / 1e6;
+    const double adv_events = adv_s * 1000.0 / m->adv_interval_ms;
+    const double conn_events = conn_s * 1000.0 / m->conn_interval_ms;
+
+    row_t rows[] = {
+        rail_row("cpu active", active_s, m->cpu_active_ma, rail_to_pack),
+        rail_row(m->idle_light_sleep ? "cpu light sleep" : "cpu idle", run_s - active_s,
+                 m->idle_light_sleep ? m->cpu_sleep_ma : m->cpu_idle_ma, rail_to_pack),
+        {"radio advertising", adv_s, adv_events, adv_events * m->adv_event_uc / POWER_UC_PER_MAH * rail_to_pack},
+        {"radio connected", conn_s, conn_events, conn_events * m->conn_event_uc / POWER_UC_PER_MAH * rail_to_pack},
+        {"led warm (full-duty s)", u->led_warm_full_s, -1, u->led_warm_full_s * m->led_warm_ma / 3600.0},
+        {"led cool (full-duty s)", u->led_cool_full_s, -1, u->led_cool_full_s * m->led_cool_ma / 3600.0},
+        rail_row("display", (double)u->display_us / 1e6, m->display_ma, rail_to_pack),
+        {"battery divider", (double)u->divider_us / 1e6, -1, (double)u->divider_us / 1e6 * m->divider_ma / 3600.0},
+    };
+    const size_t n = sizeof(rows) / sizeof(rows[0]);
+
+    double total = 0;
+    for (size_t i = 0; i < n; i++) {
+        total += rows[i].mah;
+    }
+
+    fprintf(out, "power budget (pack %.0f mAh at %.1f V, rail %.1f V at %.0f%%):\n", m->battery_mah, m->battery_v,
+            m->rail_v, m->rail_efficiency * 100);
+    fprintf(out, "  %-24s %12s %12s %10s %10s %6s\n", "", "time s", "events", "avg mA", "mAh", "share");
+    for (size_t i = 0; i < n; i++) {
+        char events[16] = "";
+        if (rows[i].events >= 0) {
+            snprintf(events, sizeof(events), "%.0f", rows[i].events);
+        }
+        fprintf(out, "  %-24s %12.1f %12s %10.3f %10.3f %5.1f%%\n", rows[i].name, rows[i].seconds, events,
+                run_s > 0 ? rows[i].mah * 3600.0 / run_s : 0.0, rows[i].mah, total > 0 ? rows[i].mah / total * 100 : 0.0);
+    }
+    double avg_ma = run_s > 0 ? total * 3600.0 / run_s : 0;
+    fprintf(out, "  %-24s %12.1f %12s %10.3f %10.3f\n", "total", run_s, "", avg_ma, total);
+    if (total > 0) {
+        fprintf(out, "nights per charge: %.1f (one %.1f h run per night), %.0f h to empty at %.2f mA\n",
+                m->battery_mah / total, run_s / 3600.0, m->battery_mah / avg_ma, avg_ma);
+    }
+    return total;
+}
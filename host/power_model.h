@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Energy model for a simulated run: per-state and per-peripheral currents, integrated over the time
+// each was active (sim.c supplies the usage). Currents on the 3.3 V rail are referred to the pack
+// through the regulator; the LEDs and the battery divider hang off the pack directly.
+//
+// Figures come from a "key = value" file (host/power_model.txt); keys left out keep the defaults
+// below, which are datasheet typicals for the ESP32-C3 and placeholders for the board parts until
+// they are measured.
+
+typedef struct {
+    double battery_mah;      // usable pack capacity
+    double battery_v;        // pack voltage (nominal)
+    double rail_v;           // logic rail
+    double rail_efficiency;  // pack -> rail converter (an LDO is rail_v / battery_v)
+    double cpu_active_ma;    // CPU running
+    double cpu_idle_ma;      // CPU idle between wakeups, no power management (WFI, clocks on)
+    double cpu_sleep_ma;     // automatic light sleep between wakeups
+    bool idle_light_sleep;   // idle in light sleep (CONFIG_PM_ENABLE + tickless idle) instead
+    double wake_active_ms;   // CPU run time charged per wakeup
+    double adv_interval_ms;  // mean advertising interval, advDelay included
+    double adv_event_uc;     // charge per advertising event (3 channels + scan responses)
+    double conn_interval_ms; // connection interval the central picks
+    double conn_event_uc;    // charge per (mostly empty) connection event
+    double led_warm_ma;      // pack current at full duty
+    double led_cool_ma;
+    double display_ma;       // CH455G with HH.MM lit, at the configured intensity
+    double divider_ma;       // battery divider while BAT_ADC_EN is high
+} power_model_t;
+
+// What the run did, in the model's terms.
+typedef struct {
+    int64_t run_us;
+    uint32_t wakeups;
+    int64_t busy_us;        // busy-waits (bit-banged bus)
+    int64_t adv_us;
+    int64_t conn_us;
+    double led_warm_full_s; // full-duty-equivalent seconds
+    double led_cool_full_s;
+    int64_t display_us;
+    int64_t divider_us;
+} power_usage_t;
+
+void power_model_defaults(power_model_t *m);
+
+// Overrides m from a model file. On failure err explains why (unknown key, bad number).
+esp_err_t power_model_load(power_model_t *m, const char *path, char *err, size_t err_len);
+
+// Prints the breakdown table and the nights-per-charge estimate; returns the run's total in mAh.
+double power_model_report(FILE *out, const power_model_t *m, const power_usage_t *u);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,840 @@
+#include "sim.h"
+
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_log.h"
+
+#include "ble_alarm.h"
+#include "ble_alarm_host.h"
+#include "civil_time.h"
+#include "hal_host.h"
+#include "host_clock.h"
+#include "host_idf.h"
+#include "host_trace.h"
+#include "time_service.h"
+#include "time_sync.h"
+
+static const char *TAG = "SIM";
+
+// Board wiring, as in main/app_main.c.
+#define SIM_PIN_I2C_SDA    4
+#define SIM_PIN_I2C_SCL    5
+#define SIM_PIN_BTN        20
+#define SIM_PIN_BAT_ADC    3
+#define SIM_PIN_BAT_ADC_EN 21
+
+// Battery divider (battery.c): 10k over 5.1k.
+#define SIM_BATT_DIV_NUM 5100
+#define SIM_BATT_DIV_DEN 15100
+
+// CH455G commands (ch455g.c).
+#define SIM_CH455_SYS_PARAM 0x48
+#define SIM_CH455_DIG0      0x68
+#define SIM_CH455_SYS_ENA   (1u << 0)
+#define SIM_CH455_SYS_SLEEP (1u << 2)
+
+#define SIM_LINE_MAX   256
+#define SIM_VALUE_MAX  128
+#define SIM_READ_MAX   512
+#define SIM_SYNC_LEG_US 15000
+
+typedef enum {
+    STEP_RTC,
+    STEP_PHONE,
+    STEP_DRIFT,
+    STEP_BATT,
+    STEP_PRESS,
+    STEP_CONNECT,
+    STEP_DISCONNECT,
+    STEP_WRITE,
+    STEP_READ,
+    STEP_SYNC,
+    STEP_EXPECT,
+    STEP_END,
+} step_kind_t;
+
+typedef enum {
+    OP_LT,
+    OP_LE,
+    OP_EQ,
+    OP_NE,
+    OP_GE,
+    OP_GT,
+} cmp_op_t;
+
+typedef struct {
+    step_kind_t kind;
+    int line;
+    int64_t value; // ms, ppm, mV, press duration (us), exchange count, expected value
+    int64_t leg_us;
+    uint16_t uuid;
+    uint8_t data[SIM_VALUE_MAX];
+    size_t len;
+    char key[16];
+    cmp_op_t op;
+} step_t;
+
+typedef struct {
+    int left;
+    int64_t leg_us;
+    uint8_t seq;
+    int stage;
+} sync_run_t;
+
+static const char *const s_op_names[] = {"<", "<=", "==", "!=", ">=", ">"};
+
+static step_t **s_steps; // kept for the whole run: pending stimuli point into them
+static size_t s_step_count;
+
+static int64_t s_phone_base_ms;
+static int64_t s_phone_base_us;
+static bool s_phone_explicit;
+
+static uint32_t s_passed;
+static uint32_t s_failed;
+
+// Display, decoded from the CH455G bus.
+static uint8_t s_disp_sys;
+static uint8_t s_disp_dig[4];
+static bool s_disp_lit;
+static int64_t s_disp_since_us;
+static int64_t s_disp_lit_us;
+static uint32_t s_disp_updates;
+static bool s_disp_changed; // digits written since the last refresh differ
+
+// Wakeups.
+static int64_t s_last_wake_us;
+static int64_t s_max_gap_us;
+static uint32_t s_wakes_per_hour_max;
+static uint32_t s_wakes_this_hour;
+static int64_t s_hour_start_us;
+
+// Light.
+static FILE *s_light_csv;
+static uint32_t s_peak_duty[HAL_HOST_PWM_CHANNELS];
+static int64_t s_first_light_us = -1;
+static int64_t s_peak_at_us[HAL_HOST_PWM_CHANNELS];
+
+static int64_t phone_ms_at(int64_t mono_us)
+{
+    int64_t d_us = mono_us - s_phone_base_us;
+    return s_phone_base_ms + (d_us >= 0 ? d_us / 1000 : -((-d_us + 999) / 1000));
+}
+
+void sim_set_phone_ms(int64_t utc_ms)
+{
+    s_phone_base_ms = utc_ms;
+    s_phone_base_us = host_clock_now_us();
+}
+
+// --- board decoders ------------------------------------------------------------------------------
+
+static char seg_to_char(uint8_t seg)
+{
+    static const uint8_t map[10] = {0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07, 0x7F, 0x6F};
+    seg &= 0x7F;
+    if (seg == 0) {
+        return ' ';
+    }
+    for (int i = 0; i < 10; i++) {
+        if (map[i] == seg) {
+            return (char)('0' + i);
+        }
+    }
+    return '?';
+}
+
+static void disp_account(void)
+{
+    int64_t now_us = host_clock_now_us();
+    if (s_disp_lit) {
+        s_disp_lit_us += now_us - s_disp_since_us;
+    }
+    s_disp_since_us = now_us;
+}
+
+static void disp_refresh(void)
+{
+    bool any = s_disp_dig[0] || s_disp_dig[1] || s_disp_dig[2] || s_disp_dig[3];
+    bool lit = (s_disp_sys & SIM_CH455_SYS_ENA) && !(s_disp_sys & SIM_CH455_SYS_SLEEP) && any;
+    bool changed = s_disp_changed;
+    s_disp_changed = false;
+    if (lit != s_disp_lit || (lit && changed)) {
+        disp_account();
+        s_disp_lit = lit;
+        if (lit) {
+            char text[9];
+            size_t n = 0;
+            for (int i = 0; i < 4; i++) {
+                text[n++] = seg_to_char(s_disp_dig[i]);
+                if (s_disp_dig[i] & 0x80) {
+                    text[n++] = '.';
+                }
+            }
+            text[n] = 0;
+            s_disp_updates++;
+            host_trace("disp", "\"%s\"", text);
+        } else {
+            host_trace("disp", "dark");
+        }
+    }
+}
+
+static void on_i2c(const uint8_t *bytes, size_t len)
+{
+    if (len != 2) {
+        return;
+    }
+    if (bytes[0] == SIM_CH455_SYS_PARAM) {
+        s_disp_sys = bytes[1];
+        disp_refresh();
+    } else if (bytes[0] >= SIM_CH455_DIG0 && bytes[0] <= SIM_CH455_DIG0 + 6 && !(bytes[0] & 1)) {
+        int idx = (bytes[0] - SIM_CH455_DIG0) / 2;
+        s_disp_changed |= s_disp_dig[idx] != bytes[1];
+        s_disp_dig[idx] = bytes[1];
+        // A render writes DIG0..DIG3 in order; take the result once it is complete.
+        if (idx == 3) {
+            disp_refresh();
+        }
+    }
+}
+
+static void on_wake(int64_t at_us, host_clock_wake_t source)
+{
+    static const char *const names[] = {"timer", "task", "radio"};
+    host_trace("wake", "%s", names[source]);
+    if (at_us - s_last_wake_us > s_max_gap_us) {
+        s_max_gap_us = at_us - s_last_wake_us;
+    }
+    s_last_wake_us = at_us;
+    while (at_us - s_hour_start_us >= 3600LL * 1000000) {
+        s_hour_start_us += 3600LL * 1000000;
+        s_wakes_this_hour = 0;
+    }
+    if (++s_wakes_this_hour > s_wakes_per_hour_max) {
+        s_wakes_per_hour_max = s_wakes_this_hour;
+    }
+}
+
+static void on_pwm(int64_t at_us, uint8_t channel, uint32_t duty)
+{
+    static const char *const names[] = {"warm", "cool"};
+    if (s_light_csv) {
+        fprintf(s_light_csv, "%lld.%06lld,%s,%lu\n", (long long)(at_us / 1000000), (long long)(at_us % 1000000),
+                names[channel], (unsigned long)duty);
+    }
+    if (duty > 0 && s_first_light_us < 0) {
+        s_first_light_us = at_us;
+    }
+    if (duty > s_peak_duty[channel]) {
+        s_peak_duty[channel] = duty;
+        s_peak_at_us[channel] = at_us;
+    }
+}
+
+void sim_attach(FILE *light_csv)
+{
+    s_light_csv = light_csv;
+    if (s_light_csv) {
+        fprintf(s_light_csv, "t_s,channel,duty\n");
+    }
+    hal_host_i2c_watch(SIM_PIN_I2C_SDA, SIM_PIN_I2C_SCL, on_i2c);
+    hal_host_pwm_set_observer(on_pwm);
+    host_clock_set_wake_hook(on_wake);
+}
+
+// --- steps ---------------------------------------------------------------------------------------
+
+static void put_i64_le(uint8_t *p, int64_t v)
+{
+    for (int i = 0; i < 8; i++) {
+        p[i] = (uint8_t)((uint64_t)v >> (8 * i));
+    }
+}
+
+static bool sync_stage(void *arg)
+{
+    sync_run_t *run = (sync_run_t *)arg;
+    int64_t now_us = host_clock_now_us();
+    uint8_t buf[1 + 1 + 8];
+    uint8_t rsp[TIME_SYNC_STATUS_LEN];
+
+    switch (run->stage) {
+    case 0: // request arrives; the phone stamped t1 as it sent it, one leg ago
+        buf[0] = TIME_SYNC_OP_REQUEST;
+        buf[1] = run->seq;
+        put_i64_le(&buf[2], phone_ms_at(now_us - run->leg_us));
+        (void)ble_alarm_host_write(0xFF1C, buf, sizeof(buf));
+        run->stage = 1;
+        (void)host_clock_at(now_us + 2 * run->leg_us, sync_stage, run);
+        break;
+    case 1: // read request arrives; the response reaches the phone one leg later (t4)
+        (void)ble_alarm_host_read(0xFF1C, rsp, sizeof(rsp));
+        run->stage = 2;
+        (void)host_clock_at(now_us + 2 * run->leg_us, sync_stage, run);
+        break;
+    case 2: // finish arrives
+        buf[0] = TIME_SYNC_OP_FINISH;
+        buf[1] = run->seq;
+        put_i64_le(&buf[2], phone_ms_at(now_us - run->leg_us));
+        (void)ble_alarm_host_write(0xFF1C, buf, sizeof(buf));
+        run->seq++;
+        run->stage = (--run->left > 0) ? 0 : 3;
+        (void)host_clock_at(now_us + run->leg_us, sync_stage, run);
+        break;
+    default: // commit
+        buf[0] = TIME_SYNC_OP_COMMIT;
+        (void)ble_alarm_host_write(0xFF1C, buf, 1);
+        free(run);
+        break;
+    }
+    return true;
+}
+
+static bool release_button(void *arg)
+{
+    (void)arg;
+    hal_host_gpio_drive(SIM_PIN_BTN, -1);
+    return false;
+}
+
+static int64_t expect_value(const char *key, bool *known)
+{
+    *known = true;
+    if (strcmp(key, "warm") == 0) {
+        return hal_host_pwm_duty(0);
+    }
+    if (strcmp(key, "cool") == 0) {
+        return hal_host_pwm_duty(1);
+    }
+    if (strcmp(key, "display") == 0) {
+        return s_disp_lit;
+    }
+    if (strcmp(key, "adv") == 0) {
+        return ble_alarm_is_advertising();
+    }
+    if (strcmp(key, "connected") == 0) {
+        return ble_alarm_is_connected();
+    }
+    if (strcmp(key, "wakeups") == 0) {
+        host_clock_stats_t st;
+        host_clock_get_stats(&st);
+        return st.wakeups;
+    }
+    if (strcmp(key, "nvs_commits") == 0) {
+        host_nvs_stats_t st;
+        host_nvs_get_stats(&st);
+        return st.commits;
+    }
+    if (strcmp(key, "clock_err_ms") == 0) {
+        return time_service_wall_ms() - phone_ms_at(host_clock_now_us());
+    }
+    *known = false;
+    return 0;
+}
+
+static bool compare(int64_t a, cmp_op_t op, int64_t b)
+{
+    switch (op) {
+    case OP_LT: return a < b;
+    case OP_LE: return a <= b;
+    case OP_EQ: return a == b;
+    case OP_NE: return a != b;
+    case OP_GE: return a >= b;
+    case OP_GT: return a > b;
+    }
+    return false;
+}
+
+static bool run_step(void *arg)
+{
+    const step_t *st = (const step_t *)arg;
+    int64_t now_us = host_clock_now_us();
+
+    switch (st->kind) {
+    case STEP_RTC:
+        hal_rtc_set_ms(st->value);
+        if (!s_phone_explicit) {
+            sim_set_phone_ms(st->value);
+        }
+        return false;
+    case STEP_PHONE:
+        sim_set_phone_ms(st->value);
+        s_phone_explicit = true;
+        return false;
+    case STEP_DRIFT:
+        hal_host_rtc_set_drift_ppm((int32_t)st->value);
+        return false;
+    case STEP_BATT:
+        hal_host_adc_set_mv(SIM_PIN_BAT_ADC, (int)(st->value * SIM_BATT_DIV_NUM / SIM_BATT_DIV_DEN),
+                            SIM_PIN_BAT_ADC_EN, 1);
+        return false;
+    case STEP_PRESS:
+        hal_host_gpio_drive(SIM_PIN_BTN, 0);
+        (void)host_clock_at(now_us + st->value, release_button, NULL);
+        return false;
+    case STEP_CONNECT:
+        ble_alarm_host_connect();
+        return true;
+    case STEP_DISCONNECT:
+        ble_alarm_host_disconnect();
+        return true;
+    case STEP_WRITE:
+        if (!ble_alarm_host_write(st->uuid, st->data, st->len)) {
+            ESP_LOGW(TAG, "line %d: write 0x%04X rejected", st->line, (unsigned)st->uuid);
+        }
+        return true;
+    case STEP_READ: {
+        uint8_t buf[SIM_READ_MAX];
+        size_t len = ble_alarm_host_read(st->uuid, buf, sizeof(buf));
+        if (host_trace_enabled()) {
+            char hex[3 * 32 + 4] = "";
+            size_t shown = len < 32 ? len : 32;
+            for (size_t i = 0; i < shown; i++) {
+                snprintf(&hex[i * 3], 4, " %02x", buf[i]);
+            }
+            host_trace("ble", "value 0x%04X:%s%s", (unsigned)st->uuid, hex, len > shown ? " ..." : "");
+        }
+        return true;
+    }
+    case STEP_SYNC: {
+        sync_run_t *run = calloc(1, sizeof(*run));
+        if (!run) {
+            return false;
+        }
+        run->left = (int)st->value;
+        run->leg_us = st->leg_us;
+        (void)sync_stage(run);
+        return true;
+    }
+    case STEP_EXPECT: {
+        bool known = false;
+        int64_t v = expect_value(st->key, &known);
+        if (known && compare(v, st->op, st->value)) {
+            s_passed++;
+            host_trace("sim", "expect %s %s %lld: ok (%lld)", st->key, s_op_names[st->op], (long long)st->value,
+                       (long long)v);
+        } else {
+            s_failed++;
+            fprintf(stderr, "line %d: at %.3f s expected %s %s %lld, got %lld\n", st->line, (double)now_us / 1e6,
+                    st->key, s_op_names[st->op], (long long)st->value, (long long)v);
+            host_trace("sim", "expect %s %s %lld: FAILED (%lld)", st->key, s_op_names[st->op], (long long)st->value,
+                       (long long)v);
+        }
+        return false;
+    }
+    case STEP_END:
+        host_clock_stop("scenario end");
+    }
+    return false;
+}
+
+// --- parsing -------------------------------------------------------------------------------------
+
+static bool parse_number(const char **p, double *out)
+{
+    char *end = NULL;
+    *out = strtod(*p, &end);
+    if (end == *p) {
+        return false;
+    }
+    *p = end;
+    return true;
+}
+
+// "1:30:00", "90", "7h30m", "250ms".
+static bool parse_duration(const char *s, int64_t *out_us)
+{
+    const char *p = s;
+    if (strchr(s, ':')) {
+        double parts[3];
+        int n = 0;
+        for (;;) {
+            if (n == 3 || !parse_number(&p, &parts[n])) {
+                return false;
+            }
+            n++;
+            if (*p != ':') {
+                break;
+            }
+            p++;
+        }
+        if (*p) {
+            return false;
+        }
+        double secs = 0;
+        for (int i = 0; i < n; i++) {
+            secs = secs * 60 + parts[i];
+        }
+        *out_us = (int64_t)(secs * 1e6 + 0.5);
+        return true;
+    }
+    double total = 0;
+    bool any = false;
+    while (*p) {
+        double v;
+        if (!parse_number(&p, &v)) {
+            return false;
+        }
+        double unit = 1e6;
+        if (strncmp(p, "ms", 2) == 0) {
+            unit = 1e3;
+            p += 2;
+        } else if (*p == 's') {
+            p++;
+        } else if (*p == 'm') {
+            unit = 60e6;
+            p++;
+        } else if (*p == 'h') {
+            unit = 3600e6;
+            p++;
+        } else if (*p || any) {
+            return false; // a bare number is seconds, but only on its own
+        }
+        total += v * unit;
+        any = true;
+    }
+    *out_us = (int64_t)(total + 0.5);
+    return any;
+}
+
+// "2026-03-02 22:00:00[.mmm]" (two tokens) or epoch ms.
+static bool parse_utc_ms(char **tok, int ntok, int64_t *out_ms)
+{
+    if (ntok == 1) {
+        char *end = NULL;
+        long long v = strtoll(tok[0], &end, 0);
+        *out_ms = v;
+        return end != tok[0] && *end == 0;
+    }
+    int y, mo, d, h, mi;
+    double sec;
+    if (ntok != 2 || sscanf(tok[0], "%d-%d-%d", &y, &mo, &d) != 3 || sscanf(tok[1], "%d:%d:%lf", &h, &mi, &sec) != 3) {
+        return false;
+    }
+    int64_t days = civil_days_from_date(y, (uint32_t)mo, (uint32_t)d);
+    *out_ms = (days * CIVIL_SECS_PER_DAY + h * 3600 + mi * 60) * 1000 + (int64_t)(sec * 1000 + 0.5);
+    return true;
+}
+
+static bool parse_uuid(const char *s, uint16_t *out)
+{
+    char *end = NULL;
+    unsigned long v = strtoul(s, &end, 16);
+    if (end == s || *end || v > 0xFFFF) {
+        return false;
+    }
+    *out = (uint16_t)v;
+    return true;
+}
+
+// Rest of the line after the UUID: "ASCII" or hex bytes.
+static bool parse_value(const char *s, uint8_t *out, size_t cap, size_t *out_len)
+{
+    while (isspace((unsigned char)*s)) {
+        s++;
+    }
+    size_t n = 0;
+    if (*s == '"') {
+        const char *end = strchr(s + 1, '"');
+        if (!end || (size_t)(end - s - 1) > cap) {
+            return false;
+        }
+        n = (size_t)(end - s - 1);
+        memcpy(out, s + 1, n);
+        *out_len = n;
+        return n > 0;
+    }
+    int nibble = -1;
+    for (; *s; s++) {
+        if (isspace((unsigned char)*s)) {
+            continue;
+        }
+        if (!isxdigit((unsigned char)*s)) {
+            return false;
+        }
+        int v = isdigit((unsigned char)*s) ? *s - '0' : (tolower((unsigned char)*s) - 'a' + 10);
+        if (nibble < 0) {
+            nibble = v;
+        } else {
+            if (n == cap) {
+                return false;
+            }
+            out[n++] = (uint8_t)((nibble << 4) | v);
+            nibble = -1;
+        }
+    }
+    *out_len = n;
+    return n > 0 && nibble < 0;
+}
+
+static bool parse_op(const char *s, cmp_op_t *out)
+{
+    for (size_t i = 0; i < sizeof(s_op_names) / sizeof(s_op_names[0]); i++) {
+        if (strcmp(s, s_op_names[i]) == 0) {
+            *out = (cmp_op_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool fail(char *err, size_t err_len, int line, const char *fmt, ...) __attribute__((format(printf, 4, 5)));
+static bool fail(char *err, size_t err_len, int line, const char *fmt, ...)
+{
+    int n = snprintf(err, err_len, "line %d: ", line);
+    va_list ap;
+    va_start(ap, fmt);
+    if (n >= 0 && (size_t)n < err_len) {
+        vsnprintf(err + n, err_len - (size_t)n, fmt, ap);
+    }
+    va_end(ap);
+    return false;
+}
+
+static bool parse_line(char *line, int lineno, int64_t *prev_us, step_t *st, char *err, size_t err_len)
+{
+    // Keep the raw line for write values (quoted text may hold spaces).
+    char raw[SIM_LINE_MAX];
+    snprintf(raw, sizeof(raw), "%s", line);
+
+    char *tok[8];
+    int ntok = 0;
+    for (char *t = strtok(line, " \t\r\n"); t && ntok < 8; t = strtok(NULL, " \t\r\n")) {
+        tok[ntok++] = t;
+    }
+    if (ntok < 2) {
+        return fail(err, err_len, lineno, "expected TIME ACTION");
+    }
+
+    int64_t at_us = 0;
+    bool rel = tok[0][0] == '+';
+    if (!parse_duration(tok[0] + (rel ? 1 : 0), &at_us)) {
+        return fail(err, err_len, lineno, "bad time \"%s\"", tok[0]);
+    }
+    if (rel) {
+        at_us += *prev_us;
+    }
+    if (at_us < *prev_us) {
+        return fail(err, err_len, lineno, "time goes backwards");
+    }
+    *prev_us = at_us;
+
+    memset(st, 0, sizeof(*st));
+    st->line = lineno;
+    const char *act = tok[1];
+    char **args = &tok[2];
+    int nargs = ntok - 2;
+
+    if (strcmp(act, "rtc") == 0 || strcmp(act, "phone") == 0) {
+        st->kind = (act[0] == 'r') ? STEP_RTC : STEP_PHONE;
+        if (!parse_utc_ms(args, nargs, &st->value)) {
+            return fail(err, err_len, lineno, "expected DATE TIME or epoch ms");
+        }
+    } else if (strcmp(act, "drift") == 0 || strcmp(act, "batt") == 0) {
+        st->kind = (act[0] == 'd') ? STEP_DRIFT : STEP_BATT;
+        char *end = NULL;
+        st->value = nargs == 1 ? strtoll(args[0], &end, 0) : 0;
+        if (nargs != 1 || *end) {
+            return fail(err, err_len, lineno, "expected a number");
+        }
+    } else if (strcmp(act, "press") == 0) {
+        st->kind = STEP_PRESS;
+        if (nargs != 1 || !parse_duration(args[0], &st->value) || st->value <= 0) {
+            return fail(err, err_len, lineno, "expected a press duration");
+        }
+    } else if (strcmp(act, "connect") == 0 || strcmp(act, "disconnect") == 0 || strcmp(act, "end") == 0) {
+        st->kind = (act[0] == 'c') ? STEP_CONNECT : (act[0] == 'd') ? STEP_DISCONNECT : STEP_END;
+    } else if (strcmp(act, "write") == 0) {
+        st->kind = STEP_WRITE;
+        if (nargs < 2 || !parse_uuid(args[0], &st->uuid)) {
+            return fail(err, err_len, lineno, "expected write UUID VALUE");
+        }
+        // Value: everything after the UUID token in the raw line.
+        const char *v = raw + (args[0] - line) + strlen(args[0]);
+        if (!parse_value(v, st->data, sizeof(st->data), &st->len)) {
+            return fail(err, err_len, lineno, "bad value (\"ASCII\" or hex bytes)");
+        }
+    } else if (strcmp(act, "read") == 0) {
+        st->kind = STEP_READ;
+        if (nargs != 1 || !parse_uuid(args[0], &st->uuid)) {
+            return fail(err, err_len, lineno, "expected read UUID");
+        }
+    } else if (strcmp(act, "sync") == 0) {
+        st->kind = STEP_SYNC;
+        st->value = 3;
+        st->leg_us = SIM_SYNC_LEG_US;
+        char *end = NULL;
+        if (nargs >= 1) {
+            st->value = strtoll(args[0], &end, 0);
+        }
+        if ((nargs >= 1 && (*end || st->value < 1 || st->value > 255)) ||
+            (nargs >= 2 && !parse_duration(args[1], &st->leg_us)) || nargs > 2) {
+            return fail(err, err_len, lineno, "expected sync [N] [LEG]");
+        }
+    } else if (strcmp(act, "expect") == 0) {
+        st->kind = STEP_EXPECT;
+        char *end = NULL;
+        if (nargs != 3 || strlen(args[0]) >= sizeof(st->key) || !parse_op(args[1], &st->op)) {
+            return fail(err, err_len, lineno, "expected expect KEY OP VALUE");
+        }
+        snprintf(st->key, sizeof(st->key), "%s", args[0]);
+        bool known = false;
+        (void)expect_value(st->key, &known);
+        st->value = strtoll(args[2], &end, 0);
+        if (!known || *end) {
+            return fail(err, err_len, lineno, "unknown key \"%s\" or bad value", args[0]);
+        }
+    } else {
+        return fail(err, err_len, lineno, "unknown action \"%s\"", act);
+    }
+    return host_clock_at(at_us, run_step, st) ? true : fail(err, err_len, lineno, "out of memory");
+}
+
+esp_err_t sim_load(const char *path, char *err, size_t err_len)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        snprintf(err, err_len, "cannot open %s", path);
+        return ESP_ERR_NOT_FOUND;
+    }
+    char line[SIM_LINE_MAX];
+    int lineno = 0;
+    int64_t prev_us = 0;
+    esp_err_t ret = ESP_OK;
+    while (fgets(line, sizeof(line), f)) {
+        lineno++;
+        // Strip comments outside quotes.
+        bool quoted = false;
+        for (char *c = line; *c; c++) {
+            if (*c == '"') {
+                quoted = !quoted;
+            } else if (*c == '#' && !quoted) {
+                *c = 0;
+                break;
+            }
+        }
+        const char *p = line;
+        while (isspace((unsigned char)*p)) {
+            p++;
+        }
+        if (!*p) {
+            continue;
+        }
+        step_t **grown = realloc(s_steps, (s_step_count + 1) * sizeof(*s_steps));
+        step_t *st = grown ? calloc(1, sizeof(*st)) : NULL;
+        if (grown) {
+            s_steps = grown;
+        }
+        if (!st) {
+            snprintf(err, err_len, "out of memory");
+            ret = ESP_ERR_NO_MEM;
+            break;
+        }
+        if (!parse_line(line, lineno, &prev_us, st, err, err_len)) {
+            free(st);
+            ret = ESP_ERR_INVALID_ARG;
+            break;
+        }
+        s_steps[s_step_count++] = st;
+    }
+    fclose(f);
+    return ret;
+}
+
+uint32_t sim_failures(void)
+{
+    return s_failed;
+}
+
+// --- report --------------------------------------------------------------------------------------
+
+static void format_utc(int64_t ms, char *out, size_t cap)
+{
+    int64_t secs = (ms >= 0) ? ms / 1000 : -((-ms + 999) / 1000);
+    int32_t year;
+    uint8_t month, day;
+    civil_date_from_days(civil_days_of(secs), &year, &month, &day);
+    uint32_t sod = civil_second_of_day(secs);
+    snprintf(out, cap, "%04d-%02u-%02u %02u:%02u:%02u UTC", (int)year, (unsigned)month, (unsigned)day,
+             (unsigned)(sod / 3600), (unsigned)(sod / 60 % 60), (unsigned)(sod % 60));
+}
+
+void sim_report(FILE *out, const timer_wheel_stats_t *wheel)
+{
+    int64_t now_us = host_clock_now_us();
+    double hours = (double)now_us / 3600e6;
+    char wall[40];
+    format_utc(hal_rtc_get_ms(), wall, sizeof(wall));
+
+    host_clock_stats_t clk;
+    host_clock_get_stats(&clk);
+    host_nvs_stats_t nvs;
+    host_nvs_get_stats(&nvs);
+    ble_alarm_host_stats_t ble;
+    ble_alarm_host_get_stats(&ble);
+    disp_account();
+
+    fprintf(out, "---\n");
+    fprintf(out, "end: %s after %.3f s (RTC %s)\n", host_clock_stop_reason(), (double)now_us / 1e6, wall);
+    fprintf(out, "wakeups: %lu (timer %lu, task %lu, radio %lu), %.1f/h avg, %lu in the busiest hour, longest idle %.1f s\n",
+            (unsigned long)clk.wakeups, (unsigned long)clk.by_source[HOST_CLOCK_WAKE_TIMER],
+            (unsigned long)clk.by_source[HOST_CLOCK_WAKE_TASK], (unsigned long)clk.by_source[HOST_CLOCK_WAKE_STIMULUS],
+            hours > 0 ? (double)clk.wakeups / hours : 0.0, (unsigned long)s_wakes_per_hour_max,
+            (double)s_max_gap_us / 1e6);
+    fprintf(out, "cpu: %lu timer callbacks, %.3f s busy-waiting\n", (unsigned long)clk.callbacks,
+            (double)clk.busy_us / 1e6);
+    if (wheel) {
+        fprintf(out, "timer wheel: wakeups=%lu fired=%lu coalesced=%lu armed=%u\n", (unsigned long)wheel->wakeups,
+                (unsigned long)wheel->fired, (unsigned long)wheel->coalesced, (unsigned)wheel->armed);
+    }
+    fprintf(out, "pwm: %lu Hz %lu-bit, now warm=%lu cool=%lu\n", (unsigned long)hal_host_pwm_freq(),
+            (unsigned long)hal_host_pwm_duty_bits(), (unsigned long)hal_host_pwm_duty(0),
+            (unsigned long)hal_host_pwm_duty(1));
+    static const char *const names[] = {"warm", "cool"};
+    for (uint8_t ch = 0; ch < HAL_HOST_PWM_CHANNELS; ch++) {
+        fprintf(out, "light %s: on %.1f s (%.1f s at full), %lu fades, peak %lu at %.1f s\n", names[ch],
+                (double)hal_host_pwm_on_us(ch) / 1e6, hal_host_pwm_full_s(ch), (unsigned long)hal_host_pwm_fades(ch),
+                (unsigned long)s_peak_duty[ch], (double)s_peak_at_us[ch] / 1e6);
+    }
+    if (s_first_light_us >= 0) {
+        fprintf(out, "first light: %.1f s\n", (double)s_first_light_us / 1e6);
+    }
+    fprintf(out, "display: lit %.1f s, %lu renders\n", (double)s_disp_lit_us / 1e6, (unsigned long)s_disp_updates);
+    fprintf(out, "battery sense: divider on %.3f s, %lu ADC reads\n",
+            (double)hal_host_gpio_high_us(SIM_PIN_BAT_ADC_EN) / 1e6, (unsigned long)hal_host_adc_reads());
+    fprintf(out, "ble: \"%s\" advertising %.1f s (%lu starts), connected %.1f s (%lu), %lu writes, %lu reads, %lu batt notifies\n",
+            ble_alarm_host_name(), (double)ble.adv_us / 1e6, (unsigned long)ble.adv_starts, (double)ble.conn_us / 1e6,
+            (unsigned long)ble.connects, (unsigned long)ble.writes, (unsigned long)ble.reads,
+            (unsigned long)ble.battery_notifies);
+    fprintf(out, "nvs: commits=%lu writes=%lu bytes=%lu entries=%lu\n", (unsigned long)nvs.commits,
+            (unsigned long)nvs.writes, (unsigned long)nvs.bytes, (unsigned long)nvs.entries);
+    if (s_step_count) {
+        fprintf(out, "scenario: %lu steps, expectations %lu passed, %lu failed\n", (unsigned long)s_step_count,
+                (unsigned long)s_passed, (unsigned long)s_failed);
+    }
+}
+
+void sim_power_usage(power_usage_t *u)
+{
+    host_clock_stats_t clk;
+    host_clock_get_stats(&clk);
+    ble_alarm_host_stats_t ble;
+    ble_alarm_host_get_stats(&ble);
+    disp_account();
+
+    *u = (power_usage_t){
+        .run_us = host_clock_now_us(),
+        .wakeups = clk.wakeups,
+        .busy_us = clk.busy_us,
+        .adv_us = ble.adv_us,
+        .conn_us = ble.conn_us,
+        .led_warm_full_s = hal_host_pwm_full_s(0),
+        .led_cool_full_s = hal_host_pwm_full_s(1),
+        .display_us = s_disp_lit_us,
+        .divider_us = hal_host_gpio_high_us(SIM_PIN_BAT_ADC_EN),
+    };
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "esp_err.h"
+
+#include "power_model.h"
+#include "timer_wheel.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Scenario-driven simulation on top of the host build: a script of user and phone actions is played
+// against app_main on the virtual clock while the board's outputs are recorded.
+//
+// Scenario file, one step per line ('#' starts a comment):
+//
+//   TIME ACTION [ARGS]
+//
+// TIME is virtual time since boot, as H:M:S, M:S or S (fractions allowed) or a duration with units
+// (7h30m, 90s, 250ms), or +DURATION after the previous step. Steps at the same time run in file order.
+//
+//   rtc DATE TIME | MS     set the RTC (UTC, "2026-03-02 22:00:00[.mmm]" or epoch ms); until a phone
+//                          step, the phone's clock (the true time) follows the first rtc step
+//   phone DATE TIME | MS   the phone's UTC clock reads this now
+//   drift PPM              RTC rate error from now on
+//   batt MV                battery voltage from now on
+//   press DURATION         hold the button for DURATION
+//   connect | disconnect   a central connects / drops
+//   write UUID VALUE       GATT write; VALUE is "ASCII" or hex bytes (spaces allowed)
+//   read UUID              GATT read, value goes to the trace
+//   sync [N] [LEG]         N (default 3) timed 0xFF1C exchanges against the phone clock and a commit,
+//                          LEG (default 15ms) one-way link delay
+//   expect KEY OP VALUE    check state now; OP is < <= == != >= >. KEY: warm, cool (duty), display,
+//                          adv, connected (0/1), wakeups, nvs_commits, clock_err_ms (firmware wall
+//                          clock minus the phone's)
+//   end                    stop the run
+//
+// Radio steps (connect, disconnect, write, read, sync) wake the CPU; the others act on inputs the
+// firmware polls.
+
+// Parses path and schedules its steps; call before host_clock_run(). On failure err explains why.
+esp_err_t sim_load(const char *path, char *err, size_t err_len);
+
+// True time at boot (phone clock) for runs that set the RTC from the command line.
+void sim_set_phone_ms(int64_t utc_ms);
+
+// Hooks the board decoders (display on the CH455G bus, wakeup log) and starts recording; call before
+// host_clock_run(). light_csv (optional) receives the LED duty breakpoints: t_s,channel,duty.
+void sim_attach(FILE *light_csv);
+
+// Expectations that did not hold.
+uint32_t sim_failures(void);
+
+// Run summary: wakeups, on-times, light, radio, storage; wheel is the timer_wheel snapshot taken at
+// the end of the run.
+void sim_report(FILE *out, const timer_wheel_stats_t *wheel);
+
+// The run so far in the energy model's terms (host/power_model.h).
+void sim_power_usage(power_usage_t *u);
+
+#ifdef __cplusplus
+}
+#endif
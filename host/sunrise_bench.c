@@ -0,0 +1,552 @@
+// Sunrise smoothness benchmark: runs the gradient engine (sunrise.c, light_mix_percent(), pwm_led.c)
+// exactly as app_run_alarm_gradient() drives it, for every duration and peak brightness, against the
+// simulated LEDC backend, and scores what the eye would see.
+//
+// The combined output (warm + cool duty, both channels sharing one brightness budget) is taken
+// relative to full duty and converted to CIE L*. A perceptual step is the change in L* across a
+// 100 ms window, about the eye's integration time, so a fast fade counts like the jump it looks
+// like and a slow one like the LSB steps the LEDC hardware fade actually makes. Per ramp:
+//
+//   max_dl     largest perceptual step (delta L*), with when and between which levels it happens
+//   lit_dl     the same once the light is on (the first fade out of dark has ended)
+//   steps      output level changes (duty LSBs walked, plus jumps)
+//   dark_s     time the output stays at zero after the ramp started
+//   hw_calls   hal_pwm_* calls (set_duty, set_fade, fade_start)
+//   final_l    L* at the peak
+//
+//   ./sunrise_bench --csv sunrise.csv
+//   ./sunrise_bench --minutes 30 --targets 1-100 --csv -
+//   ./sunrise_bench --history ../host/bench/sunrise_history.csv --label "$(git describe --always)"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "hal_host.h"
+#include "host_clock.h"
+#include "light_preset.h"
+#include "pwm_led.h"
+#include "sunrise.h"
+
+// Board pins, as in main/app_main.c.
+#define BENCH_PIN_PWM_WARM 6
+#define BENCH_PIN_PWM_COOL 7
+
+#define BENCH_MINUTES_MAX 60
+#define BENCH_TARGET_MAX  100
+#define BENCH_COLOR_TEMP_DEFAULT 50 // config_schema.h COLOR_TEMP default
+// The eye integrates light over roughly 100 ms: a change faster than that reads as a step.
+#define BENCH_WINDOW_US 100000
+
+// Breakpoints of one channel's duty over the ramp being measured.
+typedef struct {
+    int64_t t_us;
+    uint32_t duty;
+} point_t;
+
+typedef struct {
+    point_t *p;
+    size_t n;
+    size_t cap;
+} track_t;
+
+typedef struct {
+    bool run;
+    double max_dl;
+    double max_dl_at_s;
+    uint32_t max_dl_from;
+    uint32_t max_dl_to;
+    double lit_dl; // as max_dl, once the output is lit (leaves out turning on from dark)
+    double lit_dl_at_s;
+    uint32_t steps;
+    double dark_s;
+    uint32_t hw_calls;
+    double final_l;
+} result_t;
+
+static struct {
+    uint8_t min_minutes, max_minutes;
+    uint8_t min_target, max_target;
+    uint8_t color_temp;
+} s_opt = {1, BENCH_MINUTES_MAX, 1, BENCH_TARGET_MAX, BENCH_COLOR_TEMP_DEFAULT};
+
+static track_t s_track[HAL_HOST_PWM_CHANNELS];
+static bool s_recording;
+static uint32_t s_duty_max;
+static result_t s_results[BENCH_MINUTES_MAX + 1][BENCH_TARGET_MAX + 1];
+
+static void on_pwm(int64_t at_us, uint8_t channel, uint32_t duty)
+{
+    if (!s_recording || channel >= HAL_HOST_PWM_CHANNELS) {
+        return;
+    }
+    track_t *tr = &s_track[channel];
+    if (tr->n == tr->cap) {
+        tr->cap = tr->cap ? tr->cap * 2 : 1024;
+        tr->p = realloc(tr->p, tr->cap * sizeof(point_t));
+        if (!tr->p) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+    }
+    tr->p[tr->n++] = (point_t){at_us, duty};
+}
+
+static double lstar(double level)
+{
+    double y = level / (double)s_duty_max;
+    if (y > 1) {
+        y = 1;
+    }
+    return (y > 216.0 / 24389.0) ? 116.0 * cbrt(y) - 16.0 : y * 24389.0 / 27.0;
+}
+
+// Channel duty just before (left) or at (right) t_us; linear between breakpoints, dark before the
+// first one. *i is the caller's cursor, advanced monotonically.
+static double track_at(const track_t *tr, size_t *i, int64_t t_us, bool right)
+{
+    while (*i < tr->n && tr->p[*i].t_us < t_us) {
+        (*i)++;
+    }
+    size_t j = *i;
+    if (j < tr->n && tr->p[j].t_us == t_us) {
+        if (right) {
+            while (j + 1 < tr->n && tr->p[j + 1].t_us == t_us) {
+                j++;
+            }
+        }
+        return tr->p[j].duty;
+    }
+    if (j == 0) {
+        return 0;
+    }
+    const point_t *a = &tr->p[j - 1];
+    if (j == tr->n) {
+        return a->duty;
+    }
+    const point_t *b = &tr->p[j];
+    return a->duty + ((double)b->duty - a->duty) * (double)(t_us - a->t_us) / (double)(b->t_us - a->t_us);
+}
+
+// Combined output (sum of both channels) at one breakpoint: just before and from t_us on.
+typedef struct {
+    int64_t t_us;
+    double left;
+    double right;
+} level_t;
+
+static level_t *s_levels;
+static size_t s_levels_n, s_levels_cap;
+
+static void push_level(int64_t t_us, double left, double right)
+{
+    if (s_levels_n == s_levels_cap) {
+        s_levels_cap = s_levels_cap ? s_levels_cap * 2 : 1024;
+        s_levels = realloc(s_levels, s_levels_cap * sizeof(level_t));
+        if (!s_levels) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+    }
+    s_levels[s_levels_n++] = (level_t){t_us, left, right};
+}
+
+// Combined output from t_us on, as the hardware holds it (whole duty counts). *k is a cursor that
+// only moves forward.
+static uint32_t level_at(size_t *k, int64_t t_us)
+{
+    while (*k + 1 < s_levels_n && s_levels[*k + 1].t_us <= t_us) {
+        (*k)++;
+    }
+    const level_t *a = &s_levels[*k];
+    double v = a->right;
+    if (a->t_us < t_us && *k + 1 < s_levels_n) {
+        const level_t *b = &s_levels[*k + 1];
+        v = a->right + (b->left - a->right) * (double)(t_us - a->t_us) / (double)(b->t_us - a->t_us);
+    }
+    return (uint32_t)v;
+}
+
+static void note_step(result_t *r, size_t *ka, size_t *kb, int64_t a_us, int64_t t0_us, int64_t lit_us)
+{
+    if (a_us < t0_us) {
+        return;
+    }
+    uint32_t from = level_at(ka, a_us);
+    uint32_t to = level_at(kb, a_us + BENCH_WINDOW_US);
+    double dl = fabs(lstar(to) - lstar(from));
+    if (a_us >= lit_us && dl > r->lit_dl) {
+        r->lit_dl = dl;
+        r->lit_dl_at_s = (double)(a_us - t0_us) / 1e6;
+    }
+    if (dl > r->max_dl) {
+        r->max_dl = dl;
+        r->max_dl_at_s = (double)(a_us - t0_us) / 1e6;
+        r->max_dl_from = from;
+        r->max_dl_to = to;
+    }
+}
+
+// Time within a linear stretch from a to b lasting dt_us that the output reads zero.
+static double dark_part_s(double a, double b, int64_t dt_us)
+{
+    double dt_s = (double)dt_us / 1e6;
+    if (a < 1 && b < 1) {
+        return dt_s;
+    }
+    if (a < 1) {
+        return dt_s * (1 - a) / (b - a);
+    }
+    if (b < 1) {
+        return dt_s * (1 - b) / (a - b);
+    }
+    return 0;
+}
+
+static void score(result_t *r, int64_t t0_us, int64_t t_end_us)
+{
+    // Merge both channels' breakpoints into the combined output.
+    size_t cur[HAL_HOST_PWM_CHANNELS][2] = {{0}};
+    size_t next[HAL_HOST_PWM_CHANNELS] = {0};
+    s_levels_n = 0;
+    int64_t t_us = t0_us;
+    for (;;) {
+        double left = 0, right = 0;
+        for (uint8_t ch = 0; ch < HAL_HOST_PWM_CHANNELS; ch++) {
+            left += track_at(&s_track[ch], &cur[ch][0], t_us, false);
+            right += track_at(&s_track[ch], &cur[ch][1], t_us, true);
+        }
+        push_level(t_us, left, right);
+        if (t_us >= t_end_us) {
+            break;
+        }
+        int64_t t_next = t_end_us;
+        for (uint8_t ch = 0; ch < HAL_HOST_PWM_CHANNELS; ch++) {
+            const track_t *tr = &s_track[ch];
+            while (next[ch] < tr->n && tr->p[next[ch]].t_us <= t_us) {
+                next[ch]++;
+            }
+            if (next[ch] < tr->n && tr->p[next[ch]].t_us < t_next) {
+                t_next = tr->p[next[ch]].t_us;
+            }
+        }
+        t_us = t_next;
+    }
+
+    // Level changes and dark time: the hardware walks each linear stretch one LSB at a time. The
+    // light is on once the first fade out of dark has ended.
+    int64_t lit_us = INT64_MAX;
+    for (size_t k = 0; k < s_levels_n; k++) {
+        const level_t *b = &s_levels[k];
+        if (k > 0) {
+            if (lit_us == INT64_MAX && b->left >= 1) {
+                lit_us = b->t_us;
+            }
+            const level_t *a = &s_levels[k - 1];
+            uint32_t from = (uint32_t)a->right, to = (uint32_t)b->left;
+            r->steps += from < to ? to - from : from - to;
+            r->dark_s += dark_part_s(a->right, b->left, b->t_us - a->t_us);
+        }
+        if ((uint32_t)b->left != (uint32_t)b->right) {
+            r->steps++;
+        }
+    }
+
+    // Largest change over any window: the output is linear between breakpoints and L* is monotone
+    // (concave above its linear toe), so the extremes are windows starting or ending at one.
+    size_t ka = 0, kb = 0, kc = 0, kd = 0;
+    for (size_t k = 0; k < s_levels_n; k++) {
+        int64_t bp = s_levels[k].t_us;
+        note_step(r, &ka, &kb, bp - BENCH_WINDOW_US, t0_us, lit_us);
+        note_step(r, &kc, &kd, bp, t0_us, lit_us);
+    }
+    r->final_l = lstar(s_levels[s_levels_n - 1].right);
+}
+
+// One ramp from dark, as app_run_alarm_gradient() runs it with the alarm due now; then off.
+static void run_ramp(pwm_led_t *led, uint8_t minutes, uint8_t target, result_t *r)
+{
+    for (uint8_t ch = 0; ch < HAL_HOST_PWM_CHANNELS; ch++) {
+        s_track[ch].n = 0;
+    }
+    int64_t t0_us = esp_timer_get_time();
+    uint32_t calls0 = hal_host_pwm_calls();
+    s_recording = true;
+
+    uint32_t total_ms = (uint32_t)minutes * 60u * 1000u;
+    int64_t wall_ms = t0_us / 1000;
+    sunrise_t sr;
+    sunrise_start(&sr, wall_ms + total_ms, total_ms, target, t0_us, wall_ms);
+    uint8_t warm = 0, cool = 0;
+    while (!sunrise_done(&sr, esp_timer_get_time())) {
+        light_mix_percent(sunrise_brightness(&sr, esp_timer_get_time()), s_opt.color_temp, &warm, &cool);
+        (void)pwm_led_fade_percent(led, warm, cool, LIGHT_MIX_FADE_MS);
+        vTaskDelay(pdMS_TO_TICKS(SUNRISE_STEP_MS));
+    }
+    light_mix_percent(target, s_opt.color_temp, &warm, &cool);
+    (void)pwm_led_fade_percent(led, warm, cool, LIGHT_MIX_FADE_MS);
+    vTaskDelay(pdMS_TO_TICKS(LIGHT_MIX_FADE_MS));
+    // Looking at the duties reports the end of the last fade.
+    (void)hal_host_pwm_duty(0);
+    (void)hal_host_pwm_duty(1);
+
+    *r = (result_t){.run = true, .hw_calls = hal_host_pwm_calls() - calls0};
+    s_recording = false;
+    score(r, t0_us, esp_timer_get_time());
+
+    (void)pwm_led_off(led);
+    vTaskDelay(pdMS_TO_TICKS(1000));
+}
+
+static void bench_main(void)
+{
+    pwm_led_t led = {0};
+    if (pwm_led_init(&led, BENCH_PIN_PWM_WARM, BENCH_PIN_PWM_COOL) != ESP_OK) {
+        fprintf(stderr, "pwm_led_init failed\n");
+        exit(1);
+    }
+    s_duty_max = led.duty_max;
+    for (unsigned m = s_opt.min_minutes; m <= s_opt.max_minutes; m++) {
+        for (unsigned t = s_opt.min_target; t <= s_opt.max_target; t++) {
+            run_ramp(&led, (uint8_t)m, (uint8_t)t, &s_results[m][t]);
+        }
+    }
+}
+
+static void write_csv(FILE *out)
+{
+    fprintf(out, "minutes,target,max_dl,max_dl_at_s,max_dl_from,max_dl_to,lit_dl,lit_dl_at_s,steps,dark_s,hw_calls,"
+                 "final_l\n");
+    for (unsigned m = s_opt.min_minutes; m <= s_opt.max_minutes; m++) {
+        for (unsigned t = s_opt.min_target; t <= s_opt.max_target; t++) {
+            const result_t *r = &s_results[m][t];
+            fprintf(out, "%u,%u,%.3f,%.1f,%lu,%lu,%.3f,%.1f,%lu,%.1f,%lu,%.2f\n", m, t, r->max_dl, r->max_dl_at_s,
+                    (unsigned long)r->max_dl_from, (unsigned long)r->max_dl_to, r->lit_dl, r->lit_dl_at_s,
+                    (unsigned long)r->steps, r->dark_s,
+                    (unsigned long)r->hw_calls, r->final_l);
+        }
+    }
+}
+
+typedef struct {
+    uint32_t ramps;
+    const result_t *worst;
+    unsigned worst_minutes, worst_target;
+    const result_t *worst_lit;
+    unsigned worst_lit_minutes, worst_lit_target;
+    double mean_max_dl;
+    double mean_lit_dl;
+    double max_dark_s;
+    uint64_t steps;
+    uint64_t hw_calls;
+    uint64_t ramp_minutes;
+} summary_t;
+
+static void summarize(summary_t *s)
+{
+    *s = (summary_t){0};
+    for (unsigned m = s_opt.min_minutes; m <= s_opt.max_minutes; m++) {
+        for (unsigned t = s_opt.min_target; t <= s_opt.max_target; t++) {
+            const result_t *r = &s_results[m][t];
+            if (!s->worst || r->max_dl > s->worst->max_dl) {
+                s->worst = r;
+                s->worst_minutes = m;
+                s->worst_target = t;
+            }
+            if (!s->worst_lit || r->lit_dl > s->worst_lit->lit_dl) {
+                s->worst_lit = r;
+                s->worst_lit_minutes = m;
+                s->worst_lit_target = t;
+            }
+            s->ramps++;
+            s->mean_max_dl += r->max_dl;
+            s->mean_lit_dl += r->lit_dl;
+            if (r->dark_s > s->max_dark_s) {
+                s->max_dark_s = r->dark_s;
+            }
+            s->steps += r->steps;
+            s->hw_calls += r->hw_calls;
+            s->ramp_minutes += m;
+        }
+    }
+    if (s->ramps) {
+        s->mean_max_dl /= s->ramps;
+        s->mean_lit_dl /= s->ramps;
+    }
+}
+
+// Table axes: these points where the sweep covers them, else the sweep's ends.
+static size_t pick(const unsigned *want, size_t n, unsigned lo, unsigned hi, unsigned *out)
+{
+    size_t k = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (want[i] >= lo && want[i] <= hi) {
+            out[k++] = want[i];
+        }
+    }
+    if (k == 0) {
+        out[k++] = lo;
+        if (hi != lo) {
+            out[k++] = hi;
+        }
+    }
+    return k;
+}
+
+static void print_summary(FILE *out, const summary_t *s)
+{
+    static const unsigned row_want[] = {1, 5, 10, 15, 20, 30, 45, 60};
+    static const unsigned col_want[] = {1, 5, 10, 25, 50, 75, 100};
+    unsigned rows[8], cols[7];
+    size_t nr = pick(row_want, 8, s_opt.min_minutes, s_opt.max_minutes, rows);
+    size_t nc = pick(col_want, 7, s_opt.min_target, s_opt.max_target, cols);
+
+    fprintf(out, "sunrise smoothness: %lu ramps (%u-%u min x %u-%u %%), color_temp %u, %lu Hz, duty_max %lu\n",
+            (unsigned long)s->ramps, s_opt.min_minutes, s_opt.max_minutes, s_opt.min_target, s_opt.max_target,
+            s_opt.color_temp, (unsigned long)hal_host_pwm_freq(), (unsigned long)s_duty_max);
+    fprintf(out, "largest step once lit (dL*) by duration and peak brightness:\n  %8s", "");
+    for (size_t c = 0; c < nc; c++) {
+        fprintf(out, " %6u%%", cols[c]);
+    }
+    fprintf(out, "\n");
+    for (size_t i = 0; i < nr; i++) {
+        fprintf(out, "  %4u min", rows[i]);
+        for (size_t c = 0; c < nc; c++) {
+            fprintf(out, " %7.2f", s_results[rows[i]][cols[c]].lit_dl);
+        }
+        fprintf(out, "\n");
+    }
+    if (s->worst) {
+        fprintf(out, "worst step: dL* %.2f at %u min / %u %% (%.1f s in, duty %lu -> %lu)\n", s->worst->max_dl,
+                s->worst_minutes, s->worst_target, s->worst->max_dl_at_s, (unsigned long)s->worst->max_dl_from,
+                (unsigned long)s->worst->max_dl_to);
+        fprintf(out, "worst step once lit: dL* %.2f at %u min / %u %% (%.1f s in)\n", s->worst_lit->lit_dl,
+                s->worst_lit_minutes, s->worst_lit_target, s->worst_lit->lit_dl_at_s);
+    }
+    fprintf(out, "mean largest step: dL* %.2f (%.2f once lit); longest dark: %.1f s; %llu level steps; %llu hw calls "
+                 "(%.0f per ramp minute)\n",
+            s->mean_max_dl, s->mean_lit_dl, s->max_dark_s, (unsigned long long)s->steps, (unsigned long long)s->hw_calls,
+            s->ramp_minutes ? (double)s->hw_calls / (double)s->ramp_minutes : 0.0);
+}
+
+// Appends the summary as one row (header on a new file), so results can be compared across changes.
+static int append_history(const char *path, const char *label, const summary_t *s)
+{
+    FILE *f = fopen(path, "a+");
+    if (!f) {
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    if (ftell(f) == 0) {
+        fprintf(f, "label,ramps,minutes,targets,color_temp,worst_dl,worst_lit_dl,worst_lit_minutes,worst_lit_target,"
+                   "mean_lit_dl,max_dark_s,steps,hw_calls\n");
+    }
+    fprintf(f, "%s,%lu,%u-%u,%u-%u,%u,%.3f,%.3f,%u,%u,%.3f,%.1f,%llu,%llu\n", label, (unsigned long)s->ramps,
+            s_opt.min_minutes, s_opt.max_minutes, s_opt.min_target, s_opt.max_target, s_opt.color_temp,
+            s->worst ? s->worst->max_dl : 0.0, s->worst_lit ? s->worst_lit->lit_dl : 0.0, s->worst_lit_minutes,
+            s->worst_lit_target, s->mean_lit_dl, s->max_dark_s, (unsigned long long)s->steps,
+            (unsigned long long)s->hw_calls);
+    fclose(f);
+    return 0;
+}
+
+static bool parse_range(const char *val, unsigned max, uint8_t *lo, uint8_t *hi)
+{
+    char *end = NULL;
+    unsigned long a = strtoul(val, &end, 10);
+    unsigned long b = a;
+    if (end == val) {
+        return false;
+    }
+    if (*end == '-') {
+        const char *p = end + 1;
+        b = strtoul(p, &end, 10);
+        if (end == p) {
+            return false;
+        }
+    }
+    if (*end || a < 1 || a > b || b > max) {
+        return false;
+    }
+    *lo = (uint8_t)a;
+    *hi = (uint8_t)b;
+    return true;
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --minutes A[-B]  sunrise durations to run (default 1-60)\n"
+            "  --targets A[-B]  peak brightness, percent (default 1-100)\n"
+            "  --ct N           color temperature 0..100 (default 50)\n"
+            "  --csv FILE       per-ramp results ('-': stdout)\n"
+            "  --history FILE   append the summary as one CSV row\n"
+            "  --label TEXT     history row label (default \"local\")\n",
+            argv0);
+}
+
+int main(int argc, char **argv)
+{
+    const char *csv_path = NULL;
+    const char *history_path = NULL;
+    const char *label = "local";
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *val = (i + 1 < argc) ? argv[i + 1] : NULL;
+        bool ok = (val != NULL);
+        if (!ok) {
+        } else if (strcmp(arg, "--minutes") == 0) {
+            ok = parse_range(val, BENCH_MINUTES_MAX, &s_opt.min_minutes, &s_opt.max_minutes);
+        } else if (strcmp(arg, "--targets") == 0) {
+            ok = parse_range(val, BENCH_TARGET_MAX, &s_opt.min_target, &s_opt.max_target);
+        } else if (strcmp(arg, "--ct") == 0) {
+            unsigned long ct = strtoul(val, NULL, 10);
+            ok = ct <= 100;
+            s_opt.color_temp = (uint8_t)ct;
+        } else if (strcmp(arg, "--csv") == 0) {
+            csv_path = val;
+        } else if (strcmp(arg, "--history") == 0) {
+            history_path = val;
+        } else if (strcmp(arg, "--label") == 0) {
+            label = val;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            usage(argv[0]);
+            return 2;
+        }
+        i++;
+    }
+
+    esp_log_level_set("*", ESP_LOG_WARN);
+    hal_host_pwm_set_observer(on_pwm);
+    host_clock_run(bench_main, INT64_MAX / 2, NULL);
+
+    summary_t sum;
+    summarize(&sum);
+    print_summary(stdout, &sum);
+    if (csv_path) {
+        FILE *csv = (strcmp(csv_path, "-") == 0) ? stdout : fopen(csv_path, "w");
+        if (!csv) {
+            fprintf(stderr, "cannot write %s\n", csv_path);
+            return 1;
+        }
+        write_csv(csv);
+        if (csv != stdout) {
+            fclose(csv);
+        }
+    }
+    if (history_path && append_history(history_path, label, &sum) != 0) {
+        fprintf(stderr, "cannot write %s\n", history_path);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,231 @@
+// Tests of the sunrise ramp (sunrise.c) driven the way the gradient loop drives it: a sample every
+// SUNRISE_STEP_MS on the monotonic clock, and a re-plan whenever the wall clock steps. Whatever the
+// start time or the steps, the brightness never goes down, the position advances at the planned rate
+// (within SUNRISE_RATE_MIN_Q16..SUNRISE_RATE_MAX_Q16) and the peak lands on the peak wall time
+// whenever that rate allows it.
+//
+//   ./build-host/sunrise_test            every case
+//   ./build-host/sunrise_test late_start one case (ctest runs each as sunrise_<case>)
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sunrise.h"
+
+static int s_failed;
+
+#define CHECK(cond)                                                                  \
+    do {                                                                             \
+        if (!(cond)) {                                                               \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            s_failed++;                                                              \
+        }                                                                            \
+    } while (0)
+
+#define MIN_MS  (60LL * 1000LL)
+#define STEP_US (SUNRISE_STEP_MS * 1000LL)
+// An hour-long ramp at 1/4 speed, and then some.
+#define MAX_SAMPLES (5u * 3600u * 1000u / SUNRISE_STEP_MS)
+
+// A wall-clock step the loop sees before the sample at mono_us.
+typedef struct {
+    int64_t mono_us;
+    int64_t step_ms;
+} wall_step_t;
+
+typedef struct {
+    int64_t done_wall_ms; // wall time of the first sample at full brightness
+    uint32_t samples;
+    uint32_t replans;
+} ramp_result_t;
+
+// Runs one ramp of total_ms to peak at wall time peak_ms, starting at wall time start_ms (monotonic
+// time starts at an arbitrary offset), until it is done. Every sample is checked against the last.
+static ramp_result_t run_ramp(int64_t peak_ms, int64_t total_ms, int64_t start_ms, uint8_t target,
+                              const wall_step_t *steps, size_t step_count)
+{
+    ramp_result_t r = {.done_wall_ms = -1};
+    int64_t mono_us = 123456789LL;
+    int64_t wall_off_ms = start_ms - mono_us / 1000; // wall = mono + offset, until a step
+    sunrise_t sr;
+    sunrise_start(&sr, peak_ms, (uint32_t)total_ms, target, mono_us, mono_us / 1000 + wall_off_ms);
+    CHECK(sr.rate_q16 >= SUNRISE_RATE_MIN_Q16 && sr.rate_q16 <= SUNRISE_RATE_MAX_Q16);
+
+    uint8_t last_bright = sunrise_brightness(&sr, mono_us);
+    int32_t last_pos = sunrise_position_ms(&sr, mono_us);
+    CHECK(last_pos == 0 && last_bright <= 1); // from dark, whenever it starts
+    size_t next_step = 0;
+    const int64_t mono_start = mono_us;
+    while (!sunrise_done(&sr, mono_us)) {
+        uint32_t rate = sr.rate_q16;
+        mono_us += STEP_US;
+        while (next_step < step_count && mono_start + steps[next_step].mono_us <= mono_us) {
+            wall_off_ms += steps[next_step++].step_ms;
+            sunrise_replan(&sr, mono_us, mono_us / 1000 + wall_off_ms);
+            CHECK(sr.rate_q16 >= SUNRISE_RATE_MIN_Q16 && sr.rate_q16 <= SUNRISE_RATE_MAX_Q16);
+            r.replans++;
+        }
+        int32_t pos = sunrise_position_ms(&sr, mono_us);
+        uint8_t bright = sunrise_brightness(&sr, mono_us);
+        // The position moves at the rate planned before the sample (a re-plan keeps the position).
+        int64_t adv = pos - last_pos;
+        int64_t max_adv = (SUNRISE_STEP_MS * (int64_t)rate >> 16) + 1;
+        int64_t min_adv = pos == total_ms ? 0 : (SUNRISE_STEP_MS * (int64_t)rate >> 16) - 1;
+        if (adv < min_adv || adv > max_adv || bright < last_bright || bright > target) {
+            if (s_failed < 20) {
+                fprintf(stderr, "sample %u: pos %d -> %d (rate %u), bright %u -> %u\n", r.samples, last_pos, pos, rate,
+                        last_bright, bright);
+            }
+            s_failed++;
+        }
+        last_pos = pos;
+        last_bright = bright;
+        r.samples++;
+        if (r.samples >= MAX_SAMPLES) {
+            CHECK(r.samples < MAX_SAMPLES);
+            break;
+        }
+    }
+    CHECK(sunrise_brightness(&sr, mono_us) == target);
+    r.done_wall_ms = mono_us / 1000 + wall_off_ms;
+    return r;
+}
+
+// Peak within one sample of the peak wall time.
+static bool on_peak(const ramp_result_t *r, int64_t peak_ms)
+{
+    return r->done_wall_ms >= peak_ms - SUNRISE_STEP_MS && r->done_wall_ms <= peak_ms + SUNRISE_STEP_MS;
+}
+
+static void test_on_time(void)
+{
+    const int64_t peak = 1800000000000LL;
+    for (int64_t min = 1; min <= 60; min++) {
+        ramp_result_t r = run_ramp(peak, min * MIN_MS, peak - min * MIN_MS, 100, NULL, 0);
+        CHECK(on_peak(&r, peak));
+        CHECK(r.replans == 0);
+    }
+    // Low targets: the curve stays at 1 for most of the ramp, still never drops.
+    ramp_result_t r = run_ramp(peak, 30 * MIN_MS, peak - 30 * MIN_MS, 3, NULL, 0);
+    CHECK(on_peak(&r, peak));
+}
+
+// Started late (boot, a missed timer, a sync that moved the alarm closer): the ramp is compressed
+// from dark up to 4x, and only beyond that is the peak late.
+static void test_late_start(void)
+{
+    const int64_t peak = 1800000000000LL;
+    const int64_t total = 30 * MIN_MS;
+    // 1/2, 1/3 and just over 1/4 of the ramp left: still on time.
+    static const int64_t left[] = {15 * MIN_MS, 10 * MIN_MS, 7 * MIN_MS + 40000};
+    for (size_t i = 0; i < sizeof(left) / sizeof(left[0]); i++) {
+        ramp_result_t r = run_ramp(peak, total, peak - left[i], 100, NULL, 0);
+        CHECK(on_peak(&r, peak));
+    }
+    // A minute left: 4x, so the peak comes total/4 after the start, not at the peak time.
+    ramp_result_t r = run_ramp(peak, total, peak - MIN_MS, 100, NULL, 0);
+    CHECK(r.done_wall_ms >= peak - MIN_MS + total / 4 - SUNRISE_STEP_MS &&
+          r.done_wall_ms <= peak - MIN_MS + total / 4 + SUNRISE_STEP_MS);
+    // Started after the peak time: 4x from dark as well.
+    r = run_ramp(peak, total, peak + 5 * MIN_MS, 100, NULL, 0);
+    CHECK(r.done_wall_ms <= peak + 5 * MIN_MS + total / 4 + SUNRISE_STEP_MS);
+    // Started early (the alarm moved later while the light was off): stretched, down to 1/4.
+    r = run_ramp(peak, total, peak - 2 * total, 100, NULL, 0);
+    CHECK(on_peak(&r, peak));
+}
+
+// The wall clock steps in the middle of the ramp (SNTP, a phone sync, a manual set).
+static void test_mid_ramp_step(void)
+{
+    const int64_t peak = 1800000000000LL;
+    const int64_t total = 20 * MIN_MS;
+    const int64_t start = peak - total;
+    // Forward 5 minutes at half-way: 5 min of wall time left for 10 of ramp, 2x.
+    wall_step_t fwd = {.mono_us = 10 * MIN_MS * 1000, .step_ms = 5 * MIN_MS};
+    ramp_result_t r = run_ramp(peak, total, start, 100, &fwd, 1);
+    CHECK(r.replans == 1 && on_peak(&r, peak));
+    // Back 5 minutes: 15 min left for 10 of ramp, slowed to 2/3.
+    wall_step_t back = {.mono_us = 10 * MIN_MS * 1000, .step_ms = -5 * MIN_MS};
+    r = run_ramp(peak, total, start, 100, &back, 1);
+    CHECK(r.replans == 1 && on_peak(&r, peak));
+    // Forward past the peak: 4x from where it was.
+    wall_step_t past = {.mono_us = 10 * MIN_MS * 1000, .step_ms = 30 * MIN_MS};
+    r = run_ramp(peak, total, start, 100, &past, 1);
+    CHECK(r.replans == 1 && r.done_wall_ms <= peak + 20 * MIN_MS + total / 8 + SUNRISE_STEP_MS);
+    // Back by hours: slowed to 1/4, never reversed.
+    wall_step_t far_back = {.mono_us = 10 * MIN_MS * 1000, .step_ms = -3 * 60 * MIN_MS};
+    r = run_ramp(peak, total, start, 100, &far_back, 1);
+    CHECK(r.replans == 1);
+    // A late start and then a step, on the same sample as the ramp's first one.
+    wall_step_t early = {.mono_us = STEP_US, .step_ms = -2 * MIN_MS};
+    r = run_ramp(peak, total, peak - 5 * MIN_MS, 100, &early, 1);
+    CHECK(on_peak(&r, peak));
+}
+
+// Random step sequences (a fixed-seed LCG): the invariants hold whatever the clock does.
+static void test_step_storm(void)
+{
+    uint32_t seed = 0x5eed1234u;
+#define RAND() (seed = seed * 1664525u + 1013904223u, seed >> 8)
+    const int64_t peak = 1800000000000LL;
+    for (int run = 0; run < 200; run++) {
+        int64_t total = (int64_t)(1 + RAND() % 60) * MIN_MS;
+        int64_t start = peak - total + ((int64_t)(RAND() % 1200) - 600) * 1000;
+        wall_step_t steps[8];
+        int64_t at_us = 0;
+        size_t n = 1 + RAND() % 8;
+        for (size_t i = 0; i < n; i++) {
+            at_us += (int64_t)(RAND() % 600) * 1000000LL;
+            steps[i].mono_us = at_us;
+            steps[i].step_ms = ((int64_t)(RAND() % 240000) - 120000);
+        }
+        ramp_result_t r = run_ramp(peak, total, start, (uint8_t)(1 + RAND() % 100), steps, n);
+        CHECK(r.done_wall_ms > 0);
+    }
+#undef RAND
+}
+
+static const struct {
+    const char *name;
+    void (*run)(void);
+} s_cases[] = {
+    {"on_time", test_on_time},
+    {"late_start", test_late_start},
+    {"mid_ramp_step", test_mid_ramp_step},
+    {"step_storm", test_step_storm},
+};
+#define CASE_COUNT (sizeof(s_cases) / sizeof(s_cases[0]))
+
+static int run_case(size_t i)
+{
+    int before = s_failed;
+    s_cases[i].run();
+    printf("%s %s\n", s_failed == before ? "PASS" : "FAIL", s_cases[i].name);
+    return s_failed - before;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 1) {
+        for (size_t i = 0; i < CASE_COUNT; i++) {
+            run_case(i);
+        }
+    }
+    for (int a = 1; a < argc; a++) {
+        size_t i = 0;
+        while (i < CASE_COUNT && strcmp(argv[a], s_cases[i].name) != 0) {
+            i++;
+        }
+        if (i == CASE_COUNT) {
+            fprintf(stderr, "unknown case %s; cases:", argv[a]);
+            for (size_t k = 0; k < CASE_COUNT; k++) {
+                fprintf(stderr, " %s", s_cases[k].name);
+            }
+            fprintf(stderr, "\n");
+            return 2;
+        }
+        run_case(i);
+    }
+    return s_failed ? 1 : 0;
+}
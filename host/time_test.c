@@ -0,0 +1,735 @@
+// Tests of the calendar and scheduling code against the C library as the reference: civil_time.c
+// against gmtime_r/timegm, tz.c against localtime_r under the equivalent POSIX TZ rule, and the
+// next-alarm search (timekeeper.c over alarm_sched.c) against a mktime-based search, every minute
+// of a year. Plus the boundaries the sweeps only cross in passing: DST gaps and repeats, leap days,
+// midnight, the week wrap, month and year ends for one-shots and skip dates. And the syncs that set
+// the clock: an HHMMSS sync across midnight, a drift fit fed a reference a day off, a two-way
+// exchange over a jittery, lopsided link.
+//
+//   ./build-host/time_test                  every case
+//   ./build-host/time_test next_alarm_sweep one case (ctest runs each as time_<case>)
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "esp_log.h"
+#include "hal.h"
+#include "nvs_flash.h"
+
+#include "alarm_sched.h"
+#include "civil_time.h"
+#include "config_schema.h"
+#include "device_config.h"
+#include "rtc_drift.h"
+#include "time_sync.h"
+#include "timekeeper.h"
+#include "tz.h"
+
+static int s_failed;
+
+#define CHECK(cond)                                                                  \
+    do {                                                                             \
+        if (!(cond)) {                                                               \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            s_failed++;                                                              \
+        }                                                                            \
+    } while (0)
+
+// Reports the first few mismatches of a sweep in full, then only counts them.
+#define CHECK_EQ(what, a, b, at)                                                                              \
+    do {                                                                                                      \
+        long long a_ = (long long)(a), b_ = (long long)(b);                                                   \
+        if (a_ != b_) {                                                                                       \
+            if (s_failed < 20) {                                                                              \
+                fprintf(stderr, "%s:%d: %s at %lld: %lld != %lld\n", __FILE__, __LINE__, what, (long long)(at), \
+                        a_, b_);                                                                              \
+            }                                                                                                 \
+            s_failed++;                                                                                       \
+        }                                                                                                     \
+    } while (0)
+
+// The zones of tz.h as POSIX TZ strings, for glibc without tzdata.
+static const char *const s_posix[TZ_ZONE_COUNT] = {
+    [TZ_ZONE_UTC] = "UTC0",
+    [TZ_ZONE_EUROPE_LONDON] = "GMT0BST,M3.5.0/1,M10.5.0",
+    [TZ_ZONE_EUROPE_BERLIN] = "CET-1CEST,M3.5.0,M10.5.0/3",
+    [TZ_ZONE_EUROPE_ATHENS] = "EET-2EEST,M3.5.0/3,M10.5.0/4",
+    [TZ_ZONE_EUROPE_MOSCOW] = "MSK-3",
+    [TZ_ZONE_ASIA_DUBAI] = "<+04>-4",
+    [TZ_ZONE_ASIA_KOLKATA] = "IST-5:30",
+    [TZ_ZONE_ASIA_SHANGHAI] = "CST-8",
+    [TZ_ZONE_ASIA_TOKYO] = "JST-9",
+    [TZ_ZONE_AUSTRALIA_SYDNEY] = "AEST-10AEDT,M10.1.0,M4.1.0/3",
+    [TZ_ZONE_PACIFIC_AUCKLAND] = "NZST-12NZDT,M9.5.0,M4.1.0/3",
+    [TZ_ZONE_AMERICA_SAO_PAULO] = "<-03>3",
+    [TZ_ZONE_AMERICA_NEW_YORK] = "EST5EDT,M3.2.0,M11.1.0",
+    [TZ_ZONE_AMERICA_CHICAGO] = "CST6CDT,M3.2.0,M11.1.0",
+    [TZ_ZONE_AMERICA_DENVER] = "MST7MDT,M3.2.0,M11.1.0",
+    [TZ_ZONE_AMERICA_PHOENIX] = "MST7",
+    [TZ_ZONE_AMERICA_LOS_ANGELES] = "PST8PDT,M3.2.0,M11.1.0",
+};
+
+static void select_zone(uint8_t zone)
+{
+    CHECK(tz_set_zone(zone));
+    setenv("TZ", s_posix[zone], 1);
+    tzset();
+}
+
+static time_t utc_of(int year, int month, int day, int hour, int minute)
+{
+    struct tm tm = {.tm_year = year - 1900, .tm_mon = month - 1, .tm_mday = day, .tm_hour = hour, .tm_min = minute};
+    return timegm(&tm);
+}
+
+// Local wall-clock seconds (same epoch as UTC) of utc, by the C library.
+static int64_t libc_local(time_t utc)
+{
+    struct tm tm;
+    localtime_r(&utc, &tm);
+    return (int64_t)utc + tm.tm_gmtoff;
+}
+
+// --- civil_time --------------------------------------------------------------------------------
+
+// Every minute of a leap year and the year after, then every day of three centuries.
+static void test_civil_sweep(void)
+{
+    for (int64_t t = utc_of(2024, 1, 1, 0, 0); t < utc_of(2026, 1, 1, 0, 0); t += 60) {
+        time_t tt = (time_t)t;
+        struct tm tm;
+        gmtime_r(&tt, &tm);
+        civil_time_t ct;
+        civil_from_seconds(t, &ct);
+        if (ct.year != tm.tm_year + 1900 || ct.month != tm.tm_mon + 1 || ct.day != tm.tm_mday ||
+            ct.hour != tm.tm_hour || ct.minute != tm.tm_min || ct.second != tm.tm_sec || ct.wday != tm.tm_wday) {
+            CHECK_EQ("civil_from_seconds", 0, 1, t);
+        }
+        CHECK_EQ("civil_to_seconds", civil_to_seconds(&ct), t, t);
+        CHECK_EQ("second_of_week", civil_second_of_week(t), tm.tm_wday * 86400 + tm.tm_hour * 3600 + tm.tm_min * 60, t);
+    }
+
+    for (int64_t t = utc_of(1900, 1, 1, 12, 0); t < utc_of(2200, 1, 1, 0, 0); t += CIVIL_SECS_PER_DAY) {
+        time_t tt = (time_t)t;
+        struct tm tm;
+        gmtime_r(&tt, &tm);
+        int32_t days = civil_days_of(t);
+        int32_t y;
+        uint8_t m, d;
+        civil_date_from_days(days, &y, &m, &d);
+        CHECK_EQ("date_from_days", y * 10000 + m * 100 + d, (tm.tm_year + 1900) * 10000 + (tm.tm_mon + 1) * 100 + tm.tm_mday,
+                 t);
+        CHECK_EQ("days_from_date", civil_days_from_date(y, m, d), days, t);
+        CHECK_EQ("weekday", civil_weekday(days), tm.tm_wday, t);
+        CHECK_EQ("second_of_day", civil_second_of_day(t), 12 * 3600, t);
+    }
+
+    // Leap years and month lengths, as mktime rolls day 0 back to the previous month's last day.
+    static const int32_t years[] = {1900, 1996, 2000, 2023, 2024, 2100, 2400};
+    for (size_t i = 0; i < sizeof(years) / sizeof(years[0]); i++) {
+        for (int month = 1; month <= 12; month++) {
+            struct tm tm = {.tm_year = years[i] - 1900, .tm_mon = month, .tm_mday = 0, .tm_hour = 12};
+            if (month == 12) {
+                tm = (struct tm){.tm_year = years[i] + 1 - 1900, .tm_mon = 0, .tm_mday = 0, .tm_hour = 12};
+            }
+            (void)timegm(&tm);
+            CHECK_EQ("days_in_month", civil_days_in_month(years[i], (uint32_t)month), tm.tm_mday, years[i] * 100 + month);
+        }
+        CHECK(civil_is_leap(years[i]) == (civil_days_in_month(years[i], 2) == 29));
+    }
+
+    // Out-of-range fields roll over like mktime's.
+    civil_time_t ct = {.year = 2024, .month = 2, .day = 30, .hour = 25, .minute = 61, .second = 61};
+    struct tm tm = {.tm_year = 124, .tm_mon = 1, .tm_mday = 30, .tm_hour = 25, .tm_min = 61, .tm_sec = 61};
+    CHECK(civil_to_seconds(&ct) == (int64_t)timegm(&tm));
+    CHECK(civil_days_from_date(2023, 12, 32) == civil_days_from_date(2024, 1, 1));
+    CHECK(civil_days_of(-1) == -1 && civil_second_of_day(-1) == 86399);
+}
+
+// --- tz ----------------------------------------------------------------------------------------
+
+// Every zone, every hour of the table's years and the second before it, against localtime_r; and
+// local -> UTC back again wherever the local time exists exactly once.
+static void test_tz_offsets(void)
+{
+    for (uint8_t zone = 0; zone < TZ_ZONE_COUNT; zone++) {
+        select_zone(zone);
+        uint32_t changes = 0;
+        int32_t last = tz_offset_at(utc_of(TZ_TABLE_FIRST_YEAR, 1, 1, 0, 0));
+        for (int64_t t = utc_of(TZ_TABLE_FIRST_YEAR, 1, 1, 0, 0); t < utc_of(TZ_TABLE_LAST_YEAR + 1, 1, 1, 0, 0);
+             t += 3600) {
+            for (int64_t s = t - 1; s <= t; s++) {
+                int32_t off = tz_offset_at((time_t)s);
+                CHECK_EQ(tz_zone_name(zone), off, libc_local((time_t)s) - s, s);
+                changes += off != last;
+                last = off;
+            }
+            int64_t local = libc_local((time_t)t);
+            bool unique = libc_local((time_t)t - 3600) - (t - 3600) == local - t &&
+                          libc_local((time_t)t + 3600) - (t + 3600) == local - t;
+            if (unique) {
+                CHECK_EQ(tz_zone_name(zone), tz_local_to_utc((time_t)local), t, t);
+            }
+        }
+        // Two changes a year for the DST zones, none for the others.
+        uint32_t years = TZ_TABLE_LAST_YEAR - TZ_TABLE_FIRST_YEAR + 1;
+        bool dst = strchr(s_posix[zone], ',') != NULL;
+        CHECK_EQ(tz_zone_name(zone), changes, dst ? 2 * years : 0, zone);
+    }
+    CHECK(!tz_set_zone(TZ_ZONE_COUNT) && tz_get_zone() == TZ_ZONE_UTC);
+}
+
+// The hours around the changes: local times in a spring-forward gap map past it by the same
+// distance, repeated ones to their first occurrence.
+static void test_tz_transitions(void)
+{
+    select_zone(TZ_ZONE_EUROPE_BERLIN);
+    // 2026-03-29: 02:00 CET -> 03:00 CEST (01:00 UTC).
+    CHECK(tz_offset_at(utc_of(2026, 3, 29, 0, 59) + 59) == 3600);
+    CHECK(tz_offset_at(utc_of(2026, 3, 29, 1, 0)) == 7200);
+    CHECK(tz_local_to_utc(utc_of(2026, 3, 29, 1, 59)) == utc_of(2026, 3, 29, 0, 59));
+    CHECK(tz_local_to_utc(utc_of(2026, 3, 29, 2, 30)) == utc_of(2026, 3, 29, 1, 30)); // 02:30 is 03:30 CEST
+    CHECK(tz_local_to_utc(utc_of(2026, 3, 29, 3, 0)) == utc_of(2026, 3, 29, 1, 0));
+    // 2026-10-25: 03:00 CEST -> 02:00 CET (01:00 UTC); 02:00-02:59 happens twice.
+    CHECK(tz_local_to_utc(utc_of(2026, 10, 25, 2, 30)) == utc_of(2026, 10, 25, 0, 30));
+    CHECK(tz_local_to_utc(utc_of(2026, 10, 25, 3, 0)) == utc_of(2026, 10, 25, 2, 0));
+    CHECK(tz_utc_to_local(utc_of(2026, 10, 25, 1, 30)) == utc_of(2026, 10, 25, 2, 30));
+
+    select_zone(TZ_ZONE_AMERICA_NEW_YORK);
+    // 2026-03-08 02:00 EST -> 03:00 EDT (07:00 UTC); 2026-11-01 02:00 EDT -> 01:00 EST (06:00 UTC).
+    CHECK(tz_offset_at(utc_of(2026, 3, 8, 7, 0) - 1) == -5 * 3600);
+    CHECK(tz_offset_at(utc_of(2026, 3, 8, 7, 0)) == -4 * 3600);
+    CHECK(tz_local_to_utc(utc_of(2026, 3, 8, 2, 15)) == utc_of(2026, 3, 8, 7, 15));
+    CHECK(tz_local_to_utc(utc_of(2026, 11, 1, 1, 30)) == utc_of(2026, 11, 1, 5, 30));
+    CHECK(tz_offset_at(utc_of(2026, 11, 1, 6, 0)) == -5 * 3600);
+
+    select_zone(TZ_ZONE_AUSTRALIA_SYDNEY);
+    // Southern summer: DST from 2026-10-04 02:00 AEST to 2027-04-04 03:00 AEDT, across the year end.
+    CHECK(tz_offset_at(utc_of(2026, 12, 31, 13, 0)) == 11 * 3600);
+    CHECK(tz_offset_at(utc_of(2026, 7, 1, 0, 0)) == 10 * 3600);
+    CHECK(tz_local_to_utc(utc_of(2026, 10, 4, 2, 30)) == utc_of(2026, 10, 3, 16, 30));
+
+    // Leap day in a DST zone, and the table's ends hold the nearest state.
+    select_zone(TZ_ZONE_AMERICA_LOS_ANGELES);
+    CHECK(tz_utc_to_local(utc_of(2028, 2, 29, 8, 0)) == utc_of(2028, 2, 29, 0, 0));
+    CHECK(tz_offset_at(utc_of(TZ_TABLE_LAST_YEAR + 5, 1, 15, 0, 0)) == -8 * 3600);
+    CHECK(tz_offset_at(utc_of(TZ_TABLE_FIRST_YEAR - 1, 7, 15, 0, 0)) == tz_offset_at(utc_of(TZ_TABLE_FIRST_YEAR, 1, 1, 0, 0)));
+}
+
+// --- next alarm --------------------------------------------------------------------------------
+
+typedef struct {
+    uint8_t hour, minute, weekdays, lead;
+} ref_alarm_t;
+
+// Weekly alarms chosen to land on the awkward instants: inside the EU and US spring-forward gaps and
+// fall-back repeats (Sunday 02:xx), across midnight (00:05 with a 10 min sunrise starts the day
+// before), across the week wrap (Sunday 00:05 starts on Saturday) and a full hour of sunrise.
+static const ref_alarm_t s_ref_alarms[] = {
+    {6, 30, 0x3E, 30},  // weekdays 06:30
+    {2, 40, 0x01, 25},  // Sunday 02:40, start 02:15
+    {1, 50, 0x01, 60},  // Sunday 01:50, start 00:50
+    {0, 5, 0x41, 10},   // Saturday and Sunday 00:05, start 23:55 the day before
+    {23, 59, 0x10, 1},  // Thursday 23:59
+};
+#define REF_ALARMS (sizeof(s_ref_alarms) / sizeof(s_ref_alarms[0]))
+
+// Schema defaults with every slot unused: no presets, no skips.
+static device_config_t empty_cfg(void)
+{
+    device_config_t cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    config_schema_defaults(CFG_SCOPE_GLOBAL, &cfg);
+    for (size_t i = 0; i < DEVICE_CONFIG_MAX_ALARMS; i++) {
+        cfg.alarms[i] = device_config_alarm_default();
+    }
+    for (size_t i = 0; i < DEVICE_CONFIG_MAX_SKIPS; i++) {
+        config_schema_defaults(CFG_SCOPE_SKIP, &cfg.skips[i]);
+    }
+    return cfg;
+}
+
+static void build_ref_sched(alarm_sched_t *sched)
+{
+    device_config_t cfg = empty_cfg();
+    for (size_t i = 0; i < REF_ALARMS; i++) {
+        device_alarm_t *a = &cfg.alarms[i];
+        a->hour = s_ref_alarms[i].hour;
+        a->minute = s_ref_alarms[i].minute;
+        a->weekdays = s_ref_alarms[i].weekdays;
+        a->enabled = 1;
+        a->sunrise_duration = s_ref_alarms[i].lead;
+    }
+    alarm_sched_build(sched, &cfg);
+}
+
+// Local wall seconds to UTC with mktime: the earlier of the standard and daylight readings that
+// really show that wall time, or in a spring-forward gap the standard reading (the time that far
+// past the gap).
+static time_t libc_local_to_utc(int64_t wall)
+{
+    time_t w = (time_t)wall;
+    time_t best = 0;
+    bool found = false;
+    time_t gap = 0;
+    for (int isdst = 0; isdst <= 1; isdst++) {
+        struct tm tm;
+        gmtime_r(&w, &tm);
+        tm.tm_isdst = isdst;
+        time_t t = mktime(&tm);
+        if (isdst == 0) {
+            gap = t;
+        }
+        if (libc_local(t) == wall && (!found || t < best)) {
+            best = t;
+            found = true;
+        }
+    }
+    return found ? best : gap;
+}
+
+// The search as the firmware specifies it, on the C library: the first sunrise start after now on
+// the local wall clock, mapped back to UTC; a start the repeated hour puts behind us counts from now.
+static int64_t ref_seconds_until(time_t now, uint8_t *out_slot)
+{
+    int64_t local = libc_local(now);
+    int64_t day = local / 86400; // sane times only, so no negative floor
+    struct tm tm;
+    time_t lt = (time_t)local;
+    gmtime_r(&lt, &tm);
+    int64_t best = INT64_MAX;
+    for (int d = -1; d <= 8; d++) {
+        int wday = ((tm.tm_wday + d) % 7 + 7) % 7;
+        for (size_t i = 0; i < REF_ALARMS; i++) {
+            const ref_alarm_t *a = &s_ref_alarms[i];
+            if (!(a->weekdays & (1u << wday))) {
+                continue;
+            }
+            int64_t start = (day + d) * 86400 + a->hour * 3600 + a->minute * 60 - a->lead * 60;
+            if (start > local && start < best) {
+                best = start;
+                *out_slot = (uint8_t)i;
+            }
+        }
+    }
+    // The start changes a few times a day; mktime (which re-reads TZ) is the cost of the sweep.
+    static int64_t s_memo_wall = -1;
+    static time_t s_memo_utc;
+    static uint8_t s_memo_zone;
+    if (best != s_memo_wall || tz_get_zone() != s_memo_zone) {
+        s_memo_wall = best;
+        s_memo_utc = libc_local_to_utc(best);
+        s_memo_zone = tz_get_zone();
+    }
+    time_t t = s_memo_utc;
+    if (t <= now) {
+        t = now + (time_t)(best - local);
+    }
+    return (t - now) < 1 ? 1 : (int64_t)(t - now);
+}
+
+// Every minute of 2026 (and the seconds either side of each DST change) in zones with each kind of
+// rule: the integer search matches the mktime one to the second, and picks the same alarm.
+static void test_next_alarm_sweep(void)
+{
+    static const uint8_t zones[] = {TZ_ZONE_UTC, TZ_ZONE_EUROPE_BERLIN, TZ_ZONE_AMERICA_NEW_YORK,
+                                    TZ_ZONE_AUSTRALIA_SYDNEY, TZ_ZONE_ASIA_KOLKATA};
+    alarm_sched_t sched;
+    build_ref_sched(&sched);
+    for (size_t z = 0; z < sizeof(zones) / sizeof(zones[0]); z++) {
+        select_zone(zones[z]);
+        int32_t last_off = tz_offset_at(utc_of(2026, 1, 1, 0, 0));
+        for (int64_t t = utc_of(2026, 1, 1, 0, 0); t < utc_of(2027, 1, 1, 0, 0); t += 60) {
+            int32_t off = tz_offset_at((time_t)t);
+            int64_t from = t, to = t;
+            if (off != last_off) {
+                from = t - 120; // the change happened within the last minute: go over it by the second
+                to = t + 60;
+            }
+            last_off = off;
+            for (int64_t s = from; s <= to; s += (from == to) ? 1 : 7) {
+                uint8_t slot = 0xFF, ref_slot = 0xFE;
+                int64_t got = timekeeper_seconds_until_next_alarm(&sched, (time_t)s, &slot, NULL);
+                int64_t want = ref_seconds_until((time_t)s, &ref_slot);
+                CHECK_EQ(tz_zone_name(zones[z]), got, want, s);
+                CHECK_EQ("slot", slot, ref_slot, s);
+            }
+        }
+    }
+}
+
+// Fixed points where the answer is known by hand.
+static void test_next_alarm_boundaries(void)
+{
+    alarm_sched_t sched;
+    build_ref_sched(&sched);
+    uint8_t slot = 0;
+
+    // Week wrap: Saturday 2026-03-07 23:00 UTC -> the Sunday 00:05 alarm starts Saturday 23:55.
+    select_zone(TZ_ZONE_UTC);
+    CHECK(timekeeper_seconds_until_next_alarm(&sched, utc_of(2026, 3, 7, 23, 0), &slot, NULL) == 55 * 60 && slot == 3);
+    // Midnight: after that start, the next is Sunday's 00:50 (01:50 alarm).
+    CHECK(timekeeper_seconds_until_next_alarm(&sched, utc_of(2026, 3, 7, 23, 55), &slot, NULL) == 55 * 60 && slot == 2);
+    // Thursday 23:58 start, one minute before midnight.
+    CHECK(timekeeper_seconds_until_next_alarm(&sched, utc_of(2026, 3, 5, 23, 0), &slot, NULL) == 58 * 60 && slot == 4);
+
+    // Berlin spring-forward: the Sunday 02:15 start does not exist on 2026-03-29; it comes 03:15 CEST.
+    select_zone(TZ_ZONE_EUROPE_BERLIN);
+    time_t t = utc_of(2026, 3, 29, 0, 0); // 01:00 CET
+    CHECK(timekeeper_seconds_until_next_alarm(&sched, t, &slot, NULL) == 75 * 60 && slot == 1);
+    // Fall-back: 02:15 happens twice on 2026-10-25; the start is the first, 00:15 UTC.
+    t = utc_of(2026, 10, 24, 23, 0); // 01:00 CEST
+    CHECK(timekeeper_seconds_until_next_alarm(&sched, t, &slot, NULL) == 75 * 60 && slot == 1);
+    // ... and once past it in the repeated hour (02:20 CET), it is not run again that night.
+    t = utc_of(2026, 10, 25, 1, 20);
+    CHECK(timekeeper_seconds_until_next_alarm(&sched, t, &slot, NULL) > 3 * 3600 && slot == 0);
+}
+
+// One-shots and skip dates over month, year and leap-day boundaries.
+static void test_dates(void)
+{
+    select_zone(TZ_ZONE_UTC);
+    device_config_t cfg = empty_cfg();
+    // Slot 0: daily 00:10, 30 min sunrise (starts 23:40 the day before).
+    device_alarm_t *a = &cfg.alarms[0];
+    a->hour = 0;
+    a->minute = 10;
+    a->weekdays = DEVICE_ALARM_WEEKDAYS_ALL;
+    a->enabled = 1;
+    a->sunrise_duration = 30;
+    // Slot 1: one-shot 2028-02-29 07:00, 20 min sunrise.
+    a = &cfg.alarms[1];
+    a->hour = 7;
+    a->weekdays = DEVICE_ALARM_WEEKDAYS_ALL;
+    a->enabled = 1;
+    a->sunrise_duration = 20;
+    a->date_year = 28;
+    a->date_month = 2;
+    a->date_day = 29;
+    // Skip New Year's Day and 1 March for slot 0; the 00:10 alarm of those dates starts the day before.
+    cfg.skips[0] = (device_skip_t){.year = 27, .month = 1, .day = 1, .slots_lo = 0x01};
+    cfg.skips[1] = (device_skip_t){.year = 28, .month = 3, .day = 1, .slots_lo = 0x01};
+    CHECK(device_config_is_valid(&cfg));
+    alarm_sched_t sched;
+    alarm_sched_build(&sched, &cfg);
+    uint8_t slot = 0;
+
+    // 2026-12-31 12:00: the 23:40 start belongs to 1 January, which is skipped -> next is 2027-01-01 23:40.
+    CHECK(timekeeper_seconds_until_next_alarm(&sched, utc_of(2026, 12, 31, 12, 0), &slot, NULL) ==
+          utc_of(2027, 1, 1, 23, 40) - utc_of(2026, 12, 31, 12, 0));
+    // The day before: 2026-12-30 23:40 for 31 December rings normally.
+    CHECK(timekeeper_seconds_until_next_alarm(&sched, utc_of(2026, 12, 30, 12, 0), &slot, NULL) == 11 * 3600 + 40 * 60);
+
+    // Leap day: the one-shot starts 2028-02-29 06:40; the 28 Feb 23:40 start (for 29 Feb) still rings.
+    time_t t = utc_of(2028, 2, 28, 12, 0);
+    CHECK(timekeeper_seconds_until_next_alarm(&sched, t, &slot, NULL) == 11 * 3600 + 40 * 60 && slot == 0);
+    t = utc_of(2028, 2, 29, 0, 30);
+    CHECK(timekeeper_seconds_until_next_alarm(&sched, t, &slot, NULL) == 6 * 3600 + 10 * 60 && slot == 1);
+    // 29 Feb 23:40 would be for 1 March, skipped -> 1 March 23:40.
+    t = utc_of(2028, 2, 29, 12, 0);
+    CHECK(timekeeper_seconds_until_next_alarm(&sched, t, &slot, NULL) == utc_of(2028, 3, 1, 23, 40) - t && slot == 0);
+    // Past its date the one-shot never comes back.
+    alarm_sched_hit_t hit;
+    CHECK(alarm_sched_next_at(&sched, utc_of(2028, 3, 1, 0, 0), &hit) && hit.slot == 0);
+
+    // A one-shot across the year end: 2027-01-01 00:05 with a 10 min sunrise starts on 31 December.
+    a = &cfg.alarms[2];
+    *a = device_config_alarm_default();
+    a->hour = 0;
+    a->minute = 5;
+    a->weekdays = DEVICE_ALARM_WEEKDAYS_ALL;
+    a->enabled = 1;
+    a->sunrise_duration = 10;
+    a->date_year = 27;
+    a->date_month = 1;
+    a->date_day = 1;
+    alarm_sched_set_slot(&sched, 2, a);
+    t = utc_of(2026, 12, 31, 23, 50);
+    CHECK(timekeeper_seconds_until_next_alarm(&sched, t, &slot, NULL) == 5 * 60 && slot == 2);
+
+    // skip_next: the next occurrence of slot 0 comes back flagged, the one after it rings.
+    cfg.alarms[0].skip_next = 1;
+    alarm_sched_set_slot(&sched, 0, &cfg.alarms[0]);
+    bool skip = false;
+    t = utc_of(2027, 3, 10, 12, 0);
+    CHECK(timekeeper_seconds_until_next_alarm(&sched, t, &slot, &skip) == 11 * 3600 + 40 * 60 && slot == 0 && skip);
+
+    // Month and year ends with no skips in the way.
+    cfg.alarms[0].skip_next = 0;
+    alarm_sched_set_slot(&sched, 0, &cfg.alarms[0]);
+    static const int ends[][3] = {{2027, 4, 30}, {2027, 1, 31}, {2027, 2, 28}, {2028, 12, 31}};
+    for (size_t i = 0; i < sizeof(ends) / sizeof(ends[0]); i++) {
+        t = utc_of(ends[i][0], ends[i][1], ends[i][2], 23, 45);
+        CHECK(timekeeper_seconds_until_next_alarm(&sched, t, &slot, NULL) == 23 * 3600 + 55 * 60 && slot == 0);
+    }
+}
+
+// The main task applies BLE edits to sched slot by slot (and rebuilds only the skip dates after a
+// skip edit); after any sequence of edits that answers every query like a schedule built from scratch.
+static void test_sched_edits(void)
+{
+    uint32_t seed = 0x0a1a5eedu;
+#define RAND() (seed = seed * 1664525u + 1013904223u, seed >> 8)
+    device_config_t cfg = empty_cfg();
+    alarm_sched_t inc;
+    alarm_sched_build(&inc, &cfg);
+    const int64_t from = (int64_t)utc_of(2027, 1, 1, 0, 0);
+    for (int edit = 0; edit < 400; edit++) {
+        if (RAND() % 4 == 0) {
+            device_skip_t *k = &cfg.skips[RAND() % DEVICE_CONFIG_MAX_SKIPS];
+            *k = (device_skip_t){.year = (uint8_t)(RAND() % 2 ? 27 : 0), .month = (uint8_t)(1 + RAND() % 2),
+                                 .day = (uint8_t)(1 + RAND() % 28), .slots_lo = (uint8_t)RAND(),
+                                 .slots_hi = (uint8_t)RAND()};
+            alarm_sched_set_skips(&inc, cfg.skips);
+        } else {
+            uint8_t slot = (uint8_t)(RAND() % DEVICE_CONFIG_MAX_ALARMS);
+            device_alarm_t *a = &cfg.alarms[slot];
+            a->hour = (uint8_t)(RAND() % 24);
+            a->minute = (uint8_t)(RAND() % 60);
+            a->weekdays = (uint8_t)(RAND() & 0x7F);
+            a->enabled = (uint8_t)(RAND() % 4 != 0);
+            a->sunrise_duration = (uint8_t)(1 + RAND() % 60);
+            a->skip_next = (uint8_t)(RAND() % 8 == 0);
+            a->date_year = (uint8_t)(RAND() % 4 == 0 ? 27 : 0);
+            a->date_month = (uint8_t)(1 + RAND() % 2);
+            a->date_day = (uint8_t)(1 + RAND() % 28);
+            alarm_sched_set_slot(&inc, slot, a);
+        }
+        alarm_sched_t full;
+        alarm_sched_build(&full, &cfg);
+        CHECK_EQ("empty", alarm_sched_is_empty(&inc), alarm_sched_is_empty(&full), edit);
+        for (int64_t t = from; t < from + 60 * 86400; t += 86400 + 3 * 3600 + 7 * 60) {
+            alarm_sched_hit_t hi = {0}, hf = {0};
+            bool oi = alarm_sched_next_at(&inc, t, &hi);
+            bool of = alarm_sched_next_at(&full, t, &hf);
+            CHECK_EQ("found", oi, of, t);
+            if (oi && of) {
+                CHECK_EQ("start", hi.start_local, hf.start_local, t);
+                CHECK_EQ("skip", hi.skip, hf.skip, t);
+                // Two slots may share a start; either is the right answer, as long as its start matches.
+                CHECK_EQ("lead", inc.lead_min[hi.slot], full.lead_min[hi.slot], t);
+            }
+        }
+    }
+#undef RAND
+}
+
+// Drift state on blank flash.
+static void fresh_drift(void)
+{
+    (void)nvs_flash_erase();
+    (void)nvs_flash_init();
+    CHECK(rtc_drift_init() == ESP_OK);
+}
+
+// HHMMSS has no date: the sync lands on whichever day is nearest the clock, so one across local
+// midnight moves the clock by seconds in both directions, not by a day.
+static void test_hhmmss_midnight(void)
+{
+    fresh_drift();
+    select_zone(TZ_ZONE_EUROPE_BERLIN);
+    // The reference is centred in its whole second.
+    // 23:59:58 local, the phone already says 00:00:01.
+    hal_rtc_set_ms(((int64_t)utc_of(2027, 1, 10, 22, 59) + 58) * 1000);
+    CHECK(timekeeper_set_local_hhmmss(0, 0, 1));
+    CHECK(hal_rtc_get_ms() == ((int64_t)utc_of(2027, 1, 10, 23, 0) + 1) * 1000 + 500);
+    // 00:00:01 local, the phone still says 23:59:58.
+    hal_rtc_set_ms(((int64_t)utc_of(2027, 1, 10, 23, 0) + 1) * 1000);
+    CHECK(timekeeper_set_local_hhmmss(23, 59, 58));
+    CHECK(hal_rtc_get_ms() == ((int64_t)utc_of(2027, 1, 10, 22, 59) + 58) * 1000 + 500);
+    // Midday, a few seconds off: same day.
+    hal_rtc_set_ms((int64_t)utc_of(2027, 1, 10, 11, 0) * 1000);
+    CHECK(timekeeper_set_local_hhmmss(12, 0, 5));
+    CHECK(hal_rtc_get_ms() == ((int64_t)utc_of(2027, 1, 10, 11, 0) + 5) * 1000 + 500);
+}
+
+// A reference clock and an RTC that runs ppb slow against it, set to the reference at each sync.
+typedef struct {
+    int64_t ref_ms;      // reference time now
+    int64_t set_ms;      // RTC value set at the last sync
+    int64_t set_ref_ms;  // reference time of the last sync
+} drift_sim_t;
+
+static void drift_sync(drift_sim_t *d, int64_t dt_ms, int32_t ppb, int64_t ref_jump_ms)
+{
+    d->ref_ms += dt_ms;
+    int64_t since = d->ref_ms - d->set_ref_ms;
+    int64_t raw = d->set_ms + since - since * ppb / 1000000000LL;
+    d->ref_ms += ref_jump_ms;
+    rtc_drift_on_sync(raw, d->ref_ms, RTC_DRIFT_HHMMSS_UNC_MS);
+    d->set_ms = d->ref_ms;
+    d->set_ref_ms = d->ref_ms;
+}
+
+// A reference a day off the RTC (a date wrong on one side) is a step, not a drift point: points
+// after it do not pair with the ones before, and the fit follows the new rate.
+static void test_drift_step(void)
+{
+    fresh_drift();
+    const int64_t h12 = 12LL * 3600 * 1000;
+    drift_sim_t d = {.ref_ms = (int64_t)utc_of(2027, 1, 1, 0, 0) * 1000};
+    d.set_ms = d.set_ref_ms = d.ref_ms;
+    drift_sync(&d, 0, 0, 0);
+    for (int i = 0; i < 3; i++) {
+        drift_sync(&d, h12, 5000, 0);
+    }
+    rtc_drift_estimate_t est = rtc_drift_get_estimate();
+    CHECK(est.valid && est.ppb > 4900 && est.ppb < 5100);
+
+    drift_sync(&d, h12, 10000, 86400LL * 1000);
+    for (int i = 0; i < 6; i++) {
+        drift_sync(&d, h12, 10000, 0);
+    }
+    est = rtc_drift_get_estimate();
+    CHECK(est.valid && est.ppb > 9900 && est.ppb < 10100);
+}
+
+// The drift state survives a reboot bit for bit; a blob of any other length or version is dropped.
+static void test_drift_persist(void)
+{
+    fresh_drift();
+    const int64_t h12 = 12LL * 3600 * 1000;
+    drift_sim_t d = {.ref_ms = (int64_t)utc_of(2027, 1, 1, 0, 0) * 1000};
+    d.set_ms = d.set_ref_ms = d.ref_ms;
+    drift_sync(&d, 0, 0, 0);
+    for (int i = 0; i < 4; i++) {
+        drift_sync(&d, h12, -7000, 0);
+    }
+    rtc_drift_estimate_t est = rtc_drift_get_estimate();
+    int64_t later_ms = d.ref_ms + h12;
+    int64_t corrected_ms = rtc_drift_correct_ms(later_ms);
+    CHECK(est.valid && est.ppb < -6900 && est.ppb > -7100);
+
+    CHECK(rtc_drift_init() == ESP_OK);
+    rtc_drift_estimate_t back = rtc_drift_get_estimate();
+    CHECK(back.valid == est.valid && back.ppb == est.ppb && back.points == est.points);
+    CHECK(rtc_drift_correct_ms(later_ms) == corrected_ms);
+    // The points came back too: one more sync extends the same fit.
+    drift_sync(&d, h12, -7000, 0);
+    est = rtc_drift_get_estimate();
+    CHECK(est.valid && est.points == 6 && est.ppb < -6900 && est.ppb > -7100);
+
+    static const size_t bad_len[] = {1, 148, 150, 176};
+    for (size_t i = 0; i < sizeof(bad_len) / sizeof(bad_len[0]); i++) {
+        uint8_t blob[176] = {1};
+        nvs_handle_t h;
+        CHECK(nvs_open("rtc", NVS_READWRITE, &h) == ESP_OK);
+        CHECK(nvs_set_blob(h, "drift", blob, bad_len[i]) == ESP_OK);
+        nvs_close(h);
+        CHECK(rtc_drift_init() == ESP_OK);
+        est = rtc_drift_get_estimate();
+        CHECK(!est.valid && est.points == 0);
+    }
+}
+
+static void put_xchg(uint8_t out[10], uint8_t op, uint8_t seq, int64_t t_ms)
+{
+    out[0] = op;
+    out[1] = seq;
+    for (int i = 0; i < 8; i++) {
+        out[2 + i] = (uint8_t)((uint64_t)t_ms >> (8 * i));
+    }
+}
+
+// Exchanges over a link whose legs differ and jitter by tens of ms, one of them quick: the quickest
+// exchange is the one committed, and the phone clock it gives is within 10 ms.
+static void test_time_sync(void)
+{
+    const int64_t phone_off_us = (int64_t)utc_of(2027, 3, 1, 6, 0) * 1000000 + 123457; // phone = mono + this
+    uint32_t seed = 0x7157c0deu;
+#define RAND() (seed = seed * 1664525u + 1013904223u, seed >> 8)
+    time_sync_t ts;
+    time_sync_reset(&ts);
+    time_sync_result_t res;
+    bool ready = false;
+    uint8_t pkt[10];
+    uint8_t status[TIME_SYNC_STATUS_LEN];
+    int64_t mono_us = 5000000;
+    int64_t best_delay_us = INT64_MAX;
+    int64_t best_mono_us = 0;
+    const uint8_t exchanges = 8;
+    for (uint8_t seq = 1; seq <= exchanges; seq++) {
+        // Uplink 8..68 ms, downlink 15..135 ms; exchange 5 gets close to the floor on both.
+        int64_t up_us = seq == 5 ? 8200 : 8000 + (int64_t)(RAND() % 60000);
+        int64_t down_us = seq == 5 ? 15300 : 15000 + (int64_t)(RAND() % 120000);
+        int64_t t1_ms = (mono_us + phone_off_us) / 1000;
+        int64_t t2_us = mono_us + up_us;
+        int64_t t3_us = t2_us + 1000 + (int64_t)(RAND() % 30000); // the phone's read, a connection interval or so later
+        int64_t t4_ms = (t3_us + down_us + phone_off_us) / 1000;
+        put_xchg(pkt, TIME_SYNC_OP_REQUEST, seq, t1_ms);
+        CHECK(time_sync_feed(&ts, pkt, sizeof(pkt), t2_us, &res, &ready) == ESP_OK);
+        CHECK(time_sync_read(&ts, t3_us, status, sizeof(status)) == TIME_SYNC_STATUS_LEN && status[0] == seq);
+        put_xchg(pkt, TIME_SYNC_OP_FINISH, seq, t4_ms);
+        CHECK(time_sync_feed(&ts, pkt, sizeof(pkt), t3_us + down_us, &res, &ready) == ESP_OK && !ready);
+        if (up_us + down_us < best_delay_us) {
+            best_delay_us = up_us + down_us;
+            best_mono_us = t2_us + (t3_us - t2_us) / 2;
+        }
+        mono_us = t3_us + down_us + 200000 + (int64_t)(RAND() % 300000);
+    }
+#undef RAND
+    uint8_t commit = TIME_SYNC_OP_COMMIT;
+    CHECK(time_sync_feed(&ts, &commit, 1, mono_us, &res, &ready) == ESP_OK && ready);
+    CHECK(res.samples == exchanges);
+    CHECK(res.mono_us == best_mono_us);
+    // Whole-ms t1/t4 put the delay within 2 ms of the link's.
+    CHECK(res.delay_us + 2000 >= best_delay_us && res.delay_us <= best_delay_us + 2000);
+    int64_t err_ms = time_sync_utc_ms_at(&res, mono_us) - (mono_us + phone_off_us) / 1000;
+    CHECK(err_ms <= 10 && err_ms >= -10);
+    CHECK((int64_t)res.unc_ms * 1000 >= (err_ms < 0 ? -err_ms : err_ms) * 1000);
+}
+
+static const struct {
+    const char *name;
+    void (*run)(void);
+} s_cases[] = {
+    {"civil_sweep", test_civil_sweep},
+    {"tz_offsets", test_tz_offsets},
+    {"tz_transitions", test_tz_transitions},
+    {"next_alarm_sweep", test_next_alarm_sweep},
+    {"next_alarm_boundaries", test_next_alarm_boundaries},
+    {"dates", test_dates},
+    {"sched_edits", test_sched_edits},
+    {"hhmmss_midnight", test_hhmmss_midnight},
+    {"drift_step", test_drift_step},
+    {"drift_persist", test_drift_persist},
+    {"time_sync", test_time_sync},
+};
+#define CASE_COUNT (sizeof(s_cases) / sizeof(s_cases[0]))
+
+static int run_case(size_t i)
+{
+    int before = s_failed;
+    s_cases[i].run();
+    printf("%s %s\n", s_failed == before ? "PASS" : "FAIL", s_cases[i].name);
+    return s_failed - before;
+}
+
+int main(int argc, char **argv)
+{
+    esp_log_level_set("*", ESP_LOG_NONE);
+    if (argc == 1) {
+        for (size_t i = 0; i < CASE_COUNT; i++) {
+            run_case(i);
+        }
+    }
+    for (int a = 1; a < argc; a++) {
+        size_t i = 0;
+        while (i < CASE_COUNT && strcmp(argv[a], s_cases[i].name) != 0) {
+            i++;
+        }
+        if (i == CASE_COUNT) {
+            fprintf(stderr, "unknown case %s; cases:", argv[a]);
+            for (size_t k = 0; k < CASE_COUNT; k++) {
+                fprintf(stderr, " %s", s_cases[k].name);
+            }
+            fprintf(stderr, "\n");
+            return 2;
+        }
+        run_case(i);
+    }
+    return s_failed ? 1 : 0;
+}
@@ -0,0 +1,278 @@
+#include "alarm_sched.h"
+
+#include <string.h>
+
+#include "civil_time.h"
+
+#define WEEK_SECS ((int64_t)ALARM_SCHED_MINUTES_PER_WEEK * 60)
+
+static bool alarm_is_scheduled(const device_alarm_t *alarm)
+{
+    return alarm && alarm->enabled && (alarm->weekdays & DEVICE_ALARM_WEEKDAYS_ALL) != 0;
+}
+
+uint16_t alarm_sched_start_mow(const device_alarm_t *alarm, uint8_t wday)
+{
+    int32_t mow = (int32_t)wday * 24 * 60 + (int32_t)alarm->hour * 60 + alarm->minute - alarm->sunrise_duration;
+    if (mow < 0) {
+        mow += ALARM_SCHED_MINUTES_PER_WEEK;
+    }
+    return (uint16_t)mow;
+}
+
+// Index of the first entry with start_mow > key (upper bound).
+static uint8_t occ_upper_bound(const alarm_sched_t *sched, uint16_t key)
+{
+    uint8_t lo = 0;
+    uint8_t hi = sched->count;
+    while (lo < hi) {
+        uint8_t mid = (uint8_t)((lo + hi) / 2);
+        if (sched->occ[mid].start_mow <= key) {
+            lo = (uint8_t)(mid + 1);
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static void occ_insert(alarm_sched_t *sched, uint16_t start_mow, uint8_t slot)
+{
+    if (sched->count >= ALARM_SCHED_MAX_OCC) {
+        return;
+    }
+    uint8_t pos = occ_upper_bound(sched, start_mow);
+    memmove(&sched->occ[pos + 1], &sched->occ[pos], (size_t)(sched->count - pos) * sizeof(sched->occ[0]));
+    sched->occ[pos].start_mow = start_mow;
+    sched->occ[pos].slot = slot;
+    sched->count++;
+}
+
+static void dated_insert(alarm_sched_t *sched, int32_t start_min, uint8_t slot)
+{
+    uint8_t pos = sched->dated_count;
+    while (pos > 0 && sched->dated[pos - 1].start_min > start_min) {
+        sched->dated[pos] = sched->dated[pos - 1];
+        pos--;
+    }
+    sched->dated[pos].start_min = start_min;
+    sched->dated[pos].slot = slot;
+    sched->dated_count++;
+}
+
+void alarm_sched_set_slot(alarm_sched_t *sched, uint8_t slot, const device_alarm_t *alarm)
+{
+    if (!sched || slot >= DEVICE_CONFIG_MAX_ALARMS) {
+        return;
+    }
+
+    // Drop the slot's old entries in one compaction pass; order of the rest is preserved.
+    uint8_t w = 0;
+    for (uint8_t r = 0; r < sched->count; r++) {
+        if (sched->occ[r].slot != slot) {
+            sched->occ[w++] = sched->occ[r];
+        }
+    }
+    sched->count = w;
+    w = 0;
+    for (uint8_t r = 0; r < sched->dated_count; r++) {
+        if (sched->dated[r].slot != slot) {
+            sched->dated[w++] = sched->dated[r];
+        }
+    }
+    sched->dated_count = w;
+    sched->skip_next &= (uint16_t)~(1u << slot);
+
+    if (!alarm_is_scheduled(alarm)) {
+        return;
+    }
+    sched->lead_min[slot] = alarm->sunrise_duration;
+    if (alarm->skip_next) {
+        sched->skip_next |= (uint16_t)(1u << slot);
+    }
+    if (alarm->date_year != 0) {
+        int32_t day = civil_days_from_date(2000 + (int32_t)alarm->date_year, alarm->date_month, alarm->date_day);
+        int32_t start_min = (day - ALARM_SCHED_DAY0) * 24 * 60 + (int32_t)alarm->hour * 60 + alarm->minute -
+                            alarm->sunrise_duration;
+        dated_insert(sched, start_min, slot);
+        return;
+    }
+    for (uint8_t wday = 0; wday < 7; wday++) {
+        if (alarm->weekdays & (1u << wday)) {
+            occ_insert(sched, alarm_sched_start_mow(alarm, wday), slot);
+        }
+    }
+}
+
+void alarm_sched_set_skips(alarm_sched_t *sched, const device_skip_t skips[DEVICE_CONFIG_MAX_SKIPS])
+{
+    if (!sched) {
+        return;
+    }
+    sched->skip_count = 0;
+    for (uint8_t i = 0; skips && i < DEVICE_CONFIG_MAX_SKIPS; i++) {
+        const device_skip_t *k = &skips[i];
+        if (k->year == 0) {
+            continue;
+        }
+        uint16_t day = (uint16_t)(civil_days_from_date(2000 + (int32_t)k->year, k->month, k->day) - ALARM_SCHED_DAY0);
+        uint16_t slots = (uint16_t)(k->slots_lo | (k->slots_hi << 8));
+        uint8_t pos = sched->skip_count;
+        while (pos > 0 && sched->skip[pos - 1].day > day) {
+            pos--;
+        }
+        if (pos > 0 && sched->skip[pos - 1].day == day) {
+            sched->skip[pos - 1].slots |= slots;
+            continue;
+        }
+        memmove(&sched->skip[pos + 1], &sched->skip[pos], (size_t)(sched->skip_count - pos) * sizeof(sched->skip[0]));
+        sched->skip[pos].day = day;
+        sched->skip[pos].slots = slots;
+        sched->skip_count++;
+    }
+}
+
+void alarm_sched_build(alarm_sched_t *sched, const device_config_t *cfg)
+{
+    if (!sched) {
+        return;
+    }
+    memset(sched, 0, sizeof(*sched));
+    if (!cfg) {
+        return;
+    }
+    for (uint8_t slot = 0; slot < DEVICE_CONFIG_MAX_ALARMS; slot++) {
+        alarm_sched_set_slot(sched, slot, &cfg->alarms[slot]);
+    }
+    alarm_sched_set_skips(sched, cfg->skips);
+}
+
+bool alarm_sched_is_empty(const alarm_sched_t *sched)
+{
+    return !sched || (sched->count == 0 && sched->dated_count == 0);
+}
+
+bool alarm_sched_next(const alarm_sched_t *sched, uint32_t now_sow, uint8_t *out_slot, uint32_t *out_delta_s)
+{
+    if (!sched || sched->count == 0) {
+        return false;
+    }
+
+    // start * 60 > now_sow  <=>  start > floor(now_sow / 60)
+    uint16_t now_mow = (uint16_t)((now_sow / 60) % ALARM_SCHED_MINUTES_PER_WEEK);
+    uint8_t idx = occ_upper_bound(sched, now_mow);
+    uint32_t start_s;
+    if (idx < sched->count) {
+        start_s = (uint32_t)sched->occ[idx].start_mow * 60;
+    } else {
+        // Wrap into next week.
+        idx = 0;
+        start_s = ((uint32_t)sched->occ[0].start_mow + ALARM_SCHED_MINUTES_PER_WEEK) * 60;
+    }
+
+    if (out_slot) {
+        *out_slot = sched->occ[idx].slot;
+    }
+    if (out_delta_s) {
+        *out_delta_s = start_s - (now_sow % (ALARM_SCHED_MINUTES_PER_WEEK * 60));
+    }
+    return true;
+}
+
+// Whether the occurrence of slot starting at start_local rings on a skip date.
+static bool skipped_on_date(const alarm_sched_t *sched, uint8_t slot, int64_t start_local)
+{
+    if (sched->skip_count == 0) {
+        return false;
+    }
+    int32_t day = civil_days_of(start_local + (int64_t)sched->lead_min[slot] * 60) - ALARM_SCHED_DAY0;
+    uint8_t lo = 0;
+    uint8_t hi = sched->skip_count;
+    while (lo < hi) {
+        uint8_t mid = (uint8_t)((lo + hi) / 2);
+        if ((int32_t)sched->skip[mid].day < day) {
+            lo = (uint8_t)(mid + 1);
+        } else {
+            hi = mid;
+        }
+    }
+    return lo < sched->skip_count && (int32_t)sched->skip[lo].day == day && (sched->skip[lo].slots & (1u << slot));
+}
+
+static bool next_weekly(const alarm_sched_t *sched, int64_t local_now, alarm_sched_hit_t *out)
+{
+    if (sched->count == 0) {
+        return false;
+    }
+    uint32_t now_sow = civil_second_of_week(local_now);
+    int64_t week_base = local_now - now_sow;
+    uint8_t idx = occ_upper_bound(sched, (uint16_t)(now_sow / 60));
+    // A skip date passes over at most one week-list's worth of occurrences (those ringing that day),
+    // so this many steps always reach a ringing occurrence.
+    uint32_t limit = (uint32_t)sched->count * (sched->skip_count + 1u) + 1u;
+    for (uint32_t n = 0; n < limit; n++) {
+        if (idx >= sched->count) {
+            idx = 0;
+            week_base += WEEK_SECS;
+        }
+        const alarm_occ_t *o = &sched->occ[idx++];
+        int64_t start = week_base + (int64_t)o->start_mow * 60;
+        if (skipped_on_date(sched, o->slot, start)) {
+            continue;
+        }
+        out->start_local = start;
+        out->slot = o->slot;
+        out->skip = (sched->skip_next & (1u << o->slot)) != 0;
+        return true;
+    }
+    return false;
+}
+
+static bool next_dated(const alarm_sched_t *sched, int64_t local_now, alarm_sched_hit_t *out)
+{
+    // start * 60 > now - day0  <=>  start > floor((now - day0) / 60)
+    int64_t since_day0 = local_now - (int64_t)ALARM_SCHED_DAY0 * CIVIL_SECS_PER_DAY;
+    int64_t now_min = since_day0 >= 0 ? since_day0 / 60 : (since_day0 - 59) / 60;
+    uint8_t lo = 0;
+    uint8_t hi = sched->dated_count;
+    while (lo < hi) {
+        uint8_t mid = (uint8_t)((lo + hi) / 2);
+        if (sched->dated[mid].start_min <= now_min) {
+            lo = (uint8_t)(mid + 1);
+        } else {
+            hi = mid;
+        }
+    }
+    for (; lo < sched->dated_count; lo++) {
+        const alarm_dated_t *d = &sched->dated[lo];
+        int64_t start = ((int64_t)ALARM_SCHED_DAY0 * 24 * 60 + d->start_min) * 60;
+        if (skipped_on_date(sched, d->slot, start)) {
+            continue;
+        }
+        out->start_local = start;
+        out->slot = d->slot;
+        out->skip = (sched->skip_next & (1u << d->slot)) != 0;
+        return true;
+    }
+    return false;
+}
+
+bool alarm_sched_next_at(const alarm_sched_t *sched, int64_t local_now, alarm_sched_hit_t *out)
+{
+    if (alarm_sched_is_empty(sched) || !out) {
+        return false;
+    }
+    alarm_sched_hit_t weekly;
+    alarm_sched_hit_t dated;
+    bool have_weekly = next_weekly(sched, local_now, &weekly);
+    bool have_dated = next_dated(sched, local_now, &dated);
+    if (have_dated && (!have_weekly || dated.start_local < weekly.start_local)) {
+        *out = dated;
+        return true;
+    }
+    if (have_weekly) {
+        *out = weekly;
+        return true;
+    }
+    return false;
+}
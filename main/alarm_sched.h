@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "device_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ALARM_SCHED_MINUTES_PER_WEEK (7 * 24 * 60)
+#define ALARM_SCHED_MAX_OCC (DEVICE_CONFIG_MAX_ALARMS * 7)
+// Civil day number (days since 1970-01-01) of 2000-01-01; dates below count days from here.
+#define ALARM_SCHED_DAY0 (10957)
+
+// One weekly sunrise start: minute-of-week (local time, 0 = Sunday 00:00) and the alarm slot it belongs to.
+typedef struct {
+    uint16_t start_mow;
+    uint8_t slot;
+} alarm_occ_t;
+
+// One-shot sunrise start: local minutes since 2000-01-01 00:00.
+typedef struct {
+    int32_t start_min;
+    uint8_t slot;
+} alarm_dated_t;
+
+// Skip date: local days since 2000-01-01 and the slots that do not ring on it.
+typedef struct {
+    uint16_t day;
+    uint16_t slots;
+} alarm_skip_t;
+
+// Weekly occurrence list of every enabled weekly alarm, sorted by sunrise start, plus one-shots sorted
+// by absolute start and skip dates sorted by day (at most one entry per day; slot masks are merged).
+// Lookups are binary searches; editing one slot touches only that slot's entries.
+typedef struct {
+    alarm_occ_t occ[ALARM_SCHED_MAX_OCC];
+    uint8_t count;
+    alarm_dated_t dated[DEVICE_CONFIG_MAX_ALARMS];
+    uint8_t dated_count;
+    alarm_skip_t skip[DEVICE_CONFIG_MAX_SKIPS];
+    uint8_t skip_count;
+    uint16_t skip_next;                           // slots whose next occurrence is skipped
+    uint8_t lead_min[DEVICE_CONFIG_MAX_ALARMS];   // sunrise_duration: alarm time = start + lead
+} alarm_sched_t;
+
+typedef struct {
+    int64_t start_local; // local epoch seconds of the sunrise start
+    uint8_t slot;
+    bool skip; // start of an occurrence consumed by skip_next: clear the flag instead of ringing
+} alarm_sched_hit_t;
+
+// Rebuilds the whole list from the config.
+void alarm_sched_build(alarm_sched_t *sched, const device_config_t *cfg);
+
+// Replaces the occurrences of one slot after an edit (disabled/unused alarms just drop out).
+void alarm_sched_set_slot(alarm_sched_t *sched, uint8_t slot, const device_alarm_t *alarm);
+
+// Rebuilds the skip dates from the config after any skip entry changed.
+void alarm_sched_set_skips(alarm_sched_t *sched, const device_skip_t skips[DEVICE_CONFIG_MAX_SKIPS]);
+
+bool alarm_sched_is_empty(const alarm_sched_t *sched);
+
+// Finds the first sunrise start strictly after now_sow (local second-of-week), wrapping into next week.
+// Returns false if nothing is scheduled. out_delta_s is local wall-clock seconds until that start.
+// Weekly alarms only; ignores one-shots and skips.
+bool alarm_sched_next(const alarm_sched_t *sched, uint32_t now_sow, uint8_t *out_slot, uint32_t *out_delta_s);
+
+// First sunrise start strictly after local_now (local epoch seconds) across weekly alarms and
+// one-shots. Occurrences whose alarm time falls on a skip date for their slot are passed over; the
+// first remaining occurrence of a skip_next slot is returned with skip set. Returns false if nothing
+// is scheduled.
+bool alarm_sched_next_at(const alarm_sched_t *sched, int64_t local_now, alarm_sched_hit_t *out);
+
+// Sunrise start of an alarm on weekday wday (0=Sunday), as minute-of-week; wraps into the previous day/week.
+uint16_t alarm_sched_start_mow(const device_alarm_t *alarm, uint8_t wday);
+
+#ifdef __cplusplus
+}
+#endif
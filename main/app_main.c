@@ -6,38 +6,58 @@
 
 #include "esp_err.h"
 #include "esp_log.h"
-#include "driver/gpio.h"
-#include "esp_sleep.h"
 #include "esp_timer.h"
 #include "nvs_flash.h"
 
 #include "sdkconfig.h"
 
-#include "soc/soc_caps.h"
 
+#include "alarm_sched.h"
 #include "button.h"
 #include "ch455g.h"
+#include "config_image.h"
+#include "config_schema.h"
+#include "config_service.h"
 #include "device_config.h"
+#include "hal.h"
+#include "light_preset.h"
+#include "microbench.h"
 #include "pwm_led.h"
+#include "storage_telemetry.h"
+#include "sunrise.h"
+#include "provisioning.h"
+#include "rtc_drift.h"
+#include "time_persist.h"
+#include "time_service.h"
+#include "time_sync.h"
 #include "timekeeper.h"
+#include "timer_wheel.h"
+#include "tz.h"
 #include "ble_alarm.h"
 #include "battery.h"
 
 static const char *TAG = "APP";
 
 // GPIO mapping per requirement.md
-#define GPIO_I2C_SDA      GPIO_NUM_4
-#define GPIO_I2C_SCL      GPIO_NUM_5
-#define GPIO_PWM_WARM     GPIO_NUM_6
-#define GPIO_PWM_COOL     GPIO_NUM_7
-#define GPIO_BTN          GPIO_NUM_20
-#define GPIO_BAT_ADC_EN   GPIO_NUM_21
+#define GPIO_I2C_SDA      4
+#define GPIO_I2C_SCL      5
+#define GPIO_PWM_WARM     6
+#define GPIO_PWM_COOL     7
+#define GPIO_BTN          20
+#define GPIO_BAT_ADC_EN   21
 
 // Behavior constants
 #define LONG_PRESS_MS            1000
 #define TIME_SHOW_MS             (CONFIG_LIGHT_ALARM_TIME_SHOW_SECONDS * 1000)
-#define DEFAULT_SUNRISE_MINUTES_FALLBACK (CONFIG_LIGHT_ALARM_GRADIENT_MINUTES)
 #define BLE_IDLE_SLEEP_DELAY_MS  3000
+#define LOW_BATT_FLUSH_PERCENT   (CONFIG_LIGHT_ALARM_CFG_LOW_BATT_FLUSH_PERCENT)
+#define APP_PRESET_NONE          (-1)
+
+// Coalescing windows (timer_wheel.h): how late each deadline may run to share a wakeup.
+#define BATT_NOTIFY_PERIOD_US    (60LL * 1000000LL)
+#define BATT_NOTIFY_SLACK_US     (5U * 1000000U)
+#define DISP_REFRESH_SLACK_US    (250U * 1000U)
+#define TIME_SHOW_SLACK_US       (100U * 1000U)
 
 typedef enum {
     APP_STATE_DEEP_SLEEP = 0,
@@ -46,8 +66,21 @@ typedef enum {
     APP_STATE_MANUAL_LIGHT,
 } app_state_t;
 
+// What a config edit touched, so the main task only redoes that part of sched and the preset plans.
+typedef struct {
+    uint16_t alarms; // alarm slots to re-add to sched
+    uint8_t presets; // preset slots to recompile
+    bool skips;      // skip dates to rebuild
+    bool all;        // whole config replaced
+} app_cfg_dirty_t;
+
 typedef struct {
+    // The main task's copy of config_service's config. Other tasks edit the service's copy
+    // (config_service_edit) and read it (config_service_get); app_refresh_cfg() brings this one up to date.
     device_config_t cfg;
+    volatile bool cfg_pending; // guarded by s_edit_lock, with cfg_dirty
+    app_cfg_dirty_t cfg_dirty;
+    alarm_sched_t sched;
     app_state_t state;
 
     TaskHandle_t main_task;
@@ -59,6 +92,18 @@ typedef struct {
     pwm_led_t pwm;
     bool pwm_inited;
 
+    // Presets compiled to duties whenever the PWM is (re)initialized or a preset is saved.
+    light_preset_plan_t preset_plans[DEVICE_CONFIG_MAX_PRESETS];
+    volatile int8_t active_preset; // APP_PRESET_NONE: manual light uses wake_bright/color_temp
+    volatile bool manual_light_requested;
+    uint8_t preset_step;
+    int64_t preset_step_end_us;
+
+    // 0xFF1A config image upload in progress (reset on disconnect).
+    config_image_rx_t image_rx;
+    // 0xFF1C timed sync exchanges of this connection (reset on disconnect).
+    time_sync_t time_sync;
+
     button_t btn;
 
     bool ble_inited;
@@ -66,18 +111,37 @@ typedef struct {
 
     battery_t batt;
     bool batt_inited;
-    esp_timer_handle_t batt_notify_timer;
+    timer_wheel_timer_t batt_notify_timer;
 
     bool sleep_requested;
     int64_t sleep_at_us;
 
+    // Wall-clock target and the monotonic deadline derived from it; rederived on time steps.
     time_t next_alarm_ts;
+    int64_t next_alarm_due_us;
+    timer_wheel_timer_t alarm_timer;
+    volatile bool alarm_due; // set by alarm_timer, consumed by the main loop
+    uint8_t next_alarm_slot;
+    bool next_alarm_skip; // next_alarm_ts is an occurrence cancelled by the slot's skip_next
+    time_t last_fired_ts; // sunrise start of the alarm that last ran, so it is not re-entered
+    volatile bool resched_pending; // set by time steps and BLE writes, consumed by the main loop
+    volatile uint32_t time_step_seq; // bumped per step; a running sunrise re-plans when it changes
+
+    // Display shows HH:MM, so it only needs rendering at minute boundaries (disp_timer) or after a step.
+    timer_wheel_timer_t disp_timer;
+    volatile bool disp_dirty;
+    // Time-shown window; restarted by presses that extend it.
+    timer_wheel_timer_t show_timer;
+    volatile bool show_expired;
 } app_ctx_t;
 
-#define GPIO_BAT_ADC      GPIO_NUM_3
+#define GPIO_BAT_ADC      3
+
+static portMUX_TYPE s_edit_lock = portMUX_INITIALIZER_UNLOCKED;
 
 // Forward declarations (used across mode handlers)
 static void app_run_manual_light(app_ctx_t *app);
+static void app_display_off(app_ctx_t *app);
 
 static inline void app_request_light_update(app_ctx_t *app)
 {
@@ -96,18 +160,116 @@ static inline void app_wait_ms_or_light_update(uint32_t ms)
     (void)ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ms));
 }
 
+// Pending config must reach flash before the pack browns out.
+static void app_check_low_battery(uint8_t pct)
+{
+    if (pct <= LOW_BATT_FLUSH_PERCENT && config_service_is_dirty()) {
+        ESP_LOGW(TAG, "battery low (%u%%): flushing config", (unsigned)pct);
+        (void)config_service_flush();
+    }
+}
+
+// Main task: selects a zone and, if the local offset changes, publishes it like a clock step.
+static void app_select_zone(uint8_t zone)
+{
+    if (zone == tz_get_zone()) {
+        return;
+    }
+    time_t now = timekeeper_now();
+    int32_t before = tz_offset_at(now);
+    tz_set_zone(zone);
+    int32_t after = tz_offset_at(now);
+    if (after != before) {
+        time_service_publish(TIME_STEP_ZONE, (int64_t)(after - before) * 1000);
+    }
+}
+
+// Flags a config edit made on another task for the main task and wakes it.
+static void app_post_cfg_edit(app_ctx_t *app, app_cfg_dirty_t dirty)
+{
+    portENTER_CRITICAL(&s_edit_lock);
+    app->cfg_pending = true;
+    app->cfg_dirty.alarms |= dirty.alarms;
+    app->cfg_dirty.presets |= dirty.presets;
+    app->cfg_dirty.skips |= dirty.skips;
+    app->cfg_dirty.all |= dirty.all;
+    portEXIT_CRITICAL(&s_edit_lock);
+    if (app->main_task) {
+        xTaskNotifyGive(app->main_task);
+    }
+}
+
+// Main task: takes over the edits posted by other tasks, switches to an edited zone (tz tables are
+// only rebuilt here), updates the edited sched slots and recompiles the edited presets. Only a
+// replaced config rebuilds sched from scratch.
+static void app_refresh_cfg(app_ctx_t *app)
+{
+    portENTER_CRITICAL(&s_edit_lock);
+    bool pending = app->cfg_pending;
+    app_cfg_dirty_t dirty = app->cfg_dirty;
+    app->cfg_pending = false;
+    app->cfg_dirty = (app_cfg_dirty_t){0};
+    portEXIT_CRITICAL(&s_edit_lock);
+    if (!pending) {
+        return;
+    }
+    config_service_get(&app->cfg);
+    app_select_zone(app->cfg.tz_zone);
+    if (dirty.all) {
+        alarm_sched_build(&app->sched, &app->cfg);
+        if (app->pwm_inited) {
+            light_preset_compile_all(&app->pwm, &app->cfg, app->preset_plans);
+        }
+        return;
+    }
+    for (uint8_t slot = 0; slot < DEVICE_CONFIG_MAX_ALARMS; slot++) {
+        if (dirty.alarms & (1u << slot)) {
+            alarm_sched_set_slot(&app->sched, slot, &app->cfg.alarms[slot]);
+        }
+    }
+    if (dirty.skips) {
+        alarm_sched_set_skips(&app->sched, app->cfg.skips);
+    }
+    // Without PWM there is nothing to compile for; app_periph_ensure_pwm() compiles them all.
+    for (uint8_t slot = 0; slot < DEVICE_CONFIG_MAX_PRESETS && app->pwm_inited; slot++) {
+        if (dirty.presets & (1u << slot)) {
+            light_preset_compile(&app->pwm, &app->cfg.presets[slot], &app->preset_plans[slot]);
+        }
+    }
+}
+
+// A BLE edit of the service's config; fields whose schema policy is IMMEDIATE are flushed right away.
+// False when edit rejected it. A failed commit is the service's to retry, so the edit still stands.
+static bool app_config_edit(app_ctx_t *app, cfg_field_t field, config_service_edit_fn edit, void *arg,
+                            app_cfg_dirty_t dirty)
+{
+    if (config_service_edit(edit, arg) == ESP_ERR_INVALID_ARG) {
+        return false;
+    }
+    if (config_schema_field(field)->persist == CFG_PERSIST_IMMEDIATE) {
+        (void)config_service_flush();
+    }
+    app_post_cfg_edit(app, dirty);
+    return true;
+}
+
 static void batt_notify_timer_cb(void *arg)
 {
     app_ctx_t *app = (app_ctx_t *)arg;
     if (!app || !app->batt_inited) {
         return;
     }
-    if (!ble_alarm_is_connected()) {
+    bool connected = ble_alarm_is_connected();
+    // While disconnected, only sample when there is unsaved config that a low battery could lose.
+    if (!connected && !config_service_is_dirty()) {
         return;
     }
     uint8_t pct = 0;
     if (battery_read_percent(&app->batt, &pct) == ESP_OK) {
-        (void)ble_alarm_notify_battery(pct);
+        app_check_low_battery(pct);
+        if (connected) {
+            (void)ble_alarm_notify_battery(pct);
+        }
     }
 }
 
@@ -122,58 +284,173 @@ static void ble_on_connect(void *ctx)
     // Note: client must enable notifications (CCCD) for delivery.
     uint8_t pct = 0;
     if (battery_read_percent(&app->batt, &pct) == ESP_OK) {
+        app_check_low_battery(pct);
         (void)ble_alarm_notify_battery(pct);
     }
 }
 
+// Wheel callbacks: run in the timer task, so only flag and wake the main task.
+static void app_alarm_timer_cb(void *arg)
+{
+    app_ctx_t *app = (app_ctx_t *)arg;
+    app->alarm_due = true;
+    if (app->main_task) {
+        xTaskNotifyGive(app->main_task);
+    }
+}
+
+static void app_disp_timer_cb(void *arg)
+{
+    ((app_ctx_t *)arg)->disp_dirty = true;
+}
+
+static void app_show_timer_cb(void *arg)
+{
+    ((app_ctx_t *)arg)->show_expired = true;
+}
+
+// due_us 0 disarms. No slack: the sunrise start is the one deadline that must not slip.
+static void app_arm_alarm(app_ctx_t *app, int64_t due_us)
+{
+    app->next_alarm_due_us = due_us;
+    app->alarm_due = false;
+    if (due_us == 0) {
+        timer_wheel_stop(&app->alarm_timer);
+    } else {
+        (void)timer_wheel_start_at(&app->alarm_timer, due_us, 0);
+    }
+}
+
+typedef struct {
+    uint8_t slot;
+    bool skipped;
+} app_consumed_edit_t;
+
+static bool app_edit_consumed(device_config_t *cfg, void *arg)
+{
+    const app_consumed_edit_t *e = (const app_consumed_edit_t *)arg;
+    device_alarm_t *a = &cfg->alarms[e->slot];
+    bool changed = false;
+    if (e->skipped && a->skip_next) {
+        a->skip_next = 0;
+        changed = true;
+    }
+    if (a->date_year != 0 && a->enabled) {
+        a->enabled = 0;
+        changed = true;
+    }
+    return changed;
+}
+
+// An occurrence has run or been skipped: clear the slot's skip_next, and retire a one-shot alarm
+// (it only ever had this occurrence). Edits the service's copy, which a BLE write may have changed
+// since this task last looked.
+static void app_alarm_consumed(app_ctx_t *app, uint8_t slot, bool skipped)
+{
+    app_consumed_edit_t e = {.slot = slot, .skipped = skipped};
+    if (config_service_edit(app_edit_consumed, &e) != ESP_OK) {
+        return;
+    }
+    // The phone reads this state back; a reset must not replay it.
+    (void)config_service_flush();
+    config_service_get(&app->cfg);
+    alarm_sched_set_slot(&app->sched, slot, &app->cfg.alarms[slot]);
+}
+
 static void app_recompute_next_alarm(app_ctx_t *app)
 {
     if (!app) {
         return;
     }
+    app_refresh_cfg(app);
 
-    if (!app->cfg.alarm_enabled) {
+    if (alarm_sched_is_empty(&app->sched)) {
         app->next_alarm_ts = 0;
-        ESP_LOGI(TAG, "alarm disabled: next sunrise start cleared");
+        app_arm_alarm(app, 0);
+        ESP_LOGI(TAG, "no alarm enabled: next sunrise start cleared");
         return;
     }
 
-    time_t now = time(NULL);
+    time_t now = timekeeper_now();
     if (!timekeeper_is_time_sane(now)) {
+        // A clock that becomes sane does so through a time step, which reschedules.
         app->next_alarm_ts = 0;
+        app_arm_alarm(app, 0);
         return;
     }
-    int64_t seconds = timekeeper_seconds_until_next_alarm(&app->cfg, now);
-    app->next_alarm_ts = now + seconds;
-    ESP_LOGI(TAG, "next sunrise start in %llds (ts=%lld)", (long long)seconds, (long long)app->next_alarm_ts);
+    // A sunrise whose window already started but whose peak is still ahead (clock stepped into it,
+    // or a reset mid-ramp) is due now: the ramp compresses to still peak on time. Sunrise windows
+    // are at most an hour, so only starts in the last hour can qualify.
+    uint8_t slot = 0;
+    time_t from = now - 60 * 60;
+    for (;;) {
+        bool skip = false;
+        int64_t seconds = timekeeper_seconds_until_next_alarm(&app->sched, from, &slot, &skip);
+        if (seconds < 0) {
+            app->next_alarm_ts = 0;
+            app_arm_alarm(app, 0);
+            return;
+        }
+        time_t start = from + seconds;
+        time_t peak = start + (time_t)app->cfg.alarms[slot].sunrise_duration * 60;
+        if (start >= now || (peak > now && start != app->last_fired_ts)) {
+            from = start;
+            app->next_alarm_skip = skip;
+            break;
+        }
+        from = start + 1;
+    }
+    int64_t seconds = from - now;
+    app->next_alarm_ts = from;
+    app_arm_alarm(app, time_service_mono_at(app->next_alarm_ts));
+    app->next_alarm_slot = slot;
+    ESP_LOGI(TAG, "next sunrise start in %llds (ts=%lld slot=%u%s)", (long long)seconds, (long long)app->next_alarm_ts,
+             (unsigned)slot, app->next_alarm_skip ? " skipped" : "");
+}
+
+// The schedule belongs to the main task: other tasks only flag a recompute and wake it. Their alarm and
+// skip edits reach sched through app_refresh_cfg() first.
+static void app_request_resched(app_ctx_t *app)
+{
+    app->resched_pending = true;
+    if (app->main_task) {
+        xTaskNotifyGive(app->main_task);
+    }
+}
+
+// Time-step subscribers: run on the task that stepped the clock, so only flag and wake the main task.
+static void app_on_time_step_sched(const time_step_event_t *ev, void *ctx)
+{
+    app_ctx_t *app = (app_ctx_t *)ctx;
+    (void)ev;
+    app->time_step_seq++;
+    app_request_resched(app);
+}
+
+static void app_on_time_step_display(const time_step_event_t *ev, void *ctx)
+{
+    app_ctx_t *app = (app_ctx_t *)ctx;
+    (void)ev;
+    app->disp_dirty = true;
 }
 
 static void power_prep_for_sleep(void)
 {
     // Ensure battery divider is disabled
-    gpio_config_t cfg = {
-        .pin_bit_mask = (1ULL << GPIO_BAT_ADC_EN),
-        .mode = GPIO_MODE_OUTPUT,
-        .pull_up_en = GPIO_PULLUP_DISABLE,
-        .pull_down_en = GPIO_PULLDOWN_DISABLE,
-        .intr_type = GPIO_INTR_DISABLE,
-    };
-    gpio_config(&cfg);
-    gpio_set_level(GPIO_BAT_ADC_EN, 0);
+    hal_gpio_config(GPIO_BAT_ADC_EN, HAL_GPIO_OUTPUT, HAL_GPIO_PULL_NONE);
+    hal_gpio_set(GPIO_BAT_ADC_EN, 0);
 
     // Ensure PWM pins low (avoid leakage)
-    cfg.pin_bit_mask = (1ULL << GPIO_PWM_WARM) | (1ULL << GPIO_PWM_COOL);
-    gpio_config(&cfg);
-    gpio_set_level(GPIO_PWM_WARM, 0);
-    gpio_set_level(GPIO_PWM_COOL, 0);
+    hal_gpio_config(GPIO_PWM_WARM, HAL_GPIO_OUTPUT, HAL_GPIO_PULL_NONE);
+    hal_gpio_config(GPIO_PWM_COOL, HAL_GPIO_OUTPUT, HAL_GPIO_PULL_NONE);
+    hal_gpio_set(GPIO_PWM_WARM, 0);
+    hal_gpio_set(GPIO_PWM_COOL, 0);
 
     // Ensure I2C pins low (open-drain outputs)
-    cfg.pin_bit_mask = (1ULL << GPIO_I2C_SDA) | (1ULL << GPIO_I2C_SCL);
-    cfg.mode = GPIO_MODE_OUTPUT_OD;
-    cfg.pull_up_en = GPIO_PULLUP_DISABLE;
-    gpio_config(&cfg);
-    gpio_set_level(GPIO_I2C_SDA, 0);
-    gpio_set_level(GPIO_I2C_SCL, 0);
+    hal_gpio_config(GPIO_I2C_SDA, HAL_GPIO_OUTPUT_OD, HAL_GPIO_PULL_NONE);
+    hal_gpio_config(GPIO_I2C_SCL, HAL_GPIO_OUTPUT_OD, HAL_GPIO_PULL_NONE);
+    hal_gpio_set(GPIO_I2C_SDA, 0);
+    hal_gpio_set(GPIO_I2C_SCL, 0);
 }
 
 static void __attribute__((unused)) app_request_sleep_ms(app_ctx_t *app, uint32_t delay_ms)
@@ -200,12 +477,16 @@ static void __attribute__((unused)) app_enter_deep_sleep(app_ctx_t *app)
     }
 #endif
 
+    // Write-behind config must be persisted before RAM is lost.
+    (void)config_service_flush();
+    time_persist_snapshot();
+
     timekeeper_init_if_unset();
-    time_t now = time(NULL);
+    time_t now = timekeeper_now();
 
     int64_t seconds = 0;
-    if (app->cfg.alarm_enabled && timekeeper_is_time_sane(now)) {
-        seconds = timekeeper_seconds_until_next_alarm(&app->cfg, now);
+    if (!alarm_sched_is_empty(&app->sched) && timekeeper_is_time_sane(now)) {
+        seconds = timekeeper_seconds_until_next_alarm(&app->sched, now, NULL, NULL);
         if (seconds < 0) {
             seconds = 0;
         }
@@ -216,8 +497,7 @@ static void __attribute__((unused)) app_enter_deep_sleep(app_ctx_t *app)
 
     // Stop peripherals
     if (app->disp_inited) {
-        (void)ch455g_clear(&app->disp);
-        (void)ch455g_set_enabled(&app->disp, false);
+        app_display_off(app);
         (void)ch455g_set_sleep(&app->disp, true);
     }
     if (app->pwm_inited) {
@@ -230,11 +510,7 @@ static void __attribute__((unused)) app_enter_deep_sleep(app_ctx_t *app)
         app->ble_adv_running = false;
     }
 
-    if (app->batt_notify_timer) {
-        (void)esp_timer_stop(app->batt_notify_timer);
-        (void)esp_timer_delete(app->batt_notify_timer);
-        app->batt_notify_timer = NULL;
-    }
+    timer_wheel_stop(&app->batt_notify_timer);
     if (app->batt_inited) {
         battery_deinit(&app->batt);
         app->batt_inited = false;
@@ -242,32 +518,33 @@ static void __attribute__((unused)) app_enter_deep_sleep(app_ctx_t *app)
 
     power_prep_for_sleep();
 
-    esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_ALL);
-
-    if (seconds > 0) {
-        ESP_ERROR_CHECK(esp_sleep_enable_timer_wakeup((uint64_t)seconds * 1000000ULL));
-    }
-
-    // Button wakeup: GPIO low level (preferred on ESP32-C3 since GPIO20 is not an RTC IO).
-    gpio_pullup_en(GPIO_BTN);
-    gpio_pulldown_dis(GPIO_BTN);
-#if SOC_GPIO_SUPPORT_DEEPSLEEP_WAKEUP
-    ESP_ERROR_CHECK(gpio_wakeup_enable(GPIO_BTN, GPIO_INTR_LOW_LEVEL));
-    ESP_ERROR_CHECK(esp_sleep_enable_gpio_wakeup());
-#else
-    ESP_ERROR_CHECK(esp_sleep_enable_ext0_wakeup(GPIO_BTN, 0));
-#endif
-
-    esp_deep_sleep_start();
+    // Button wakeup: GPIO low level.
+    hal_deep_sleep((seconds > 0) ? (uint64_t)seconds * 1000000ULL : 0, GPIO_BTN);
 }
 
 static void app_display_show_now(app_ctx_t *app)
 {
     timekeeper_init_if_unset();
-    time_t now = time(NULL);
-    struct tm t;
-    localtime_r(&now, &t);
-    (void)ch455g_show_hhmm(&app->disp, t.tm_hour, t.tm_min);
+    if (!app->disp_dirty) {
+        return;
+    }
+    app->disp_dirty = false;
+    int64_t mono = time_service_mono_us();
+
+    int64_t wall_ms = time_service_wall_ms();
+    timekeeper_local_t t;
+    (void)timekeeper_get_local((time_t)(wall_ms / 1000), &t);
+    (void)ch455g_show_hhmm_ex(&app->disp, t.hour, t.minute, time_persist_is_approximate());
+    // Next render at the next local minute boundary (offsets are whole minutes).
+    int64_t ms_into_minute = (int64_t)t.second * 1000 + wall_ms % 1000;
+    (void)timer_wheel_start_at(&app->disp_timer, mono + (60000 - ms_into_minute) * 1000, DISP_REFRESH_SLACK_US);
+}
+
+static void app_display_off(app_ctx_t *app)
+{
+    timer_wheel_stop(&app->disp_timer);
+    (void)ch455g_clear(&app->disp);
+    (void)ch455g_set_enabled(&app->disp, false);
 }
 
 static void app_periph_ensure_display(app_ctx_t *app)
@@ -278,6 +555,8 @@ static void app_periph_ensure_display(app_ctx_t *app)
     }
     (void)ch455g_set_sleep(&app->disp, false);
     (void)ch455g_set_enabled(&app->disp, true);
+    // May have been cleared since the last render.
+    app->disp_dirty = true;
 }
 
 static void app_periph_ensure_pwm(app_ctx_t *app)
@@ -286,6 +565,10 @@ static void app_periph_ensure_pwm(app_ctx_t *app)
         esp_err_t err = pwm_led_init(&app->pwm, GPIO_PWM_WARM, GPIO_PWM_COOL);
         if (err == ESP_OK) {
             app->pwm_inited = true;
+            const provisioning_data_t *prov = provisioning_get();
+            if (prov) {
+                (void)pwm_led_set_gain(&app->pwm, prov->led_warm_gain_q12, prov->led_cool_gain_q12);
+            }
             ESP_LOGI(TAG, "pwm init ok (warm=%d cool=%d)", (int)GPIO_PWM_WARM, (int)GPIO_PWM_COOL);
 
             // Self-test: briefly light warm-only then cool-only for diagnosis.
@@ -300,6 +583,8 @@ static void app_periph_ensure_pwm(app_ctx_t *app)
             ESP_LOGI(TAG, "pwm selftest: warm=0%% cool=100%% (expect cool LED on)");
             vTaskDelay(pdMS_TO_TICKS(200));
             (void)pwm_led_set_percent(&app->pwm, 0, 0);
+
+            light_preset_compile_all(&app->pwm, &app->cfg, app->preset_plans);
         } else {
             ESP_LOGE(TAG, "pwm init failed: %s", esp_err_to_name(err));
         }
@@ -311,46 +596,14 @@ static void app_apply_light_linear_mix(app_ctx_t *app, uint8_t total_brightness_
     if (!app) {
         return;
     }
-    if (total_brightness_0_100 > 100) {
-        total_brightness_0_100 = 100;
-    }
-    if (color_temp_0_100 > 100) {
-        color_temp_0_100 = 100;
-    }
 
-    // Linear fit/mix:
-    //  - color_temp=0   => 100% cool
-    //  - color_temp=100 => 100% warm
-    // Keep warm+cool == total_brightness.
-    uint16_t warm = (uint16_t)total_brightness_0_100 * (uint16_t)color_temp_0_100;
-    warm = (warm + 50) / 100; // rounded
-    if (warm > total_brightness_0_100) {
-        warm = total_brightness_0_100;
-    }
-
-    // Avoid both channels going to 0 when brightness is very low.
-    // If there is a non-zero brightness budget but rounding zeroed one side, force 1% to that side.
-    uint16_t cool = (uint16_t)total_brightness_0_100 - warm;
-    if (total_brightness_0_100 > 0 && color_temp_0_100 > 0 && warm == 0) {
-        warm = 1;
-        if (cool > 0) {
-            cool -= 1;
-        }
-    }
-    if (total_brightness_0_100 > 0 && color_temp_0_100 < 100 && cool == 0) {
-        cool = 1;
-        if (warm > 0) {
-            warm -= 1;
-        }
-    }
-
-    uint8_t warm_u8 = (uint8_t)warm;
-    uint8_t cool_u8 = (uint8_t)cool;
+    uint8_t warm_u8 = 0;
+    uint8_t cool_u8 = 0;
+    light_mix_percent(total_brightness_0_100, color_temp_0_100, &warm_u8, &cool_u8);
 
     app_periph_ensure_pwm(app);
     // Smooth fade to target using hardware fade; keep a moderate fade time to improve visible gradient.
-    const uint32_t fade_ms = 300;
-    esp_err_t err = pwm_led_fade_percent(&app->pwm, warm_u8, cool_u8, fade_ms);
+    esp_err_t err = pwm_led_fade_percent(&app->pwm, warm_u8, cool_u8, LIGHT_MIX_FADE_MS);
     static int64_t s_last_mix_log_us;
     int64_t now_us = esp_timer_get_time();
     if (err == ESP_OK) {
@@ -367,6 +620,91 @@ static void app_apply_light_linear_mix(app_ctx_t *app, uint8_t total_brightness_
     }
 }
 
+static bool app_preset_is_active(const app_ctx_t *app)
+{
+    int8_t idx = app->active_preset;
+    return idx >= 0 && idx < DEVICE_CONFIG_MAX_PRESETS && app->preset_plans[idx].valid;
+}
+
+// Replays the active preset's compiled plan. From dark the whole curve runs; when switching
+// while lit, fade straight to the final duties over the preset's fade time.
+static void app_preset_start(app_ctx_t *app, bool from_dark)
+{
+    const light_preset_plan_t *plan = &app->preset_plans[app->active_preset];
+    app->preset_step = from_dark ? 0 : (uint8_t)(plan->step_count - 1);
+    const light_fade_step_t *st = &plan->steps[app->preset_step];
+    uint32_t ms = from_dark ? st->time_ms : plan->total_ms;
+    esp_err_t err = pwm_led_fade_duty(&app->pwm, st->warm_duty, st->cool_duty, ms);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "preset %d apply failed: %s", (int)app->active_preset, esp_err_to_name(err));
+    }
+    app->preset_step_end_us = esp_timer_get_time() + (int64_t)ms * 1000;
+    ESP_LOGI(TAG, "preset %d \"%s\" on (steps=%u fade=%lums)", (int)app->active_preset,
+             app->cfg.presets[app->active_preset].name, (unsigned)plan->step_count, (unsigned long)ms);
+}
+
+// Advances a multi-step preset fade; step boundaries are polled from the light loops.
+static void app_preset_tick(app_ctx_t *app)
+{
+    if (!app_preset_is_active(app)) {
+        return;
+    }
+    const light_preset_plan_t *plan = &app->preset_plans[app->active_preset];
+    if (app->preset_step + 1 >= plan->step_count || esp_timer_get_time() < app->preset_step_end_us) {
+        return;
+    }
+    app->preset_step++;
+    const light_fade_step_t *st = &plan->steps[app->preset_step];
+    (void)pwm_led_fade_duty(&app->pwm, st->warm_duty, st->cool_duty, st->time_ms);
+    app->preset_step_end_us += (int64_t)st->time_ms * 1000;
+}
+
+// Manual light output: the active preset if any, otherwise wake_bright/color_temp.
+static void app_apply_manual_light(app_ctx_t *app, bool from_dark)
+{
+    app_periph_ensure_pwm(app);
+    if (app_preset_is_active(app)) {
+        app_preset_start(app, from_dark);
+        return;
+    }
+    app->active_preset = APP_PRESET_NONE;
+    app_apply_light_linear_mix(app, app->cfg.wake_bright, app->cfg.color_temp);
+}
+
+// Button gesture: next used preset, wrapping back to the plain wake_bright/color_temp light.
+static void app_preset_cycle(app_ctx_t *app)
+{
+    int8_t idx = app->active_preset;
+    for (;;) {
+        idx++;
+        if (idx >= DEVICE_CONFIG_MAX_PRESETS) {
+            idx = APP_PRESET_NONE;
+            break;
+        }
+        if (app->preset_plans[idx].valid) {
+            break;
+        }
+    }
+    app->active_preset = idx;
+    ESP_LOGI(TAG, "preset cycle -> %d", (int)idx);
+    app_apply_manual_light(app, false);
+}
+
+// Merges the alarm fields of slot 0 only; keeps other persisted settings.
+static bool app_edit_hhmme(device_config_t *cfg, void *arg)
+{
+    const device_alarm_t *in = (const device_alarm_t *)arg;
+    device_alarm_t *a = &cfg->alarms[0];
+    a->hour = in->hour;
+    a->minute = in->minute;
+    a->enabled = in->enabled;
+    if (a->enabled && a->weekdays == 0) {
+        // HHMME clients only know a daily alarm.
+        a->weekdays = DEVICE_ALARM_WEEKDAYS_ALL;
+    }
+    return true;
+}
+
 static bool ble_on_write(const uint8_t hhmme5[5], void *ctx)
 {
     app_ctx_t *app = (app_ctx_t *)ctx;
@@ -374,35 +712,49 @@ static bool ble_on_write(const uint8_t hhmme5[5], void *ctx)
     if (!device_config_parse_hhmme_ascii(hhmme5, 5, &new_cfg)) {
         return false;
     }
-
-    // Merge alarm fields only; keep other persisted settings.
-    app->cfg.alarm_hour = new_cfg.alarm_hour;
-    app->cfg.alarm_minute = new_cfg.alarm_minute;
-    app->cfg.alarm_enabled = new_cfg.alarm_enabled;
-    (void)device_config_save(&app->cfg);
+    const device_alarm_t *a = &new_cfg.alarms[0];
+    (void)app_config_edit(app, CFG_FIELD_ALARM_HOUR, app_edit_hhmme, (void *)a, (app_cfg_dirty_t){.alarms = 1u});
 
     ESP_LOGI(TAG, "alarm updated to %02u%02u (enabled=%u)",
-             app->cfg.alarm_hour,
-             app->cfg.alarm_minute,
-             (unsigned)app->cfg.alarm_enabled);
+             a->hour,
+             a->minute,
+             (unsigned)a->enabled);
 
-    // If we are staying awake (ALWAYS_ON), update next-alarm schedule immediately.
-    app_recompute_next_alarm(app);
+    app_request_resched(app);
 
     // New requirement: keep connection active; do not disconnect/sleep after writes.
 
     return true;
 }
 
+static bool app_edit_color_temp(device_config_t *cfg, void *arg)
+{
+    cfg->color_temp = *(const uint8_t *)arg;
+    return true;
+}
+
+static bool app_edit_wake_bright(device_config_t *cfg, void *arg)
+{
+    cfg->wake_bright = *(const uint8_t *)arg;
+    cfg->alarms[0].wake_bright = cfg->wake_bright;
+    return true;
+}
+
+static bool app_edit_sunrise_duration(device_config_t *cfg, void *arg)
+{
+    cfg->alarms[0].sunrise_duration = *(const uint8_t *)arg;
+    return true;
+}
+
 static bool ble_on_write_color_temp(uint8_t value_0_100, void *ctx)
 {
     app_ctx_t *app = (app_ctx_t *)ctx;
-    if (!app || value_0_100 > 100) {
+    if (!app || !CFG_IN_RANGE(COLOR_TEMP, value_0_100)) {
         return false;
     }
-    app->cfg.color_temp = value_0_100;
-    (void)device_config_save(&app->cfg);
-    ESP_LOGI(TAG, "color temp updated to %u (0=cool..100=warm)", (unsigned)app->cfg.color_temp);
+    app->active_preset = APP_PRESET_NONE;
+    (void)app_config_edit(app, CFG_FIELD_COLOR_TEMP, app_edit_color_temp, &value_0_100, (app_cfg_dirty_t){0});
+    ESP_LOGI(TAG, "color temp updated to %u (0=cool..100=warm)", (unsigned)value_0_100);
     app_request_light_update(app);
     return true;
 }
@@ -410,12 +762,13 @@ static bool ble_on_write_color_temp(uint8_t value_0_100, void *ctx)
 static bool ble_on_write_wake_bright(uint8_t value_0_100, void *ctx)
 {
     app_ctx_t *app = (app_ctx_t *)ctx;
-    if (!app || value_0_100 > 100) {
+    if (!app || !CFG_IN_RANGE(WAKE_BRIGHT, value_0_100) || !CFG_IN_RANGE(ALARM_WAKE_BRIGHT, value_0_100)) {
         return false;
     }
-    app->cfg.wake_bright = value_0_100;
-    (void)device_config_save(&app->cfg);
-    ESP_LOGI(TAG, "wake bright updated to %u", (unsigned)app->cfg.wake_bright);
+    app->active_preset = APP_PRESET_NONE;
+    // A slider: the write-behind debounce absorbs the drag. Slot 0's copy rides along with it.
+    (void)app_config_edit(app, CFG_FIELD_WAKE_BRIGHT, app_edit_wake_bright, &value_0_100, (app_cfg_dirty_t){0});
+    ESP_LOGI(TAG, "wake bright updated to %u", (unsigned)value_0_100);
     app_request_light_update(app);
     return true;
 }
@@ -423,18 +776,248 @@ static bool ble_on_write_wake_bright(uint8_t value_0_100, void *ctx)
 static bool ble_on_write_sunrise_duration(uint8_t minutes_1_60, void *ctx)
 {
     app_ctx_t *app = (app_ctx_t *)ctx;
-    if (!app || minutes_1_60 < 1 || minutes_1_60 > 60) {
+    if (!app || !CFG_IN_RANGE(ALARM_SUNRISE, minutes_1_60)) {
         return false;
     }
-    app->cfg.sunrise_duration = minutes_1_60;
-    (void)device_config_save(&app->cfg);
-    ESP_LOGI(TAG, "sunrise duration updated to %u minutes", (unsigned)app->cfg.sunrise_duration);
+    (void)app_config_edit(app, CFG_FIELD_ALARM_SUNRISE, app_edit_sunrise_duration, &minutes_1_60,
+                          (app_cfg_dirty_t){.alarms = 1u});
+    ESP_LOGI(TAG, "sunrise duration updated to %u minutes", (unsigned)minutes_1_60);
 
-    // Schedule changed -> recompute immediately.
-    app_recompute_next_alarm(app);
+    app_request_resched(app);
+    return true;
+}
+
+typedef struct {
+    uint8_t slot;
+    device_alarm_t alarm;
+} app_alarm_edit_t;
+
+static bool app_edit_alarm(device_config_t *cfg, void *arg)
+{
+    const app_alarm_edit_t *e = (const app_alarm_edit_t *)arg;
+    cfg->alarms[e->slot] = e->alarm;
+    return true;
+}
+
+static bool ble_on_write_alarm_record(const uint8_t *data, size_t len, void *ctx)
+{
+    app_ctx_t *app = (app_ctx_t *)ctx;
+    app_alarm_edit_t e;
+    if (!app || !device_config_parse_alarm_record(data, len, &e.slot, &e.alarm)) {
+        return false;
+    }
+    (void)app_config_edit(app, CFG_FIELD_ALARM_HOUR, app_edit_alarm, &e,
+                          (app_cfg_dirty_t){.alarms = (uint16_t)(1u << e.slot)});
+    ESP_LOGI(TAG, "alarm slot %u: %02u%02u days=0x%02x en=%u sunrise=%umin bright=%u", (unsigned)e.slot,
+             (unsigned)e.alarm.hour, (unsigned)e.alarm.minute, (unsigned)e.alarm.weekdays, (unsigned)e.alarm.enabled,
+             (unsigned)e.alarm.sunrise_duration, (unsigned)e.alarm.wake_bright);
+
+    app_request_resched(app);
+    return true;
+}
+
+static size_t ble_on_read_alarm_table(uint8_t *out, size_t cap, void *ctx)
+{
+    (void)ctx;
+    device_config_t cfg;
+    config_service_get(&cfg);
+    size_t len = 0;
+    for (uint8_t slot = 0; slot < DEVICE_CONFIG_MAX_ALARMS; slot++) {
+        if (cfg.alarms[slot].weekdays == 0) {
+            continue;
+        }
+        if (len + DEVICE_ALARM_RECORD_LEN > cap) {
+            break;
+        }
+        device_config_format_alarm_record(slot, &cfg.alarms[slot], &out[len]);
+        len += DEVICE_ALARM_RECORD_LEN;
+    }
+    return len;
+}
+
+typedef struct {
+    uint8_t slot;
+    device_preset_t preset;
+} app_preset_edit_t;
+
+static bool app_edit_preset(device_config_t *cfg, void *arg)
+{
+    const app_preset_edit_t *e = (const app_preset_edit_t *)arg;
+    cfg->presets[e->slot] = e->preset;
+    return true;
+}
+
+// 0xFF18 write: 1 byte selects a preset (0xFF = none) and turns manual light on; a longer
+// value is a preset record that is stored and compiled.
+static bool ble_on_write_preset(const uint8_t *data, size_t len, void *ctx)
+{
+    app_ctx_t *app = (app_ctx_t *)ctx;
+    if (!app || !data) {
+        return false;
+    }
+
+    if (len == 1) {
+        int8_t idx = (data[0] == 0xFF) ? APP_PRESET_NONE : (int8_t)data[0];
+        if (idx != APP_PRESET_NONE && data[0] >= DEVICE_CONFIG_MAX_PRESETS) {
+            return false;
+        }
+        device_config_t cfg;
+        config_service_get(&cfg);
+        if (idx != APP_PRESET_NONE && cfg.presets[idx].name[0] == 0) {
+            return false;
+        }
+        app->active_preset = idx;
+        app->manual_light_requested = true;
+        ESP_LOGI(TAG, "preset %d selected over BLE", (int)idx);
+        app_request_light_update(app);
+        return true;
+    }
+
+    app_preset_edit_t e;
+    if (!device_config_parse_preset_record(data, len, &e.slot, &e.preset)) {
+        return false;
+    }
+    // The main task recompiles the slot when it picks the edit up.
+    (void)app_config_edit(app, CFG_FIELD_PRESET_BRIGHTNESS, app_edit_preset, &e,
+                          (app_cfg_dirty_t){.presets = (uint8_t)(1u << e.slot)});
+    const device_preset_t *preset = &e.preset;
+    if (app->active_preset == (int8_t)e.slot) {
+        if (preset->name[0] == 0) {
+            app->active_preset = APP_PRESET_NONE;
+        }
+        app_request_light_update(app);
+    }
+    ESP_LOGI(TAG, "preset slot %u: \"%s\" bright=%u ct=%u curve=%u fade=%ums", (unsigned)e.slot, preset->name,
+             (unsigned)preset->brightness, (unsigned)preset->color_temp, (unsigned)preset->curve,
+             (unsigned)preset->fade_ds * 100u);
+    return true;
+}
+
+static size_t ble_on_read_presets(uint8_t *out, size_t cap, void *ctx)
+{
+    app_ctx_t *app = (app_ctx_t *)ctx;
+    if (cap < 1) {
+        return 0;
+    }
+    out[0] = (app->active_preset == APP_PRESET_NONE) ? 0xFF : (uint8_t)app->active_preset;
+    device_config_t cfg;
+    config_service_get(&cfg);
+    size_t len = 1;
+    for (uint8_t slot = 0; slot < DEVICE_CONFIG_MAX_PRESETS; slot++) {
+        if (cfg.presets[slot].name[0] == 0) {
+            continue;
+        }
+        if (len + DEVICE_PRESET_RECORD_MAX_LEN > cap) {
+            break;
+        }
+        len += device_config_format_preset_record(slot, &cfg.presets[slot], &out[len]);
+    }
+    return len;
+}
+
+typedef struct {
+    const uint8_t *data;
+    size_t len;
+    cfg_tlv_result_t res;
+} app_settings_edit_t;
+
+// Items are range-checked one by one; dates need the whole edit (day against month and year).
+static bool app_edit_settings(device_config_t *cfg, void *arg)
+{
+    app_settings_edit_t *e = (app_settings_edit_t *)arg;
+    device_config_t next = *cfg;
+    if (!config_schema_apply_tlv(&next, e->data, e->len, &e->res) || !device_config_is_valid(&next)) {
+        return false;
+    }
+    *cfg = next;
+    return true;
+}
+
+// 0xFF19 write: schema TLV items; applied all-or-nothing.
+static bool ble_on_write_settings(const uint8_t *data, size_t len, void *ctx)
+{
+    app_ctx_t *app = (app_ctx_t *)ctx;
+    if (!app) {
+        return false;
+    }
+    app_settings_edit_t e = {.data = data, .len = len};
+    if (config_service_edit(app_edit_settings, &e) == ESP_ERR_INVALID_ARG) {
+        return false;
+    }
+    const cfg_tlv_result_t res = e.res;
+    if (res.immediate) {
+        (void)config_service_flush();
+    }
+    app_post_cfg_edit(app, (app_cfg_dirty_t){.alarms = res.alarms_changed,
+                                              .presets = res.presets_changed,
+                                              .skips = res.skips_changed != 0});
+    ESP_LOGI(TAG, "settings updated: globals=%d alarms=0x%04x presets=0x%02x skips=0x%02x immediate=%d",
+             (int)res.globals_changed, (unsigned)res.alarms_changed, (unsigned)res.presets_changed,
+             (unsigned)res.skips_changed, (int)res.immediate);
+
+    if (res.alarms_changed || res.skips_changed || res.globals_changed) {
+        app_request_resched(app);
+    }
+    if (res.globals_changed || res.presets_changed) {
+        if (res.globals_changed) {
+            app->active_preset = APP_PRESET_NONE;
+        }
+        app_request_light_update(app);
+    }
+    return true;
+}
+
+static size_t ble_on_read_settings(uint8_t *out, size_t cap, void *ctx)
+{
+    (void)ctx;
+    device_config_t cfg;
+    config_service_get(&cfg);
+    // Globals, then the date items of dated/skip-next alarms and used skip entries.
+    size_t len = config_schema_encode_globals(&cfg, out, cap);
+    return len + config_schema_encode_dates(&cfg, out + len, cap - len);
+}
+
+// 0xFF1A write: one chunked-upload command. A committed image replaces the whole config at once.
+static bool ble_on_write_config_image(const uint8_t *data, size_t len, void *ctx)
+{
+    app_ctx_t *app = (app_ctx_t *)ctx;
+    if (!app) {
+        return false;
+    }
+    device_config_t cfg;
+    bool ready = false;
+    if (config_image_rx_feed(&app->image_rx, data, len, &cfg, &ready) != ESP_OK) {
+        return false;
+    }
+    if (!ready) {
+        return true;
+    }
+
+    (void)config_service_update(&cfg);
+    (void)config_service_flush();
+    app->active_preset = APP_PRESET_NONE;
+    app_post_cfg_edit(app, (app_cfg_dirty_t){.all = true});
+    ESP_LOGI(TAG, "config image applied");
+
+    app_request_resched(app);
+    app_request_light_update(app);
     return true;
 }
 
+static size_t ble_on_read_config_image(uint8_t *out, size_t cap, void *ctx)
+{
+    (void)ctx;
+    device_config_t cfg;
+    config_service_get(&cfg);
+    return device_config_export_image(&cfg, out, cap);
+}
+
+static size_t ble_on_read_storage_stats(uint8_t *out, size_t cap, void *ctx)
+{
+    (void)ctx;
+    return storage_telemetry_encode(out, cap);
+}
+
 static bool ble_on_time_sync(const uint8_t hhmmss6[6], void *ctx)
 {
     app_ctx_t *app = (app_ctx_t *)ctx;
@@ -456,16 +1039,44 @@ static bool ble_on_time_sync(const uint8_t hhmmss6[6], void *ctx)
         return false;
     }
 
+    // The step event reschedules the alarm and display on the main task.
     ESP_LOGI(TAG, "time synced to %02u:%02u:%02u", (unsigned)hh, (unsigned)mm, (unsigned)ss);
 
-    // Time changed -> recompute schedule immediately.
-    app_recompute_next_alarm(app);
-
     // New requirement: keep connection active; do not disconnect/sleep after time sync.
 
     return true;
 }
 
+// 0xFF1C write: one step of a timed exchange; a commit sets the clock from the best exchange.
+static bool ble_on_write_time_exchange(const uint8_t *data, size_t len, int64_t rx_us, void *ctx)
+{
+    app_ctx_t *app = (app_ctx_t *)ctx;
+    if (!app) {
+        return false;
+    }
+    time_sync_result_t res;
+    bool ready = false;
+    if (time_sync_feed(&app->time_sync, data, len, rx_us, &res, &ready) != ESP_OK) {
+        return false;
+    }
+    if (!ready) {
+        return true;
+    }
+    // Projected on the monotonic clock up to the moment the wall clock is set.
+    if (!timekeeper_set_utc_ms(time_sync_utc_ms_at(&res, time_service_mono_us()), res.unc_ms)) {
+        return false;
+    }
+    ESP_LOGI(TAG, "time synced by exchange: best delay %lu us of %u, +-%lu ms", (unsigned long)res.delay_us,
+             (unsigned)res.samples, (unsigned long)res.unc_ms);
+    return true;
+}
+
+static size_t ble_on_read_time_exchange(uint8_t *out, size_t cap, int64_t at_us, void *ctx)
+{
+    app_ctx_t *app = (app_ctx_t *)ctx;
+    return time_sync_read(&app->time_sync, at_us, out, cap);
+}
+
 static uint8_t ble_on_batt_read(void *ctx)
 {
     app_ctx_t *app = (app_ctx_t *)ctx;
@@ -481,19 +1092,24 @@ static uint8_t ble_on_batt_read(void *ctx)
         return 0;
     }
     pct = battery_mv_to_percent(mv);
+    app_check_low_battery(pct);
     ESP_LOGI(TAG, "battery read: %u mV -> %u%%", (unsigned)mv, (unsigned)pct);
     return pct;
 }
 
 static void ble_on_read(uint8_t out_hhmme5[5], void *ctx)
 {
-    app_ctx_t *app = (app_ctx_t *)ctx;
-    device_config_format_hhmme_ascii(&app->cfg, out_hhmme5);
+    (void)ctx;
+    device_config_t cfg;
+    config_service_get(&cfg);
+    device_config_format_hhmme_ascii(&cfg, out_hhmme5);
 }
 
 static void ble_on_disconnect(void *ctx)
 {
     app_ctx_t *app = (app_ctx_t *)ctx;
+    config_image_rx_reset(&app->image_rx);
+    time_sync_reset(&app->time_sync);
 
     // New requirement: any time we are not connected, keep advertising (GAP packets).
     (void)ble_alarm_start_advertising();
@@ -503,31 +1119,40 @@ static void ble_on_disconnect(void *ctx)
 static void app_ble_ensure_adv(app_ctx_t *app)
 {
     if (!app->ble_inited) {
-        ESP_ERROR_CHECK(ble_alarm_init(ble_on_write,
-                                       ble_on_read,
-                                       ble_on_time_sync,
-                                       ble_on_batt_read,
-                                       ble_on_write_color_temp,
-                                       ble_on_write_wake_bright,
-                                       ble_on_write_sunrise_duration,
-                                       ble_on_connect,
-                                       ble_on_disconnect,
-                                       app));
+        const ble_alarm_callbacks_t cbs = {
+            .on_write = ble_on_write,
+            .on_read = ble_on_read,
+            .on_time_sync = ble_on_time_sync,
+            .on_batt_read = ble_on_batt_read,
+            .on_write_color_temp = ble_on_write_color_temp,
+            .on_write_wake_bright = ble_on_write_wake_bright,
+            .on_write_sunrise_duration = ble_on_write_sunrise_duration,
+            .on_write_alarm_record = ble_on_write_alarm_record,
+            .on_read_alarm_table = ble_on_read_alarm_table,
+            .on_write_preset = ble_on_write_preset,
+            .on_read_presets = ble_on_read_presets,
+            .on_write_settings = ble_on_write_settings,
+            .on_read_settings = ble_on_read_settings,
+            .on_write_config_image = ble_on_write_config_image,
+            .on_read_config_image = ble_on_read_config_image,
+            .on_read_storage_stats = ble_on_read_storage_stats,
+            .on_write_time_exchange = ble_on_write_time_exchange,
+            .on_read_time_exchange = ble_on_read_time_exchange,
+            .on_connect = ble_on_connect,
+            .on_disconnect = ble_on_disconnect,
+            .ctx = app,
+        };
+        char suffix[PROVISIONING_NAME_SUFFIX_MAX + 1];
+        if (provisioning_get_name_suffix(suffix)) {
+            (void)ble_alarm_set_name_suffix(suffix);
+        }
+        ESP_ERROR_CHECK(ble_alarm_init(&cbs));
         app->ble_inited = true;
 
         // Start a periodic battery notify while awake; ble_alarm will only send when CCCD enabled.
-        if (!app->batt_notify_timer) {
-            const esp_timer_create_args_t args = {
-                .callback = &batt_notify_timer_cb,
-                .arg = app,
-                .dispatch_method = ESP_TIMER_TASK,
-                .name = "batt_notify",
-                .skip_unhandled_events = true,
-            };
-            (void)esp_timer_create(&args, &app->batt_notify_timer);
-            if (app->batt_notify_timer) {
-                (void)esp_timer_start_periodic(app->batt_notify_timer, 60ULL * 1000000ULL);
-            }
+        if (!timer_wheel_is_armed(&app->batt_notify_timer)) {
+            timer_wheel_timer_init(&app->batt_notify_timer, "batt_notify", batt_notify_timer_cb, app);
+            (void)timer_wheel_start_periodic(&app->batt_notify_timer, BATT_NOTIFY_PERIOD_US, BATT_NOTIFY_SLACK_US);
         }
     }
     (void)ble_alarm_start_advertising();
@@ -540,24 +1165,33 @@ static void app_run_show_time(app_ctx_t *app, uint32_t show_ms)
     app_periph_ensure_display(app);
     app_ble_ensure_adv(app);
 
-    int64_t end_us = esp_timer_get_time() + (int64_t)show_ms * 1000;
+    app->show_expired = false;
+    (void)timer_wheel_start_once(&app->show_timer, (uint64_t)show_ms * 1000, TIME_SHOW_SLACK_US);
 
-    while (esp_timer_get_time() < end_us) {
+    while (!app->show_expired) {
         app_display_show_now(app);
+        if (app->state == APP_STATE_MANUAL_LIGHT) {
+            app_preset_tick(app);
+        }
 
         // Let long-press break out to manual light immediately.
         button_event_t ev = button_poll(&app->btn);
         if (ev == BUTTON_EVENT_LONG) {
             ESP_LOGI(TAG, "show_time: long press -> manual light");
+            timer_wheel_stop(&app->show_timer);
             app_run_manual_light(app);
             return;
         }
+        // Another short press while the time is shown over manual light steps through presets.
+        if (ev == BUTTON_EVENT_SHORT && app->state == APP_STATE_MANUAL_LIGHT) {
+            app_preset_cycle(app);
+            (void)timer_wheel_start_once(&app->show_timer, (uint64_t)show_ms * 1000, TIME_SHOW_SLACK_US);
+        }
 
         vTaskDelay(pdMS_TO_TICKS(100));
     }
 
-    (void)ch455g_clear(&app->disp);
-    (void)ch455g_set_enabled(&app->disp, false);
+    app_display_off(app);
 }
 
 static void app_run_alarm_gradient(app_ctx_t *app)
@@ -570,72 +1204,53 @@ static void app_run_alarm_gradient(app_ctx_t *app)
     // Prevent a stale release from being interpreted as an immediate SHORT cancel.
     button_sync_state(&app->btn);
 
-    uint8_t sunrise_min = app->cfg.sunrise_duration;
-    if (sunrise_min < 1 || sunrise_min > 60) {
-        sunrise_min = (uint8_t)DEFAULT_SUNRISE_MINUTES_FALLBACK;
-        if (sunrise_min < 1) sunrise_min = 1;
-        if (sunrise_min > 60) sunrise_min = 60;
-    }
+    const uint8_t slot = (app->next_alarm_slot < DEVICE_CONFIG_MAX_ALARMS) ? app->next_alarm_slot : 0;
+    const device_alarm_t *alarm = &app->cfg.alarms[slot];
+
+    // Alarm fields were range-checked against the schema when loaded/written.
+    const uint8_t sunrise_min = alarm->sunrise_duration;
 
     int64_t total_ms = (int64_t)sunrise_min * 60 * 1000;
 
-    // Keep total_ms strictly based on sunrise_duration.
-    // Shortening based on "time until alarm" can collapse the ramp into a few seconds if the clock/alarm time
-    // is not aligned (user feedback: jumps to max brightness too fast).
+    // The ramp peaks at the alarm time on the wall clock: next_alarm_ts is the sunrise start. A late
+    // start or a sync mid-ramp changes the ramp's rate (bounded), never its brightness directly.
+    int64_t wall_ms = time_service_wall_ms();
+    int64_t peak_wall_ms = (app->next_alarm_ts != 0) ? (int64_t)app->next_alarm_ts * 1000 + total_ms : wall_ms + total_ms;
+    sunrise_t sr;
+    sunrise_start(&sr, peak_wall_ms, (uint32_t)total_ms, alarm->wake_bright, time_service_mono_us(), wall_ms);
+    uint32_t steps_seen = app->time_step_seq;
 
-    ESP_LOGI(TAG, "gradient: sunrise_min=%u total_ms=%lld target_bright=%u ct=%u",
+    ESP_LOGI(TAG, "gradient: slot=%u sunrise_min=%u total_ms=%lld peak_in=%lldms rate=%lu/65536 target_bright=%u ct=%u",
+             (unsigned)slot,
              (unsigned)sunrise_min,
              (long long)total_ms,
-             (unsigned)((app->cfg.wake_bright > 100) ? 100 : app->cfg.wake_bright),
-             (unsigned)((app->cfg.color_temp > 100) ? 100 : app->cfg.color_temp));
-
-    int64_t start_us = esp_timer_get_time();
-    int64_t end_us = start_us + total_ms * 1000;
+             (long long)(peak_wall_ms - wall_ms),
+             (unsigned long)sr.rate_q16,
+             (unsigned)alarm->wake_bright,
+             (unsigned)app->cfg.color_temp);
 
     bool canceled = false;
 
-    while (esp_timer_get_time() < end_us) {
-        int64_t now_us = esp_timer_get_time();
-        int64_t elapsed_ms = (now_us - start_us) / 1000;
-
-        // Scale gradient by configured wake max brightness.
-        uint8_t target = app->cfg.wake_bright;
-        if (target > 100) {
-            target = 100;
+    for (;;) {
+        app_refresh_cfg(app);
+        int64_t now_us = time_service_mono_us();
+        if (app->time_step_seq != steps_seen) {
+            steps_seen = app->time_step_seq;
+            sunrise_replan(&sr, now_us, time_service_wall_ms());
+            ESP_LOGI(TAG, "gradient: clock stepped -> replan at %ldms, rate=%lu/65536",
+                     (long)sunrise_position_ms(&sr, now_us), (unsigned long)sr.rate_q16);
         }
-
-        // Exponential-ish ramp (cubic): brightness = target * progress^3.
-        // This makes the beginning even smoother than quadratic.
-        uint8_t brightness = 0;
-        if (target == 0 || elapsed_ms <= 0) {
-            brightness = 0;
-        } else if (elapsed_ms >= total_ms) {
-            brightness = target;
-        } else {
-            // progress in Q15 (0..32768)
-            uint32_t p = (uint32_t)(((uint64_t)elapsed_ms << 15) / (uint64_t)total_ms);
-            if (p > (1u << 15)) {
-                p = (1u << 15);
-            }
-            // p2 and p3 in Q15
-            uint32_t p2 = (uint32_t)(((uint64_t)p * (uint64_t)p) >> 15);
-            uint32_t p3 = (uint32_t)(((uint64_t)p2 * (uint64_t)p) >> 15);
-            uint32_t b = (uint32_t)(((uint64_t)p3 * (uint64_t)target + (1u << 14)) >> 15);
-            if (b > target) {
-                b = target;
-            }
-            brightness = (uint8_t)b;
-            // Make sure we don't stay totally dark for too long when the ramp just started.
-            if (brightness == 0) {
-                brightness = 1;
-            }
+        if (sunrise_done(&sr, now_us)) {
+            break;
         }
+        uint8_t brightness = sunrise_brightness(&sr, now_us);
 
         // Rate-limited progress log (helps diagnose "few seconds to full bright" cases).
         static int64_t s_last_grad_log_us;
         if (s_last_grad_log_us == 0 || (now_us - s_last_grad_log_us) >= 3000000LL) {
-            int64_t remain_ms = (end_us - now_us) / 1000;
-            ESP_LOGI(TAG, "gradient: elapsed=%lldms remain=%lldms bright=%u/%u", (long long)elapsed_ms, (long long)remain_ms, (unsigned)brightness, (unsigned)target);
+            ESP_LOGI(TAG, "gradient: pos=%ld/%lldms peak_in=%lldms bright=%u/%u", (long)sunrise_position_ms(&sr, now_us),
+                     (long long)total_ms, (long long)(peak_wall_ms - time_service_wall_ms()), (unsigned)brightness,
+                     (unsigned)alarm->wake_bright);
             s_last_grad_log_us = now_us;
         }
         app_apply_light_linear_mix(app, brightness, app->cfg.color_temp);
@@ -649,7 +1264,7 @@ static void app_run_alarm_gradient(app_ctx_t *app)
             break;
         }
 
-        app_wait_ms_or_light_update(500);
+        app_wait_ms_or_light_update(SUNRISE_STEP_MS);
     }
 
     // After the sunrise finishes, keep light ON until user cancels with a short press.
@@ -657,11 +1272,7 @@ static void app_run_alarm_gradient(app_ctx_t *app)
     if (canceled) {
         (void)pwm_led_off(&app->pwm);
     } else {
-        uint8_t target = app->cfg.wake_bright;
-        if (target > 100) {
-            target = 100;
-        }
-        app_apply_light_linear_mix(app, target, app->cfg.color_temp);
+        app_apply_light_linear_mix(app, alarm->wake_bright, app->cfg.color_temp);
 
         // Wait here until user short-presses to close the alarm. Allow BLE updates to change
         // brightness/color temperature while the alarm is active.
@@ -675,17 +1286,13 @@ static void app_run_alarm_gradient(app_ctx_t *app)
             }
             if (app->light_update_pending) {
                 app->light_update_pending = false;
-                target = app->cfg.wake_bright;
-                if (target > 100) {
-                    target = 100;
-                }
-                app_apply_light_linear_mix(app, target, app->cfg.color_temp);
+                app_refresh_cfg(app);
+                app_apply_light_linear_mix(app, alarm->wake_bright, app->cfg.color_temp);
             }
             app_wait_ms_or_light_update(100);
         }
     }
-    (void)ch455g_clear(&app->disp);
-    (void)ch455g_set_enabled(&app->disp, false);
+    app_display_off(app);
 
     // New requirement: cancel deep sleep mode.
     return;
@@ -699,34 +1306,32 @@ static void app_run_manual_light(app_ctx_t *app)
     app_periph_ensure_pwm(app);
     app_ble_ensure_adv(app);
 
-    // Manual light uses configured color temperature; brightness uses user-configured max (wake_bright).
-    uint8_t manual_bright = app->cfg.wake_bright;
-    if (manual_bright > 100) {
-        manual_bright = 100;
-    }
-    app_apply_light_linear_mix(app, manual_bright, app->cfg.color_temp);
+    // Manual light uses the active preset, or configured color temperature with the user-configured
+    // max brightness (wake_bright).
+    app->manual_light_requested = false;
+    app_apply_manual_light(app, true);
 
-    uint8_t last_bright = manual_bright;
-    uint8_t last_ct = (app->cfg.color_temp > 100) ? 100 : app->cfg.color_temp;
+    uint8_t last_bright = app->cfg.wake_bright;
+    uint8_t last_ct = app->cfg.color_temp;
+    int8_t last_preset = app->active_preset;
     app->light_update_pending = false;
 
     for (;;) {
+        app_refresh_cfg(app);
         app_display_show_now(app);
+        app_preset_tick(app);
 
         // Apply only when changed (reduces constant fade restarts -> less noise, more responsiveness).
         uint8_t cur_bright = app->cfg.wake_bright;
-        if (cur_bright > 100) {
-            cur_bright = 100;
-        }
         uint8_t cur_ct = app->cfg.color_temp;
-        if (cur_ct > 100) {
-            cur_ct = 100;
-        }
-        if (app->light_update_pending || cur_bright != last_bright || cur_ct != last_ct) {
+        int8_t cur_preset = app->active_preset;
+        if (app->light_update_pending || cur_bright != last_bright || cur_ct != last_ct || cur_preset != last_preset) {
             app->light_update_pending = false;
-            app_apply_light_linear_mix(app, cur_bright, cur_ct);
+            app->manual_light_requested = false;
+            app_apply_manual_light(app, false);
             last_bright = cur_bright;
             last_ct = cur_ct;
+            last_preset = app->active_preset;
         }
 
         button_event_t ev = button_poll(&app->btn);
@@ -739,6 +1344,7 @@ static void app_run_manual_light(app_ctx_t *app)
             ESP_LOGI(TAG, "manual light: short press -> show time");
             app_run_show_time(app, TIME_SHOW_MS);
             app->state = APP_STATE_MANUAL_LIGHT;
+            last_preset = app->active_preset; // already applied by the show-time gesture
             app_periph_ensure_display(app);
             app_periph_ensure_pwm(app);
             app_ble_ensure_adv(app);
@@ -748,8 +1354,7 @@ static void app_run_manual_light(app_ctx_t *app)
     }
 
     (void)pwm_led_off(&app->pwm);
-    (void)ch455g_clear(&app->disp);
-    (void)ch455g_set_enabled(&app->disp, false);
+    app_display_off(app);
 
     // New requirement: cancel deep sleep mode.
     return;
@@ -778,16 +1383,35 @@ static void app_run_always_on(app_ctx_t *app)
     app_recompute_next_alarm(app);
 
     for (;;) {
+        app_refresh_cfg(app);
         // Alarm trigger while staying awake (ALWAYS_ON). This keeps the PWM wake-up behavior testable
         // without deep sleep.
-        time_t now = time(NULL);
-        if (app->cfg.alarm_enabled && app->next_alarm_ts == 0 && timekeeper_is_time_sane(now)) {
+        // Deadlines are monotonic; a wall-clock step only matters through its event.
+        if (app->resched_pending) {
+            app->resched_pending = false;
             app_recompute_next_alarm(app);
         }
-        if (app->next_alarm_ts != 0 && timekeeper_is_time_sane(now) && now >= app->next_alarm_ts) {
-            ESP_LOGI(TAG, "ALWAYS_ON: alarm due -> start gradient");
-            app_run_alarm_gradient(app);
-            app_recompute_next_alarm(app);
+        if (app->alarm_due) {
+            app->alarm_due = false;
+            time_t now = timekeeper_now();
+            if (now < app->next_alarm_ts) {
+                // Drift correction moved the wall clock relative to the monotonic one; re-arm.
+                app_arm_alarm(app, time_service_mono_at(app->next_alarm_ts));
+            } else if (app->next_alarm_skip) {
+                ESP_LOGI(TAG, "ALWAYS_ON: alarm slot %u skipped once", (unsigned)app->next_alarm_slot);
+                app->last_fired_ts = app->next_alarm_ts;
+                app_alarm_consumed(app, app->next_alarm_slot, true);
+                app_recompute_next_alarm(app);
+            } else {
+                ESP_LOGI(TAG, "ALWAYS_ON: alarm due -> start gradient");
+                app->last_fired_ts = app->next_alarm_ts;
+                const uint8_t slot = app->next_alarm_slot;
+                app_run_alarm_gradient(app);
+                if (slot < DEVICE_CONFIG_MAX_ALARMS) {
+                    app_alarm_consumed(app, slot, false);
+                }
+                app_recompute_next_alarm(app);
+            }
         }
 
         // In ALWAYS_ON debug, also handle BTN so display/LED can be verified without deep sleep.
@@ -799,6 +1423,9 @@ static void app_run_always_on(app_ctx_t *app)
             ESP_LOGI(TAG, "ALWAYS_ON: long press -> manual light toggle");
             // Debounce long vs short: once we enter manual, we stay until long press inside manual exits.
             app_run_manual_light(app);
+        } else if (app->manual_light_requested) {
+            ESP_LOGI(TAG, "ALWAYS_ON: preset selected over BLE -> manual light");
+            app_run_manual_light(app);
         }
 
         // Periodic log so monitor has continuous output.
@@ -807,13 +1434,18 @@ static void app_run_always_on(app_ctx_t *app)
         if ((tick % 10) == 0) {
             ESP_LOGI(TAG, "ALWAYS_ON tick: connected=%d adv=%d", (int)ble_alarm_is_connected(), (int)ble_alarm_is_advertising());
         }
-        vTaskDelay(pdMS_TO_TICKS(200));
+        // Button polling still needs the tick; the alarm timer cuts it short.
+        app_wait_ms_or_light_update(200);
     }
 }
 
 void app_main(void)
 {
     ESP_LOGI(TAG, "boot (deep sleep disabled by requirement)");
+#if CONFIG_LIGHT_ALARM_MICROBENCH
+    microbench_result_t bench[MICROBENCH_MAX_CASES];
+    microbench_print(stdout, "CPU cycles", bench, microbench_run_all(bench, MICROBENCH_MAX_CASES));
+#endif
 
     esp_err_t err = nvs_flash_init();
     if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
@@ -822,31 +1454,52 @@ void app_main(void)
     } else {
         ESP_ERROR_CHECK(err);
     }
+    // Before every module that arms a deadline.
+    ESP_ERROR_CHECK(timer_wheel_init());
+    // Before config_service_init() so a migration write on first boot is already counted.
+    (void)storage_telemetry_init();
+    // Before the first clock read: timekeeper_now() applies the persisted drift estimate.
+    (void)rtc_drift_init();
+    // Before anything calls timekeeper_init_if_unset(), which restores from these snapshots.
+    (void)time_persist_init();
+
+    // Per-unit factory data lives in its own partition, so the NVS erase above never loses it.
+    (void)provisioning_init();
+    const provisioning_data_t *prov = provisioning_get();
+    battery_trim_t batt_trim = {.en_active_level = -1, .gain_q12 = PROVISIONING_GAIN_Q12_ONE};
+    if (prov) {
+        batt_trim.en_active_level = (prov->bat_en_active_level == PROVISIONING_BAT_EN_AUTO)
+                                        ? -1
+                                        : (int8_t)prov->bat_en_active_level;
+        batt_trim.gain_q12 = prov->batt_gain_q12;
+        batt_trim.offset_mv = prov->batt_offset_mv;
+    }
 
     app_ctx_t app = {0};
     app.main_task = xTaskGetCurrentTaskHandle();
-    ESP_ERROR_CHECK(device_config_load(&app.cfg));
+    app.active_preset = APP_PRESET_NONE;
+    timer_wheel_timer_init(&app.alarm_timer, "alarm", app_alarm_timer_cb, &app);
+    timer_wheel_timer_init(&app.disp_timer, "disp_minute", app_disp_timer_cb, &app);
+    timer_wheel_timer_init(&app.show_timer, "time_show", app_show_timer_cb, &app);
+    ESP_ERROR_CHECK(config_service_init(&app.cfg));
+    tz_set_zone(app.cfg.tz_zone);
+    alarm_sched_build(&app.sched, &app.cfg);
+    ESP_ERROR_CHECK(time_service_subscribe(app_on_time_step_sched, &app));
+    ESP_ERROR_CHECK(time_service_subscribe(app_on_time_step_display, &app));
 
     ESP_ERROR_CHECK(button_init(&app.btn, GPIO_BTN, true, LONG_PRESS_MS));
 
     // Always keep BAT_ADC_EN off unless sampling.
-    gpio_config_t en = {
-        .pin_bit_mask = (1ULL << GPIO_BAT_ADC_EN),
-        .mode = GPIO_MODE_OUTPUT,
-        .pull_up_en = GPIO_PULLUP_DISABLE,
-        .pull_down_en = GPIO_PULLDOWN_DISABLE,
-        .intr_type = GPIO_INTR_DISABLE,
-    };
-    gpio_config(&en);
+    hal_gpio_config(GPIO_BAT_ADC_EN, HAL_GPIO_OUTPUT, HAL_GPIO_PULL_NONE);
 #if CONFIG_LIGHT_ALARM_DEBUG_BAT_ADC_EN_ALWAYS_HIGH
-    gpio_set_level(GPIO_BAT_ADC_EN, 1);
+    hal_gpio_set(GPIO_BAT_ADC_EN, 1);
     ESP_LOGW(TAG, "DEBUG: BAT_ADC_EN forced HIGH permanently");
 #else
-    gpio_set_level(GPIO_BAT_ADC_EN, 0);
+    hal_gpio_set(GPIO_BAT_ADC_EN, (batt_trim.en_active_level == 0) ? 1 : 0);
 #endif
 
     // Battery ADC (best-effort): used by BLE battery characteristic.
-    if (battery_init(&app.batt, GPIO_BAT_ADC, GPIO_BAT_ADC_EN) == ESP_OK) {
+    if (battery_init(&app.batt, GPIO_BAT_ADC, GPIO_BAT_ADC_EN, &batt_trim) == ESP_OK) {
         app.batt_inited = true;
     } else {
         ESP_LOGW(TAG, "battery init failed; battery characteristic will report 0%%");
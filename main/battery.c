@@ -3,9 +3,6 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
-#include "esp_adc/adc_cali.h"
-#include "esp_adc/adc_cali_scheme.h"
-#include "esp_adc/adc_oneshot.h"
 #include "esp_log.h"
 #include "esp_timer.h"
 
@@ -57,13 +54,13 @@ uint8_t battery_mv_to_percent(uint32_t mv)
     return mv_to_percent(mv);
 }
 
-static int battery_read_raw_avg(adc_oneshot_unit_handle_t unit, adc_channel_t channel)
+static int battery_read_raw_avg(hal_adc_t *adc)
 {
     int raw_sum = 0;
     const int samples = 8;
     for (int i = 0; i < samples; i++) {
         int raw = 0;
-        if (adc_oneshot_read(unit, channel, &raw) != ESP_OK) {
+        if (hal_adc_read_raw(adc, &raw) != ESP_OK) {
             return -1;
         }
         raw_sum += raw;
@@ -72,7 +69,14 @@ static int battery_read_raw_avg(adc_oneshot_unit_handle_t unit, adc_channel_t ch
     return raw_sum / samples;
 }
 
-esp_err_t battery_init(battery_t *bat, gpio_num_t adc_gpio, gpio_num_t en_gpio)
+static uint32_t apply_trim(const battery_t *bat, uint32_t mv)
+{
+    int64_t v = ((int64_t)mv * (int64_t)bat->gain_q12 + 2048) >> 12;
+    v += bat->offset_mv;
+    return (v > 0) ? (uint32_t)v : 0;
+}
+
+esp_err_t battery_init(battery_t *bat, hal_gpio_t adc_gpio, hal_gpio_t en_gpio, const battery_trim_t *trim)
 {
     if (!bat) {
         return ESP_ERR_INVALID_ARG;
@@ -82,83 +86,27 @@ esp_err_t battery_init(battery_t *bat, gpio_num_t adc_gpio, gpio_num_t en_gpio)
     bat->adc_gpio = adc_gpio;
     bat->en_gpio = en_gpio;
     bat->en_active_high = true;
-
-    gpio_config_t en = {
-        .pin_bit_mask = (1ULL << en_gpio),
-        .mode = GPIO_MODE_OUTPUT,
-        .pull_up_en = GPIO_PULLUP_DISABLE,
-        .pull_down_en = GPIO_PULLDOWN_DISABLE,
-        .intr_type = GPIO_INTR_DISABLE,
-    };
-    esp_err_t err = gpio_config(&en);
-    if (err != ESP_OK) {
-        return err;
+    bat->gain_q12 = 4096;
+    if (trim) {
+        bat->gain_q12 = trim->gain_q12;
+        bat->offset_mv = trim->offset_mv;
     }
-    gpio_set_level(en_gpio, 0);
 
-    adc_unit_t unit_id;
-    adc_channel_t channel;
-    err = adc_oneshot_io_to_channel(adc_gpio, &unit_id, &channel);
+    esp_err_t err = hal_gpio_config(en_gpio, HAL_GPIO_OUTPUT, HAL_GPIO_PULL_NONE);
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "adc_oneshot_io_to_channel failed for gpio=%d: %s", (int)adc_gpio, esp_err_to_name(err));
         return err;
     }
+    hal_gpio_set(en_gpio, (trim && trim->en_active_level == 0) ? 1 : 0);
 
-    adc_oneshot_unit_init_cfg_t unit_cfg = {
-        .unit_id = unit_id,
-        .ulp_mode = ADC_ULP_MODE_DISABLE,
-    };
-
-    adc_oneshot_unit_handle_t unit = NULL;
-    err = adc_oneshot_new_unit(&unit_cfg, &unit);
+    err = hal_adc_open(&bat->adc, adc_gpio);
     if (err != ESP_OK) {
+        ESP_LOGE(TAG, "adc open failed for gpio=%d: %s", (int)adc_gpio, esp_err_to_name(err));
         return err;
     }
+    int unit_id = bat->adc.unit_id;
+    int channel = bat->adc.channel;
+    bool cali_ok = (bat->adc.cali != NULL);
 
-    adc_oneshot_chan_cfg_t chan_cfg = {
-        // Use 11dB attenuation to avoid saturation near 2.0V ADC input (≈8.4V battery after divider).
-        .atten = ADC_ATTEN_DB_11,
-        .bitwidth = ADC_BITWIDTH_DEFAULT,
-    };
-    err = adc_oneshot_config_channel(unit, channel, &chan_cfg);
-    if (err != ESP_OK) {
-        adc_oneshot_del_unit(unit);
-        return err;
-    }
-
-    bat->unit = unit;
-    bat->channel = (int)channel;
-
-    // Calibration is best-effort.
-    adc_cali_handle_t cali = NULL;
-    bool cali_ok = false;
-
-#if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
-    {
-        adc_cali_curve_fitting_config_t cali_cfg = {
-            .unit_id = unit_id,
-            .chan = channel,
-            .atten = ADC_ATTEN_DB_11,
-            .bitwidth = ADC_BITWIDTH_DEFAULT,
-        };
-        if (adc_cali_create_scheme_curve_fitting(&cali_cfg, &cali) == ESP_OK) {
-            cali_ok = true;
-        }
-    }
-#elif ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED
-    {
-        adc_cali_line_fitting_config_t cali_cfg = {
-            .unit_id = unit_id,
-            .atten = ADC_ATTEN_DB_11,
-            .bitwidth = ADC_BITWIDTH_DEFAULT,
-        };
-        if (adc_cali_create_scheme_line_fitting(&cali_cfg, &cali) == ESP_OK) {
-            cali_ok = true;
-        }
-    }
-#endif
-
-    bat->cali = cali;
     bat->cali_enabled = cali_ok;
     bat->inited = true;
 
@@ -166,7 +114,7 @@ esp_err_t battery_init(battery_t *bat, gpio_num_t adc_gpio, gpio_num_t en_gpio)
     // Debug mode: keep BAT_ADC_EN high all the time as requested.
     // In this mode we assume active-high gating and do not auto-detect polarity.
     bat->en_active_high = true;
-    gpio_set_level(bat->en_gpio, 1);
+    hal_gpio_set(bat->en_gpio, 1);
     ESP_LOGW(TAG, "DEBUG: BAT_ADC_EN forced HIGH permanently");
     ESP_LOGI(TAG, "battery init: gpio_adc=%d unit=%d chan=%d cali=%d en_active_high=%d",
              (int)adc_gpio,
@@ -177,19 +125,31 @@ esp_err_t battery_init(battery_t *bat, gpio_num_t adc_gpio, gpio_num_t en_gpio)
     return ESP_OK;
 #endif
 
+    if (trim && trim->en_active_level >= 0) {
+        // Polarity recorded at the factory: no probing, no extra wake of the divider.
+        bat->en_active_high = (trim->en_active_level != 0);
+        hal_gpio_set(bat->en_gpio, bat->en_active_high ? 0 : 1);
+        ESP_LOGI(TAG, "battery init: gpio_adc=%d unit=%d chan=%d cali=%d en_active_high=%d (provisioned) gain_q12=%u offset=%d",
+                 (int)adc_gpio,
+                 (int)unit_id,
+                 (int)channel,
+                 (int)cali_ok,
+                 (int)bat->en_active_high,
+                 (unsigned)bat->gain_q12,
+                 (int)bat->offset_mv);
+        return ESP_OK;
+    }
+
     // Auto-detect BAT_ADC_EN polarity (some boards wire the enable transistor inverted).
     // We assume the enabled state produces a significantly higher ADC reading than the disabled state.
     {
-        adc_oneshot_unit_handle_t u = (adc_oneshot_unit_handle_t)bat->unit;
-        adc_channel_t ch = (adc_channel_t)bat->channel;
-
-        gpio_set_level(bat->en_gpio, 1);
+        hal_gpio_set(bat->en_gpio, 1);
         vTaskDelay(pdMS_TO_TICKS(10));
-        int raw_high = battery_read_raw_avg(u, ch);
+        int raw_high = battery_read_raw_avg(&bat->adc);
 
-        gpio_set_level(bat->en_gpio, 0);
+        hal_gpio_set(bat->en_gpio, 0);
         vTaskDelay(pdMS_TO_TICKS(10));
-        int raw_low = battery_read_raw_avg(u, ch);
+        int raw_low = battery_read_raw_avg(&bat->adc);
 
         // Return to "disabled" by default (active level decided below).
         const int margin = 50;
@@ -215,7 +175,7 @@ esp_err_t battery_init(battery_t *bat, gpio_num_t adc_gpio, gpio_num_t en_gpio)
                  raw_low);
 
         // Ensure sampling path is disabled when idle.
-        gpio_set_level(bat->en_gpio, bat->en_active_high ? 0 : 1);
+        hal_gpio_set(bat->en_gpio, bat->en_active_high ? 0 : 1);
     }
     return ESP_OK;
 }
@@ -234,24 +194,20 @@ esp_err_t battery_read_mv(battery_t *bat, uint32_t *out_mv)
     int disable_level = bat->en_active_high ? 0 : 1;
 #endif
 
-    gpio_set_level(bat->en_gpio, enable_level);
+    hal_gpio_set(bat->en_gpio, enable_level);
     // Requirement.md suggests >=10ms settle time after enabling BAT_ADC_EN.
     vTaskDelay(pdMS_TO_TICKS(10));
 
-    adc_oneshot_unit_handle_t unit = (adc_oneshot_unit_handle_t)bat->unit;
-    adc_channel_t channel = (adc_channel_t)bat->channel;
-
-    int raw_avg = battery_read_raw_avg(unit, channel);
-    gpio_set_level(bat->en_gpio, disable_level);
+    int raw_avg = battery_read_raw_avg(&bat->adc);
+    hal_gpio_set(bat->en_gpio, disable_level);
     if (raw_avg < 0) {
         return ESP_FAIL;
     }
 
     uint32_t vadc_mv = 0;
-    if (bat->cali_enabled && bat->cali) {
+    if (bat->cali_enabled) {
         int mv = 0;
-        esp_err_t err = adc_cali_raw_to_voltage((adc_cali_handle_t)bat->cali, raw_avg, &mv);
-        if (err == ESP_OK) {
+        if (hal_adc_raw_to_mv(&bat->adc, raw_avg, &mv)) {
             vadc_mv = (uint32_t)mv;
         }
     }
@@ -266,7 +222,7 @@ esp_err_t battery_read_mv(battery_t *bat, uint32_t *out_mv)
         vadc_mv = (uint32_t)mv;
     }
 
-    uint32_t vbat_mv = scale_divider_to_battery_mv(vadc_mv);
+    uint32_t vbat_mv = apply_trim(bat, scale_divider_to_battery_mv(vadc_mv));
     *out_mv = vbat_mv;
 
     // Helpful for diagnosing saturation / wiring / divider issues.
@@ -315,19 +271,9 @@ void battery_deinit(battery_t *bat)
         return;
     }
 
-    if (bat->cali_enabled && bat->cali) {
-#if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
-        (void)adc_cali_delete_scheme_curve_fitting((adc_cali_handle_t)bat->cali);
-#elif ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED
-        (void)adc_cali_delete_scheme_line_fitting((adc_cali_handle_t)bat->cali);
-#endif
-    }
-
-    if (bat->unit) {
-        (void)adc_oneshot_del_unit((adc_oneshot_unit_handle_t)bat->unit);
-    }
+    hal_adc_close(&bat->adc);
 
-    gpio_set_level(bat->en_gpio, 0);
+    hal_gpio_set(bat->en_gpio, 0);
 
     *bat = (battery_t){0};
 }
@@ -3,30 +3,39 @@
 #include <stdbool.h>
 #include <stdint.h>
 
-#include "driver/gpio.h"
 #include "esp_err.h"
 
+#include "hal.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 typedef struct {
     bool inited;
-    gpio_num_t adc_gpio;
-    gpio_num_t en_gpio;
+    hal_gpio_t adc_gpio;
+    hal_gpio_t en_gpio;
     bool en_active_high;
 
-    // ADC
-    void *unit; // adc_oneshot_unit_handle_t (opaque here to keep header light)
-    int channel; // adc_channel_t
-
-    // calibration
-    void *cali; // adc_cali_handle_t (opaque)
+    // ADC; calibration is best-effort
+    hal_adc_t adc;
     bool cali_enabled;
+
+    // per-unit trim (provisioning)
+    uint16_t gain_q12; // 4096 = 1.0
+    int16_t offset_mv;
 } battery_t;
 
-// Initializes ADC and calibration (best-effort). en_gpio will be driven low when idle.
-esp_err_t battery_init(battery_t *bat, gpio_num_t adc_gpio, gpio_num_t en_gpio);
+// Per-unit values from the provisioning partition.
+typedef struct {
+    int8_t en_active_level; // 0/1, or -1 to auto-detect BAT_ADC_EN polarity
+    uint16_t gain_q12;      // applied to the battery mV, 4096 = 1.0
+    int16_t offset_mv;      // added after the gain
+} battery_trim_t;
+
+// Initializes ADC and calibration (best-effort). en_gpio will be driven to its inactive level when idle.
+// trim may be NULL: BAT_ADC_EN polarity is then probed and no gain/offset is applied.
+esp_err_t battery_init(battery_t *bat, hal_gpio_t adc_gpio, hal_gpio_t en_gpio, const battery_trim_t *trim);
 
 // Reads battery voltage (mV) at the battery terminals.
 // Returns ESP_OK and sets out_mv.
@@ -12,9 +12,19 @@
 
 #include "nvs_flash.h"
 
+#include "ble_value.h"
+#include "config_schema.h"
+#include "device_config.h"
+#include "storage_telemetry.h"
+#include "time_sync.h"
+#include "timer_wheel.h"
+
 static const char *TAG = "BLE";
 
 #define DEVICE_NAME_DEFAULT "LightClock_001"
+#define DEVICE_NAME_PREFIX  "LightClock_"
+// Scan response holds at most 29 name bytes.
+#define DEVICE_NAME_MAX     (29)
 
 #define SVC_UUID_16  0xFF10
 #define ALARM_CHAR_UUID_16     0xFF11
@@ -23,22 +33,22 @@ static const char *TAG = "BLE";
 #define COLOR_TEMP_CHAR_UUID_16  0xFF14
 #define WAKE_BRIGHT_CHAR_UUID_16 0xFF15
 #define SUNRISE_DUR_CHAR_UUID_16  0xFF16
+#define ALARM_TABLE_CHAR_UUID_16  0xFF17
+#define PRESET_CHAR_UUID_16       0xFF18
+#define SETTINGS_CHAR_UUID_16     0xFF19
+#define CONFIG_IMAGE_CHAR_UUID_16 0xFF1A
+#define STORAGE_STATS_CHAR_UUID_16 0xFF1B
+#define TIME_XCHG_CHAR_UUID_16    0xFF1C
 #define UUID16_CCCD            0x2902
 
 // Primary service + (char decl/value) + descriptors.
 // Keep some headroom as we extend characteristics.
-#define NUM_HANDLES  20
-
-static ble_alarm_on_write_hhmme_t s_on_write;
-static ble_alarm_on_read_hhmme_t s_on_read;
-static ble_alarm_on_write_hhmmss_t s_on_time_sync;
-static ble_alarm_on_read_batt_percent_t s_on_batt_read;
-static ble_alarm_on_write_u8_t s_on_color_temp_write;
-static ble_alarm_on_write_u8_t s_on_wake_bright_write;
-static ble_alarm_on_write_u8_t s_on_sunrise_dur_write;
-static ble_alarm_on_connect_t s_on_connect;
-static ble_alarm_on_disconnect_t s_on_disconnect;
-static void *s_ctx;
+#define NUM_HANDLES  28
+
+// Advertising (re)start retries may slip this much to share a wakeup with another deadline.
+#define ADV_RETRY_SLACK_US (100U * 1000U)
+
+static ble_alarm_callbacks_t s_cbs;
 
 static bool s_inited;
 static bool s_connected;
@@ -46,21 +56,21 @@ static bool s_adv_started;
 static bool s_want_adv;
 static bool s_adv_data_ready;
 static bool s_adv_config_attempted;
+static char s_device_name[DEVICE_NAME_MAX + 1] = DEVICE_NAME_DEFAULT;
 
-static esp_timer_handle_t s_adv_retry_timer;
+static timer_wheel_timer_t s_adv_retry_timer;
 
 static void ble_alarm_try_config_adv_payloads(void);
 static void ble_alarm_adv_retry_cb(void *arg);
 
 static void ble_alarm_schedule_adv_retry_ms(uint32_t delay_ms)
 {
-    if (!s_adv_retry_timer) {
+    if (!s_adv_retry_timer.cb) {
         return;
     }
 
-    // Best-effort: stop any existing schedule and start a new one.
-    (void)esp_timer_stop(s_adv_retry_timer);
-    (void)esp_timer_start_once(s_adv_retry_timer, (uint64_t)delay_ms * 1000ULL);
+    // Best-effort: (re)arm, replacing any existing schedule. Retries are not time critical.
+    (void)timer_wheel_start_once(&s_adv_retry_timer, (uint64_t)delay_ms * 1000ULL, ADV_RETRY_SLACK_US);
 }
 
 static uint16_t s_gatts_if;
@@ -74,6 +84,12 @@ static uint16_t s_batt_cccd_handle;
 static uint16_t s_color_temp_char_handle;
 static uint16_t s_wake_bright_char_handle;
 static uint16_t s_sunrise_dur_char_handle;
+static uint16_t s_alarm_table_char_handle;
+static uint16_t s_preset_char_handle;
+static uint16_t s_settings_char_handle;
+static uint16_t s_config_image_char_handle;
+static uint16_t s_storage_stats_char_handle;
+static uint16_t s_time_xchg_char_handle;
 static bool s_batt_notify_enabled;
 
 static esp_attr_value_t s_char_val;
@@ -91,186 +107,24 @@ static uint8_t s_adv_config_done;
 #define ADV_CONFIG_FLAG      (1 << 0)
 #define SCAN_RSP_CONFIG_FLAG (1 << 1)
 
-static bool is_ascii_digit(uint8_t c)
-{
-    return (c >= '0' && c <= '9');
-}
-
-static bool normalize_hhmmss6(const uint8_t *data, uint16_t len, uint8_t out_hhmmss6[6])
-{
-    if (!data || !out_hhmmss6 || len == 0) {
-        return false;
-    }
-
-    // Preferred: exactly 6 ASCII digits.
-    if (len == 6) {
-        for (int i = 0; i < 6; i++) {
-            if (!is_ascii_digit(data[i])) {
-                return false;
-            }
-        }
-        memcpy(out_hhmmss6, data, 6);
-        return true;
-    }
-
-    // Robust: collect first 6 digits from payload (e.g. "12:30:05" or with \r\n).
-    uint8_t tmp[6];
-    int n = 0;
-    for (uint16_t i = 0; i < len && n < 6; i++) {
-        if (is_ascii_digit(data[i])) {
-            tmp[n++] = data[i];
-        }
-    }
-    if (n != 6) {
-        return false;
-    }
-    memcpy(out_hhmmss6, tmp, 6);
-    return true;
-}
-
-static bool try_normalize_write_to_hhmm4(const uint8_t *data, uint16_t len, uint8_t out_hhmm4[4])
-{
-    if (!data || !out_hhmm4 || len == 0) {
-        return false;
-    }
-
-    // 1) Preferred format: 4 ASCII digits "HHMM".
-    if (len == 4 && is_ascii_digit(data[0]) && is_ascii_digit(data[1]) && is_ascii_digit(data[2]) && is_ascii_digit(data[3])) {
-        memcpy(out_hhmm4, data, 4);
-        return true;
-    }
-
-    // 2) Common tooling format: ASCII with terminator / CRLF / spaces.
-    uint16_t start = 0;
-    uint16_t end = len;
-    while (start < end && (data[start] == 0 || data[start] == ' ' || data[start] == '\r' || data[start] == '\n' || data[start] == '\t')) {
-        start++;
-    }
-    while (end > start && (data[end - 1] == 0 || data[end - 1] == ' ' || data[end - 1] == '\r' || data[end - 1] == '\n' || data[end - 1] == '\t')) {
-        end--;
-    }
-    if (end > start) {
-        uint16_t trimmed_len = (uint16_t)(end - start);
-        if (trimmed_len == 4 && is_ascii_digit(data[start]) && is_ascii_digit(data[start + 1]) && is_ascii_digit(data[start + 2]) &&
-            is_ascii_digit(data[start + 3])) {
-            memcpy(out_hhmm4, &data[start], 4);
-            return true;
-        }
-
-        // 3) Tooling sometimes sends decimal string (e.g. "1325") but as a number with fewer digits.
-        // Accept 1..4 digits and zero-pad to 4.
-        if (trimmed_len >= 1 && trimmed_len <= 4) {
-            bool all_digits = true;
-            for (uint16_t i = 0; i < trimmed_len; i++) {
-                if (!is_ascii_digit(data[start + i])) {
-                    all_digits = false;
-                    break;
-                }
-            }
-            if (all_digits) {
-                // Left pad with '0'
-                uint16_t pad = (uint16_t)(4 - trimmed_len);
-                memset(out_hhmm4, '0', pad);
-                memcpy(&out_hhmm4[pad], &data[start], trimmed_len);
-                return true;
-            }
-        }
-    }
-
-    // 4) Packed BCD (2 bytes): 0xHH 0xMM (each nibble 0..9)
-    if (len == 2) {
-        uint8_t hh = data[0];
-        uint8_t mm = data[1];
-        uint8_t hh_hi = (uint8_t)((hh >> 4) & 0x0F);
-        uint8_t hh_lo = (uint8_t)(hh & 0x0F);
-        uint8_t mm_hi = (uint8_t)((mm >> 4) & 0x0F);
-        uint8_t mm_lo = (uint8_t)(mm & 0x0F);
-        if (hh_hi <= 9 && hh_lo <= 9 && mm_hi <= 9 && mm_lo <= 9) {
-            out_hhmm4[0] = (uint8_t)('0' + hh_hi);
-            out_hhmm4[1] = (uint8_t)('0' + hh_lo);
-            out_hhmm4[2] = (uint8_t)('0' + mm_hi);
-            out_hhmm4[3] = (uint8_t)('0' + mm_lo);
-            return true;
-        }
-    }
-
-    // 5) Little-endian integer (2 or 4 bytes) representing HHMM as a decimal number (e.g. 1325).
-    if (len == 2 || len == 4) {
-        uint32_t v_le = 0;
-        for (uint16_t i = 0; i < len; i++) {
-            v_le |= ((uint32_t)data[i]) << (8 * i);
-        }
-
-        if (v_le <= 2359) {
-            uint32_t hh = v_le / 100;
-            uint32_t mm = v_le % 100;
-            if (hh < 24 && mm < 60) {
-                out_hhmm4[0] = (uint8_t)('0' + (hh / 10));
-                out_hhmm4[1] = (uint8_t)('0' + (hh % 10));
-                out_hhmm4[2] = (uint8_t)('0' + (mm / 10));
-                out_hhmm4[3] = (uint8_t)('0' + (mm % 10));
-                return true;
-            }
-        }
-    }
-
-    return false;
-}
-
-static bool try_normalize_write_to_hhmme5(const uint8_t *data, uint16_t len, uint8_t out_hhmme5[5])
+// Serves a characteristic value longer than one ATT_MTU: the client follows up with
+// Read Blob requests carrying an offset into the same value.
+static void send_long_read_rsp(esp_gatt_if_t gatts_if, const esp_ble_gatts_cb_param_t *param, esp_gatt_rsp_t *rsp,
+                               const uint8_t *value, size_t len)
 {
-    if (!data || !out_hhmme5 || len == 0) {
-        return false;
-    }
-
-    // 1) Preferred: exactly 5 ASCII digits "HHMME" where E is 0/1.
-    if (len == 5) {
-        if (is_ascii_digit(data[0]) && is_ascii_digit(data[1]) && is_ascii_digit(data[2]) && is_ascii_digit(data[3]) &&
-            (data[4] == '0' || data[4] == '1')) {
-            memcpy(out_hhmme5, data, 5);
-            return true;
-        }
-    }
-
-    // 2) Backward-compatible: accept HHMM (enable defaults to 1)
-    {
-        uint8_t hhmm4[4] = {0};
-        if (try_normalize_write_to_hhmm4(data, len, hhmm4)) {
-            memcpy(out_hhmme5, hhmm4, 4);
-            out_hhmme5[4] = '1';
-            return true;
-        }
-    }
-
-    // 3) Robust: trim and collect digits; use first 4 digits as HHMM and optional 5th as E.
-    uint16_t start = 0;
-    uint16_t end = len;
-    while (start < end && (data[start] == 0 || data[start] == ' ' || data[start] == '\r' || data[start] == '\n' || data[start] == '\t')) {
-        start++;
-    }
-    while (end > start && (data[end - 1] == 0 || data[end - 1] == ' ' || data[end - 1] == '\r' || data[end - 1] == '\n' || data[end - 1] == '\t')) {
-        end--;
-    }
-    if (end <= start) {
-        return false;
-    }
-
-    uint8_t digits[5] = {0};
-    int n = 0;
-    for (uint16_t i = start; i < end && n < 5; i++) {
-        if (is_ascii_digit(data[i])) {
-            digits[n++] = data[i];
-        }
-    }
-    if (n < 4) {
-        return false;
+    uint16_t offset = param->read.offset;
+    if (offset > len) {
+        esp_ble_gatts_send_response(gatts_if, param->read.conn_id, param->read.trans_id, ESP_GATT_INVALID_OFFSET, rsp);
+        return;
     }
-    memcpy(out_hhmme5, digits, 4);
-    out_hhmme5[4] = (n >= 5) ? digits[4] : (uint8_t)'1';
-    if (out_hhmme5[4] != '0' && out_hhmme5[4] != '1') {
-        out_hhmme5[4] = '1';
+    size_t n = len - offset;
+    if (n > sizeof(rsp->attr_value.value)) {
+        n = sizeof(rsp->attr_value.value);
     }
-    return true;
+    memcpy(rsp->attr_value.value, &value[offset], n);
+    rsp->attr_value.offset = offset;
+    rsp->attr_value.len = (uint16_t)n;
+    esp_ble_gatts_send_response(gatts_if, param->read.conn_id, param->read.trans_id, ESP_GATT_OK, rsp);
 }
 
 // Raw advertising payload (legacy, <= 31 bytes):
@@ -291,7 +145,7 @@ static void ble_alarm_try_config_adv_payloads(void)
     }
     s_adv_config_attempted = true;
 
-    esp_err_t err = esp_ble_gap_set_device_name(DEVICE_NAME_DEFAULT);
+    esp_err_t err = esp_ble_gap_set_device_name(s_device_name);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "set dev name failed: %s", esp_err_to_name(err));
     }
@@ -302,7 +156,7 @@ static void ble_alarm_try_config_adv_payloads(void)
 
     // Build scan response: Complete Local Name (AD type 0x09)
     // Legacy scan response payload limit is 31 bytes total.
-    size_t name_len = strlen(DEVICE_NAME_DEFAULT);
+    size_t name_len = strlen(s_device_name);
     if (name_len > 29) {
         ESP_LOGW(TAG, "device name too long for scan rsp (%u), truncating", (unsigned)name_len);
         name_len = 29;
@@ -310,7 +164,7 @@ static void ble_alarm_try_config_adv_payloads(void)
     uint8_t scan_rsp_raw[31];
     scan_rsp_raw[0] = (uint8_t)(1 + name_len); // length of (type + data)
     scan_rsp_raw[1] = 0x09;                    // Complete Local Name
-    memcpy(&scan_rsp_raw[2], DEVICE_NAME_DEFAULT, name_len);
+    memcpy(&scan_rsp_raw[2], s_device_name, name_len);
     const uint8_t scan_rsp_len = (uint8_t)(2 + name_len);
 
     ESP_LOGI(TAG, "adv raw len=%u scan_rsp len=%u name_len=%u", (unsigned)sizeof(s_adv_raw), (unsigned)scan_rsp_len,
@@ -379,7 +233,12 @@ static void gap_cb(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param)
         ESP_LOGI(TAG, "adv payloads ready");
     }
 
-    if (s_adv_config_done == 0 && s_adv_data_ready && s_want_adv && !s_adv_started && !s_connected) {
+    // Only the payload events start advertising from here. Restarts after a stop or a failed start go
+    // through the retry timer: starting again from the failure event would spin as long as the
+    // stack keeps failing.
+    const bool payload_evt =
+        (event == ESP_GAP_BLE_ADV_DATA_RAW_SET_COMPLETE_EVT || event == ESP_GAP_BLE_SCAN_RSP_DATA_RAW_SET_COMPLETE_EVT);
+    if (payload_evt && s_adv_config_done == 0 && s_adv_data_ready && s_want_adv && !s_adv_started && !s_connected) {
         esp_err_t err = esp_ble_gap_start_advertising(&s_adv_params);
         if (err != ESP_OK) {
             ESP_LOGE(TAG, "esp_ble_gap_start_advertising failed: %s", esp_err_to_name(err));
@@ -516,6 +375,102 @@ static void gatts_cb(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble
             } else if (uuid16 == SUNRISE_DUR_CHAR_UUID_16) {
                 s_sunrise_dur_char_handle = param->add_char.attr_handle;
                 ESP_LOGI(TAG, "sunrise dur char handle=%u", (unsigned)s_sunrise_dur_char_handle);
+
+                // Add alarm table characteristic (read + write, binary slot records)
+                esp_bt_uuid_t at_uuid = {.len = ESP_UUID_LEN_16, .uuid = {.uuid16 = ALARM_TABLE_CHAR_UUID_16}};
+                esp_gatt_char_prop_t prop = ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_WRITE;
+                esp_err_t err = esp_ble_gatts_add_char(s_service_handle,
+                                                      &at_uuid,
+                                                      ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+                                                      prop,
+                                                      NULL,
+                                                      NULL);
+                if (err != ESP_OK) {
+                    ESP_LOGE(TAG, "add alarm table char failed: %s", esp_err_to_name(err));
+                }
+            } else if (uuid16 == ALARM_TABLE_CHAR_UUID_16) {
+                s_alarm_table_char_handle = param->add_char.attr_handle;
+                ESP_LOGI(TAG, "alarm table char handle=%u", (unsigned)s_alarm_table_char_handle);
+
+                // Add preset characteristic (read + write: select or store a preset)
+                esp_bt_uuid_t pr_uuid = {.len = ESP_UUID_LEN_16, .uuid = {.uuid16 = PRESET_CHAR_UUID_16}};
+                esp_gatt_char_prop_t prop = ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_WRITE;
+                esp_err_t err = esp_ble_gatts_add_char(s_service_handle,
+                                                      &pr_uuid,
+                                                      ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+                                                      prop,
+                                                      NULL,
+                                                      NULL);
+                if (err != ESP_OK) {
+                    ESP_LOGE(TAG, "add preset char failed: %s", esp_err_to_name(err));
+                }
+            } else if (uuid16 == PRESET_CHAR_UUID_16) {
+                s_preset_char_handle = param->add_char.attr_handle;
+                ESP_LOGI(TAG, "preset char handle=%u", (unsigned)s_preset_char_handle);
+
+                // Add settings characteristic (read + write, schema TLV)
+                esp_bt_uuid_t st_uuid = {.len = ESP_UUID_LEN_16, .uuid = {.uuid16 = SETTINGS_CHAR_UUID_16}};
+                esp_gatt_char_prop_t prop = ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_WRITE;
+                esp_err_t err = esp_ble_gatts_add_char(s_service_handle,
+                                                      &st_uuid,
+                                                      ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+                                                      prop,
+                                                      NULL,
+                                                      NULL);
+                if (err != ESP_OK) {
+                    ESP_LOGE(TAG, "add settings char failed: %s", esp_err_to_name(err));
+                }
+            } else if (uuid16 == SETTINGS_CHAR_UUID_16) {
+                s_settings_char_handle = param->add_char.attr_handle;
+                ESP_LOGI(TAG, "settings char handle=%u", (unsigned)s_settings_char_handle);
+
+                // Add config image characteristic (read = export, write = chunked import)
+                esp_bt_uuid_t ci_uuid = {.len = ESP_UUID_LEN_16, .uuid = {.uuid16 = CONFIG_IMAGE_CHAR_UUID_16}};
+                esp_gatt_char_prop_t prop = ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_WRITE;
+                esp_err_t err = esp_ble_gatts_add_char(s_service_handle,
+                                                      &ci_uuid,
+                                                      ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+                                                      prop,
+                                                      NULL,
+                                                      NULL);
+                if (err != ESP_OK) {
+                    ESP_LOGE(TAG, "add config image char failed: %s", esp_err_to_name(err));
+                }
+            } else if (uuid16 == CONFIG_IMAGE_CHAR_UUID_16) {
+                s_config_image_char_handle = param->add_char.attr_handle;
+                ESP_LOGI(TAG, "config image char handle=%u", (unsigned)s_config_image_char_handle);
+
+                // Add storage telemetry characteristic (read-only)
+                esp_bt_uuid_t ss_uuid = {.len = ESP_UUID_LEN_16, .uuid = {.uuid16 = STORAGE_STATS_CHAR_UUID_16}};
+                esp_gatt_char_prop_t prop = ESP_GATT_CHAR_PROP_BIT_READ;
+                esp_err_t err = esp_ble_gatts_add_char(s_service_handle,
+                                                      &ss_uuid,
+                                                      ESP_GATT_PERM_READ,
+                                                      prop,
+                                                      NULL,
+                                                      NULL);
+                if (err != ESP_OK) {
+                    ESP_LOGE(TAG, "add storage stats char failed: %s", esp_err_to_name(err));
+                }
+            } else if (uuid16 == STORAGE_STATS_CHAR_UUID_16) {
+                s_storage_stats_char_handle = param->add_char.attr_handle;
+                ESP_LOGI(TAG, "storage stats char handle=%u", (unsigned)s_storage_stats_char_handle);
+
+                // Add timed time-sync exchange characteristic (write = exchange step, read = stamp + status)
+                esp_bt_uuid_t tx_uuid = {.len = ESP_UUID_LEN_16, .uuid = {.uuid16 = TIME_XCHG_CHAR_UUID_16}};
+                esp_gatt_char_prop_t prop = ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_WRITE;
+                esp_err_t err = esp_ble_gatts_add_char(s_service_handle,
+                                                      &tx_uuid,
+                                                      ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+                                                      prop,
+                                                      NULL,
+                                                      NULL);
+                if (err != ESP_OK) {
+                    ESP_LOGE(TAG, "add time exchange char failed: %s", esp_err_to_name(err));
+                }
+            } else if (uuid16 == TIME_XCHG_CHAR_UUID_16) {
+                s_time_xchg_char_handle = param->add_char.attr_handle;
+                ESP_LOGI(TAG, "time exchange char handle=%u", (unsigned)s_time_xchg_char_handle);
             }
         }
         break;
@@ -548,8 +503,8 @@ static void gatts_cb(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble
         s_conn_id = param->connect.conn_id;
         memcpy(s_remote_bda, param->connect.remote_bda, sizeof(esp_bd_addr_t));
         ESP_LOGI(TAG, "connected");
-        if (s_on_connect) {
-            s_on_connect(s_ctx);
+        if (s_cbs.on_connect) {
+            s_cbs.on_connect(s_cbs.ctx);
         }
         break;
 
@@ -559,9 +514,12 @@ static void gatts_cb(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble
         s_adv_started = false;
         s_conn_id = 0;
         memset(s_remote_bda, 0, sizeof(s_remote_bda));
+        // No bonding, so the CCCD lasts one connection: the next central starts unsubscribed.
+        s_batt_notify_enabled = false;
+        s_cccd_val = 0;
         ESP_LOGI(TAG, "disconnected reason=0x%02x", param->disconnect.reason);
-        if (s_on_disconnect) {
-            s_on_disconnect(s_ctx);
+        if (s_cbs.on_disconnect) {
+            s_cbs.on_disconnect(s_cbs.ctx);
         }
         // Self-heal: if app wants advertising, restart after disconnect.
         if (s_want_adv) {
@@ -570,6 +528,8 @@ static void gatts_cb(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble
         break;
 
     case ESP_GATTS_READ_EVT: {
+        // Time-sync stamp (t3): first thing, before any logging.
+        const int64_t at_us = esp_timer_get_time();
         if (!param->read.need_rsp) {
             break;
         }
@@ -579,8 +539,8 @@ static void gatts_cb(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble
 
         if (param->read.handle == s_alarm_char_handle) {
             uint8_t hhmme[5] = {0};
-            if (s_on_read) {
-                s_on_read(hhmme, s_ctx);
+            if (s_cbs.on_read) {
+                s_cbs.on_read(hhmme, s_cbs.ctx);
             } else {
                 memcpy(hhmme, s_char_val_buf, sizeof(hhmme));
             }
@@ -589,12 +549,56 @@ static void gatts_cb(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble
             esp_ble_gatts_send_response(gatts_if, param->read.conn_id, param->read.trans_id, ESP_GATT_OK, &rsp);
         } else if (param->read.handle == s_batt_char_handle) {
             uint8_t pct = 0;
-            if (s_on_batt_read) {
-                pct = s_on_batt_read(s_ctx);
+            if (s_cbs.on_batt_read) {
+                pct = s_cbs.on_batt_read(s_cbs.ctx);
             }
             rsp.attr_value.value[0] = pct;
             rsp.attr_value.len = 1;
             esp_ble_gatts_send_response(gatts_if, param->read.conn_id, param->read.trans_id, ESP_GATT_OK, &rsp);
+        } else if (param->read.handle == s_alarm_table_char_handle) {
+            uint8_t buf[DEVICE_CONFIG_MAX_ALARMS * DEVICE_ALARM_RECORD_LEN];
+            size_t len = 0;
+            if (s_cbs.on_read_alarm_table) {
+                len = s_cbs.on_read_alarm_table(buf, sizeof(buf), s_cbs.ctx);
+            }
+            send_long_read_rsp(gatts_if, param, &rsp, buf, len);
+        } else if (param->read.handle == s_preset_char_handle) {
+            uint8_t buf[1 + DEVICE_CONFIG_MAX_PRESETS * DEVICE_PRESET_RECORD_MAX_LEN];
+            size_t len = 0;
+            if (s_cbs.on_read_presets) {
+                len = s_cbs.on_read_presets(buf, sizeof(buf), s_cbs.ctx);
+            }
+            send_long_read_rsp(gatts_if, param, &rsp, buf, len);
+        } else if (param->read.handle == s_settings_char_handle) {
+            static uint8_t s_settings_buf[CFG_TLV_GLOBALS_MAX_LEN + CFG_TLV_DATES_MAX_LEN];
+            size_t len = 0;
+            if (s_cbs.on_read_settings) {
+                len = s_cbs.on_read_settings(s_settings_buf, sizeof(s_settings_buf), s_cbs.ctx);
+            }
+            send_long_read_rsp(gatts_if, param, &rsp, s_settings_buf, len);
+        } else if (param->read.handle == s_config_image_char_handle) {
+            // Exported fresh for every Read Blob; the blob encoding is deterministic, so offsets line up
+            // as long as the config does not change mid-read.
+            static uint8_t s_image_buf[DEVICE_CONFIG_IMAGE_MAX_LEN];
+            size_t len = 0;
+            if (s_cbs.on_read_config_image) {
+                len = s_cbs.on_read_config_image(s_image_buf, sizeof(s_image_buf), s_cbs.ctx);
+            }
+            send_long_read_rsp(gatts_if, param, &rsp, s_image_buf, len);
+        } else if (param->read.handle == s_storage_stats_char_handle) {
+            uint8_t buf[STORAGE_TELEMETRY_WIRE_MAX_LEN];
+            size_t len = 0;
+            if (s_cbs.on_read_storage_stats) {
+                len = s_cbs.on_read_storage_stats(buf, sizeof(buf), s_cbs.ctx);
+            }
+            send_long_read_rsp(gatts_if, param, &rsp, buf, len);
+        } else if (param->read.handle == s_time_xchg_char_handle) {
+            uint8_t buf[TIME_SYNC_STATUS_LEN];
+            size_t len = 0;
+            if (s_cbs.on_read_time_exchange) {
+                len = s_cbs.on_read_time_exchange(buf, sizeof(buf), at_us, s_cbs.ctx);
+            }
+            send_long_read_rsp(gatts_if, param, &rsp, buf, len);
         } else {
             esp_ble_gatts_send_response(gatts_if, param->read.conn_id, param->read.trans_id, ESP_GATT_READ_NOT_PERMIT, &rsp);
         }
@@ -602,6 +606,8 @@ static void gatts_cb(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble
     }
 
     case ESP_GATTS_WRITE_EVT: {
+        // Time-sync stamp (t2): first thing, before the hex dump below.
+        const int64_t rx_us = esp_timer_get_time();
         ESP_LOGI(TAG, "write: handle=%u len=%u need_rsp=%u", (unsigned)param->write.handle, (unsigned)param->write.len,
                  (unsigned)param->write.need_rsp);
         if (param->write.len > 0 && param->write.value) {
@@ -619,8 +625,8 @@ static void gatts_cb(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble
 
                 // Requirement: after a successful connection, provide battery to the client.
                 // Typical BLE flow enables CCCD right after connect; send once immediately.
-                if (s_batt_notify_enabled && s_on_batt_read) {
-                    uint8_t pct = s_on_batt_read(s_ctx);
+                if (s_batt_notify_enabled && s_cbs.on_batt_read) {
+                    uint8_t pct = s_cbs.on_batt_read(s_cbs.ctx);
                     (void)ble_alarm_notify_battery(pct);
                 }
             } else {
@@ -636,13 +642,13 @@ static void gatts_cb(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble
             esp_gatt_status_t st = ESP_GATT_OK;
             bool accepted = false;
             uint8_t hhmmss6[6] = {0};
-            bool normalized = normalize_hhmmss6(param->write.value, param->write.len, hhmmss6);
-            if (normalized && s_on_time_sync) {
+            bool normalized = ble_value_normalize_hhmmss6(param->write.value, param->write.len, hhmmss6);
+            if (normalized && s_cbs.on_time_sync) {
                 ESP_LOGI(TAG, "time sync normalized to HHMMSS='%c%c%c%c%c%c'", hhmmss6[0], hhmmss6[1], hhmmss6[2], hhmmss6[3], hhmmss6[4],
                          hhmmss6[5]);
-                accepted = s_on_time_sync(hhmmss6, s_ctx);
+                accepted = s_cbs.on_time_sync(hhmmss6, s_cbs.ctx);
             } else {
-                ESP_LOGW(TAG, "time sync rejected: normalized=%d cb=%d", (int)normalized, (int)(s_on_time_sync != NULL));
+                ESP_LOGW(TAG, "time sync rejected: normalized=%d cb=%d", (int)normalized, (int)(s_cbs.on_time_sync != NULL));
             }
             if (!accepted) {
                 st = ESP_GATT_INVALID_ATTR_LEN;
@@ -660,26 +666,21 @@ static void gatts_cb(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble
 
             if (param->write.len == 1 && param->write.value) {
                 uint8_t v = param->write.value[0];
+                // Range checks are the callbacks' job (schema table, see config_schema.h).
                 if (param->write.handle == s_color_temp_char_handle) {
-                    if (v <= 100) {
-                        ESP_LOGI(TAG, "color temp write=%u", (unsigned)v);
-                        if (s_on_color_temp_write) {
-                            accepted = s_on_color_temp_write(v, s_ctx);
-                        }
+                    ESP_LOGI(TAG, "color temp write=%u", (unsigned)v);
+                    if (s_cbs.on_write_color_temp) {
+                        accepted = s_cbs.on_write_color_temp(v, s_cbs.ctx);
                     }
                 } else if (param->write.handle == s_wake_bright_char_handle) {
-                    if (v <= 100) {
-                        ESP_LOGI(TAG, "wake bright write=%u", (unsigned)v);
-                        if (s_on_wake_bright_write) {
-                            accepted = s_on_wake_bright_write(v, s_ctx);
-                        }
+                    ESP_LOGI(TAG, "wake bright write=%u", (unsigned)v);
+                    if (s_cbs.on_write_wake_bright) {
+                        accepted = s_cbs.on_write_wake_bright(v, s_cbs.ctx);
                     }
                 } else if (param->write.handle == s_sunrise_dur_char_handle) {
-                    if (v >= 1 && v <= 60) {
-                        ESP_LOGI(TAG, "sunrise dur write=%u min", (unsigned)v);
-                        if (s_on_sunrise_dur_write) {
-                            accepted = s_on_sunrise_dur_write(v, s_ctx);
-                        }
+                    ESP_LOGI(TAG, "sunrise dur write=%u min", (unsigned)v);
+                    if (s_cbs.on_write_sunrise_duration) {
+                        accepted = s_cbs.on_write_sunrise_duration(v, s_cbs.ctx);
                     }
                 }
             }
@@ -693,6 +694,81 @@ static void gatts_cb(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble
             break;
         }
 
+        if (param->write.handle == s_alarm_table_char_handle) {
+            bool accepted = false;
+            if (s_cbs.on_write_alarm_record && param->write.value) {
+                accepted = s_cbs.on_write_alarm_record(param->write.value, param->write.len, s_cbs.ctx);
+            }
+            if (!accepted) {
+                ESP_LOGW(TAG, "alarm record rejected (len=%u)", (unsigned)param->write.len);
+            }
+            if (param->write.need_rsp) {
+                esp_ble_gatts_send_response(gatts_if, param->write.conn_id, param->write.trans_id,
+                                            accepted ? ESP_GATT_OK : ESP_GATT_INVALID_ATTR_LEN, NULL);
+            }
+            break;
+        }
+
+        if (param->write.handle == s_settings_char_handle) {
+            bool accepted = false;
+            if (s_cbs.on_write_settings && param->write.value) {
+                accepted = s_cbs.on_write_settings(param->write.value, param->write.len, s_cbs.ctx);
+            }
+            if (!accepted) {
+                ESP_LOGW(TAG, "settings write rejected (len=%u)", (unsigned)param->write.len);
+            }
+            if (param->write.need_rsp) {
+                esp_ble_gatts_send_response(gatts_if, param->write.conn_id, param->write.trans_id,
+                                            accepted ? ESP_GATT_OK : ESP_GATT_INVALID_ATTR_LEN, NULL);
+            }
+            break;
+        }
+
+        if (param->write.handle == s_time_xchg_char_handle) {
+            bool accepted = false;
+            if (s_cbs.on_write_time_exchange && param->write.value) {
+                accepted = s_cbs.on_write_time_exchange(param->write.value, param->write.len, rx_us, s_cbs.ctx);
+            }
+            if (!accepted) {
+                ESP_LOGW(TAG, "time exchange write rejected (len=%u)", (unsigned)param->write.len);
+            }
+            if (param->write.need_rsp) {
+                esp_ble_gatts_send_response(gatts_if, param->write.conn_id, param->write.trans_id,
+                                            accepted ? ESP_GATT_OK : ESP_GATT_INVALID_ATTR_LEN, NULL);
+            }
+            break;
+        }
+
+        if (param->write.handle == s_config_image_char_handle) {
+            bool accepted = false;
+            if (s_cbs.on_write_config_image && param->write.value) {
+                accepted = s_cbs.on_write_config_image(param->write.value, param->write.len, s_cbs.ctx);
+            }
+            if (!accepted) {
+                ESP_LOGW(TAG, "config image write rejected (len=%u)", (unsigned)param->write.len);
+            }
+            if (param->write.need_rsp) {
+                esp_ble_gatts_send_response(gatts_if, param->write.conn_id, param->write.trans_id,
+                                            accepted ? ESP_GATT_OK : ESP_GATT_INVALID_ATTR_LEN, NULL);
+            }
+            break;
+        }
+
+        if (param->write.handle == s_preset_char_handle) {
+            bool accepted = false;
+            if (s_cbs.on_write_preset && param->write.value) {
+                accepted = s_cbs.on_write_preset(param->write.value, param->write.len, s_cbs.ctx);
+            }
+            if (!accepted) {
+                ESP_LOGW(TAG, "preset write rejected (len=%u)", (unsigned)param->write.len);
+            }
+            if (param->write.need_rsp) {
+                esp_ble_gatts_send_response(gatts_if, param->write.conn_id, param->write.trans_id,
+                                            accepted ? ESP_GATT_OK : ESP_GATT_INVALID_ATTR_LEN, NULL);
+            }
+            break;
+        }
+
         if (param->write.handle != s_alarm_char_handle) {
             ESP_LOGW(TAG, "write ignored (unknown handle): got_handle=%u alarm=%u time=%u batt_cccd=%u", (unsigned)param->write.handle,
                      (unsigned)s_alarm_char_handle, (unsigned)s_time_sync_char_handle, (unsigned)s_batt_cccd_handle);
@@ -706,12 +782,12 @@ static void gatts_cb(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble
         bool accepted = false;
 
         uint8_t hhmme5[5] = {0};
-        bool normalized = try_normalize_write_to_hhmme5(param->write.value, param->write.len, hhmme5);
-        if (normalized && s_on_write) {
+        bool normalized = ble_value_normalize_hhmme5(param->write.value, param->write.len, hhmme5);
+        if (normalized && s_cbs.on_write) {
             ESP_LOGI(TAG, "write normalized to HHMME='%c%c%c%c%c'", hhmme5[0], hhmme5[1], hhmme5[2], hhmme5[3], hhmme5[4]);
-            accepted = s_on_write(hhmme5, s_ctx);
+            accepted = s_cbs.on_write(hhmme5, s_cbs.ctx);
         } else {
-            ESP_LOGW(TAG, "write rejected: normalized=%d on_write=%d", (int)normalized, (int)(s_on_write != NULL));
+            ESP_LOGW(TAG, "write rejected: normalized=%d on_write=%d", (int)normalized, (int)(s_cbs.on_write != NULL));
         }
         if (!accepted) {
             st = ESP_GATT_INVALID_ATTR_LEN;
@@ -730,31 +806,33 @@ static void gatts_cb(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble
     }
 }
 
-esp_err_t ble_alarm_init(ble_alarm_on_write_hhmme_t on_write,
-                         ble_alarm_on_read_hhmme_t on_read,
-                         ble_alarm_on_write_hhmmss_t on_time_sync,
-                         ble_alarm_on_read_batt_percent_t on_batt_read,
-                         ble_alarm_on_write_u8_t on_write_color_temp,
-                         ble_alarm_on_write_u8_t on_write_wake_bright,
-                         ble_alarm_on_write_u8_t on_write_sunrise_duration,
-                         ble_alarm_on_connect_t on_connect,
-                         ble_alarm_on_disconnect_t on_disconnect,
-                         void *ctx)
+esp_err_t ble_alarm_set_name_suffix(const char *suffix)
+{
+    if (s_inited) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!suffix || suffix[0] == 0) {
+        strcpy(s_device_name, DEVICE_NAME_DEFAULT);
+        return ESP_OK;
+    }
+    if (strlen(DEVICE_NAME_PREFIX) + strlen(suffix) > DEVICE_NAME_MAX) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    strcpy(s_device_name, DEVICE_NAME_PREFIX);
+    strcat(s_device_name, suffix);
+    return ESP_OK;
+}
+
+esp_err_t ble_alarm_init(const ble_alarm_callbacks_t *cbs)
 {
     if (s_inited) {
         return ESP_OK;
     }
+    if (!cbs) {
+        return ESP_ERR_INVALID_ARG;
+    }
 
-    s_on_write = on_write;
-    s_on_read = on_read;
-    s_on_time_sync = on_time_sync;
-    s_on_batt_read = on_batt_read;
-    s_on_color_temp_write = on_write_color_temp;
-    s_on_wake_bright_write = on_write_wake_bright;
-    s_on_sunrise_dur_write = on_write_sunrise_duration;
-    s_on_connect = on_connect;
-    s_on_disconnect = on_disconnect;
-    s_ctx = ctx;
+    s_cbs = *cbs;
 
     // NVS must be initialized by app.
 
@@ -800,15 +878,8 @@ esp_err_t ble_alarm_init(ble_alarm_on_write_hhmme_t on_write,
         return err;
     }
 
-    if (!s_adv_retry_timer) {
-        const esp_timer_create_args_t args = {
-            .callback = &ble_alarm_adv_retry_cb,
-            .arg = NULL,
-            .dispatch_method = ESP_TIMER_TASK,
-            .name = "ble_adv_retry",
-            .skip_unhandled_events = true,
-        };
-        (void)esp_timer_create(&args, &s_adv_retry_timer);
+    if (!s_adv_retry_timer.cb) {
+        timer_wheel_timer_init(&s_adv_retry_timer, "ble_adv_retry", ble_alarm_adv_retry_cb, NULL);
     }
 
     s_adv_config_done = 0;
@@ -865,9 +936,7 @@ esp_err_t ble_alarm_stop_advertising(void)
     }
     s_want_adv = false;
     s_adv_started = false;
-    if (s_adv_retry_timer) {
-        (void)esp_timer_stop(s_adv_retry_timer);
-    }
+    timer_wheel_stop(&s_adv_retry_timer);
     return esp_ble_gap_stop_advertising();
 }
 
@@ -907,11 +976,7 @@ esp_err_t ble_alarm_deinit(void)
     (void)esp_bt_controller_disable();
     (void)esp_bt_controller_deinit();
 
-    if (s_adv_retry_timer) {
-        (void)esp_timer_stop(s_adv_retry_timer);
-        (void)esp_timer_delete(s_adv_retry_timer);
-        s_adv_retry_timer = NULL;
-    }
+    timer_wheel_stop(&s_adv_retry_timer);
 
     s_inited = false;
     s_connected = false;
@@ -927,6 +992,12 @@ esp_err_t ble_alarm_deinit(void)
     s_color_temp_char_handle = 0;
     s_wake_bright_char_handle = 0;
     s_sunrise_dur_char_handle = 0;
+    s_alarm_table_char_handle = 0;
+    s_preset_char_handle = 0;
+    s_settings_char_handle = 0;
+    s_config_image_char_handle = 0;
+    s_storage_stats_char_handle = 0;
+    s_time_xchg_char_handle = 0;
     s_batt_notify_enabled = false;
     s_cccd_val = 0;
 
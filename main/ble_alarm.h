@@ -21,16 +21,43 @@ typedef uint8_t (*ble_alarm_on_read_batt_percent_t)(void *ctx);
 
 typedef bool (*ble_alarm_on_write_u8_t)(uint8_t value_0_100, void *ctx);
 
-esp_err_t ble_alarm_init(ble_alarm_on_write_hhmme_t on_write,
-                         ble_alarm_on_read_hhmme_t on_read,
-                         ble_alarm_on_write_hhmmss_t on_time_sync,
-                         ble_alarm_on_read_batt_percent_t on_batt_read,
-                         ble_alarm_on_write_u8_t on_write_color_temp,
-                         ble_alarm_on_write_u8_t on_write_wake_bright,
-                         ble_alarm_on_write_u8_t on_write_sunrise_duration,
-                         ble_alarm_on_connect_t on_connect,
-                         ble_alarm_on_disconnect_t on_disconnect,
-                         void *ctx);
+typedef bool (*ble_alarm_on_write_bytes_t)(const uint8_t *data, size_t len, void *ctx);
+// Fills out (capacity cap) and returns the number of bytes; long reads are served from this buffer by offset.
+typedef size_t (*ble_alarm_on_read_bytes_t)(uint8_t *out, size_t cap, void *ctx);
+// As above, plus esp_timer_get_time() taken as the GATTS event arrived (time-sync stamps).
+typedef bool (*ble_alarm_on_write_stamped_t)(const uint8_t *data, size_t len, int64_t rx_us, void *ctx);
+typedef size_t (*ble_alarm_on_read_stamped_t)(uint8_t *out, size_t cap, int64_t at_us, void *ctx);
+
+typedef struct {
+    ble_alarm_on_write_hhmme_t on_write;                  // 0xFF11 write
+    ble_alarm_on_read_hhmme_t on_read;                    // 0xFF11 read
+    ble_alarm_on_write_hhmmss_t on_time_sync;             // 0xFF12 write
+    ble_alarm_on_read_batt_percent_t on_batt_read;        // 0xFF13 read / notify
+    ble_alarm_on_write_u8_t on_write_color_temp;          // 0xFF14 write
+    ble_alarm_on_write_u8_t on_write_wake_bright;         // 0xFF15 write
+    ble_alarm_on_write_u8_t on_write_sunrise_duration;    // 0xFF16 write
+    ble_alarm_on_write_bytes_t on_write_alarm_record;     // 0xFF17 write (one slot record)
+    ble_alarm_on_read_bytes_t on_read_alarm_table;        // 0xFF17 read (all used slots)
+    ble_alarm_on_write_bytes_t on_write_preset;           // 0xFF18 write (select index or store record)
+    ble_alarm_on_read_bytes_t on_read_presets;            // 0xFF18 read (active index + used records)
+    ble_alarm_on_write_bytes_t on_write_settings;         // 0xFF19 write (schema TLV items)
+    ble_alarm_on_read_bytes_t on_read_settings;           // 0xFF19 read (global fields, alarm dates and skips as TLV)
+    ble_alarm_on_write_bytes_t on_write_config_image;     // 0xFF1A write (chunked image upload command)
+    ble_alarm_on_read_bytes_t on_read_config_image;       // 0xFF1A read (full config image export)
+    ble_alarm_on_read_bytes_t on_read_storage_stats;      // 0xFF1B read (NVS usage/wear telemetry)
+    ble_alarm_on_write_stamped_t on_write_time_exchange;  // 0xFF1C write (timed sync step, time_sync.h)
+    ble_alarm_on_read_stamped_t on_read_time_exchange;    // 0xFF1C read (timed sync stamp + status)
+    ble_alarm_on_connect_t on_connect;
+    ble_alarm_on_disconnect_t on_disconnect;
+    void *ctx;
+} ble_alarm_callbacks_t;
+
+// Advertised name becomes "LightClock_<suffix>" (per-unit, from provisioning). Must be called
+// before ble_alarm_init(); NULL/empty keeps the default name.
+esp_err_t ble_alarm_set_name_suffix(const char *suffix);
+
+// Callbacks are copied; NULL entries reject the corresponding write/read.
+esp_err_t ble_alarm_init(const ble_alarm_callbacks_t *cbs);
 
 esp_err_t ble_alarm_start_advertising(void);
 esp_err_t ble_alarm_stop_advertising(void);
@@ -0,0 +1,185 @@
+#include "ble_value.h"
+
+#include <string.h>
+
+static bool is_ascii_digit(uint8_t c)
+{
+    return (c >= '0' && c <= '9');
+}
+
+bool ble_value_normalize_hhmmss6(const uint8_t *data, uint16_t len, uint8_t out_hhmmss6[6])
+{
+    if (!data || !out_hhmmss6 || len == 0) {
+        return false;
+    }
+
+    // Preferred: exactly 6 ASCII digits.
+    if (len == 6) {
+        for (int i = 0; i < 6; i++) {
+            if (!is_ascii_digit(data[i])) {
+                return false;
+            }
+        }
+        memcpy(out_hhmmss6, data, 6);
+        return true;
+    }
+
+    // Robust: collect first 6 digits from payload (e.g. "12:30:05" or with \r\n).
+    uint8_t tmp[6];
+    int n = 0;
+    for (uint16_t i = 0; i < len && n < 6; i++) {
+        if (is_ascii_digit(data[i])) {
+            tmp[n++] = data[i];
+        }
+    }
+    if (n != 6) {
+        return false;
+    }
+    memcpy(out_hhmmss6, tmp, 6);
+    return true;
+}
+
+static bool normalize_hhmm4(const uint8_t *data, uint16_t len, uint8_t out_hhmm4[4])
+{
+    if (!data || !out_hhmm4 || len == 0) {
+        return false;
+    }
+
+    // 1) Preferred format: 4 ASCII digits "HHMM".
+    if (len == 4 && is_ascii_digit(data[0]) && is_ascii_digit(data[1]) && is_ascii_digit(data[2]) && is_ascii_digit(data[3])) {
+        memcpy(out_hhmm4, data, 4);
+        return true;
+    }
+
+    // 2) Common tooling format: ASCII with terminator / CRLF / spaces.
+    uint16_t start = 0;
+    uint16_t end = len;
+    while (start < end && (data[start] == 0 || data[start] == ' ' || data[start] == '\r' || data[start] == '\n' || data[start] == '\t')) {
+        start++;
+    }
+    while (end > start && (data[end - 1] == 0 || data[end - 1] == ' ' || data[end - 1] == '\r' || data[end - 1] == '\n' || data[end - 1] == '\t')) {
+        end--;
+    }
+    if (end > start) {
+        uint16_t trimmed_len = (uint16_t)(end - start);
+        if (trimmed_len == 4 && is_ascii_digit(data[start]) && is_ascii_digit(data[start + 1]) && is_ascii_digit(data[start + 2]) &&
+            is_ascii_digit(data[start + 3])) {
+            memcpy(out_hhmm4, &data[start], 4);
+            return true;
+        }
+
+        // 3) Tooling sometimes sends decimal string (e.g. "1325") but as a number with fewer digits.
+        // Accept 1..4 digits and zero-pad to 4.
+        if (trimmed_len >= 1 && trimmed_len <= 4) {
+            bool all_digits = true;
+            for (uint16_t i = 0; i < trimmed_len; i++) {
+                if (!is_ascii_digit(data[start + i])) {
+                    all_digits = false;
+                    break;
+                }
+            }
+            if (all_digits) {
+                // Left pad with '0'
+                uint16_t pad = (uint16_t)(4 - trimmed_len);
+                memset(out_hhmm4, '0', pad);
+                memcpy(&out_hhmm4[pad], &data[start], trimmed_len);
+                return true;
+            }
+        }
+    }
+
+    // 4) Packed BCD (2 bytes): 0xHH 0xMM (each nibble 0..9)
+    if (len == 2) {
+        uint8_t hh = data[0];
+        uint8_t mm = data[1];
+        uint8_t hh_hi = (uint8_t)((hh >> 4) & 0x0F);
+        uint8_t hh_lo = (uint8_t)(hh & 0x0F);
+        uint8_t mm_hi = (uint8_t)((mm >> 4) & 0x0F);
+        uint8_t mm_lo = (uint8_t)(mm & 0x0F);
+        if (hh_hi <= 9 && hh_lo <= 9 && mm_hi <= 9 && mm_lo <= 9) {
+            out_hhmm4[0] = (uint8_t)('0' + hh_hi);
+            out_hhmm4[1] = (uint8_t)('0' + hh_lo);
+            out_hhmm4[2] = (uint8_t)('0' + mm_hi);
+            out_hhmm4[3] = (uint8_t)('0' + mm_lo);
+            return true;
+        }
+    }
+
+    // 5) Little-endian integer (2 or 4 bytes) representing HHMM as a decimal number (e.g. 1325).
+    if (len == 2 || len == 4) {
+        uint32_t v_le = 0;
+        for (uint16_t i = 0; i < len; i++) {
+            v_le |= ((uint32_t)data[i]) << (8 * i);
+        }
+
+        if (v_le <= 2359) {
+            uint32_t hh = v_le / 100;
+            uint32_t mm = v_le % 100;
+            if (hh < 24 && mm < 60) {
+                out_hhmm4[0] = (uint8_t)('0' + (hh / 10));
+                out_hhmm4[1] = (uint8_t)('0' + (hh % 10));
+                out_hhmm4[2] = (uint8_t)('0' + (mm / 10));
+                out_hhmm4[3] = (uint8_t)('0' + (mm % 10));
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+bool ble_value_normalize_hhmme5(const uint8_t *data, uint16_t len, uint8_t out_hhmme5[5])
+{
+    if (!data || !out_hhmme5 || len == 0) {
+        return false;
+    }
+
+    // 1) Preferred: exactly 5 ASCII digits "HHMME" where E is 0/1.
+    if (len == 5) {
+        if (is_ascii_digit(data[0]) && is_ascii_digit(data[1]) && is_ascii_digit(data[2]) && is_ascii_digit(data[3]) &&
+            (data[4] == '0' || data[4] == '1')) {
+            memcpy(out_hhmme5, data, 5);
+            return true;
+        }
+    }
+
+    // 2) Backward-compatible: accept HHMM (enable defaults to 1)
+    {
+        uint8_t hhmm4[4] = {0};
+        if (normalize_hhmm4(data, len, hhmm4)) {
+            memcpy(out_hhmme5, hhmm4, 4);
+            out_hhmme5[4] = '1';
+            return true;
+        }
+    }
+
+    // 3) Robust: trim and collect digits; use first 4 digits as HHMM and optional 5th as E.
+    uint16_t start = 0;
+    uint16_t end = len;
+    while (start < end && (data[start] == 0 || data[start] == ' ' || data[start] == '\r' || data[start] == '\n' || data[start] == '\t')) {
+        start++;
+    }
+    while (end > start && (data[end - 1] == 0 || data[end - 1] == ' ' || data[end - 1] == '\r' || data[end - 1] == '\n' || data[end - 1] == '\t')) {
+        end--;
+    }
+    if (end <= start) {
+        return false;
+    }
+
+    uint8_t digits[5] = {0};
+    int n = 0;
+    for (uint16_t i = start; i < end && n < 5; i++) {
+        if (is_ascii_digit(data[i])) {
+            digits[n++] = data[i];
+        }
+    }
+    if (n < 4) {
+        return false;
+    }
+    memcpy(out_hhmme5, digits, 4);
+    out_hhmme5[4] = (n >= 5) ? digits[4] : (uint8_t)'1';
+    if (out_hhmme5[4] != '0' && out_hhmme5[4] != '1') {
+        out_hhmme5[4] = '1';
+    }
+    return true;
+}
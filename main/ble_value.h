@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Normalizers for the ASCII time values written over BLE. Phone apps and generic BLE tools send
+// these in several shapes (with separators, CR/LF, a NUL, fewer digits, BCD or a little-endian
+// number); each is reduced to the canonical digits the callbacks in ble_alarm.h take.
+
+// 0xFF12: "HHMMSS" from exactly 6 digits, or the first 6 digits of a longer payload ("12:30:05\r\n").
+bool ble_value_normalize_hhmmss6(const uint8_t *data, uint16_t len, uint8_t out_hhmmss6[6]);
+
+// 0xFF11: "HHMME" (E = enable '0'/'1'). Also takes HHMM in any of the forms above (enable '1') and
+// 4-5 digits with separators.
+bool ble_value_normalize_hhmme5(const uint8_t *data, uint16_t len, uint8_t out_hhmme5[5]);
+
+#ifdef __cplusplus
+}
+#endif
@@ -9,7 +9,7 @@ static const char *TAG_BTN = "BTN";
 
 static bool is_pressed(const button_t *btn)
 {
-    int lvl = gpio_get_level(btn->gpio);
+    int lvl = hal_gpio_get(btn->gpio);
     return btn->active_low ? (lvl == 0) : (lvl != 0);
 }
 
@@ -25,7 +25,7 @@ void button_sync_state(button_t *btn)
     btn->long_reported = false;
 }
 
-esp_err_t button_init(button_t *btn, gpio_num_t gpio, bool active_low, uint32_t long_press_ms)
+esp_err_t button_init(button_t *btn, hal_gpio_t gpio, bool active_low, uint32_t long_press_ms)
 {
     if (!btn) {
         return ESP_ERR_INVALID_ARG;
@@ -38,15 +38,7 @@ esp_err_t button_init(button_t *btn, gpio_num_t gpio, bool active_low, uint32_t
     btn->press_start_us = 0;
     btn->long_reported = false;
 
-    gpio_config_t cfg = {
-        .pin_bit_mask = (1ULL << gpio),
-        .mode = GPIO_MODE_INPUT,
-        .pull_up_en = active_low ? GPIO_PULLUP_ENABLE : GPIO_PULLUP_DISABLE,
-        .pull_down_en = active_low ? GPIO_PULLDOWN_DISABLE : GPIO_PULLDOWN_ENABLE,
-        .intr_type = GPIO_INTR_DISABLE,
-    };
-
-    return gpio_config(&cfg);
+    return hal_gpio_config(gpio, HAL_GPIO_INPUT, active_low ? HAL_GPIO_PULL_UP : HAL_GPIO_PULL_DOWN);
 }
 
 uint32_t button_measure_press_ms(button_t *btn, uint32_t max_ms)
@@ -3,9 +3,10 @@
 #include <stdbool.h>
 #include <stdint.h>
 
-#include "driver/gpio.h"
 #include "esp_err.h"
 
+#include "hal.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -17,7 +18,7 @@ typedef enum {
 } button_event_t;
 
 typedef struct {
-    gpio_num_t gpio;
+    hal_gpio_t gpio;
     bool active_low;
     uint32_t long_press_ms;
 
@@ -27,7 +28,7 @@ typedef struct {
     bool long_reported;
 } button_t;
 
-esp_err_t button_init(button_t *btn, gpio_num_t gpio, bool active_low, uint32_t long_press_ms);
+esp_err_t button_init(button_t *btn, hal_gpio_t gpio, bool active_low, uint32_t long_press_ms);
 
 // Sync internal state to the current GPIO level. Useful when switching modes to avoid
 // treating a previous press/release as a new event.
@@ -1,7 +1,6 @@
 #include "ch455g.h"
 
 #include "esp_log.h"
-#include "esp_rom_sys.h"
 
 static const char *TAG = "CH455";
 
@@ -22,13 +21,13 @@ static const char *TAG = "CH455";
 static inline void delay_half_period(void)
 {
     // ~100kHz-ish bitbang; keep conservative for signal integrity
-    esp_rom_delay_us(5);
+    hal_delay_us(5);
 }
 
-static inline void scl_high(const ch455g_t *d) { gpio_set_level(d->scl, 1); }
-static inline void scl_low(const ch455g_t *d)  { gpio_set_level(d->scl, 0); }
-static inline void sda_high(const ch455g_t *d) { gpio_set_level(d->sda, 1); }
-static inline void sda_low(const ch455g_t *d)  { gpio_set_level(d->sda, 0); }
+static inline void scl_high(const ch455g_t *d) { hal_gpio_set(d->scl, 1); }
+static inline void scl_low(const ch455g_t *d)  { hal_gpio_set(d->scl, 0); }
+static inline void sda_high(const ch455g_t *d) { hal_gpio_set(d->sda, 1); }
+static inline void sda_low(const ch455g_t *d)  { hal_gpio_set(d->sda, 0); }
 
 static void start_cond(const ch455g_t *d)
 {
@@ -109,7 +108,7 @@ static uint8_t sys_param_build(uint8_t intensity_0_7, bool enabled, bool sleep)
     return b;
 }
 
-esp_err_t ch455g_init(ch455g_t *dev, gpio_num_t sda, gpio_num_t scl, uint8_t intensity)
+esp_err_t ch455g_init(ch455g_t *dev, hal_gpio_t sda, hal_gpio_t scl, uint8_t intensity)
 {
     if (!dev) {
         return ESP_ERR_INVALID_ARG;
@@ -119,18 +118,12 @@ esp_err_t ch455g_init(ch455g_t *dev, gpio_num_t sda, gpio_num_t scl, uint8_t int
     dev->scl = scl;
     dev->sys_param = sys_param_build(intensity, true, false);
 
-    gpio_config_t cfg = {
-        .pin_bit_mask = (1ULL << sda) | (1ULL << scl),
-        .mode = GPIO_MODE_INPUT_OUTPUT_OD,
-        .pull_up_en = GPIO_PULLUP_ENABLE,
-        .pull_down_en = GPIO_PULLDOWN_DISABLE,
-        .intr_type = GPIO_INTR_DISABLE,
-    };
-    ESP_ERROR_CHECK(gpio_config(&cfg));
+    ESP_ERROR_CHECK(hal_gpio_config(sda, HAL_GPIO_INPUT_OUTPUT_OD, HAL_GPIO_PULL_UP));
+    ESP_ERROR_CHECK(hal_gpio_config(scl, HAL_GPIO_INPUT_OUTPUT_OD, HAL_GPIO_PULL_UP));
 
     // idle high
-    gpio_set_level(sda, 1);
-    gpio_set_level(scl, 1);
+    hal_gpio_set(sda, 1);
+    hal_gpio_set(scl, 1);
 
     esp_err_t err = ch455_write2(dev, CH455_CMD_SYS_PARAM, dev->sys_param);
     if (err != ESP_OK) {
@@ -210,6 +203,11 @@ static uint8_t seg_for_digit(int d)
 }
 
 esp_err_t ch455g_show_hhmm(ch455g_t *dev, int hour, int minute)
+{
+    return ch455g_show_hhmm_ex(dev, hour, minute, false);
+}
+
+esp_err_t ch455g_show_hhmm_ex(ch455g_t *dev, int hour, int minute, bool approximate)
 {
     if (!dev || hour < 0 || hour > 23 || minute < 0 || minute > 59) {
         return ESP_ERR_INVALID_ARG;
@@ -231,6 +229,10 @@ esp_err_t ch455g_show_hhmm(ch455g_t *dev, int hour, int minute)
     // Per latest hardware confirmation: there is NO dedicated colon; only a single DP dot is available.
     // Use a single dot between hour and minute by enabling DP on the center-left digit (hours units).
     dig1 |= 0x80;
+    // Approximate time: a second dot after the minutes ("12.34.").
+    if (approximate) {
+        dig3 |= 0x80;
+    }
 
     return ch455g_set_4digits_raw(dev, dig0, dig1, dig2, dig3);
 }
@@ -0,0 +1,64 @@
+#include "civil_time.h"
+
+int32_t civil_days_from_date(int32_t year, uint32_t month, uint32_t day)
+{
+    // Shift the year to start in March so the leap day is the last day of the "year".
+    int32_t y = year - (month <= 2);
+    int32_t era = (y >= 0 ? y : y - 399) / 400;
+    uint32_t yoe = (uint32_t)(y - era * 400);                               // [0, 399]
+    uint32_t doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1; // [0, 365]
+    uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;                   // [0, 146096]
+    return era * 146097 + (int32_t)doe - 719468;
+}
+
+void civil_date_from_days(int32_t days, int32_t *year, uint8_t *month, uint8_t *day)
+{
+    days += 719468;
+    int32_t era = (days >= 0 ? days : days - 146096) / 146097;
+    uint32_t doe = (uint32_t)(days - era * 146097);
+    uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    uint32_t mp = (5 * doy + 2) / 153;
+    uint32_t m = mp < 10 ? mp + 3 : mp - 9;
+    if (year) {
+        *year = (int32_t)yoe + era * 400 + (m <= 2);
+    }
+    if (month) {
+        *month = (uint8_t)m;
+    }
+    if (day) {
+        *day = (uint8_t)(doy - (153 * mp + 2) / 5 + 1);
+    }
+}
+
+uint8_t civil_days_in_month(int32_t year, uint32_t month)
+{
+    static const uint8_t mdays[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    if (month < 1 || month > 12) {
+        return 0;
+    }
+    return (uint8_t)(mdays[month - 1] + (month == 2 && civil_is_leap(year)));
+}
+
+void civil_from_seconds(int64_t secs, civil_time_t *out)
+{
+    if (!out) {
+        return;
+    }
+    int32_t days = civil_days_of(secs);
+    uint32_t sod = civil_second_of_day(secs);
+    civil_date_from_days(days, &out->year, &out->month, &out->day);
+    out->hour = (uint8_t)(sod / 3600u);
+    out->minute = (uint8_t)((sod / 60u) % 60u);
+    out->second = (uint8_t)(sod % 60u);
+    out->wday = civil_weekday(days);
+}
+
+int64_t civil_to_seconds(const civil_time_t *ct)
+{
+    if (!ct) {
+        return 0;
+    }
+    int64_t days = civil_days_from_date(ct->year, ct->month, ct->day);
+    return days * CIVIL_SECS_PER_DAY + (int64_t)ct->hour * 3600 + (int64_t)ct->minute * 60 + ct->second;
+}
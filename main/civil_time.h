@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Proleptic Gregorian calendar arithmetic on plain integers (H. Hinnant's days_from_civil /
+// civil_from_days). No tables, no division by anything but constants, no libc: replaces
+// mktime/localtime_r/gmtime_r, which in newlib normalise field by field and take the env lock.
+// Seconds are "epoch seconds" in whatever frame the caller uses (UTC or local wall clock).
+
+typedef struct {
+    int32_t year;
+    uint8_t month;  // 1..12
+    uint8_t day;    // 1..31
+    uint8_t hour;   // 0..23
+    uint8_t minute; // 0..59
+    uint8_t second; // 0..59
+    uint8_t wday;   // 0 = Sunday
+} civil_time_t;
+
+#define CIVIL_SECS_PER_DAY (86400)
+
+// Days since 1970-01-01 of y-m-d (month 1..12). Out-of-range days roll over like mktime's tm_mday.
+int32_t civil_days_from_date(int32_t year, uint32_t month, uint32_t day);
+void civil_date_from_days(int32_t days, int32_t *year, uint8_t *month, uint8_t *day);
+
+static inline bool civil_is_leap(int32_t year)
+{
+    return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+uint8_t civil_days_in_month(int32_t year, uint32_t month);
+
+// 0 = Sunday; 1970-01-01 was a Thursday.
+static inline uint8_t civil_weekday(int32_t days)
+{
+    int32_t w = (days + 4) % 7;
+    return (uint8_t)(w < 0 ? w + 7 : w);
+}
+
+// Floor division of epoch seconds into whole days and second of day, valid for negative input.
+static inline int32_t civil_days_of(int64_t secs)
+{
+    int64_t d = secs / CIVIL_SECS_PER_DAY;
+    return (int32_t)(d - (secs % CIVIL_SECS_PER_DAY < 0));
+}
+
+static inline uint32_t civil_second_of_day(int64_t secs)
+{
+    return (uint32_t)(secs - (int64_t)civil_days_of(secs) * CIVIL_SECS_PER_DAY);
+}
+
+// Second of the week (Sunday 00:00:00 = 0), as used by alarm_sched.
+static inline uint32_t civil_second_of_week(int64_t secs)
+{
+    return (uint32_t)civil_weekday(civil_days_of(secs)) * CIVIL_SECS_PER_DAY + civil_second_of_day(secs);
+}
+
+void civil_from_seconds(int64_t secs, civil_time_t *out);
+// Ignores wday. month must be 1..12 and day >= 1; larger day/hour/minute/second values roll over
+// as in mktime.
+int64_t civil_to_seconds(const civil_time_t *ct);
+
+#ifdef __cplusplus
+}
+#endif
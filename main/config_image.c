@@ -0,0 +1,91 @@
+#include "config_image.h"
+
+#include <string.h>
+
+#include "esp_log.h"
+
+static const char *TAG = "CFG_IMG";
+
+// DEVICE_CONFIG_IMAGE_MAX_LEN must fit the u16 length/offset fields.
+_Static_assert(DEVICE_CONFIG_IMAGE_MAX_LEN <= UINT16_MAX, "config image too large for u16 offsets");
+
+static uint16_t get_u16_le(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+void config_image_rx_reset(config_image_rx_t *rx)
+{
+    if (!rx) {
+        return;
+    }
+    rx->active = false;
+    rx->total = 0;
+    rx->received = 0;
+}
+
+static esp_err_t rx_fail(config_image_rx_t *rx, esp_err_t err, const char *why)
+{
+    ESP_LOGW(TAG, "upload aborted: %s (%u/%u bytes)", why, (unsigned)rx->received, (unsigned)rx->total);
+    config_image_rx_reset(rx);
+    return err;
+}
+
+esp_err_t config_image_rx_feed(config_image_rx_t *rx, const uint8_t *data, size_t len, device_config_t *out_cfg,
+                               bool *out_ready)
+{
+    if (!rx || !data || len == 0 || !out_cfg || !out_ready) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out_ready = false;
+
+    switch (data[0]) {
+    case CONFIG_IMAGE_OP_ABORT:
+        config_image_rx_reset(rx);
+        return ESP_OK;
+
+    case CONFIG_IMAGE_OP_BEGIN: {
+        if (len != 3) {
+            return rx_fail(rx, ESP_ERR_INVALID_SIZE, "bad begin");
+        }
+        uint16_t total = get_u16_le(&data[1]);
+        if (total == 0 || total > DEVICE_CONFIG_IMAGE_MAX_LEN) {
+            return rx_fail(rx, ESP_ERR_INVALID_SIZE, "bad total length");
+        }
+        rx->active = true;
+        rx->total = total;
+        rx->received = 0;
+        return ESP_OK;
+    }
+
+    case CONFIG_IMAGE_OP_DATA: {
+        if (!rx->active || len < 3) {
+            return rx_fail(rx, ESP_ERR_INVALID_STATE, "data without begin");
+        }
+        uint16_t offset = get_u16_le(&data[1]);
+        size_t n = len - 3;
+        if (offset != rx->received || n > (size_t)(rx->total - rx->received)) {
+            return rx_fail(rx, ESP_ERR_INVALID_SIZE, "chunk out of order");
+        }
+        memcpy(&rx->buf[offset], &data[3], n);
+        rx->received = (uint16_t)(rx->received + n);
+        return ESP_OK;
+    }
+
+    case CONFIG_IMAGE_OP_COMMIT: {
+        if (!rx->active || len != 1 || rx->received != rx->total) {
+            return rx_fail(rx, ESP_ERR_INVALID_STATE, "incomplete image");
+        }
+        esp_err_t err = device_config_import_image(rx->buf, rx->total, out_cfg);
+        if (err != ESP_OK) {
+            return rx_fail(rx, err, esp_err_to_name(err));
+        }
+        config_image_rx_reset(rx);
+        *out_ready = true;
+        return ESP_OK;
+    }
+
+    default:
+        return rx_fail(rx, ESP_ERR_NOT_SUPPORTED, "unknown op");
+    }
+}
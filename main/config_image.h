@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "device_config.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Chunked upload of a whole config image (0xFF1A write). Each write is one command:
+//   0x00                         abort
+//   0x01 total_len(u16)          begin; discards any partial upload
+//   0x02 offset(u16) data[..]    append; offset must equal the bytes received so far
+//   0x03                         commit; the image is decoded and validated as a whole
+// Nothing reaches the running config until commit succeeds, so a dropped link or a bad image
+// leaves the device exactly as it was.
+#define CONFIG_IMAGE_OP_ABORT  (0x00)
+#define CONFIG_IMAGE_OP_BEGIN  (0x01)
+#define CONFIG_IMAGE_OP_DATA   (0x02)
+#define CONFIG_IMAGE_OP_COMMIT (0x03)
+
+typedef struct {
+    bool active;
+    uint16_t total;
+    uint16_t received;
+    uint8_t buf[DEVICE_CONFIG_IMAGE_MAX_LEN];
+} config_image_rx_t;
+
+void config_image_rx_reset(config_image_rx_t *rx);
+
+// Feeds one command. Returns ESP_OK when accepted; *out_ready is set (and out_cfg filled) only by a
+// successful commit. Any error aborts the upload.
+esp_err_t config_image_rx_feed(config_image_rx_t *rx, const uint8_t *data, size_t len, device_config_t *out_cfg,
+                               bool *out_ready);
+
+#ifdef __cplusplus
+}
+#endif
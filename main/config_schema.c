@@ -0,0 +1,215 @@
+#include "config_schema.h"
+
+#include <string.h>
+
+#define CFG_SCOPE_STRUCT_GLOBAL device_config_t
+#define CFG_SCOPE_STRUCT_ALARM  device_alarm_t
+#define CFG_SCOPE_STRUCT_PRESET device_preset_t
+#define CFG_SCOPE_STRUCT_SKIP   device_skip_t
+
+static const cfg_field_desc_t s_fields[CFG_FIELD_COUNT] = {
+#define CFG_X_DESC(id_, wire_, scope_, member_, type_, min_, max_, def_, persist_) \
+    [CFG_FIELD_##id_] = {                                                           \
+        .name = #id_,                                                               \
+        .offset = (uint16_t)offsetof(CFG_SCOPE_STRUCT_##scope_, member_),           \
+        .wire_id = (wire_),                                                         \
+        .scope = CFG_SCOPE_##scope_,                                                \
+        .type = CFG_TYPE_##type_,                                                   \
+        .persist = CFG_PERSIST_##persist_,                                          \
+        .min = (min_),                                                              \
+        .max = (max_),                                                              \
+        .def = (def_),                                                              \
+    },
+    CONFIG_SCHEMA_FIELDS(CFG_X_DESC)
+#undef CFG_X_DESC
+};
+
+// Every field is a u8 member; keep the table honest if a wider member is ever added.
+#define CFG_X_SIZE_CHECK(id_, wire_, scope_, member_, type_, min_, max_, def_, persist_)      \
+    _Static_assert(sizeof(((CFG_SCOPE_STRUCT_##scope_ *)0)->member_) == 1, #id_ " must be u8"); \
+    _Static_assert((min_) <= (def_) && (def_) <= (max_), #id_ " default out of range");
+CONFIG_SCHEMA_FIELDS(CFG_X_SIZE_CHECK)
+#undef CFG_X_SIZE_CHECK
+
+// wire_id -> field index + 1 (0 = unknown), so TLV parsing is a single table load.
+static const uint8_t s_by_wire[256] = {
+#define CFG_X_WIRE(id_, wire_, scope_, member_, type_, min_, max_, def_, persist_) [(wire_)] = CFG_FIELD_##id_ + 1,
+    CONFIG_SCHEMA_FIELDS(CFG_X_WIRE)
+#undef CFG_X_WIRE
+};
+
+const cfg_field_desc_t *config_schema_field(cfg_field_t id)
+{
+    return ((unsigned)id < CFG_FIELD_COUNT) ? &s_fields[id] : NULL;
+}
+
+const cfg_field_desc_t *config_schema_find_wire(uint8_t wire_id)
+{
+    uint8_t idx = s_by_wire[wire_id];
+    return idx ? &s_fields[idx - 1] : NULL;
+}
+
+static bool scope_valid(cfg_scope_t scope, const void *obj)
+{
+    const uint8_t *base = (const uint8_t *)obj;
+    for (size_t i = 0; i < CFG_FIELD_COUNT; i++) {
+        const cfg_field_desc_t *f = &s_fields[i];
+        if (f->scope == scope && !config_schema_in_range(f, base[f->offset])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool config_schema_valid_globals(const device_config_t *cfg)
+{
+    return cfg && scope_valid(CFG_SCOPE_GLOBAL, cfg);
+}
+
+bool config_schema_valid_alarm(const device_alarm_t *alarm)
+{
+    return alarm && scope_valid(CFG_SCOPE_ALARM, alarm);
+}
+
+bool config_schema_valid_preset(const device_preset_t *preset)
+{
+    return preset && scope_valid(CFG_SCOPE_PRESET, preset);
+}
+
+bool config_schema_valid_skip(const device_skip_t *skip)
+{
+    return skip && scope_valid(CFG_SCOPE_SKIP, skip);
+}
+
+void config_schema_defaults(cfg_scope_t scope, void *obj)
+{
+    uint8_t *base = (uint8_t *)obj;
+    for (size_t i = 0; i < CFG_FIELD_COUNT; i++) {
+        const cfg_field_desc_t *f = &s_fields[i];
+        if (f->scope == scope) {
+            base[f->offset] = f->def;
+        }
+    }
+}
+
+// Appends one item per schema field of scope whose wire id is at least min_wire; returns the new length.
+static size_t encode_scope(cfg_scope_t scope, uint8_t min_wire, uint8_t index, const void *obj, uint8_t *out, size_t len,
+                           size_t cap)
+{
+    const uint8_t *base = (const uint8_t *)obj;
+    for (size_t i = 0; i < CFG_FIELD_COUNT; i++) {
+        const cfg_field_desc_t *f = &s_fields[i];
+        if (f->scope != scope || f->wire_id < min_wire) {
+            continue;
+        }
+        if (len + CFG_TLV_ITEM_HDR_LEN + 1 > cap) {
+            break;
+        }
+        out[len + 0] = f->wire_id;
+        out[len + 1] = index;
+        out[len + 2] = 1;
+        out[len + 3] = base[f->offset];
+        len += CFG_TLV_ITEM_HDR_LEN + 1;
+    }
+    return len;
+}
+
+size_t config_schema_encode_globals(const device_config_t *cfg, uint8_t *out, size_t cap)
+{
+    if (!cfg || !out) {
+        return 0;
+    }
+    return encode_scope(CFG_SCOPE_GLOBAL, 0, 0, cfg, out, 0, cap);
+}
+
+size_t config_schema_encode_dates(const device_config_t *cfg, uint8_t *out, size_t cap)
+{
+    if (!cfg || !out) {
+        return 0;
+    }
+    size_t len = 0;
+    for (uint8_t i = 0; i < DEVICE_CONFIG_MAX_ALARMS; i++) {
+        const device_alarm_t *a = &cfg->alarms[i];
+        if (a->weekdays != 0 && (a->date_year != 0 || a->skip_next)) {
+            len = encode_scope(CFG_SCOPE_ALARM, config_schema_field(CFG_FIELD_ALARM_DATE_YEAR)->wire_id, i, a, out, len, cap);
+        }
+    }
+    for (uint8_t i = 0; i < DEVICE_CONFIG_MAX_SKIPS; i++) {
+        if (cfg->skips[i].year != 0) {
+            len = encode_scope(CFG_SCOPE_SKIP, 0, i, &cfg->skips[i], out, len, cap);
+        }
+    }
+    return len;
+}
+
+// Resolves the struct a TLV item addresses, or NULL if the index is out of range for the scope.
+static uint8_t *tlv_target(device_config_t *cfg, const cfg_field_desc_t *f, uint8_t index)
+{
+    switch (f->scope) {
+    case CFG_SCOPE_GLOBAL:
+        return (index == 0) ? (uint8_t *)cfg : NULL;
+    case CFG_SCOPE_ALARM:
+        return (index < DEVICE_CONFIG_MAX_ALARMS) ? (uint8_t *)&cfg->alarms[index] : NULL;
+    case CFG_SCOPE_PRESET:
+        if (index >= DEVICE_CONFIG_MAX_PRESETS || cfg->presets[index].name[0] == 0) {
+            return NULL;
+        }
+        return (uint8_t *)&cfg->presets[index];
+    case CFG_SCOPE_SKIP:
+        return (index < DEVICE_CONFIG_MAX_SKIPS) ? (uint8_t *)&cfg->skips[index] : NULL;
+    default:
+        return NULL;
+    }
+}
+
+bool config_schema_apply_tlv(device_config_t *cfg, const uint8_t *data, size_t len, cfg_tlv_result_t *out_result)
+{
+    if (!cfg || !data || len == 0) {
+        return false;
+    }
+
+    // Pass 1: check every item so a bad item leaves cfg untouched.
+    size_t off = 0;
+    while (off < len) {
+        if (off + CFG_TLV_ITEM_HDR_LEN > len) {
+            return false;
+        }
+        const cfg_field_desc_t *f = config_schema_find_wire(data[off]);
+        uint8_t vlen = data[off + 2];
+        if (!f || vlen != 1 || off + CFG_TLV_ITEM_HDR_LEN + vlen > len || !tlv_target(cfg, f, data[off + 1]) ||
+            !config_schema_in_range(f, data[off + CFG_TLV_ITEM_HDR_LEN])) {
+            return false;
+        }
+        off += CFG_TLV_ITEM_HDR_LEN + vlen;
+    }
+
+    // Pass 2: apply and record what changed.
+    cfg_tlv_result_t res;
+    memset(&res, 0, sizeof(res));
+    for (off = 0; off < len; off += CFG_TLV_ITEM_HDR_LEN + 1) {
+        const cfg_field_desc_t *f = config_schema_find_wire(data[off]);
+        uint8_t index = data[off + 1];
+        uint8_t v = data[off + CFG_TLV_ITEM_HDR_LEN];
+        uint8_t *base = tlv_target(cfg, f, index);
+        if (base[f->offset] == v) {
+            continue;
+        }
+        base[f->offset] = v;
+        if (f->persist == CFG_PERSIST_IMMEDIATE) {
+            res.immediate = true;
+        }
+        if (f->scope == CFG_SCOPE_GLOBAL) {
+            res.globals_changed = true;
+        } else if (f->scope == CFG_SCOPE_ALARM) {
+            res.alarms_changed |= (uint16_t)(1u << index);
+        } else if (f->scope == CFG_SCOPE_PRESET) {
+            res.presets_changed |= (uint8_t)(1u << index);
+        } else {
+            res.skips_changed |= (uint8_t)(1u << index);
+        }
+    }
+    if (out_result) {
+        *out_result = res;
+    }
+    return true;
+}
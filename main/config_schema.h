@@ -0,0 +1,151 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sdkconfig.h"
+
+#include "device_config.h"
+#include "tz.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Single source of truth for every persisted config field. Validation, defaults, the 0xFF19
+// settings TLV and the BLE write checks are all generated from this table.
+//
+//   X(ID, wire_id, scope, member, type, min, max, default, persist)
+//
+// scope:   GLOBAL -> device_config_t, ALARM -> device_alarm_t, PRESET -> device_preset_t,
+//          SKIP -> device_skip_t
+// wire_id: stable tag on the wire (never reuse a retired id)
+// persist: DEFERRED = write-behind commit, IMMEDIATE = flushed as soon as it changes
+#define CONFIG_SCHEMA_FIELDS(X)                                                                   \
+    X(COLOR_TEMP,        0x01, GLOBAL, color_temp,       U8,   0, 100,  50, DEFERRED)           \
+    X(WAKE_BRIGHT,       0x02, GLOBAL, wake_bright,      U8,   0, 100, 100, DEFERRED)           \
+    X(TZ_ZONE,           0x03, GLOBAL, tz_zone,          U8,   0, TZ_ZONE_COUNT - 1, CONFIG_LIGHT_ALARM_TZ_DEFAULT_ZONE, IMMEDIATE) \
+    X(ALARM_HOUR,        0x10, ALARM,  hour,             U8,   0,  23,   7, IMMEDIATE)          \
+    X(ALARM_MINUTE,      0x11, ALARM,  minute,           U8,   0,  59,   0, IMMEDIATE)          \
+    X(ALARM_WEEKDAYS,    0x12, ALARM,  weekdays,         BITS, 0, 0x7F,  0, IMMEDIATE)          \
+    X(ALARM_ENABLED,     0x13, ALARM,  enabled,          BOOL, 0,   1,   0, IMMEDIATE)          \
+    X(ALARM_SUNRISE,     0x14, ALARM,  sunrise_duration, U8,   1,  60, CONFIG_LIGHT_ALARM_GRADIENT_MINUTES, IMMEDIATE) \
+    X(ALARM_WAKE_BRIGHT, 0x15, ALARM,  wake_bright,      U8,   0, 100, 100, IMMEDIATE)          \
+    X(ALARM_DATE_YEAR,   0x16, ALARM,  date_year,        U8,   0,  99,   0, IMMEDIATE)          \
+    X(ALARM_DATE_MONTH,  0x17, ALARM,  date_month,       U8,   1,  12,   1, IMMEDIATE)          \
+    X(ALARM_DATE_DAY,    0x18, ALARM,  date_day,         U8,   1,  31,   1, IMMEDIATE)          \
+    X(ALARM_SKIP_NEXT,   0x19, ALARM,  skip_next,        BOOL, 0,   1,   0, IMMEDIATE)          \
+    X(PRESET_BRIGHTNESS, 0x20, PRESET, brightness,       U8,   0, 100, 100, DEFERRED)           \
+    X(PRESET_COLOR_TEMP, 0x21, PRESET, color_temp,       U8,   0, 100,  50, DEFERRED)           \
+    X(PRESET_CURVE,      0x22, PRESET, curve,            U8,   0, DEVICE_PRESET_CURVE_COUNT - 1, 0, DEFERRED) \
+    X(PRESET_FADE_DS,    0x23, PRESET, fade_ds,          U8,   0, 255,   5, DEFERRED)           \
+    X(SKIP_YEAR,         0x30, SKIP,   year,             U8,   0,  99,   0, IMMEDIATE)          \
+    X(SKIP_MONTH,        0x31, SKIP,   month,            U8,   1,  12,   1, IMMEDIATE)          \
+    X(SKIP_DAY,          0x32, SKIP,   day,              U8,   1,  31,   1, IMMEDIATE)          \
+    X(SKIP_SLOTS_LO,     0x33, SKIP,   slots_lo,         BITS, 0, 0xFF, 0xFF, IMMEDIATE)        \
+    X(SKIP_SLOTS_HI,     0x34, SKIP,   slots_hi,         BITS, 0, 0xFF, 0xFF, IMMEDIATE)
+
+typedef enum {
+    CFG_SCOPE_GLOBAL = 0,
+    CFG_SCOPE_ALARM,
+    CFG_SCOPE_PRESET,
+    CFG_SCOPE_SKIP,
+} cfg_scope_t;
+
+typedef enum {
+    CFG_TYPE_U8 = 0,
+    CFG_TYPE_BOOL,
+    CFG_TYPE_BITS,
+} cfg_type_t;
+
+typedef enum {
+    CFG_PERSIST_DEFERRED = 0,
+    CFG_PERSIST_IMMEDIATE,
+} cfg_persist_t;
+
+typedef enum {
+#define CFG_X_ENUM(id_, wire_, scope_, member_, type_, min_, max_, def_, persist_) CFG_FIELD_##id_,
+    CONFIG_SCHEMA_FIELDS(CFG_X_ENUM)
+#undef CFG_X_ENUM
+    CFG_FIELD_COUNT,
+} cfg_field_t;
+
+// Compile-time CFG_MIN_<ID> / CFG_MAX_<ID> / CFG_DEF_<ID> constants for hot paths.
+enum {
+#define CFG_X_LIMITS(id_, wire_, scope_, member_, type_, min_, max_, def_, persist_) \
+    CFG_MIN_##id_ = (min_), CFG_MAX_##id_ = (max_), CFG_DEF_##id_ = (def_),
+    CONFIG_SCHEMA_FIELDS(CFG_X_LIMITS)
+#undef CFG_X_LIMITS
+};
+
+// Single unsigned compare: (v - min) wraps to a large value when v < min.
+#define CFG_IN_RANGE(id, v) ((unsigned)((int)(v) - (int)CFG_MIN_##id) <= (unsigned)(CFG_MAX_##id - CFG_MIN_##id))
+
+typedef struct {
+    const char *name;
+    uint16_t offset; // offsetof(member) in the scope's struct
+    uint8_t wire_id;
+    uint8_t scope;   // cfg_scope_t
+    uint8_t type;    // cfg_type_t
+    uint8_t persist; // cfg_persist_t
+    uint8_t min;
+    uint8_t max;
+    uint8_t def;
+} cfg_field_desc_t;
+
+const cfg_field_desc_t *config_schema_field(cfg_field_t id);
+// O(1) lookup by wire id; NULL if unknown.
+const cfg_field_desc_t *config_schema_find_wire(uint8_t wire_id);
+
+static inline bool config_schema_in_range(const cfg_field_desc_t *f, uint8_t v)
+{
+    return (uint8_t)(v - f->min) <= (uint8_t)(f->max - f->min);
+}
+
+// Range checks of every field in the given scope.
+bool config_schema_valid_globals(const device_config_t *cfg);
+bool config_schema_valid_alarm(const device_alarm_t *alarm);
+bool config_schema_valid_preset(const device_preset_t *preset);
+bool config_schema_valid_skip(const device_skip_t *skip);
+
+// Fills every schema field of obj (device_config_t / device_alarm_t / device_preset_t / device_skip_t)
+// with its default.
+void config_schema_defaults(cfg_scope_t scope, void *obj);
+
+// Settings TLV (0xFF19), one item per field: wire_id(u8) index(u8) len(u8) value[len].
+// index selects the alarm/preset slot and is 0 for global fields.
+#define CFG_TLV_ITEM_HDR_LEN (3)
+enum {
+    CFG_GLOBAL_FIELD_COUNT = 0
+#define CFG_X_COUNT(id_, wire_, scope_, member_, type_, min_, max_, def_, persist_) +(CFG_SCOPE_##scope_ == CFG_SCOPE_GLOBAL)
+    CONFIG_SCHEMA_FIELDS(CFG_X_COUNT)
+#undef CFG_X_COUNT
+};
+#define CFG_TLV_GLOBALS_MAX_LEN (CFG_GLOBAL_FIELD_COUNT * (CFG_TLV_ITEM_HDR_LEN + 1))
+// Dates and skips of a read: ALARM_DATE_* and ALARM_SKIP_NEXT of every alarm plus every SKIP field
+// of every entry.
+#define CFG_TLV_DATES_MAX_LEN ((DEVICE_CONFIG_MAX_ALARMS * 4 + DEVICE_CONFIG_MAX_SKIPS * 5) * (CFG_TLV_ITEM_HDR_LEN + 1))
+
+typedef struct {
+    bool globals_changed;
+    bool immediate;         // at least one changed field has CFG_PERSIST_IMMEDIATE
+    uint16_t alarms_changed; // bitmap of alarm slots
+    uint8_t presets_changed; // bitmap of preset slots
+    uint8_t skips_changed;   // bitmap of skip entries
+} cfg_tlv_result_t;
+
+// Encodes all global fields; returns bytes written.
+size_t config_schema_encode_globals(const device_config_t *cfg, uint8_t *out, size_t cap);
+// Encodes the date fields of dated or skip-next alarms and every field of used skip entries;
+// returns bytes written.
+size_t config_schema_encode_dates(const device_config_t *cfg, uint8_t *out, size_t cap);
+
+// All-or-nothing: every item is checked against the schema before any is applied to cfg.
+// Preset fields are only accepted for slots that are in use (presets are created through 0xFF18).
+// Ranges only: a date spread over several items is checked by the caller on the result.
+bool config_schema_apply_tlv(device_config_t *cfg, const uint8_t *data, size_t len, cfg_tlv_result_t *out_result);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,217 @@
+#include "config_service.h"
+
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+
+#include "sdkconfig.h"
+
+#include "timer_wheel.h"
+
+static const char *TAG = "CFGSVC";
+
+#define COMMIT_DELAY_US ((int64_t)CONFIG_LIGHT_ALARM_CFG_COMMIT_DELAY_MS * 1000)
+// A continuous stream of updates (slider drag) must not postpone the commit forever.
+#define COMMIT_MAX_DEFER_US (COMMIT_DELAY_US * 4)
+// The commit may ride along with another wakeup up to this much later.
+#define COMMIT_SLACK_US ((uint32_t)(COMMIT_DELAY_US / 4))
+// A failed commit is retried after COMMIT_DELAY_US, doubling up to this while it keeps failing.
+#define COMMIT_RETRY_MAX_US (60LL * 1000000LL)
+
+static SemaphoreHandle_t s_lock;
+static timer_wheel_timer_t s_commit_timer;
+static device_config_t s_cfg;
+static bool s_dirty;
+static int64_t s_dirty_since_us;
+static uint32_t s_pending_updates; // updates since the last commit
+static int64_t s_retry_us;          // current retry delay, 0 while commits succeed
+static config_service_stats_t s_stats;
+
+static void config_service_commit_timer_cb(void *arg)
+{
+    (void)arg;
+    (void)config_service_flush();
+}
+
+static void config_service_shutdown_handler(void)
+{
+    (void)config_service_flush();
+}
+
+esp_err_t config_service_init(device_config_t *out_cfg)
+{
+    if (!out_cfg) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_lock) {
+        s_lock = xSemaphoreCreateMutex();
+        if (!s_lock) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    esp_err_t err = device_config_load(&s_cfg);
+    if (err != ESP_OK) {
+        return err;
+    }
+    s_dirty = false;
+    s_pending_updates = 0;
+    s_retry_us = 0;
+
+    if (!s_commit_timer.cb) {
+        timer_wheel_timer_init(&s_commit_timer, "cfg_commit", config_service_commit_timer_cb, NULL);
+        // Covers esp_restart() from any code path.
+        (void)esp_register_shutdown_handler(config_service_shutdown_handler);
+    }
+
+    *out_cfg = s_cfg;
+    return ESP_OK;
+}
+
+void config_service_get(device_config_t *out_cfg)
+{
+    if (!out_cfg) {
+        return;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    *out_cfg = s_cfg;
+    xSemaphoreGive(s_lock);
+}
+
+// Stores cfg and schedules its commit. Called with s_lock held; releases it.
+static esp_err_t config_service_store_and_unlock(const device_config_t *cfg)
+{
+    int64_t now_us = esp_timer_get_time();
+    if (memcmp(&s_cfg, cfg, sizeof(s_cfg)) == 0) {
+        xSemaphoreGive(s_lock);
+        return ESP_OK;
+    }
+    s_cfg = *cfg;
+    if (!s_dirty) {
+        s_dirty = true;
+        s_dirty_since_us = now_us;
+    }
+    s_pending_updates++;
+    s_stats.updates++;
+    if (s_retry_us != 0) {
+        // A failed commit is waiting for its retry, which will write this copy too.
+        xSemaphoreGive(s_lock);
+        return ESP_OK;
+    }
+
+    // Debounce: restart the countdown on every change, but never defer past COMMIT_MAX_DEFER_US.
+    int64_t deadline_us = s_dirty_since_us + COMMIT_MAX_DEFER_US;
+    int64_t delay_us = COMMIT_DELAY_US;
+    if (now_us + delay_us > deadline_us) {
+        delay_us = (deadline_us > now_us) ? (deadline_us - now_us) : 0;
+    }
+    int64_t slack_us = deadline_us - (now_us + delay_us);
+    if (slack_us > COMMIT_SLACK_US) {
+        slack_us = COMMIT_SLACK_US;
+    }
+    esp_err_t err = timer_wheel_start_once(&s_commit_timer, (uint64_t)delay_us, (uint32_t)slack_us);
+    xSemaphoreGive(s_lock);
+
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "commit timer start failed (%s); committing now", esp_err_to_name(err));
+        return config_service_flush();
+    }
+    return ESP_OK;
+}
+
+esp_err_t config_service_update(const device_config_t *cfg)
+{
+    if (!cfg || !s_lock) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    return config_service_store_and_unlock(cfg);
+}
+
+esp_err_t config_service_edit(config_service_edit_fn edit, void *arg)
+{
+    if (!edit || !s_lock) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    device_config_t next = s_cfg;
+    if (!edit(&next, arg)) {
+        xSemaphoreGive(s_lock);
+        return ESP_ERR_INVALID_ARG;
+    }
+    return config_service_store_and_unlock(&next);
+}
+
+esp_err_t config_service_flush(void)
+{
+    if (!s_lock) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Hold the lock across the commit so a concurrent flush cannot write an older snapshot last.
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (!s_dirty) {
+        xSemaphoreGive(s_lock);
+        return ESP_OK;
+    }
+    timer_wheel_stop(&s_commit_timer);
+
+    esp_err_t err = device_config_save(&s_cfg);
+    if (err == ESP_OK) {
+        s_dirty = false;
+        s_stats.commits++;
+        if (s_pending_updates > 1) {
+            s_stats.coalesced += s_pending_updates - 1;
+        }
+        s_pending_updates = 0;
+        s_retry_us = 0;
+    } else {
+        // Still dirty: try again later rather than leave the change in RAM until the next update.
+        s_stats.commit_errors++;
+        s_retry_us = (s_retry_us == 0) ? COMMIT_DELAY_US : s_retry_us * 2;
+        if (s_retry_us > COMMIT_RETRY_MAX_US) {
+            s_retry_us = COMMIT_RETRY_MAX_US;
+        }
+        (void)timer_wheel_start_once(&s_commit_timer, (uint64_t)s_retry_us, COMMIT_SLACK_US);
+    }
+    config_service_stats_t stats = s_stats;
+    int64_t retry_us = s_retry_us;
+    xSemaphoreGive(s_lock);
+
+    if (err == ESP_OK) {
+        device_config_stats_t nvs_stats;
+        device_config_get_stats(&nvs_stats);
+        ESP_LOGI(TAG, "committed (updates=%u commits=%u coalesced=%u nvs_writes=%u nvs_skipped=%u)", (unsigned)stats.updates,
+                 (unsigned)stats.commits, (unsigned)stats.coalesced, (unsigned)nvs_stats.writes, (unsigned)nvs_stats.skipped);
+    } else {
+        ESP_LOGE(TAG, "commit failed: %s (errors=%u), retry in %lld ms", esp_err_to_name(err),
+                 (unsigned)stats.commit_errors, (long long)(retry_us / 1000));
+    }
+    return err;
+}
+
+bool config_service_is_dirty(void)
+{
+    if (!s_lock) {
+        return false;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    bool dirty = s_dirty;
+    xSemaphoreGive(s_lock);
+    return dirty;
+}
+
+void config_service_get_stats(config_service_stats_t *out_stats)
+{
+    if (!out_stats || !s_lock) {
+        return;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    *out_stats = s_stats;
+    xSemaphoreGive(s_lock);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "device_config.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Write-behind cache in front of device_config_save().
+// The service owns the authoritative in-RAM copy. Updates only mark it dirty and (re)arm a debounce
+// timer; the NVS commit happens CONFIG_LIGHT_ALARM_CFG_COMMIT_DELAY_MS after the last change, or earlier
+// via config_service_flush() (low battery, deep sleep, esp_restart()). A failed commit leaves the
+// config dirty and is retried with a backoff from the same delay up to a minute.
+
+typedef struct {
+    uint32_t updates;       // accepted config_service_update() calls
+    uint32_t commits;       // successful NVS commits
+    uint32_t commit_errors; // failed NVS commits (config stays dirty and is retried)
+    uint32_t coalesced;     // updates absorbed by a later commit instead of committing on their own
+} config_service_stats_t;
+
+// Loads the persisted config and starts the service. out_cfg receives the loaded config.
+esp_err_t config_service_init(device_config_t *out_cfg);
+
+// Copies the current in-RAM config.
+void config_service_get(device_config_t *out_cfg);
+
+// Replaces the in-RAM config and schedules a debounced commit.
+esp_err_t config_service_update(const device_config_t *cfg);
+
+// Edits the in-RAM config in place under the service lock, so edits from different tasks never
+// overwrite each other with stale copies. edit gets the current config and returns false to reject the
+// edit, which leaves the config untouched (ESP_ERR_INVALID_ARG). An accepted edit is committed like
+// config_service_update(). edit must not call back into the service.
+typedef bool (*config_service_edit_fn)(device_config_t *cfg, void *arg);
+esp_err_t config_service_edit(config_service_edit_fn edit, void *arg);
+
+// Commits immediately if dirty. Safe to call from any task.
+esp_err_t config_service_flush(void);
+
+bool config_service_is_dirty(void);
+
+void config_service_get_stats(config_service_stats_t *out_stats);
+
+#ifdef __cplusplus
+}
+#endif
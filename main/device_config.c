@@ -2,13 +2,27 @@
 
 #include <string.h>
 
+#include "civil_time.h"
+#include "config_schema.h"
+#include "storage_telemetry.h"
+
 #include "esp_log.h"
+#include "esp_rom_crc.h"
 #include "nvs.h"
 #include "nvs_flash.h"
 
 static const char *TAG = "CFG";
 
 static const char *NVS_NS = "cfg";
+
+// A/B journal: each save goes to the slot NOT holding the newest record, so a write torn by
+// power loss only ever damages the older copy. Load takes the valid record with the higher seq.
+static const char *const KEY_REC[2] = {"cfg_a", "cfg_b"};
+
+// Single-copy blob key used before the A/B journal. Only read during migration, then erased.
+static const char *KEY_BLOB = "cfg_blob";
+
+// Legacy (pre-blob) layout: one u8 key per field. Only read during migration, then erased.
 static const char *KEY_ALARM_H = "alarm_h";
 static const char *KEY_ALARM_M = "alarm_m";
 static const char *KEY_ALARM_E = "alarm_e";
@@ -16,63 +30,601 @@ static const char *KEY_COLOR_TEMP = "color_t";
 static const char *KEY_WAKE_BRIGHT = "wake_b";
 static const char *KEY_SUNRISE_DUR = "sunrise";
 
+// Config blob: fixed header followed by a little-endian payload.
+// Bump CFG_BLOB_VERSION whenever the payload layout changes and teach cfg_blob_decode()
+// how to upgrade the older payload.
+#define CFG_BLOB_MAGIC   (0x434Cu) // "LC"
+#define CFG_BLOB_VERSION (5)
+#define CFG_BLOB_HDR_LEN (8)
+#define CFG_BLOB_MAX_PAYLOAD (384)
+
+// Payload v1: alarm_hour, alarm_minute, alarm_enabled, color_temp, wake_bright, sunrise_duration.
+#define CFG_PAYLOAD_V1_LEN (6)
+
+// Payload v2: color_temp(u8) wake_bright(u8) used_slots(u16 bitmap) then one packed u32 per used slot,
+// in slot order. Packed alarm bits:
+//   [0..10]  minute of day (0..1439)
+//   [11]     enabled
+//   [12..18] weekdays
+//   [19..24] sunrise_duration (1..60)
+//   [25..31] wake_bright (0..100)
+#define CFG_PAYLOAD_V2_FIXED_LEN (4)
+#define CFG_ALARM_PACKED_LEN (4)
+_Static_assert(CFG_MAX_ALARM_WEEKDAYS < (1 << 7) && CFG_MAX_ALARM_SUNRISE < (1 << 6) && CFG_MAX_ALARM_WAKE_BRIGHT < (1 << 7),
+               "schema range no longer fits the packed alarm bits");
+
+// Payload v3: the v2 payload followed by used_presets(u8 bitmap) and, per used preset in slot order,
+// brightness, color_temp, curve, fade_ds, name_len, name[name_len].
+// From v3 on the header byte holding payload_len is reserved (0) and the payload runs to the end
+// of the blob, so the payload may exceed 255 bytes.
+#define CFG_PRESET_PACKED_HDR_LEN (5)
+
+// Payload v4: the v3 payload followed by tz_zone(u8). Older blobs decode to the default zone.
+
+// Payload v5: the v4 payload followed by
+//   dated_alarms(u16 bitmap) and, per dated alarm in slot order, date_year, date_month, date_day;
+//   skip_next(u16 bitmap);
+//   used_skips(u8 bitmap) and, per used skip entry in order, year, month, day, slots_lo, slots_hi.
+// Older blobs decode to weekly alarms and no skips.
+#define CFG_DATE_PACKED_LEN (3)
+#define CFG_SKIP_PACKED_LEN (5)
+
+typedef struct {
+    uint8_t bytes[CFG_BLOB_HDR_LEN + CFG_BLOB_MAX_PAYLOAD];
+    size_t len;
+} cfg_blob_t;
+_Static_assert(DEVICE_CONFIG_IMAGE_MAX_LEN == CFG_BLOB_HDR_LEN + CFG_BLOB_MAX_PAYLOAD, "config image is the config blob");
+
+// Journal record: seq(u32) crc32(u32, over seq + blob) followed by the config blob.
+#define CFG_REC_HDR_LEN (8)
+
+typedef struct {
+    uint8_t bytes[CFG_REC_HDR_LEN + CFG_BLOB_HDR_LEN + CFG_BLOB_MAX_PAYLOAD];
+    size_t len;
+} cfg_rec_t;
+
+// Last image known to be in NVS (loaded or written). Saves that would rewrite the same bytes are skipped.
+static cfg_blob_t s_persisted;
+static bool s_persisted_valid;
+static device_config_stats_t s_stats;
+
+// Record scratch buffer (load/save are serialized by the caller, see config_service); keeps the
+// journal I/O off the main task stack.
+static cfg_rec_t s_rec;
+
+// Journal head: slot holding the newest valid record and its sequence number.
+static int s_head_slot = -1; // -1: no valid record
+static uint32_t s_head_seq;
+
+static void cfg_note_persisted(const cfg_blob_t *blob)
+{
+    s_persisted = *blob;
+    s_persisted_valid = true;
+}
+
+static bool preset_valid(const device_preset_t *p)
+{
+    if (p->name[0] == 0) {
+        return true;
+    }
+    return config_schema_valid_preset(p) && (memchr(p->name, 0, sizeof(p->name)) != NULL);
+}
+
+// Year 0 means "no date" for both alarms and skip entries.
+static bool date_valid(uint8_t year, uint8_t month, uint8_t day)
+{
+    return year == 0 || day <= civil_days_in_month(2000 + (int32_t)year, month);
+}
+
+// Ranges come from the schema table (config_schema.h); only structural rules live here.
 static bool cfg_valid(const device_config_t *cfg)
 {
-    if (!cfg) {
+    if (!config_schema_valid_globals(cfg)) {
         return false;
     }
-        return (cfg->alarm_hour < 24) && (cfg->alarm_minute < 60) && (cfg->alarm_enabled <= 1) && (cfg->color_temp <= 100) &&
-            (cfg->wake_bright <= 100) && (cfg->sunrise_duration >= 1) && (cfg->sunrise_duration <= 60);
+    for (size_t i = 0; i < DEVICE_CONFIG_MAX_ALARMS; i++) {
+        const device_alarm_t *a = &cfg->alarms[i];
+        if (!config_schema_valid_alarm(a) || !date_valid(a->date_year, a->date_month, a->date_day)) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < DEVICE_CONFIG_MAX_PRESETS; i++) {
+        if (!preset_valid(&cfg->presets[i])) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < DEVICE_CONFIG_MAX_SKIPS; i++) {
+        const device_skip_t *k = &cfg->skips[i];
+        if (!config_schema_valid_skip(k) || !date_valid(k->year, k->month, k->day)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool device_config_is_valid(const device_config_t *cfg)
+{
+    return cfg && cfg_valid(cfg);
+}
+
+device_alarm_t device_config_alarm_default(void)
+{
+    device_alarm_t a;
+    memset(&a, 0, sizeof(a));
+    config_schema_defaults(CFG_SCOPE_ALARM, &a);
+    return a;
 }
 
 static device_config_t cfg_default(void)
 {
-    device_config_t cfg = {
-        .alarm_hour = DEVICE_CONFIG_DEFAULT_HOUR,
-        .alarm_minute = DEVICE_CONFIG_DEFAULT_MINUTE,
-        .alarm_enabled = DEVICE_CONFIG_DEFAULT_ENABLED,
-        .color_temp = DEVICE_CONFIG_DEFAULT_COLOR_TEMP,
-        .wake_bright = DEVICE_CONFIG_DEFAULT_WAKE_BRIGHT,
-        .sunrise_duration = DEVICE_CONFIG_DEFAULT_SUNRISE_DURATION_MINUTES,
+    device_config_t cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    config_schema_defaults(CFG_SCOPE_GLOBAL, &cfg);
+    for (size_t i = 0; i < DEVICE_CONFIG_MAX_ALARMS; i++) {
+        cfg.alarms[i] = device_config_alarm_default();
+    }
+    for (size_t i = 0; i < DEVICE_CONFIG_MAX_SKIPS; i++) {
+        config_schema_defaults(CFG_SCOPE_SKIP, &cfg.skips[i]);
+    }
+    // Slot 0: daily alarm, as the single-alarm firmware shipped.
+    cfg.alarms[0].weekdays = DEVICE_ALARM_WEEKDAYS_ALL;
+    cfg.alarms[0].enabled = 1;
+
+    static const device_preset_t default_presets[] = {
+        {.name = "reading", .brightness = 90, .color_temp = 35, .curve = DEVICE_PRESET_CURVE_LINEAR, .fade_ds = 5},
+        {.name = "night", .brightness = 5, .color_temp = 100, .curve = DEVICE_PRESET_CURVE_EASE_IN, .fade_ds = 20},
+        {.name = "relax", .brightness = 40, .color_temp = 80, .curve = DEVICE_PRESET_CURVE_EASE_OUT, .fade_ds = 15},
     };
+    memcpy(cfg.presets, default_presets, sizeof(default_presets));
     return cfg;
 }
 
-esp_err_t device_config_save(const device_config_t *cfg)
+// Maps the single-alarm fields of v1 blobs / legacy keys onto slot 0.
+static void cfg_from_single_alarm(device_config_t *cfg, uint8_t hour, uint8_t minute, uint8_t enabled, uint8_t color_temp,
+                                  uint8_t wake_bright, uint8_t sunrise_duration)
 {
-    if (!cfg_valid(cfg)) {
+    *cfg = cfg_default();
+    cfg->alarms[0].hour = hour;
+    cfg->alarms[0].minute = minute;
+    cfg->alarms[0].enabled = enabled;
+    cfg->alarms[0].sunrise_duration = sunrise_duration;
+    cfg->alarms[0].wake_bright = wake_bright;
+    cfg->color_temp = color_temp;
+    cfg->wake_bright = wake_bright;
+}
+
+static void put_u16_le(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)(v & 0xFF);
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32_le(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v & 0xFF);
+    p[1] = (uint8_t)((v >> 8) & 0xFF);
+    p[2] = (uint8_t)((v >> 16) & 0xFF);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint16_t get_u16_le(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32_le(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint32_t alarm_pack(const device_alarm_t *a)
+{
+    uint32_t minute_of_day = (uint32_t)a->hour * 60 + a->minute;
+    return minute_of_day | ((uint32_t)(a->enabled & 1) << 11) | ((uint32_t)(a->weekdays & 0x7F) << 12) |
+           ((uint32_t)(a->sunrise_duration & 0x3F) << 19) | ((uint32_t)(a->wake_bright & 0x7F) << 25);
+}
+
+static void alarm_unpack(uint32_t v, device_alarm_t *a)
+{
+    uint32_t minute_of_day = v & 0x7FF;
+    a->hour = (uint8_t)(minute_of_day / 60);
+    a->minute = (uint8_t)(minute_of_day % 60);
+    a->enabled = (uint8_t)((v >> 11) & 1);
+    a->weekdays = (uint8_t)((v >> 12) & 0x7F);
+    a->sunrise_duration = (uint8_t)((v >> 19) & 0x3F);
+    a->wake_bright = (uint8_t)((v >> 25) & 0x7F);
+}
+
+static size_t cfg_encode_presets(const device_config_t *cfg, uint8_t *out)
+{
+    uint8_t used = 0;
+    size_t len = 1;
+    for (size_t i = 0; i < DEVICE_CONFIG_MAX_PRESETS; i++) {
+        const device_preset_t *p = &cfg->presets[i];
+        if (p->name[0] == 0) {
+            continue;
+        }
+        used |= (uint8_t)(1u << i);
+        size_t name_len = strnlen(p->name, DEVICE_PRESET_NAME_MAX);
+        out[len + 0] = p->brightness;
+        out[len + 1] = p->color_temp;
+        out[len + 2] = p->curve;
+        out[len + 3] = p->fade_ds;
+        out[len + 4] = (uint8_t)name_len;
+        memcpy(&out[len + CFG_PRESET_PACKED_HDR_LEN], p->name, name_len);
+        len += CFG_PRESET_PACKED_HDR_LEN + name_len;
+    }
+    out[0] = used;
+    return len;
+}
+
+static esp_err_t cfg_decode_presets(const uint8_t *in, size_t len, device_config_t *cfg, size_t *out_used)
+{
+    if (len < 1) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    uint8_t used = in[0];
+    size_t off = 1;
+    for (size_t i = 0; i < DEVICE_CONFIG_MAX_PRESETS; i++) {
+        device_preset_t *p = &cfg->presets[i];
+        memset(p, 0, sizeof(*p));
+        if (!(used & (1u << i))) {
+            continue;
+        }
+        if (off + CFG_PRESET_PACKED_HDR_LEN > len) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        size_t name_len = in[off + 4];
+        if (name_len == 0 || name_len > DEVICE_PRESET_NAME_MAX || off + CFG_PRESET_PACKED_HDR_LEN + name_len > len) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        p->brightness = in[off + 0];
+        p->color_temp = in[off + 1];
+        p->curve = in[off + 2];
+        p->fade_ds = in[off + 3];
+        memcpy(p->name, &in[off + CFG_PRESET_PACKED_HDR_LEN], name_len);
+        off += CFG_PRESET_PACKED_HDR_LEN + name_len;
+    }
+    *out_used = off;
+    return ESP_OK;
+}
+
+static size_t cfg_encode_dates(const device_config_t *cfg, uint8_t *out)
+{
+    uint16_t dated = 0;
+    uint16_t skip_next = 0;
+    size_t len = 2;
+    for (size_t i = 0; i < DEVICE_CONFIG_MAX_ALARMS; i++) {
+        const device_alarm_t *a = &cfg->alarms[i];
+        if (a->weekdays == 0) {
+            continue;
+        }
+        if (a->skip_next) {
+            skip_next |= (uint16_t)(1u << i);
+        }
+        if (a->date_year == 0) {
+            continue;
+        }
+        dated |= (uint16_t)(1u << i);
+        out[len + 0] = a->date_year;
+        out[len + 1] = a->date_month;
+        out[len + 2] = a->date_day;
+        len += CFG_DATE_PACKED_LEN;
+    }
+    put_u16_le(&out[0], dated);
+    put_u16_le(&out[len], skip_next);
+    len += 2;
+
+    uint8_t used = 0;
+    size_t used_off = len++;
+    for (size_t i = 0; i < DEVICE_CONFIG_MAX_SKIPS; i++) {
+        const device_skip_t *k = &cfg->skips[i];
+        if (k->year == 0) {
+            continue;
+        }
+        used |= (uint8_t)(1u << i);
+        out[len + 0] = k->year;
+        out[len + 1] = k->month;
+        out[len + 2] = k->day;
+        out[len + 3] = k->slots_lo;
+        out[len + 4] = k->slots_hi;
+        len += CFG_SKIP_PACKED_LEN;
+    }
+    out[used_off] = used;
+    return len;
+}
+
+static esp_err_t cfg_decode_dates(const uint8_t *in, size_t len, device_config_t *cfg, size_t *out_used)
+{
+    if (len < 2) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    uint16_t dated = get_u16_le(&in[0]);
+    size_t off = 2;
+    for (size_t i = 0; i < DEVICE_CONFIG_MAX_ALARMS; i++) {
+        if (!(dated & (1u << i))) {
+            continue;
+        }
+        if (off + CFG_DATE_PACKED_LEN > len) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        cfg->alarms[i].date_year = in[off + 0];
+        cfg->alarms[i].date_month = in[off + 1];
+        cfg->alarms[i].date_day = in[off + 2];
+        off += CFG_DATE_PACKED_LEN;
+    }
+    if (off + 3 > len) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    uint16_t skip_next = get_u16_le(&in[off]);
+    for (size_t i = 0; i < DEVICE_CONFIG_MAX_ALARMS; i++) {
+        cfg->alarms[i].skip_next = (uint8_t)((skip_next >> i) & 1);
+    }
+    uint8_t used = in[off + 2];
+    off += 3;
+    for (size_t i = 0; i < DEVICE_CONFIG_MAX_SKIPS; i++) {
+        if (!(used & (1u << i))) {
+            continue;
+        }
+        if (off + CFG_SKIP_PACKED_LEN > len) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        device_skip_t *k = &cfg->skips[i];
+        k->year = in[off + 0];
+        k->month = in[off + 1];
+        k->day = in[off + 2];
+        k->slots_lo = in[off + 3];
+        k->slots_hi = in[off + 4];
+        off += CFG_SKIP_PACKED_LEN;
+    }
+    *out_used = off;
+    return ESP_OK;
+}
+
+// Header: magic(u16) version(u8) payload_len(u8, reserved from v3) crc32(u32, over payload only).
+static void cfg_blob_encode(const device_config_t *cfg, cfg_blob_t *out)
+{
+    uint8_t *payload = &out->bytes[CFG_BLOB_HDR_LEN];
+    payload[0] = cfg->color_temp;
+    payload[1] = cfg->wake_bright;
+    uint16_t used = 0;
+    size_t payload_len = CFG_PAYLOAD_V2_FIXED_LEN;
+    for (size_t i = 0; i < DEVICE_CONFIG_MAX_ALARMS; i++) {
+        // Unused slots are implied by the bitmap and decode to device_config_alarm_default().
+        if (cfg->alarms[i].weekdays == 0) {
+            continue;
+        }
+        used |= (uint16_t)(1u << i);
+        put_u32_le(&payload[payload_len], alarm_pack(&cfg->alarms[i]));
+        payload_len += CFG_ALARM_PACKED_LEN;
+    }
+    put_u16_le(&payload[2], used);
+    payload_len += cfg_encode_presets(cfg, &payload[payload_len]);
+    payload[payload_len++] = cfg->tz_zone;
+    payload_len += cfg_encode_dates(cfg, &payload[payload_len]);
+
+    put_u16_le(&out->bytes[0], CFG_BLOB_MAGIC);
+    out->bytes[2] = CFG_BLOB_VERSION;
+    out->bytes[3] = 0;
+    put_u32_le(&out->bytes[4], esp_rom_crc32_le(0, payload, (uint32_t)payload_len));
+    out->len = CFG_BLOB_HDR_LEN + payload_len;
+}
+
+static esp_err_t cfg_blob_decode(const uint8_t *blob, size_t len, device_config_t *out_cfg)
+{
+    if (len < CFG_BLOB_HDR_LEN || get_u16_le(&blob[0]) != CFG_BLOB_MAGIC) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    uint8_t version = blob[2];
+    size_t payload_len = len - CFG_BLOB_HDR_LEN;
+    const uint8_t *payload = &blob[CFG_BLOB_HDR_LEN];
+    if (version < 3 && blob[3] != payload_len) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (esp_rom_crc32_le(0, payload, (uint32_t)payload_len) != get_u32_le(&blob[4])) {
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    device_config_t cfg = cfg_default();
+    size_t off = 0; // payload bytes the layout accounts for
+    switch (version) {
+    case 1:
+        if (payload_len < CFG_PAYLOAD_V1_LEN) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        cfg_from_single_alarm(&cfg, payload[0], payload[1], payload[2], payload[3], payload[4], payload[5]);
+        off = CFG_PAYLOAD_V1_LEN;
+        break;
+    case 2:
+    case 3:
+    case 4:
+    case 5: {
+        if (payload_len < CFG_PAYLOAD_V2_FIXED_LEN) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        cfg.color_temp = payload[0];
+        cfg.wake_bright = payload[1];
+        uint16_t used = get_u16_le(&payload[2]);
+        off = CFG_PAYLOAD_V2_FIXED_LEN;
+        for (size_t i = 0; i < DEVICE_CONFIG_MAX_ALARMS; i++) {
+            cfg.alarms[i] = device_config_alarm_default();
+            if (!(used & (1u << i))) {
+                continue;
+            }
+            if (off + CFG_ALARM_PACKED_LEN > payload_len) {
+                return ESP_ERR_INVALID_SIZE;
+            }
+            alarm_unpack(get_u32_le(&payload[off]), &cfg.alarms[i]);
+            off += CFG_ALARM_PACKED_LEN;
+        }
+        if (version >= 3) {
+            size_t used_len = 0;
+            esp_err_t err = cfg_decode_presets(&payload[off], payload_len - off, &cfg, &used_len);
+            if (err != ESP_OK) {
+                return err;
+            }
+            off += used_len;
+        }
+        if (version >= 4) {
+            if (off + 1 > payload_len) {
+                return ESP_ERR_INVALID_SIZE;
+            }
+            cfg.tz_zone = payload[off];
+            off += 1;
+        }
+        if (version >= 5) {
+            size_t used_len = 0;
+            esp_err_t err = cfg_decode_dates(&payload[off], payload_len - off, &cfg, &used_len);
+            if (err != ESP_OK) {
+                return err;
+            }
+            off += used_len;
+        }
+        break;
+    }
+    default:
+        return ESP_ERR_INVALID_VERSION;
+    }
+    // Every layout has one exact length for its content; anything past it is not a blob we wrote.
+    if (off != payload_len) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    if (!cfg_valid(&cfg)) {
         return ESP_ERR_INVALID_ARG;
     }
+    *out_cfg = cfg;
+    return ESP_OK;
+}
 
-    nvs_handle_t handle;
-    esp_err_t err = nvs_open(NVS_NS, NVS_READWRITE, &handle);
+// Reads the pre-blob per-field keys. Returns ESP_ERR_NVS_NOT_FOUND if the alarm time is missing.
+static esp_err_t cfg_load_legacy(nvs_handle_t handle, device_config_t *out_cfg)
+{
+    device_config_t cfg = cfg_default();
+
+    uint8_t h = 0, m = 0;
+    uint8_t en = cfg.alarms[0].enabled;
+    uint8_t ct = cfg.color_temp;
+    uint8_t wb = cfg.wake_bright;
+    uint8_t sd = cfg.alarms[0].sunrise_duration;
+    esp_err_t eh = nvs_get_u8(handle, KEY_ALARM_H, &h);
+    esp_err_t em = nvs_get_u8(handle, KEY_ALARM_M, &m);
+    if (eh != ESP_OK || em != ESP_OK) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    (void)nvs_get_u8(handle, KEY_ALARM_E, &en);
+    (void)nvs_get_u8(handle, KEY_COLOR_TEMP, &ct);
+    (void)nvs_get_u8(handle, KEY_WAKE_BRIGHT, &wb);
+    (void)nvs_get_u8(handle, KEY_SUNRISE_DUR, &sd);
+
+    cfg_from_single_alarm(&cfg, h, m, en, ct, wb, sd);
+    if (!cfg_valid(&cfg)) {
+        ESP_LOGW(TAG, "Invalid legacy cfg in NVS (%u:%u en=%u ct=%u wb=%u sd=%u)", h, m, (unsigned)en, (unsigned)ct,
+                 (unsigned)wb, (unsigned)sd);
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out_cfg = cfg;
+    return ESP_OK;
+}
+
+static void cfg_rec_encode(uint32_t seq, const cfg_blob_t *blob, cfg_rec_t *out)
+{
+    put_u32_le(&out->bytes[0], seq);
+    memcpy(&out->bytes[CFG_REC_HDR_LEN], blob->bytes, blob->len);
+    uint32_t crc = esp_rom_crc32_le(0, &out->bytes[0], 4);
+    crc = esp_rom_crc32_le(crc, &out->bytes[CFG_REC_HDR_LEN], (uint32_t)blob->len);
+    put_u32_le(&out->bytes[4], crc);
+    out->len = CFG_REC_HDR_LEN + blob->len;
+}
+
+// Reads and checks one journal slot. The record CRC catches torn writes before the blob is parsed.
+static esp_err_t cfg_rec_read(nvs_handle_t handle, int slot, uint32_t *out_seq, cfg_blob_t *out_blob,
+                              device_config_t *out_cfg)
+{
+    cfg_rec_t *rec = &s_rec;
+    rec->len = sizeof(rec->bytes);
+    esp_err_t err = nvs_get_blob(handle, KEY_REC[slot], rec->bytes, &rec->len);
     if (err != ESP_OK) {
         return err;
     }
-
-    err = nvs_set_u8(handle, KEY_ALARM_H, cfg->alarm_hour);
-    if (err == ESP_OK) {
-        err = nvs_set_u8(handle, KEY_ALARM_M, cfg->alarm_minute);
+    if (rec->len < CFG_REC_HDR_LEN + CFG_BLOB_HDR_LEN) {
+        return ESP_ERR_INVALID_SIZE;
     }
-    if (err == ESP_OK) {
-        err = nvs_set_u8(handle, KEY_ALARM_E, cfg->alarm_enabled);
+    uint32_t crc = esp_rom_crc32_le(0, &rec->bytes[0], 4);
+    crc = esp_rom_crc32_le(crc, &rec->bytes[CFG_REC_HDR_LEN], (uint32_t)(rec->len - CFG_REC_HDR_LEN));
+    if (crc != get_u32_le(&rec->bytes[4])) {
+        return ESP_ERR_INVALID_CRC;
     }
+    out_blob->len = rec->len - CFG_REC_HDR_LEN;
+    memcpy(out_blob->bytes, &rec->bytes[CFG_REC_HDR_LEN], out_blob->len);
+    err = cfg_blob_decode(out_blob->bytes, out_blob->len, out_cfg);
     if (err == ESP_OK) {
-        err = nvs_set_u8(handle, KEY_COLOR_TEMP, cfg->color_temp);
+        *out_seq = get_u32_le(&rec->bytes[0]);
     }
-    if (err == ESP_OK) {
-        err = nvs_set_u8(handle, KEY_WAKE_BRIGHT, cfg->wake_bright);
+    return err;
+}
+
+// Writes the next journal record into the older slot and drops any pre-journal keys in the same commit.
+static esp_err_t cfg_write_blob(const device_config_t *cfg, bool erase_legacy)
+{
+    cfg_blob_t blob;
+    cfg_blob_encode(cfg, &blob);
+
+    if (!erase_legacy && s_persisted_valid && blob.len == s_persisted.len && memcmp(blob.bytes, s_persisted.bytes, blob.len) == 0) {
+        s_stats.skipped++;
+        return ESP_OK;
     }
-    if (err == ESP_OK) {
-        err = nvs_set_u8(handle, KEY_SUNRISE_DUR, cfg->sunrise_duration);
+
+    int slot = (s_head_slot == 0) ? 1 : 0;
+    uint32_t seq = (s_head_slot < 0) ? 1 : s_head_seq + 1;
+    cfg_rec_encode(seq, &blob, &s_rec);
+
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(NVS_NS, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    err = nvs_set_blob(handle, KEY_REC[slot], s_rec.bytes, s_rec.len);
+    if (err == ESP_OK && erase_legacy) {
+        // KEY_ALARM_H and KEY_BLOB go last: while either is left, load knows to finish the job.
+        const char *const legacy_keys[] = {
+            KEY_SUNRISE_DUR, KEY_WAKE_BRIGHT, KEY_COLOR_TEMP, KEY_ALARM_E, KEY_ALARM_M, KEY_ALARM_H, KEY_BLOB,
+        };
+        for (size_t i = 0; i < sizeof(legacy_keys) / sizeof(legacy_keys[0]); i++) {
+            esp_err_t e = nvs_erase_key(handle, legacy_keys[i]);
+            if (e != ESP_OK && e != ESP_ERR_NVS_NOT_FOUND) {
+                ESP_LOGW(TAG, "erase legacy key %s failed: %s", legacy_keys[i], esp_err_to_name(e));
+            }
+        }
     }
     if (err == ESP_OK) {
         err = nvs_commit(handle);
     }
     nvs_close(handle);
+
+    if (err == ESP_OK) {
+        cfg_note_persisted(&blob);
+        s_head_slot = slot;
+        s_head_seq = seq;
+        s_stats.writes++;
+        storage_telemetry_note_commit(NVS_NS, s_rec.len);
+    } else {
+        // Unknown what reached flash; force the next save through. The head record is untouched,
+        // so the next attempt targets the same (older) slot again.
+        s_persisted_valid = false;
+    }
     return err;
 }
 
+esp_err_t device_config_save(const device_config_t *cfg)
+{
+    if (!cfg_valid(cfg)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return cfg_write_blob(cfg, false);
+}
+
 esp_err_t device_config_load(device_config_t *out_cfg)
 {
     if (!out_cfg) {
@@ -80,59 +632,129 @@ esp_err_t device_config_load(device_config_t *out_cfg)
     }
 
     device_config_t cfg = cfg_default();
+    s_head_slot = -1;
+    s_head_seq = 0;
+    // Whatever was written before, NVS is the reference from here on.
+    s_persisted_valid = false;
 
     nvs_handle_t handle;
     esp_err_t err = nvs_open(NVS_NS, NVS_READONLY, &handle);
     if (err == ESP_ERR_NVS_NOT_FOUND) {
         *out_cfg = cfg;
-        ESP_LOGW(TAG, "NVS namespace missing; saving defaults %02u%02u", cfg.alarm_hour, cfg.alarm_minute);
+        ESP_LOGW(TAG, "NVS namespace missing; saving defaults %02u%02u", cfg.alarms[0].hour, cfg.alarms[0].minute);
         return device_config_save(&cfg);
     }
     if (err != ESP_OK) {
         return err;
     }
 
-    uint8_t h = 0, m = 0;
-    uint8_t en = cfg.alarm_enabled;
-    uint8_t ct = cfg.color_temp;
-    uint8_t wb = cfg.wake_bright;
-    uint8_t sd = cfg.sunrise_duration;
-    esp_err_t eh = nvs_get_u8(handle, KEY_ALARM_H, &h);
-    esp_err_t em = nvs_get_u8(handle, KEY_ALARM_M, &m);
-    esp_err_t een = nvs_get_u8(handle, KEY_ALARM_E, &en);
-    esp_err_t ect = nvs_get_u8(handle, KEY_COLOR_TEMP, &ct);
-    esp_err_t ewb = nvs_get_u8(handle, KEY_WAKE_BRIGHT, &wb);
-    esp_err_t esd = nvs_get_u8(handle, KEY_SUNRISE_DUR, &sd);
-    nvs_close(handle);
-
-    if (eh == ESP_OK && em == ESP_OK) {
-        cfg.alarm_hour = h;
-        cfg.alarm_minute = m;
-        if (een == ESP_OK) {
-            cfg.alarm_enabled = en;
+    // Single pass over both journal slots; keep the valid record with the newest seq.
+    cfg_blob_t head_blob;
+    for (int slot = 0; slot < 2; slot++) {
+        uint32_t seq = 0;
+        cfg_blob_t blob;
+        device_config_t rec_cfg;
+        esp_err_t e = cfg_rec_read(handle, slot, &seq, &blob, &rec_cfg);
+        if (e != ESP_OK) {
+            if (e != ESP_ERR_NVS_NOT_FOUND) {
+                ESP_LOGW(TAG, "cfg record %s invalid (%s); ignoring", KEY_REC[slot], esp_err_to_name(e));
+            }
+            continue;
         }
-        if (ect == ESP_OK) {
-            cfg.color_temp = ct;
+        // Wrap-safe "newer than".
+        if (s_head_slot < 0 || (int32_t)(seq - s_head_seq) > 0) {
+            s_head_slot = slot;
+            s_head_seq = seq;
+            head_blob = blob;
+            cfg = rec_cfg;
         }
-        if (ewb == ESP_OK) {
-            cfg.wake_bright = wb;
+    }
+
+    if (s_head_slot >= 0) {
+        // A migration cut off between its journal write and the erase leaves the old keys behind.
+        size_t blob_len = 0;
+        uint8_t legacy_h = 0;
+        bool leftovers = nvs_get_blob(handle, KEY_BLOB, NULL, &blob_len) == ESP_OK ||
+                         nvs_get_u8(handle, KEY_ALARM_H, &legacy_h) == ESP_OK;
+        nvs_close(handle);
+        *out_cfg = cfg;
+        if (leftovers) {
+            ESP_LOGI(TAG, "Dropping pre-journal cfg keys");
+            return cfg_write_blob(&cfg, true);
         }
-        if (esd == ESP_OK) {
-            cfg.sunrise_duration = sd;
+        if (head_blob.bytes[2] != CFG_BLOB_VERSION) {
+            ESP_LOGI(TAG, "Upgrading cfg blob v%u -> v%u", (unsigned)head_blob.bytes[2], (unsigned)CFG_BLOB_VERSION);
+            return cfg_write_blob(&cfg, false);
         }
-        if (cfg_valid(&cfg)) {
+        cfg_note_persisted(&head_blob);
+        ESP_LOGI(TAG, "cfg loaded from %s (seq=%lu)", KEY_REC[s_head_slot], (unsigned long)s_head_seq);
+        return ESP_OK;
+    }
+
+    // No valid journal record (first boot, or the very first journal write was torn): migrate the
+    // single-copy blob, or the per-field keys before that. Both are erased only once a record is in.
+    cfg_blob_t blob;
+    blob.len = sizeof(blob.bytes);
+    err = nvs_get_blob(handle, KEY_BLOB, blob.bytes, &blob.len);
+    if (err == ESP_OK) {
+        nvs_close(handle);
+        err = cfg_blob_decode(blob.bytes, blob.len, &cfg);
+        if (err == ESP_OK) {
+            ESP_LOGI(TAG, "Migrating cfg blob v%u to journal", (unsigned)blob.bytes[2]);
             *out_cfg = cfg;
-            return ESP_OK;
+            return cfg_write_blob(&cfg, true);
+        }
+        ESP_LOGW(TAG, "Invalid cfg blob in NVS (%s, len=%u); reset to defaults", esp_err_to_name(err), (unsigned)blob.len);
+    } else if (err == ESP_ERR_NVS_NOT_FOUND) {
+        // First boot after upgrade: migrate the per-field keys into the journal.
+        err = cfg_load_legacy(handle, &cfg);
+        nvs_close(handle);
+        if (err == ESP_OK) {
+            ESP_LOGI(TAG, "Migrating legacy cfg keys to blob v%u", (unsigned)CFG_BLOB_VERSION);
+            *out_cfg = cfg;
+            return cfg_write_blob(&cfg, true);
         }
-        ESP_LOGW(TAG, "Invalid cfg in NVS (%u:%u en=%u ct=%u wb=%u sd=%u); reset to defaults", h, m, (unsigned)en, (unsigned)ct,
-                 (unsigned)wb, (unsigned)sd);
-    } else {
         ESP_LOGW(TAG, "Cfg missing in NVS; reset to defaults");
+    } else {
+        nvs_close(handle);
+        ESP_LOGW(TAG, "Cfg blob read failed (%s); reset to defaults", esp_err_to_name(err));
     }
 
     cfg = cfg_default();
     *out_cfg = cfg;
-    return device_config_save(&cfg);
+    return cfg_write_blob(&cfg, true);
+}
+
+void device_config_get_stats(device_config_stats_t *out_stats)
+{
+    if (out_stats) {
+        *out_stats = s_stats;
+    }
+}
+
+size_t device_config_export_image(const device_config_t *cfg, uint8_t *out, size_t cap)
+{
+    if (!cfg || !out) {
+        return 0;
+    }
+    cfg_blob_t blob;
+    cfg_blob_encode(cfg, &blob);
+    if (blob.len > cap) {
+        return 0;
+    }
+    memcpy(out, blob.bytes, blob.len);
+    return blob.len;
+}
+
+esp_err_t device_config_import_image(const uint8_t *data, size_t len, device_config_t *out_cfg)
+{
+    if (!data || !out_cfg) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (len > DEVICE_CONFIG_IMAGE_MAX_LEN) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return cfg_blob_decode(data, len, out_cfg);
 }
 
 bool device_config_parse_hhmm_ascii(const uint8_t *data, size_t len, device_config_t *out_cfg)
@@ -151,13 +773,13 @@ bool device_config_parse_hhmm_ascii(const uint8_t *data, size_t len, device_conf
     uint8_t mm = (uint8_t)((data[2] - '0') * 10 + (data[3] - '0'));
 
     // Only validate HH:MM here; other fields are not part of this payload.
-    if (!(hh < 24 && mm < 60)) {
+    if (!CFG_IN_RANGE(ALARM_HOUR, hh) || !CFG_IN_RANGE(ALARM_MINUTE, mm)) {
         return false;
     }
 
     // Keep API backward-compatible: caller can merge these two fields.
-    out_cfg->alarm_hour = hh;
-    out_cfg->alarm_minute = mm;
+    out_cfg->alarms[0].hour = hh;
+    out_cfg->alarms[0].minute = mm;
     return true;
 }
 
@@ -166,10 +788,11 @@ void device_config_format_hhmm_ascii(const device_config_t *cfg, uint8_t out4[4]
     if (!cfg || !out4) {
         return;
     }
-    out4[0] = (uint8_t)('0' + (cfg->alarm_hour / 10));
-    out4[1] = (uint8_t)('0' + (cfg->alarm_hour % 10));
-    out4[2] = (uint8_t)('0' + (cfg->alarm_minute / 10));
-    out4[3] = (uint8_t)('0' + (cfg->alarm_minute % 10));
+    const device_alarm_t *a = &cfg->alarms[0];
+    out4[0] = (uint8_t)('0' + (a->hour / 10));
+    out4[1] = (uint8_t)('0' + (a->hour % 10));
+    out4[2] = (uint8_t)('0' + (a->minute / 10));
+    out4[3] = (uint8_t)('0' + (a->minute % 10));
 }
 
 bool device_config_parse_hhmme_ascii(const uint8_t *data, size_t len, device_config_t *out_cfg)
@@ -191,13 +814,13 @@ bool device_config_parse_hhmme_ascii(const uint8_t *data, size_t len, device_con
 
     uint8_t hh = (uint8_t)((data[0] - '0') * 10 + (data[1] - '0'));
     uint8_t mm = (uint8_t)((data[2] - '0') * 10 + (data[3] - '0'));
-    if (hh >= 24 || mm >= 60) {
+    if (!CFG_IN_RANGE(ALARM_HOUR, hh) || !CFG_IN_RANGE(ALARM_MINUTE, mm)) {
         return false;
     }
 
-    out_cfg->alarm_hour = hh;
-    out_cfg->alarm_minute = mm;
-    out_cfg->alarm_enabled = (uint8_t)(data[4] == '1');
+    out_cfg->alarms[0].hour = hh;
+    out_cfg->alarms[0].minute = mm;
+    out_cfg->alarms[0].enabled = (uint8_t)(data[4] == '1');
     return true;
 }
 
@@ -206,9 +829,96 @@ void device_config_format_hhmme_ascii(const device_config_t *cfg, uint8_t out5[5
     if (!cfg || !out5) {
         return;
     }
-    out5[0] = (uint8_t)('0' + (cfg->alarm_hour / 10));
-    out5[1] = (uint8_t)('0' + (cfg->alarm_hour % 10));
-    out5[2] = (uint8_t)('0' + (cfg->alarm_minute / 10));
-    out5[3] = (uint8_t)('0' + (cfg->alarm_minute % 10));
-    out5[4] = (uint8_t)(cfg->alarm_enabled ? '1' : '0');
+    const device_alarm_t *a = &cfg->alarms[0];
+    out5[0] = (uint8_t)('0' + (a->hour / 10));
+    out5[1] = (uint8_t)('0' + (a->hour % 10));
+    out5[2] = (uint8_t)('0' + (a->minute / 10));
+    out5[3] = (uint8_t)('0' + (a->minute % 10));
+    out5[4] = (uint8_t)((a->enabled && a->weekdays) ? '1' : '0');
+}
+
+bool device_config_parse_alarm_record(const uint8_t *data, size_t len, uint8_t *out_slot, device_alarm_t *out_alarm)
+{
+    if (!data || !out_slot || !out_alarm || len != DEVICE_ALARM_RECORD_LEN) {
+        return false;
+    }
+    if (data[0] >= DEVICE_CONFIG_MAX_ALARMS) {
+        return false;
+    }
+
+    // A record replaces the whole slot: a dated or skip-next alarm becomes a plain weekly one.
+    device_alarm_t a = device_config_alarm_default();
+    if (data[3] != 0) {
+        a.hour = data[1];
+        a.minute = data[2];
+        a.weekdays = data[3];
+        a.enabled = data[4];
+        a.sunrise_duration = data[5];
+        a.wake_bright = data[6];
+        if (!config_schema_valid_alarm(&a)) {
+            return false;
+        }
+    }
+
+    *out_slot = data[0];
+    *out_alarm = a;
+    return true;
+}
+
+bool device_config_parse_preset_record(const uint8_t *data, size_t len, uint8_t *out_slot, device_preset_t *out_preset)
+{
+    if (!data || !out_slot || !out_preset || len < DEVICE_PRESET_RECORD_HDR_LEN) {
+        return false;
+    }
+    size_t name_len = data[5];
+    if (data[0] >= DEVICE_CONFIG_MAX_PRESETS || name_len > DEVICE_PRESET_NAME_MAX || len != DEVICE_PRESET_RECORD_HDR_LEN + name_len) {
+        return false;
+    }
+
+    device_preset_t p;
+    memset(&p, 0, sizeof(p));
+    if (name_len > 0) {
+        p.brightness = data[1];
+        p.color_temp = data[2];
+        p.curve = data[3];
+        p.fade_ds = data[4];
+        memcpy(p.name, &data[DEVICE_PRESET_RECORD_HDR_LEN], name_len);
+        if (memchr(p.name, 0, name_len) != NULL || !preset_valid(&p)) {
+            return false;
+        }
+    }
+
+    *out_slot = data[0];
+    *out_preset = p;
+    return true;
+}
+
+size_t device_config_format_preset_record(uint8_t slot, const device_preset_t *preset, uint8_t *out)
+{
+    if (!preset || !out) {
+        return 0;
+    }
+    size_t name_len = strnlen(preset->name, DEVICE_PRESET_NAME_MAX);
+    out[0] = slot;
+    out[1] = preset->brightness;
+    out[2] = preset->color_temp;
+    out[3] = preset->curve;
+    out[4] = preset->fade_ds;
+    out[5] = (uint8_t)name_len;
+    memcpy(&out[DEVICE_PRESET_RECORD_HDR_LEN], preset->name, name_len);
+    return DEVICE_PRESET_RECORD_HDR_LEN + name_len;
+}
+
+void device_config_format_alarm_record(uint8_t slot, const device_alarm_t *alarm, uint8_t out[DEVICE_ALARM_RECORD_LEN])
+{
+    if (!alarm || !out) {
+        return;
+    }
+    out[0] = slot;
+    out[1] = alarm->hour;
+    out[2] = alarm->minute;
+    out[3] = alarm->weekdays;
+    out[4] = alarm->enabled;
+    out[5] = alarm->sunrise_duration;
+    out[6] = alarm->wake_bright;
 }
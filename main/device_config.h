@@ -10,25 +10,98 @@
 extern "C" {
 #endif
 
+#define DEVICE_CONFIG_MAX_ALARMS (16)
+
+// Weekday bits follow struct tm::tm_wday: bit0=Sunday .. bit6=Saturday.
+#define DEVICE_ALARM_WEEKDAYS_ALL (0x7F)
+
+typedef struct {
+    uint8_t hour;             // 0-23
+    uint8_t minute;           // 0-59
+    uint8_t weekdays;         // DEVICE_ALARM_WEEKDAYS_* mask; 0 = slot unused
+    uint8_t enabled;          // 0/1
+    uint8_t sunrise_duration; // 1-60 minutes (sunrise simulation before the alarm time)
+    uint8_t wake_bright;      // 0-100 (peak brightness of this alarm's sunrise)
+    // One-shot: rings once, on date_year/month/day (local), then disables itself. weekdays must still
+    // be non-zero (slot in use) but is ignored. date_year 0 = weekly alarm.
+    uint8_t date_year;        // 0 or 1-99 (2001-2099)
+    uint8_t date_month;       // 1-12
+    uint8_t date_day;         // 1-31 (checked against the month)
+    uint8_t skip_next;        // 0/1: the next occurrence is skipped, then this clears
+} device_alarm_t;
+
+#define DEVICE_CONFIG_MAX_SKIPS (8)
+#define DEVICE_SKIP_SLOTS_ALL (0xFFFF)
+
+// Skip date ("holiday"): alarms of the given slots do not ring on that local date. An alarm belongs
+// to the date its alarm time falls on, not its sunrise start.
+typedef struct {
+    uint8_t year;     // 0 = entry unused, 1-99 (2001-2099)
+    uint8_t month;    // 1-12
+    uint8_t day;      // 1-31 (checked against the month)
+    uint8_t slots_lo; // alarm slot bitmap (slots 0-7); both halves 0xFF = every alarm
+    uint8_t slots_hi; // slots 8-15
+} device_skip_t;
+
+#define DEVICE_CONFIG_MAX_PRESETS (8)
+#define DEVICE_PRESET_NAME_MAX (11)
+
+typedef enum {
+    DEVICE_PRESET_CURVE_LINEAR = 0,
+    DEVICE_PRESET_CURVE_EASE_IN,  // slow start (perceptually gentle fade-in)
+    DEVICE_PRESET_CURVE_EASE_OUT, // fast start, soft landing
+    DEVICE_PRESET_CURVE_COUNT,
+} device_preset_curve_t;
+
+// Named manual-light scene ("reading", "night", ...).
 typedef struct {
-    uint8_t alarm_hour;   // 0-23
-    uint8_t alarm_minute; // 0-59
-    uint8_t alarm_enabled; // 0/1
+    char name[DEVICE_PRESET_NAME_MAX + 1]; // NUL-terminated; empty = slot unused
+    uint8_t brightness;                    // 0-100
+    uint8_t color_temp;                    // 0-100 (0=cool, 100=warm)
+    uint8_t curve;                         // device_preset_curve_t
+    uint8_t fade_ds;                       // fade-in time in 100 ms units
+} device_preset_t;
+
+typedef struct {
+    // Slot 0 is the legacy single alarm exposed through 0xFF11/0xFF16.
+    device_alarm_t alarms[DEVICE_CONFIG_MAX_ALARMS];
+    device_preset_t presets[DEVICE_CONFIG_MAX_PRESETS];
+    device_skip_t skips[DEVICE_CONFIG_MAX_SKIPS];
     uint8_t color_temp;   // 0-100 (0=cool, 100=warm)
-    uint8_t wake_bright;  // 0-100 (max brightness target for alarm gradient)
-    uint8_t sunrise_duration; // 1-60 minutes (sunrise simulation duration)
+    uint8_t wake_bright;  // 0-100 (manual light brightness; 0xFF15 also sets alarm slot 0 peak)
+    uint8_t tz_zone;      // tz_zone_t; alarm times are local wall-clock times in this zone
 } device_config_t;
 
-#define DEVICE_CONFIG_DEFAULT_HOUR   (7)
-#define DEVICE_CONFIG_DEFAULT_MINUTE (0)
-#define DEVICE_CONFIG_DEFAULT_ENABLED (1)
-#define DEVICE_CONFIG_DEFAULT_COLOR_TEMP  (50)
-#define DEVICE_CONFIG_DEFAULT_WAKE_BRIGHT (100)
-#define DEVICE_CONFIG_DEFAULT_SUNRISE_DURATION_MINUTES (30)
+// Field ranges and defaults live in config_schema.h.
+
+typedef struct {
+    uint32_t writes;  // blob writes that reached nvs_commit
+    uint32_t skipped; // saves skipped because the persisted image already matched
+} device_config_stats_t;
+
+// Unused slot: schema defaults (no weekdays, disabled).
+device_alarm_t device_config_alarm_default(void);
 
+// Picks the newest valid copy of the A/B journal, so a save torn by power loss falls back to the
+// previous config instead of defaults.
 esp_err_t device_config_load(device_config_t *out_cfg);
+// Schema ranges plus the structural rules (real calendar dates, NUL-terminated names). Used to
+// check a whole config after a multi-field edit such as a 0xFF19 write.
+bool device_config_is_valid(const device_config_t *cfg);
+// No-op (and no flash access) when cfg matches the last persisted image. Otherwise overwrites the
+// older journal copy only. Not thread-safe; callers serialize (see config_service).
 esp_err_t device_config_save(const device_config_t *cfg);
+void device_config_get_stats(device_config_stats_t *out_stats);
+
+// Config image for backup/restore and fleet provisioning (0xFF1A, tools/cfgimage.py): the same
+// versioned, CRC-protected blob the journal stores, covering light settings, all alarms, presets and skip dates.
+#define DEVICE_CONFIG_IMAGE_MAX_LEN (8 + 384)
+// Returns the image length, or 0 if cap is too small.
+size_t device_config_export_image(const device_config_t *cfg, uint8_t *out, size_t cap);
+// Decodes and validates a whole image (older versions are upgraded); out_cfg is untouched on error.
+esp_err_t device_config_import_image(const uint8_t *data, size_t len, device_config_t *out_cfg);
 
+// HHMM / HHMME operate on alarm slot 0.
 bool device_config_parse_hhmm_ascii(const uint8_t *data, size_t len, device_config_t *out_cfg);
 void device_config_format_hhmm_ascii(const device_config_t *cfg, uint8_t out4[4]);
 
@@ -36,6 +109,20 @@ void device_config_format_hhmm_ascii(const device_config_t *cfg, uint8_t out4[4]
 bool device_config_parse_hhmme_ascii(const uint8_t *data, size_t len, device_config_t *out_cfg);
 void device_config_format_hhmme_ascii(const device_config_t *cfg, uint8_t out5[5]);
 
+// Alarm table record (0xFF17): slot, hour, minute, weekdays, enabled, sunrise_duration, wake_bright.
+#define DEVICE_ALARM_RECORD_LEN (7)
+// weekdays == 0 clears the slot.
+bool device_config_parse_alarm_record(const uint8_t *data, size_t len, uint8_t *out_slot, device_alarm_t *out_alarm);
+void device_config_format_alarm_record(uint8_t slot, const device_alarm_t *alarm, uint8_t out[DEVICE_ALARM_RECORD_LEN]);
+
+// Preset record (0xFF18): slot, brightness, color_temp, curve, fade_ds, name_len, name[name_len].
+// name_len == 0 clears the slot.
+#define DEVICE_PRESET_RECORD_HDR_LEN (6)
+#define DEVICE_PRESET_RECORD_MAX_LEN (DEVICE_PRESET_RECORD_HDR_LEN + DEVICE_PRESET_NAME_MAX)
+bool device_config_parse_preset_record(const uint8_t *data, size_t len, uint8_t *out_slot, device_preset_t *out_preset);
+// Returns bytes written (<= DEVICE_PRESET_RECORD_MAX_LEN).
+size_t device_config_format_preset_record(uint8_t slot, const device_preset_t *preset, uint8_t *out);
+
 #ifdef __cplusplus
 }
 #endif
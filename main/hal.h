@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Board hardware seam: the only calls into ESP-IDF drivers (GPIO, LEDC, ADC, sleep, RTC) and the
+// CPU cycle counter.
+// hal_idf.c backs it on the chip; host/hal_host.c backs it with inspectable fakes for the host build.
+//
+// NVS, esp_timer, FreeRTOS and logging are not wrapped: their IDF APIs are already portable (the IDF
+// linux target ships them), so modules keep calling them and the host build supplies its own
+// implementations of those headers instead.
+
+typedef int hal_gpio_t; // GPIO number
+
+typedef enum {
+    HAL_GPIO_INPUT = 0,
+    HAL_GPIO_OUTPUT,
+    HAL_GPIO_OUTPUT_OD,       // open-drain
+    HAL_GPIO_INPUT_OUTPUT_OD, // open-drain, level readable back
+} hal_gpio_mode_t;
+
+typedef enum {
+    HAL_GPIO_PULL_NONE = 0,
+    HAL_GPIO_PULL_UP,
+    HAL_GPIO_PULL_DOWN,
+} hal_gpio_pull_t;
+
+esp_err_t hal_gpio_config(hal_gpio_t pin, hal_gpio_mode_t mode, hal_gpio_pull_t pull);
+void hal_gpio_set(hal_gpio_t pin, int level);
+int hal_gpio_get(hal_gpio_t pin);
+
+// Busy-wait, for bit-banged buses.
+void hal_delay_us(uint32_t us);
+
+// Free-running cycle counter for timing short code paths (wraps; differences stay valid). CPU cycles
+// on the chip; on the host whatever counter the machine has (TSC ticks on x86).
+uint32_t hal_cycle_count(void);
+
+// PWM: two LEDC channels (0, 1) on one low-speed timer, APB clock.
+esp_err_t hal_pwm_timer_config(uint32_t freq_hz, uint32_t duty_bits);
+// Frequency the timer actually runs at (the divider is integer, so it can fall short at high resolution).
+uint32_t hal_pwm_get_freq(void);
+esp_err_t hal_pwm_channel_config(uint8_t channel, hal_gpio_t pin);
+// Idempotent.
+esp_err_t hal_pwm_fade_install(void);
+// Sets and latches the duty right away.
+esp_err_t hal_pwm_set_duty(uint8_t channel, uint32_t duty);
+// Programs a linear fade to duty over time_ms; hal_pwm_fade_start() runs it without waiting.
+esp_err_t hal_pwm_set_fade(uint8_t channel, uint32_t duty, uint32_t time_ms);
+esp_err_t hal_pwm_fade_start(uint8_t channel);
+
+// One-shot ADC channel at 11 dB attenuation, with best-effort factory calibration.
+typedef struct {
+    void *unit; // adc_oneshot_unit_handle_t
+    void *cali; // adc_cali_handle_t, NULL when uncalibrated
+    int unit_id;
+    int channel;
+} hal_adc_t;
+
+esp_err_t hal_adc_open(hal_adc_t *adc, hal_gpio_t pin);
+esp_err_t hal_adc_read_raw(hal_adc_t *adc, int *out_raw);
+// Calibrated pin voltage; false when calibration is unavailable or fails.
+bool hal_adc_raw_to_mv(const hal_adc_t *adc, int raw, int *out_mv);
+void hal_adc_close(hal_adc_t *adc);
+
+// Deep sleep until wake_us elapses (0: no timer wakeup) or wake_pin reads low (pulled up).
+void hal_deep_sleep(uint64_t wake_us, hal_gpio_t wake_pin) __attribute__((noreturn));
+
+// System RTC wall clock (UTC ms since the epoch), as gettimeofday()/settimeofday() keep it.
+int64_t hal_rtc_get_ms(void);
+void hal_rtc_set_ms(int64_t ms);
+
+#ifdef __cplusplus
+}
+#endif
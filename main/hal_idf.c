@@ -0,0 +1,251 @@
+#include "hal.h"
+
+#include <stddef.h>
+#include <sys/time.h>
+
+#include "driver/gpio.h"
+#include "driver/ledc.h"
+#include "esp_adc/adc_cali.h"
+#include "esp_adc/adc_cali_scheme.h"
+#include "esp_adc/adc_oneshot.h"
+#include "esp_cpu.h"
+#include "esp_rom_sys.h"
+#include "esp_sleep.h"
+#include "soc/soc_caps.h"
+
+#define HAL_PWM_MODE  LEDC_LOW_SPEED_MODE
+#define HAL_PWM_TIMER LEDC_TIMER_0
+// Use 11dB attenuation to avoid saturation near 2.0V ADC input (≈8.4V battery after divider).
+#define HAL_ADC_ATTEN ADC_ATTEN_DB_11
+
+esp_err_t hal_gpio_config(hal_gpio_t pin, hal_gpio_mode_t mode, hal_gpio_pull_t pull)
+{
+    gpio_config_t cfg = {
+        .pin_bit_mask = (1ULL << pin),
+        .mode = (mode == HAL_GPIO_INPUT)       ? GPIO_MODE_INPUT
+                : (mode == HAL_GPIO_OUTPUT)    ? GPIO_MODE_OUTPUT
+                : (mode == HAL_GPIO_OUTPUT_OD) ? GPIO_MODE_OUTPUT_OD
+                                               : GPIO_MODE_INPUT_OUTPUT_OD,
+        .pull_up_en = (pull == HAL_GPIO_PULL_UP) ? GPIO_PULLUP_ENABLE : GPIO_PULLUP_DISABLE,
+        .pull_down_en = (pull == HAL_GPIO_PULL_DOWN) ? GPIO_PULLDOWN_ENABLE : GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE,
+    };
+    return gpio_config(&cfg);
+}
+
+void hal_gpio_set(hal_gpio_t pin, int level)
+{
+    gpio_set_level((gpio_num_t)pin, level);
+}
+
+int hal_gpio_get(hal_gpio_t pin)
+{
+    return gpio_get_level((gpio_num_t)pin);
+}
+
+void hal_delay_us(uint32_t us)
+{
+    esp_rom_delay_us(us);
+}
+
+uint32_t hal_cycle_count(void)
+{
+    return (uint32_t)esp_cpu_get_cycle_count();
+}
+
+esp_err_t hal_pwm_timer_config(uint32_t freq_hz, uint32_t duty_bits)
+{
+    // NOTE: LEDC_AUTO_CLK may select REF_TICK (1MHz) on some targets, which would force
+    // ~1.95kHz at 9-bit resolution (audible whine with EN/PWM dimming drivers).
+    // Force APB clock so requested >20kHz PWM is actually achievable.
+    ledc_timer_config_t timer = {
+        .speed_mode = HAL_PWM_MODE,
+        .duty_resolution = (ledc_timer_bit_t)duty_bits,
+        .timer_num = HAL_PWM_TIMER,
+        .freq_hz = freq_hz,
+        .clk_cfg = LEDC_USE_APB_CLK,
+    };
+    return ledc_timer_config(&timer);
+}
+
+uint32_t hal_pwm_get_freq(void)
+{
+    return ledc_get_freq(HAL_PWM_MODE, HAL_PWM_TIMER);
+}
+
+esp_err_t hal_pwm_channel_config(uint8_t channel, hal_gpio_t pin)
+{
+    ledc_channel_config_t ch = {
+        .speed_mode = HAL_PWM_MODE,
+        .channel = (ledc_channel_t)channel,
+        .timer_sel = HAL_PWM_TIMER,
+        .intr_type = LEDC_INTR_DISABLE,
+        .gpio_num = pin,
+        .duty = 0,
+        .hpoint = 0,
+    };
+    return ledc_channel_config(&ch);
+}
+
+esp_err_t hal_pwm_fade_install(void)
+{
+    esp_err_t err = ledc_fade_func_install(0);
+    // INVALID_STATE if already installed; treat as OK
+    return (err == ESP_ERR_INVALID_STATE) ? ESP_OK : err;
+}
+
+esp_err_t hal_pwm_set_duty(uint8_t channel, uint32_t duty)
+{
+    esp_err_t err = ledc_set_duty(HAL_PWM_MODE, (ledc_channel_t)channel, duty);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return ledc_update_duty(HAL_PWM_MODE, (ledc_channel_t)channel);
+}
+
+esp_err_t hal_pwm_set_fade(uint8_t channel, uint32_t duty, uint32_t time_ms)
+{
+    return ledc_set_fade_with_time(HAL_PWM_MODE, (ledc_channel_t)channel, duty, (int)time_ms);
+}
+
+esp_err_t hal_pwm_fade_start(uint8_t channel)
+{
+    return ledc_fade_start(HAL_PWM_MODE, (ledc_channel_t)channel, LEDC_FADE_NO_WAIT);
+}
+
+esp_err_t hal_adc_open(hal_adc_t *adc, hal_gpio_t pin)
+{
+    if (!adc) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *adc = (hal_adc_t){0};
+
+    adc_unit_t unit_id;
+    adc_channel_t channel;
+    esp_err_t err = adc_oneshot_io_to_channel(pin, &unit_id, &channel);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    adc_oneshot_unit_init_cfg_t unit_cfg = {
+        .unit_id = unit_id,
+        .ulp_mode = ADC_ULP_MODE_DISABLE,
+    };
+    adc_oneshot_unit_handle_t unit = NULL;
+    err = adc_oneshot_new_unit(&unit_cfg, &unit);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    adc_oneshot_chan_cfg_t chan_cfg = {
+        .atten = HAL_ADC_ATTEN,
+        .bitwidth = ADC_BITWIDTH_DEFAULT,
+    };
+    err = adc_oneshot_config_channel(unit, channel, &chan_cfg);
+    if (err != ESP_OK) {
+        adc_oneshot_del_unit(unit);
+        return err;
+    }
+
+    // Calibration is best-effort.
+    adc_cali_handle_t cali = NULL;
+#if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
+    {
+        adc_cali_curve_fitting_config_t cali_cfg = {
+            .unit_id = unit_id,
+            .chan = channel,
+            .atten = HAL_ADC_ATTEN,
+            .bitwidth = ADC_BITWIDTH_DEFAULT,
+        };
+        if (adc_cali_create_scheme_curve_fitting(&cali_cfg, &cali) != ESP_OK) {
+            cali = NULL;
+        }
+    }
+#elif ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED
+    {
+        adc_cali_line_fitting_config_t cali_cfg = {
+            .unit_id = unit_id,
+            .atten = HAL_ADC_ATTEN,
+            .bitwidth = ADC_BITWIDTH_DEFAULT,
+        };
+        if (adc_cali_create_scheme_line_fitting(&cali_cfg, &cali) != ESP_OK) {
+            cali = NULL;
+        }
+    }
+#endif
+
+    adc->unit = unit;
+    adc->cali = cali;
+    adc->unit_id = (int)unit_id;
+    adc->channel = (int)channel;
+    return ESP_OK;
+}
+
+esp_err_t hal_adc_read_raw(hal_adc_t *adc, int *out_raw)
+{
+    if (!adc || !adc->unit || !out_raw) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return adc_oneshot_read((adc_oneshot_unit_handle_t)adc->unit, (adc_channel_t)adc->channel, out_raw);
+}
+
+bool hal_adc_raw_to_mv(const hal_adc_t *adc, int raw, int *out_mv)
+{
+    if (!adc || !adc->cali || !out_mv) {
+        return false;
+    }
+    return adc_cali_raw_to_voltage((adc_cali_handle_t)adc->cali, raw, out_mv) == ESP_OK;
+}
+
+void hal_adc_close(hal_adc_t *adc)
+{
+    if (!adc) {
+        return;
+    }
+    if (adc->cali) {
+#if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
+        (void)adc_cali_delete_scheme_curve_fitting((adc_cali_handle_t)adc->cali);
+#elif ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED
+        (void)adc_cali_delete_scheme_line_fitting((adc_cali_handle_t)adc->cali);
+#endif
+    }
+    if (adc->unit) {
+        (void)adc_oneshot_del_unit((adc_oneshot_unit_handle_t)adc->unit);
+    }
+    *adc = (hal_adc_t){0};
+}
+
+void hal_deep_sleep(uint64_t wake_us, hal_gpio_t wake_pin)
+{
+    esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_ALL);
+
+    if (wake_us > 0) {
+        ESP_ERROR_CHECK(esp_sleep_enable_timer_wakeup(wake_us));
+    }
+
+    // Button wakeup: GPIO low level (preferred on ESP32-C3 since GPIO20 is not an RTC IO).
+    gpio_pullup_en((gpio_num_t)wake_pin);
+    gpio_pulldown_dis((gpio_num_t)wake_pin);
+#if SOC_GPIO_SUPPORT_DEEPSLEEP_WAKEUP
+    ESP_ERROR_CHECK(gpio_wakeup_enable((gpio_num_t)wake_pin, GPIO_INTR_LOW_LEVEL));
+    ESP_ERROR_CHECK(esp_sleep_enable_gpio_wakeup());
+#else
+    ESP_ERROR_CHECK(esp_sleep_enable_ext0_wakeup((gpio_num_t)wake_pin, 0));
+#endif
+
+    esp_deep_sleep_start();
+}
+
+int64_t hal_rtc_get_ms(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+void hal_rtc_set_ms(int64_t ms)
+{
+    int64_t sec = ms >= 0 ? ms / 1000 : (ms - 999) / 1000;
+    struct timeval tv = {.tv_sec = (time_t)sec, .tv_usec = (suseconds_t)((ms - sec * 1000) * 1000)};
+    settimeofday(&tv, NULL);
+}
@@ -0,0 +1,100 @@
+#include "light_preset.h"
+
+#include <string.h>
+
+// Brightness fraction (x/16 of the preset brightness) reached at the end of each of the
+// LIGHT_PRESET_MAX_STEPS equal-time segments.
+static const uint8_t s_curve_q4[DEVICE_PRESET_CURVE_COUNT][LIGHT_PRESET_MAX_STEPS] = {
+    [DEVICE_PRESET_CURVE_LINEAR] = {16, 16, 16, 16}, // single step, see step count below
+    [DEVICE_PRESET_CURVE_EASE_IN] = {1, 4, 9, 16},   // (t)^2
+    [DEVICE_PRESET_CURVE_EASE_OUT] = {7, 12, 15, 16}, // 1-(1-t)^2
+};
+
+void light_mix_percent(uint8_t total_0_100, uint8_t color_temp_0_100, uint8_t *out_warm, uint8_t *out_cool)
+{
+    if (total_0_100 > 100) {
+        total_0_100 = 100;
+    }
+    if (color_temp_0_100 > 100) {
+        color_temp_0_100 = 100;
+    }
+
+    // Linear fit/mix:
+    //  - color_temp=0   => 100% cool
+    //  - color_temp=100 => 100% warm
+    // Keep warm+cool == total_brightness.
+    uint16_t warm = (uint16_t)total_0_100 * (uint16_t)color_temp_0_100;
+    warm = (warm + 50) / 100; // rounded
+    if (warm > total_0_100) {
+        warm = total_0_100;
+    }
+
+    // Avoid both channels going to 0 when brightness is very low.
+    // If there is a non-zero brightness budget but rounding zeroed one side, force 1% to that side.
+    uint16_t cool = (uint16_t)total_0_100 - warm;
+    if (total_0_100 > 0 && color_temp_0_100 > 0 && warm == 0) {
+        warm = 1;
+        if (cool > 0) {
+            cool -= 1;
+        }
+    }
+    if (total_0_100 > 0 && color_temp_0_100 < 100 && cool == 0) {
+        cool = 1;
+        if (warm > 0) {
+            warm -= 1;
+        }
+    }
+
+    if (out_warm) {
+        *out_warm = (uint8_t)warm;
+    }
+    if (out_cool) {
+        *out_cool = (uint8_t)cool;
+    }
+}
+
+void light_preset_compile(const pwm_led_t *led, const device_preset_t *preset, light_preset_plan_t *out)
+{
+    if (!out) {
+        return;
+    }
+    memset(out, 0, sizeof(*out));
+    if (!led || !led->inited || !preset || preset->name[0] == 0) {
+        return;
+    }
+
+    uint8_t curve = (preset->curve < DEVICE_PRESET_CURVE_COUNT) ? preset->curve : DEVICE_PRESET_CURVE_LINEAR;
+    uint8_t steps = (curve == DEVICE_PRESET_CURVE_LINEAR) ? 1 : LIGHT_PRESET_MAX_STEPS;
+    uint32_t total_ms = (uint32_t)preset->fade_ds * 100u;
+
+    for (uint8_t i = 0; i < steps; i++) {
+        uint8_t q4 = (steps == 1) ? 16 : s_curve_q4[curve][i];
+        uint8_t bright = (uint8_t)(((uint16_t)preset->brightness * q4 + 8) / 16);
+        if (bright == 0 && preset->brightness > 0) {
+            bright = 1;
+        }
+        uint8_t warm = 0, cool = 0;
+        light_mix_percent(bright, preset->color_temp, &warm, &cool);
+
+        light_fade_step_t *st = &out->steps[i];
+        if (pwm_led_percent_to_duties(led, warm, cool, &st->warm_duty, &st->cool_duty) != ESP_OK) {
+            memset(out, 0, sizeof(*out));
+            return;
+        }
+        st->time_ms = total_ms / steps;
+    }
+    out->step_count = steps;
+    out->total_ms = total_ms;
+    out->valid = true;
+}
+
+void light_preset_compile_all(const pwm_led_t *led, const device_config_t *cfg,
+                              light_preset_plan_t out[DEVICE_CONFIG_MAX_PRESETS])
+{
+    if (!cfg || !out) {
+        return;
+    }
+    for (size_t i = 0; i < DEVICE_CONFIG_MAX_PRESETS; i++) {
+        light_preset_compile(led, &cfg->presets[i], &out[i]);
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "device_config.h"
+#include "pwm_led.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Piecewise-linear approximation of the preset curve; the last step holds the final duties.
+#define LIGHT_PRESET_MAX_STEPS (4)
+
+typedef struct {
+    uint32_t warm_duty;
+    uint32_t cool_duty;
+    uint32_t time_ms;
+} light_fade_step_t;
+
+// A preset resolved to hardware duties. Activation only replays these steps.
+typedef struct {
+    bool valid;
+    uint8_t step_count;
+    uint32_t total_ms;
+    light_fade_step_t steps[LIGHT_PRESET_MAX_STEPS];
+} light_preset_plan_t;
+
+// Hardware fade used whenever the warm/cool mix is applied (manual light, each sunrise step).
+#define LIGHT_MIX_FADE_MS (300)
+
+// Splits a total brightness into warm/cool percents (color_temp 0=cool..100=warm), keeping
+// warm+cool == total and both channels lit when the mix asks for them.
+void light_mix_percent(uint8_t total_0_100, uint8_t color_temp_0_100, uint8_t *out_warm, uint8_t *out_cool);
+
+// Compiles one preset; an unused slot (or an uninitialized LED) yields valid=false.
+void light_preset_compile(const pwm_led_t *led, const device_preset_t *preset, light_preset_plan_t *out);
+
+void light_preset_compile_all(const pwm_led_t *led, const device_config_t *cfg,
+                              light_preset_plan_t out[DEVICE_CONFIG_MAX_PRESETS]);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,182 @@
+#include "microbench.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "alarm_sched.h"
+#include "battery.h"
+#include "ble_value.h"
+#include "device_config.h"
+#include "hal.h"
+#include "light_preset.h"
+#include "pwm_led.h"
+#include "sunrise.h"
+#include "timekeeper.h"
+
+// 2026-03-02 22:00:00 UTC, a Monday.
+#define MICROBENCH_NOW (1772488800)
+
+// Results land here so the calls cannot be optimized away.
+static volatile uint32_t s_sink;
+
+// An initialized 10-bit, 40 kHz channel pair as pwm_led_init() leaves it, without touching LEDC.
+static const pwm_led_t s_led = {
+    .inited = true,
+    .freq_hz = 40000,
+    .duty_max = 1023,
+    .duty_min = 25,
+    .warm_gain_q12 = 4096,
+    .cool_gain_q12 = 4096,
+};
+
+static alarm_sched_t s_sched;
+static sunrise_t s_sunrise;
+
+// Shapes seen on 0xFF11/0xFF12 writes: canonical, separators, CR/LF, short, BCD, little-endian.
+static const struct {
+    const char *data;
+    uint8_t len;
+} s_writes[] = {
+    {"06301", 5}, {"0630", 4}, {"06:30:1\r\n", 9}, {"630", 3}, {"\x06\x30", 2}, {"223015", 6}, {"22:30:15", 8},
+    {"22:30:15\r\n", 10},
+};
+#define MICROBENCH_WRITES (sizeof(s_writes) / sizeof(s_writes[0]))
+
+static uint32_t case_duties_mixed(uint32_t i)
+{
+    uint8_t warm = (uint8_t)(i % 101);
+    uint8_t cool = (uint8_t)((i * 7) % (101 - warm));
+    uint32_t w = 0, c = 0;
+    (void)pwm_led_percent_to_duties(&s_led, warm, cool, &w, &c);
+    return w + c;
+}
+
+// Both channels set independently (sum > 100): the curve runs once per channel.
+static uint32_t case_duties_split(uint32_t i)
+{
+    uint8_t warm = (uint8_t)(51 + i % 50);
+    uint8_t cool = (uint8_t)(51 + (i * 7) % 50);
+    uint32_t w = 0, c = 0;
+    (void)pwm_led_percent_to_duties(&s_led, warm, cool, &w, &c);
+    return w + c;
+}
+
+static uint32_t case_light_mix(uint32_t i)
+{
+    uint8_t warm = 0, cool = 0;
+    light_mix_percent((uint8_t)(i % 101), (uint8_t)((i * 37) % 101), &warm, &cool);
+    return (uint32_t)warm + cool;
+}
+
+static uint32_t case_sunrise(uint32_t i)
+{
+    return sunrise_brightness(&s_sunrise, (int64_t)i * 7031 * 1000);
+}
+
+static uint32_t case_next_alarm(uint32_t i)
+{
+    uint8_t slot = 0;
+    bool skip = false;
+    return (uint32_t)timekeeper_seconds_until_next_alarm(&s_sched, MICROBENCH_NOW + (time_t)i * 7919, &slot, &skip);
+}
+
+static uint32_t case_hhmme(uint32_t i)
+{
+    uint8_t out[5];
+    const uint8_t *data = (const uint8_t *)s_writes[i % MICROBENCH_WRITES].data;
+    return ble_value_normalize_hhmme5(data, s_writes[i % MICROBENCH_WRITES].len, out) ? out[3] : 0;
+}
+
+static uint32_t case_hhmmss(uint32_t i)
+{
+    uint8_t out[6];
+    const uint8_t *data = (const uint8_t *)s_writes[i % MICROBENCH_WRITES].data;
+    return ble_value_normalize_hhmmss6(data, s_writes[i % MICROBENCH_WRITES].len, out) ? out[5] : 0;
+}
+
+static uint32_t case_battery(uint32_t i)
+{
+    return battery_mv_to_percent(6000 + (i * 11) % 2600);
+}
+
+static const struct {
+    const char *name;
+    uint32_t (*call)(uint32_t i);
+} s_cases[] = {
+    {"pwm_led_percent_to_duties/mixed", case_duties_mixed},
+    {"pwm_led_percent_to_duties/split", case_duties_split},
+    {"light_mix_percent", case_light_mix},
+    {"sunrise_brightness", case_sunrise},
+    {"timekeeper_seconds_until_next_alarm", case_next_alarm},
+    {"ble_value_normalize_hhmme5", case_hhmme},
+    {"ble_value_normalize_hhmmss6", case_hhmmss},
+    {"battery_mv_to_percent", case_battery},
+};
+#define MICROBENCH_CASES (sizeof(s_cases) / sizeof(s_cases[0]))
+
+static void setup(void)
+{
+    // A realistic table: weekday and weekend alarms, a one-shot, a skip date.
+    device_config_t cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    for (size_t i = 0; i < DEVICE_CONFIG_MAX_ALARMS; i++) {
+        cfg.alarms[i] = device_config_alarm_default();
+    }
+    cfg.alarms[0] = (device_alarm_t){.hour = 6, .minute = 30, .weekdays = 0x3E, .enabled = 1, .sunrise_duration = 30,
+                                     .wake_bright = 100};
+    cfg.alarms[1] = (device_alarm_t){.hour = 8, .minute = 0, .weekdays = 0x41, .enabled = 1, .sunrise_duration = 45,
+                                     .wake_bright = 80};
+    cfg.alarms[2] = (device_alarm_t){.hour = 5, .minute = 15, .weekdays = 0x7F, .enabled = 1, .sunrise_duration = 20,
+                                     .wake_bright = 60, .date_year = 26, .date_month = 3, .date_day = 20};
+    cfg.skips[0] = (device_skip_t){.year = 26, .month = 4, .day = 6, .slots_lo = 0xFF, .slots_hi = 0xFF};
+    alarm_sched_build(&s_sched, &cfg);
+
+    sunrise_start(&s_sunrise, 30 * 60 * 1000, 30 * 60 * 1000, 100, 0, 0);
+}
+
+static uint32_t median(uint32_t *v, size_t n)
+{
+    // Insertion sort: n is MICROBENCH_RUNS.
+    for (size_t i = 1; i < n; i++) {
+        uint32_t x = v[i];
+        size_t j = i;
+        while (j > 0 && v[j - 1] > x) {
+            v[j] = v[j - 1];
+            j--;
+        }
+        v[j] = x;
+    }
+    return v[n / 2];
+}
+
+size_t microbench_run_all(microbench_result_t *out, size_t cap)
+{
+    setup();
+    size_t c = 0;
+    for (; c < MICROBENCH_CASES && c < cap; c++) {
+        uint32_t runs[MICROBENCH_RUNS];
+        for (size_t r = 0; r < MICROBENCH_RUNS; r++) {
+            uint32_t acc = 0;
+            uint32_t t0 = hal_cycle_count();
+            for (uint32_t i = 0; i < MICROBENCH_CALLS; i++) {
+                acc += s_cases[c].call(i);
+            }
+            runs[r] = hal_cycle_count() - t0;
+            s_sink = acc;
+        }
+        out[c].name = s_cases[c].name;
+        out[c].median_cycles = median(runs, MICROBENCH_RUNS);
+        out[c].min_cycles = runs[0];
+    }
+    return c;
+}
+
+void microbench_print(FILE *out, const char *counter, const microbench_result_t *results, size_t n)
+{
+    fprintf(out, "microbench %-36s %10s %10s  (%s per call, best/median of %d runs x %d calls)\n", "case", "min", "median",
+            counter, MICROBENCH_RUNS, MICROBENCH_CALLS);
+    for (size_t i = 0; i < n; i++) {
+        fprintf(out, "microbench %-36s %10.1f %10.1f\n", results[i].name,
+                (double)results[i].min_cycles / MICROBENCH_CALLS, (double)results[i].median_cycles / MICROBENCH_CALLS);
+    }
+}
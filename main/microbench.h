@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Microbenchmarks of the pure functions on the light-update and BLE-write paths, timed with
+// hal_cycle_count() so the same cases run on the chip (CONFIG_LIGHT_ALARM_MICROBENCH, printed at
+// boot) and on the host (host/microbench_main.c).
+//
+// Each case makes MICROBENCH_CALLS calls over a spread of inputs, MICROBENCH_RUNS times. The fastest
+// run is the figure to compare (interrupts and cache misses only ever add); the median shows the
+// spread. Numbers are per call and include the loop and input generation (a few cycles).
+
+#define MICROBENCH_RUNS  (9)
+#define MICROBENCH_CALLS (256)
+#define MICROBENCH_MAX_CASES (16)
+
+typedef struct {
+    const char *name;
+    uint32_t min_cycles;    // fastest run, all MICROBENCH_CALLS calls
+    uint32_t median_cycles; // median run
+} microbench_result_t;
+
+// Runs every case; fills up to cap results and returns how many it filled.
+size_t microbench_run_all(microbench_result_t *out, size_t cap);
+
+// The common report, identical on host and chip: a header naming the counter, then one line per case:
+//   microbench <name> <min cycles/call> <median cycles/call>
+void microbench_print(FILE *out, const char *counter, const microbench_result_t *results, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,140 @@
+#include "provisioning.h"
+
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+
+static const char *TAG = "PROV";
+
+// The payload struct is read in place from flash, so its layout is part of the record format.
+static_assert(sizeof(provisioning_data_t) == 18, "provisioning record layout changed");
+static_assert(offsetof(provisioning_data_t, batt_gain_q12) == 2, "provisioning record layout changed");
+static_assert(offsetof(provisioning_data_t, led_warm_gain_q12) == 6, "provisioning record layout changed");
+static_assert(offsetof(provisioning_data_t, name_suffix) == 10, "provisioning record layout changed");
+static_assert((PROVISIONING_HDR_LEN % 4) == 0, "payload must stay aligned in the mapping");
+
+// Kept mapped for the lifetime of the firmware; nothing ever unmaps it.
+static esp_partition_mmap_handle_t s_map;
+static const provisioning_data_t *s_data;
+
+static uint32_t get_u32_le(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool gain_valid(uint16_t q12)
+{
+    // Trims outside 0.5x..1.5x are a bad fixture reading, not a real unit.
+    return q12 >= PROVISIONING_GAIN_Q12_ONE / 2 && q12 <= PROVISIONING_GAIN_Q12_ONE + PROVISIONING_GAIN_Q12_ONE / 2;
+}
+
+static esp_err_t record_check(const uint8_t *rec, size_t avail)
+{
+    if (get_u32_le(&rec[0]) != PROVISIONING_MAGIC) {
+        // Erased flash (0xFF..) lands here: the unit was never provisioned.
+        return ESP_ERR_NOT_FOUND;
+    }
+    uint8_t version = rec[4];
+    uint8_t payload_len = rec[5];
+    if (version == 0 || payload_len < sizeof(provisioning_data_t) ||
+        PROVISIONING_HDR_LEN + (size_t)payload_len > avail) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (esp_rom_crc32_le(0, &rec[PROVISIONING_HDR_LEN], payload_len) != get_u32_le(&rec[8])) {
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    const provisioning_data_t *d = (const provisioning_data_t *)&rec[PROVISIONING_HDR_LEN];
+    if (d->bat_en_active_level > 1 && d->bat_en_active_level != PROVISIONING_BAT_EN_AUTO) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!gain_valid(d->batt_gain_q12) || !gain_valid(d->led_warm_gain_q12) || !gain_valid(d->led_cool_gain_q12)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ESP_OK;
+}
+
+esp_err_t provisioning_init(void)
+{
+    if (s_data) {
+        return ESP_OK;
+    }
+
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                           (esp_partition_subtype_t)PROVISIONING_PARTITION_SUBTYPE,
+                                                           PROVISIONING_PARTITION_LABEL);
+    if (!part) {
+        ESP_LOGW(TAG, "no '%s' partition; using probed defaults", PROVISIONING_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // Only map what a record can occupy; the MMU rounds up to one page anyway.
+    size_t map_len = PROVISIONING_HDR_LEN + 255;
+    if (map_len > part->size) {
+        map_len = part->size;
+    }
+    const void *ptr = NULL;
+    esp_partition_mmap_handle_t handle;
+    esp_err_t err = esp_partition_mmap(part, 0, map_len, ESP_PARTITION_MMAP_DATA, &ptr, &handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "mmap failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    const uint8_t *rec = (const uint8_t *)ptr;
+    err = record_check(rec, map_len);
+    if (err != ESP_OK) {
+        esp_partition_munmap(handle);
+        if (err == ESP_ERR_NOT_FOUND) {
+            ESP_LOGW(TAG, "unit not provisioned; using probed defaults");
+        } else {
+            ESP_LOGE(TAG, "invalid provisioning record (v%u len=%u): %s",
+                     (unsigned)rec[4], (unsigned)rec[5], esp_err_to_name(err));
+        }
+        return err == ESP_ERR_NOT_FOUND ? err : ESP_ERR_INVALID_STATE;
+    }
+
+    s_map = handle;
+    s_data = (const provisioning_data_t *)&rec[PROVISIONING_HDR_LEN];
+    ESP_LOGI(TAG, "board_rev=%u bat_en=%u batt_gain=%u/%d led_gain=%u/%u (record v%u)",
+             (unsigned)s_data->board_rev,
+             (unsigned)s_data->bat_en_active_level,
+             (unsigned)s_data->batt_gain_q12,
+             (int)s_data->batt_offset_mv,
+             (unsigned)s_data->led_warm_gain_q12,
+             (unsigned)s_data->led_cool_gain_q12,
+             (unsigned)rec[4]);
+    return ESP_OK;
+}
+
+const provisioning_data_t *provisioning_get(void)
+{
+    return s_data;
+}
+
+bool provisioning_get_name_suffix(char out[PROVISIONING_NAME_SUFFIX_MAX + 1])
+{
+    if (!out) {
+        return false;
+    }
+    out[0] = 0;
+    if (!s_data) {
+        return false;
+    }
+    size_t n = 0;
+    while (n < PROVISIONING_NAME_SUFFIX_MAX && s_data->name_suffix[n] != 0) {
+        char c = s_data->name_suffix[n];
+        // Keep the advertised name printable even if the fixture wrote garbage.
+        if (c < 0x21 || c > 0x7E) {
+            break;
+        }
+        out[n] = c;
+        n++;
+    }
+    out[n] = 0;
+    return n > 0;
+}
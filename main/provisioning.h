@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Per-unit factory data in the read-only "prov" partition (see partitions.csv).
+// It lives outside NVS, so nvs_flash_erase()/factory reset never touches it. The record is
+// memory-mapped at boot and read in place; the firmware never writes it (tools/mkprov.py does).
+//
+// Record (little-endian):
+//   magic(u32 "PROV") version(u8) payload_len(u8) reserved(u16) crc32(u32, over payload only)
+//   payload: provisioning_data_t, newer versions only append fields.
+#define PROVISIONING_PARTITION_LABEL "prov"
+#define PROVISIONING_PARTITION_SUBTYPE (0x40)
+#define PROVISIONING_MAGIC (0x564F5250u) // "PROV"
+#define PROVISIONING_VERSION (1)
+#define PROVISIONING_HDR_LEN (12)
+
+#define PROVISIONING_GAIN_Q12_ONE (4096)
+#define PROVISIONING_BAT_EN_AUTO (0xFF)
+#define PROVISIONING_NAME_SUFFIX_MAX (8)
+
+// Laid out so every field is naturally aligned at its offset in the mapped record.
+typedef struct {
+    uint8_t board_rev;
+    uint8_t bat_en_active_level;  // 0 = active-low, 1 = active-high, PROVISIONING_BAT_EN_AUTO = probe
+    uint16_t batt_gain_q12;       // battery mV scale, PROVISIONING_GAIN_Q12_ONE = 1.0
+    int16_t batt_offset_mv;       // added after scaling
+    uint16_t led_warm_gain_q12;   // per-channel duty trim, PROVISIONING_GAIN_Q12_ONE = 1.0
+    uint16_t led_cool_gain_q12;
+    char name_suffix[PROVISIONING_NAME_SUFFIX_MAX]; // NUL-padded, not necessarily NUL-terminated
+} provisioning_data_t;
+
+// Maps and validates the record. ESP_ERR_NOT_FOUND when the partition is missing or unprogrammed;
+// callers then keep their probed/default behaviour.
+esp_err_t provisioning_init(void);
+
+// Zero-copy view into flash; NULL until provisioning_init() succeeded.
+const provisioning_data_t *provisioning_get(void);
+
+// Copies name_suffix into out (NUL-terminated). Returns false if there is no suffix.
+bool provisioning_get_name_suffix(char out[PROVISIONING_NAME_SUFFIX_MAX + 1]);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,11 +1,15 @@
 #include "pwm_led.h"
 
-#include "driver/ledc.h"
 #include "esp_log.h"
 #include "esp_timer.h"
 
+#include "hal.h"
+
 static const char *TAG = "PWM";
 
+#define PWM_CH_WARM 0
+#define PWM_CH_COOL 1
+
 // Many EN/PWM dimming drivers won't respond to extremely short PWM pulses.
 // Enforce a minimum high-time (pulse width) so low percentages (e.g. <=3%) still light.
 // Unit: nanoseconds.
@@ -115,28 +119,50 @@ static void percents_to_duties(uint8_t warm_percent, uint8_t cool_percent,
     }
 }
 
+static uint32_t apply_gain(uint32_t duty, uint16_t gain_q12, uint32_t duty_max, uint32_t duty_min)
+{
+    if (duty == 0) {
+        return 0;
+    }
+    uint32_t v = (uint32_t)(((uint64_t)duty * gain_q12 + 2048) >> 12);
+    if (v < duty_min) {
+        v = duty_min;
+    }
+    return (v > duty_max) ? duty_max : v;
+}
+
+static void led_percents_to_duties(const pwm_led_t *led, uint8_t warm_percent, uint8_t cool_percent,
+                                   uint32_t *out_warm_duty, uint32_t *out_cool_duty)
+{
+    uint32_t warm_duty = 0;
+    uint32_t cool_duty = 0;
+    percents_to_duties(warm_percent, cool_percent, led->duty_max, led->duty_min, &warm_duty, &cool_duty);
+    *out_warm_duty = apply_gain(warm_duty, led->warm_gain_q12, led->duty_max, led->duty_min);
+    *out_cool_duty = apply_gain(cool_duty, led->cool_gain_q12, led->duty_max, led->duty_min);
+}
+
 // Internal fade helper
-static esp_err_t set_duty_and_fade(gpio_num_t warm_gpio, gpio_num_t cool_gpio,
+static esp_err_t set_duty_and_fade(hal_gpio_t warm_gpio, hal_gpio_t cool_gpio,
                                    uint32_t warm_duty, uint32_t cool_duty,
                                    uint32_t time_ms)
 {
     // Warm channel
-    esp_err_t err = ledc_set_fade_with_time(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_0, warm_duty, time_ms);
+    esp_err_t err = hal_pwm_set_fade(PWM_CH_WARM, warm_duty, time_ms);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "fade set warm failed: %s", esp_err_to_name(err));
         return err;
     }
-    err = ledc_set_fade_with_time(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_1, cool_duty, time_ms);
+    err = hal_pwm_set_fade(PWM_CH_COOL, cool_duty, time_ms);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "fade set cool failed: %s", esp_err_to_name(err));
         return err;
     }
-    err = ledc_fade_start(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_0, LEDC_FADE_NO_WAIT);
+    err = hal_pwm_fade_start(PWM_CH_WARM);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "fade start warm failed: %s", esp_err_to_name(err));
         return err;
     }
-    err = ledc_fade_start(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_1, LEDC_FADE_NO_WAIT);
+    err = hal_pwm_fade_start(PWM_CH_COOL);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "fade start cool failed: %s", esp_err_to_name(err));
         return err;
@@ -144,7 +170,7 @@ static esp_err_t set_duty_and_fade(gpio_num_t warm_gpio, gpio_num_t cool_gpio,
     return ESP_OK;
 }
 
-esp_err_t pwm_led_init(pwm_led_t *led, gpio_num_t warm_gpio, gpio_num_t cool_gpio)
+esp_err_t pwm_led_init(pwm_led_t *led, hal_gpio_t warm_gpio, hal_gpio_t cool_gpio)
 {
     if (!led) {
         return ESP_ERR_INVALID_ARG;
@@ -152,83 +178,61 @@ esp_err_t pwm_led_init(pwm_led_t *led, gpio_num_t warm_gpio, gpio_num_t cool_gpi
 
     led->warm_gpio = warm_gpio;
     led->cool_gpio = cool_gpio;
+    led->warm_gain_q12 = 4096;
+    led->cool_gain_q12 = 4096;
     // Requirement: set to 40kHz to avoid audible noise.
     led->freq_hz = 40000;
 
-    // NOTE: LEDC_AUTO_CLK may select REF_TICK (1MHz) on some targets, which would force
-    // ~1.95kHz at 9-bit resolution (audible whine with EN/PWM dimming drivers).
-    // Force APB clock so requested >20kHz PWM is actually achievable.
+    // The HAL runs the timer off the APB clock so requested >20kHz PWM is actually achievable.
     // Prefer higher resolution to make very-low brightness (e.g. 1%) actually dim.
     // We'll step down resolution if we can't keep ultrasonic PWM frequency.
-    uint32_t duty_bits = 10;
-    ledc_timer_config_t timer = {
-        .speed_mode = LEDC_LOW_SPEED_MODE,
-        .duty_resolution = LEDC_TIMER_10_BIT, // prefer 10-bit
-        .timer_num = LEDC_TIMER_0,
-        .freq_hz = led->freq_hz,
-        .clk_cfg = LEDC_USE_APB_CLK,
-    };
-    esp_err_t err = ledc_timer_config(&timer);
+    uint32_t duty_bits = 10; // prefer 10-bit
+    esp_err_t err = hal_pwm_timer_config(led->freq_hz, duty_bits);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "timer config failed: %s", esp_err_to_name(err));
         return err;
     }
 
-    uint32_t actual_hz = ledc_get_freq(LEDC_LOW_SPEED_MODE, LEDC_TIMER_0);
+    uint32_t actual_hz = hal_pwm_get_freq();
     if (actual_hz < 38000) {
         ESP_LOGW(TAG, "PWM freq too low (%uHz) at 10-bit; reconfig to 9-bit", (unsigned)actual_hz);
         duty_bits = 9;
-        timer.duty_resolution = LEDC_TIMER_9_BIT;
-        err = ledc_timer_config(&timer);
+        err = hal_pwm_timer_config(led->freq_hz, duty_bits);
         if (err != ESP_OK) {
             ESP_LOGE(TAG, "timer reconfig (9-bit) failed: %s", esp_err_to_name(err));
             return err;
         }
-        actual_hz = ledc_get_freq(LEDC_LOW_SPEED_MODE, LEDC_TIMER_0);
+        actual_hz = hal_pwm_get_freq();
     }
     if (actual_hz < 38000) {
         ESP_LOGW(TAG, "PWM freq too low (%uHz) at 9-bit; reconfig to 8-bit", (unsigned)actual_hz);
         duty_bits = 8;
-        timer.duty_resolution = LEDC_TIMER_8_BIT;
-        err = ledc_timer_config(&timer);
+        err = hal_pwm_timer_config(led->freq_hz, duty_bits);
         if (err != ESP_OK) {
             ESP_LOGE(TAG, "timer reconfig (8-bit) failed: %s", esp_err_to_name(err));
             return err;
         }
-        actual_hz = ledc_get_freq(LEDC_LOW_SPEED_MODE, LEDC_TIMER_0);
+        actual_hz = hal_pwm_get_freq();
     }
 
     led->duty_max = (1u << duty_bits) - 1;
     led->duty_min = calc_min_duty(led->freq_hz, led->duty_max);
 
-    ledc_channel_config_t ch0 = {
-        .speed_mode = LEDC_LOW_SPEED_MODE,
-        .channel = LEDC_CHANNEL_0,
-        .timer_sel = LEDC_TIMER_0,
-        .intr_type = LEDC_INTR_DISABLE,
-        .gpio_num = warm_gpio,
-        .duty = 0,
-        .hpoint = 0,
-    };
-    err = ledc_channel_config(&ch0);
+    err = hal_pwm_channel_config(PWM_CH_WARM, warm_gpio);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "warm channel config failed: %s", esp_err_to_name(err));
         return err;
     }
 
-    ledc_channel_config_t ch1 = ch0;
-    ch1.channel = LEDC_CHANNEL_1;
-    ch1.gpio_num = cool_gpio;
-    ch1.duty = 0;
-    err = ledc_channel_config(&ch1);
+    err = hal_pwm_channel_config(PWM_CH_COOL, cool_gpio);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "cool channel config failed: %s", esp_err_to_name(err));
         return err;
     }
 
     // Install fade service once for all fade operations.
-    err = ledc_fade_func_install(0);
-    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) { // INVALID_STATE if already installed; treat as OK
+    err = hal_pwm_fade_install();
+    if (err != ESP_OK) {
         ESP_LOGE(TAG, "fade func install failed: %s", esp_err_to_name(err));
         return err;
     }
@@ -253,29 +257,19 @@ esp_err_t pwm_led_set_percent(pwm_led_t *led, uint8_t warm_percent, uint8_t cool
 
     uint32_t warm_duty = 0;
     uint32_t cool_duty = 0;
-    percents_to_duties(warm_percent, cool_percent, led->duty_max, led->duty_min, &warm_duty, &cool_duty);
+    led_percents_to_duties(led, warm_percent, cool_percent, &warm_duty, &cool_duty);
 
-    esp_err_t err = ledc_set_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_0, warm_duty);
+    esp_err_t err = hal_pwm_set_duty(PWM_CH_WARM, warm_duty);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "set duty warm failed: %s", esp_err_to_name(err));
         return err;
     }
-    err = ledc_update_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_0);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "update duty warm failed: %s", esp_err_to_name(err));
-        return err;
-    }
 
-    err = ledc_set_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_1, cool_duty);
+    err = hal_pwm_set_duty(PWM_CH_COOL, cool_duty);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "set duty cool failed: %s", esp_err_to_name(err));
         return err;
     }
-    err = ledc_update_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_1);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "update duty cool failed: %s", esp_err_to_name(err));
-        return err;
-    }
 
     static int64_t s_last_log_us;
     int64_t now_us = esp_timer_get_time();
@@ -294,7 +288,7 @@ esp_err_t pwm_led_fade_percent(pwm_led_t *led, uint8_t warm_percent, uint8_t coo
 
     uint32_t warm_duty = 0;
     uint32_t cool_duty = 0;
-    percents_to_duties(warm_percent, cool_percent, led->duty_max, led->duty_min, &warm_duty, &cool_duty);
+    led_percents_to_duties(led, warm_percent, cool_percent, &warm_duty, &cool_duty);
 
     esp_err_t err = set_duty_and_fade(led->warm_gpio, led->cool_gpio, warm_duty, cool_duty, time_ms);
     if (err != ESP_OK) {
@@ -314,6 +308,48 @@ esp_err_t pwm_led_fade_percent(pwm_led_t *led, uint8_t warm_percent, uint8_t coo
     return ESP_OK;
 }
 
+esp_err_t pwm_led_percent_to_duties(const pwm_led_t *led, uint8_t warm_percent, uint8_t cool_percent,
+                                    uint32_t *out_warm_duty, uint32_t *out_cool_duty)
+{
+    if (!led || !led->inited) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uint32_t warm_duty = 0;
+    uint32_t cool_duty = 0;
+    led_percents_to_duties(led, warm_percent, cool_percent, &warm_duty, &cool_duty);
+    if (out_warm_duty) {
+        *out_warm_duty = warm_duty;
+    }
+    if (out_cool_duty) {
+        *out_cool_duty = cool_duty;
+    }
+    return ESP_OK;
+}
+
+esp_err_t pwm_led_set_gain(pwm_led_t *led, uint16_t warm_gain_q12, uint16_t cool_gain_q12)
+{
+    if (!led || warm_gain_q12 == 0 || cool_gain_q12 == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    led->warm_gain_q12 = warm_gain_q12;
+    led->cool_gain_q12 = cool_gain_q12;
+    return ESP_OK;
+}
+
+esp_err_t pwm_led_fade_duty(pwm_led_t *led, uint32_t warm_duty, uint32_t cool_duty, uint32_t time_ms)
+{
+    if (!led || !led->inited) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (warm_duty > led->duty_max) {
+        warm_duty = led->duty_max;
+    }
+    if (cool_duty > led->duty_max) {
+        cool_duty = led->duty_max;
+    }
+    return set_duty_and_fade(led->warm_gpio, led->cool_gpio, warm_duty, cool_duty, time_ms);
+}
+
 esp_err_t pwm_led_off(pwm_led_t *led)
 {
     if (!led || !led->inited) {
@@ -3,23 +3,30 @@
 #include <stdbool.h>
 #include <stdint.h>
 
-#include "driver/gpio.h"
 #include "esp_err.h"
 
+#include "hal.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 typedef struct {
     bool inited;
-    gpio_num_t warm_gpio;
-    gpio_num_t cool_gpio;
+    hal_gpio_t warm_gpio;
+    hal_gpio_t cool_gpio;
     uint32_t freq_hz;
     uint32_t duty_max;
     uint32_t duty_min; // minimum non-zero duty to guarantee a visible/high-enough pulse width
+    uint16_t warm_gain_q12; // per-unit channel trim, 4096 = 1.0
+    uint16_t cool_gain_q12;
 } pwm_led_t;
 
-esp_err_t pwm_led_init(pwm_led_t *led, gpio_num_t warm_gpio, gpio_num_t cool_gpio);
+esp_err_t pwm_led_init(pwm_led_t *led, hal_gpio_t warm_gpio, hal_gpio_t cool_gpio);
+
+// Per-unit channel trim (from provisioning), applied to every percent->duty mapping below.
+// pwm_led_init() resets both gains to 1.0; precomputed duties must be recomputed after a change.
+esp_err_t pwm_led_set_gain(pwm_led_t *led, uint16_t warm_gain_q12, uint16_t cool_gain_q12);
 
 // percent 0..100
 esp_err_t pwm_led_set_percent(pwm_led_t *led, uint8_t warm_percent, uint8_t cool_percent);
@@ -28,6 +35,14 @@ esp_err_t pwm_led_set_percent(pwm_led_t *led, uint8_t warm_percent, uint8_t cool
 // Percents are 0..100; time_ms is total fade duration.
 esp_err_t pwm_led_fade_percent(pwm_led_t *led, uint8_t warm_percent, uint8_t cool_percent, uint32_t time_ms);
 
+// Resolves percents to channel duties with the same curve/minimum-pulse rules as the calls above,
+// so callers can precompute duties once and replay them with pwm_led_fade_duty().
+esp_err_t pwm_led_percent_to_duties(const pwm_led_t *led, uint8_t warm_percent, uint8_t cool_percent,
+                                    uint32_t *out_warm_duty, uint32_t *out_cool_duty);
+
+// Hardware fade to precomputed duties (no percent mapping).
+esp_err_t pwm_led_fade_duty(pwm_led_t *led, uint32_t warm_duty, uint32_t cool_duty, uint32_t time_ms);
+
 esp_err_t pwm_led_off(pwm_led_t *led);
 
 #ifdef __cplusplus
@@ -0,0 +1,329 @@
+#include "rtc_drift.h"
+
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+
+#include "esp_log.h"
+#include "nvs.h"
+
+#include "sdkconfig.h"
+#include "storage_telemetry.h"
+
+static const char *TAG = "DRIFT";
+
+static const char *NVS_NS = "rtc";
+static const char *KEY_STATE = "drift";
+
+#define RTC_DRIFT_STATE_VERSION (1)
+#define RTC_DRIFT_MAX_PAIRS (RTC_DRIFT_MAX_POINTS * (RTC_DRIFT_MAX_POINTS - 1) / 2)
+
+// Persisted blob, little-endian and unpadded: version, count, head, seg, flags (STATE_FLAG_*),
+// anchor_ms i64, ppb i32, then RTC_DRIFT_MAX_POINTS x (x_s u32, err_ms i32, seg u8, unc_ms u16).
+#define STATE_FLAG_ANCHOR_VALID (0x01)
+#define STATE_FLAG_PPB_VALID (0x02)
+#define STATE_HEAD_LEN (17)
+#define STATE_POINT_LEN (11)
+#define STATE_BLOB_LEN (STATE_HEAD_LEN + RTC_DRIFT_MAX_POINTS * STATE_POINT_LEN)
+
+typedef struct {
+    uint8_t version;
+    uint8_t count;
+    uint8_t head; // next slot to write
+    uint8_t seg;
+    bool anchor_valid;
+    int64_t anchor_ms; // raw == reference at this instant (the last sync)
+    int32_t ppb;
+    bool ppb_valid;
+    rtc_drift_point_t points[RTC_DRIFT_MAX_POINTS];
+} rtc_drift_state_t;
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static rtc_drift_state_t s_st;
+
+static void sort_i32(int32_t *v, uint32_t n)
+{
+    for (uint32_t i = 1; i < n; i++) {
+        int32_t x = v[i];
+        uint32_t j = i;
+        while (j > 0 && v[j - 1] > x) {
+            v[j] = v[j - 1];
+            j--;
+        }
+        v[j] = x;
+    }
+}
+
+rtc_drift_estimate_t rtc_drift_fit(const rtc_drift_point_t *points, uint8_t count)
+{
+    rtc_drift_estimate_t est = {.points = count};
+    if (!points || count < 2) {
+        return est;
+    }
+    if (count > RTC_DRIFT_MAX_POINTS) {
+        count = RTC_DRIFT_MAX_POINTS;
+    }
+
+    int32_t slopes[RTC_DRIFT_MAX_PAIRS];
+    uint32_t n = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        for (uint8_t j = (uint8_t)(i + 1); j < count; j++) {
+            const rtc_drift_point_t *a = &points[i];
+            const rtc_drift_point_t *b = &points[j];
+            if (a->seg != b->seg) {
+                continue;
+            }
+            int64_t dx = (int64_t)b->x_s - (int64_t)a->x_s;
+            if (dx < 0) {
+                dx = -dx;
+                a = &points[j];
+                b = &points[i];
+            }
+            if (dx * 1000 < ((int64_t)a->unc_ms + b->unc_ms) * RTC_DRIFT_MIN_BASELINE_S) {
+                continue;
+            }
+            // ms per s -> ppb: x 1e6.
+            int64_t ppb = ((int64_t)b->err_ms - (int64_t)a->err_ms) * 1000000LL / dx;
+            if (ppb > INT32_MAX || ppb < INT32_MIN) {
+                continue;
+            }
+            slopes[n++] = (int32_t)ppb;
+        }
+    }
+    est.pairs = (uint8_t)n;
+    if (n == 0) {
+        return est;
+    }
+
+    sort_i32(slopes, n);
+    int32_t median = (n & 1) ? slopes[n / 2] : (int32_t)(((int64_t)slopes[n / 2 - 1] + slopes[n / 2]) / 2);
+    const int32_t limit = CONFIG_LIGHT_ALARM_RTC_DRIFT_MAX_PPM * 1000;
+    if (median > limit || median < -limit) {
+        return est;
+    }
+    est.ppb = median;
+    est.valid = true;
+    return est;
+}
+
+static void put_u16_le(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)(v & 0xFF);
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32_le(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v & 0xFF);
+    p[1] = (uint8_t)((v >> 8) & 0xFF);
+    p[2] = (uint8_t)((v >> 16) & 0xFF);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint16_t get_u16_le(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32_le(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void state_pack(const rtc_drift_state_t *st, uint8_t out[STATE_BLOB_LEN])
+{
+    out[0] = st->version;
+    out[1] = st->count;
+    out[2] = st->head;
+    out[3] = st->seg;
+    out[4] = (uint8_t)((st->anchor_valid ? STATE_FLAG_ANCHOR_VALID : 0) | (st->ppb_valid ? STATE_FLAG_PPB_VALID : 0));
+    put_u32_le(&out[5], (uint32_t)(uint64_t)st->anchor_ms);
+    put_u32_le(&out[9], (uint32_t)((uint64_t)st->anchor_ms >> 32));
+    put_u32_le(&out[13], (uint32_t)st->ppb);
+    uint8_t *p = &out[STATE_HEAD_LEN];
+    for (size_t i = 0; i < RTC_DRIFT_MAX_POINTS; i++, p += STATE_POINT_LEN) {
+        const rtc_drift_point_t *pt = &st->points[i];
+        put_u32_le(&p[0], pt->x_s);
+        put_u32_le(&p[4], (uint32_t)pt->err_ms);
+        p[8] = pt->seg;
+        put_u16_le(&p[9], pt->unc_ms);
+    }
+}
+
+static esp_err_t state_unpack(const uint8_t *in, size_t len, rtc_drift_state_t *st)
+{
+    if (len != STATE_BLOB_LEN || in[0] != RTC_DRIFT_STATE_VERSION || in[1] > RTC_DRIFT_MAX_POINTS ||
+        in[2] >= RTC_DRIFT_MAX_POINTS) {
+        return ESP_ERR_INVALID_VERSION;
+    }
+    memset(st, 0, sizeof(*st));
+    st->version = in[0];
+    st->count = in[1];
+    st->head = in[2];
+    st->seg = in[3];
+    st->anchor_valid = (in[4] & STATE_FLAG_ANCHOR_VALID) != 0;
+    st->ppb_valid = (in[4] & STATE_FLAG_PPB_VALID) != 0;
+    st->anchor_ms = (int64_t)((uint64_t)get_u32_le(&in[5]) | ((uint64_t)get_u32_le(&in[9]) << 32));
+    st->ppb = (int32_t)get_u32_le(&in[13]);
+    const uint8_t *p = &in[STATE_HEAD_LEN];
+    for (size_t i = 0; i < RTC_DRIFT_MAX_POINTS; i++, p += STATE_POINT_LEN) {
+        rtc_drift_point_t *pt = &st->points[i];
+        pt->x_s = get_u32_le(&p[0]);
+        pt->err_ms = (int32_t)get_u32_le(&p[4]);
+        pt->seg = p[8];
+        pt->unc_ms = get_u16_le(&p[9]);
+    }
+    return ESP_OK;
+}
+
+static void save_state(const rtc_drift_state_t *st)
+{
+    uint8_t blob[STATE_BLOB_LEN];
+    state_pack(st, blob);
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(NVS_NS, NVS_READWRITE, &handle);
+    if (err == ESP_OK) {
+        err = nvs_set_blob(handle, KEY_STATE, blob, sizeof(blob));
+        if (err == ESP_OK) {
+            err = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    if (err == ESP_OK) {
+        storage_telemetry_note_commit(NVS_NS, sizeof(blob));
+    } else {
+        ESP_LOGW(TAG, "save failed: %s", esp_err_to_name(err));
+    }
+}
+
+esp_err_t rtc_drift_init(void)
+{
+    rtc_drift_state_t st;
+    uint8_t blob[STATE_BLOB_LEN];
+    size_t len = sizeof(blob);
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(NVS_NS, NVS_READONLY, &handle);
+    if (err == ESP_OK) {
+        err = nvs_get_blob(handle, KEY_STATE, blob, &len);
+        nvs_close(handle);
+    }
+    if (err == ESP_OK || err == ESP_ERR_NVS_INVALID_LENGTH) {
+        err = err == ESP_OK ? state_unpack(blob, len, &st) : ESP_ERR_INVALID_VERSION;
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "discarding incompatible drift state");
+        }
+    }
+    if (err != ESP_OK) {
+        memset(&st, 0, sizeof(st));
+        st.version = RTC_DRIFT_STATE_VERSION;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    s_st = st;
+    portEXIT_CRITICAL(&s_lock);
+
+    if (st.ppb_valid) {
+        ESP_LOGI(TAG, "drift %+ld ppb from %u points", (long)st.ppb, (unsigned)st.count);
+    }
+    return (err == ESP_ERR_NVS_NOT_FOUND || err == ESP_ERR_INVALID_VERSION) ? ESP_OK : err;
+}
+
+int64_t rtc_drift_correct_ms(int64_t raw_ms)
+{
+#if CONFIG_LIGHT_ALARM_RTC_DRIFT_COMP
+    portENTER_CRITICAL(&s_lock);
+    bool apply = s_st.ppb_valid && s_st.anchor_valid && raw_ms > s_st.anchor_ms;
+    int64_t since = raw_ms - s_st.anchor_ms;
+    int32_t ppb = s_st.ppb;
+    portEXIT_CRITICAL(&s_lock);
+    if (apply) {
+        // Fits in int64 for any interval under ~290 years at 1000 ppm.
+        return raw_ms + since * ppb / 1000000000LL;
+    }
+#endif
+    return raw_ms;
+}
+
+void rtc_drift_on_sync(int64_t raw_ms, int64_t ref_ms, uint32_t unc_ms)
+{
+    if (unc_ms > UINT16_MAX) {
+        unc_ms = UINT16_MAX;
+    }
+    rtc_drift_state_t st;
+    portENTER_CRITICAL(&s_lock);
+    st = s_st;
+    portEXIT_CRITICAL(&s_lock);
+
+    uint8_t last = (uint8_t)((st.head + RTC_DRIFT_MAX_POINTS - 1) % RTC_DRIFT_MAX_POINTS);
+    int64_t dx_ms = raw_ms - st.anchor_ms;
+    bool chained = st.anchor_valid && st.count > 0 && dx_ms >= 0;
+    if (chained) {
+        int64_t budget_ms = dx_ms * CONFIG_LIGHT_ALARM_RTC_DRIFT_MAX_PPM / 1000000 + st.points[last].unc_ms + unc_ms;
+        int64_t off_ms = ref_ms - raw_ms;
+        chained = off_ms <= RTC_DRIFT_STEP_BUDGETS * budget_ms && -off_ms <= RTC_DRIFT_STEP_BUDGETS * budget_ms;
+    }
+    rtc_drift_point_t p;
+    if (chained) {
+        const rtc_drift_point_t *prev = &st.points[last];
+        p.x_s = prev->x_s + (uint32_t)((dx_ms + 500) / 1000);
+        p.err_ms = prev->err_ms + (int32_t)(ref_ms - raw_ms);
+        p.seg = st.seg;
+        p.unc_ms = (uint16_t)unc_ms;
+        // Keep the segment's first point; refresh any later one that is too recent to add information.
+        bool refresh = dx_ms < (int64_t)RTC_DRIFT_MIN_SPACING_S * 1000 && st.count > 1 && st.points[last].x_s != 0 &&
+                       st.points[last].seg == st.seg;
+        if (refresh) {
+            st.head = last;
+            st.count--;
+        }
+    } else {
+        // First sync ever, after a step, the clock went backwards or the reference is too far off to
+        // be drift: new segment.
+        st.seg++;
+        p = (rtc_drift_point_t){.x_s = 0, .err_ms = 0, .seg = st.seg, .unc_ms = (uint16_t)unc_ms};
+    }
+
+    st.points[st.head] = p;
+    st.head = (uint8_t)((st.head + 1) % RTC_DRIFT_MAX_POINTS);
+    if (st.count < RTC_DRIFT_MAX_POINTS) {
+        st.count++;
+    }
+    st.anchor_ms = ref_ms;
+    st.anchor_valid = true;
+
+    rtc_drift_estimate_t est = rtc_drift_fit(st.points, st.count);
+    if (est.valid) {
+        st.ppb = est.ppb;
+        st.ppb_valid = true;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    s_st = st;
+    portEXIT_CRITICAL(&s_lock);
+
+    ESP_LOGI(TAG, "sync: raw off by %+lld ms (+-%u), seg %u x=%lus; drift %+ld ppb (%s, %u pairs)",
+             (long long)(raw_ms - ref_ms), (unsigned)p.unc_ms, (unsigned)p.seg, (unsigned long)p.x_s, (long)st.ppb,
+             est.valid ? "updated" : (st.ppb_valid ? "kept" : "none"), (unsigned)est.pairs);
+    save_state(&st);
+}
+
+void rtc_drift_on_clock_step(void)
+{
+    rtc_drift_state_t st;
+    portENTER_CRITICAL(&s_lock);
+    bool was_valid = s_st.anchor_valid;
+    s_st.anchor_valid = false;
+    st = s_st;
+    portEXIT_CRITICAL(&s_lock);
+    if (was_valid) {
+        save_state(&st);
+    }
+}
+
+rtc_drift_estimate_t rtc_drift_get_estimate(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    rtc_drift_estimate_t est = {.valid = s_st.ppb_valid, .ppb = s_st.ppb, .points = s_st.count};
+    portEXIT_CRITICAL(&s_lock);
+    return est;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// RTC crystal drift estimation from successive time syncs.
+//
+// Between syncs the system clock free-runs on the 32 kHz RTC ("raw" time). Each sync yields a
+// point (x = raw seconds elapsed along the current chain of syncs, err = accumulated reference minus
+// raw time); the drift rate is the slope of err over x, fitted with a Theil-Sen estimator (median of
+// pairwise slopes) so a single bad reference (phone clock off, typo'd time) does not skew it. The
+// corrected time is raw + rate * (raw - time of last sync): continuous, and exact at each sync.
+//
+// A clock step without a reference (power loss, build-time fallback) ends the chain; later syncs
+// start a new segment and slopes are only taken within a segment, so the old points still count. So
+// does a reference further from the raw clock than drift can explain (a wrong date or zone on either
+// side): it starts a new segment instead of becoming a point. Points and the current estimate are
+// persisted in NVS on every sync.
+
+#define RTC_DRIFT_MAX_POINTS (12)
+// A pair needs this much baseline per second of combined reference error (1 s / 6 h = 46 ppm), or it
+// is skipped: two HHMMSS syncs (+-500 ms each) need 6 h, two timed exchanges (a few ms) minutes.
+#define RTC_DRIFT_MIN_BASELINE_S (6 * 3600)
+// Error bound of a whole-second HHMMSS reference.
+#define RTC_DRIFT_HHMMSS_UNC_MS (500)
+// Syncs closer than this to the previous one refresh the last point instead of adding one.
+#define RTC_DRIFT_MIN_SPACING_S (3600)
+// A sync is a step when reference minus raw exceeds this many times the most that drift at
+// CONFIG_LIGHT_ALARM_RTC_DRIFT_MAX_PPM since the last sync, plus both references' error bounds, explains.
+#define RTC_DRIFT_STEP_BUDGETS (3)
+
+typedef struct {
+    uint32_t x_s;   // raw seconds since the segment's first sync
+    int32_t err_ms; // accumulated (reference - raw) since the segment's first sync
+    uint8_t seg;
+    uint16_t unc_ms; // error bound of the reference
+} rtc_drift_point_t;
+
+typedef struct {
+    bool valid;
+    int32_t ppb;  // rate of reference vs raw time; > 0: RTC runs slow, corrected time gains
+    uint8_t pairs; // pairwise slopes that went into the median
+    uint8_t points;
+} rtc_drift_estimate_t;
+
+// Theil-Sen fit over points (any order); pure, no state. Result is invalid without a usable pair
+// or when the median exceeds CONFIG_LIGHT_ALARM_RTC_DRIFT_MAX_PPM.
+rtc_drift_estimate_t rtc_drift_fit(const rtc_drift_point_t *points, uint8_t count);
+
+// Loads persisted points/estimate. Call after nvs_flash_init() and before the clock is read.
+esp_err_t rtc_drift_init(void);
+
+// Raw epoch milliseconds to corrected epoch milliseconds.
+int64_t rtc_drift_correct_ms(int64_t raw_ms);
+
+// A reference time arrived; raw_ms is the clock just before it is set to ref_ms, which is good to
+// +-unc_ms.
+void rtc_drift_on_sync(int64_t raw_ms, int64_t ref_ms, uint32_t unc_ms);
+
+// The clock was set without a reference; the next sync starts a new segment.
+void rtc_drift_on_clock_step(void);
+
+rtc_drift_estimate_t rtc_drift_get_estimate(void);
+
+#ifdef __cplusplus
+}
+#endif
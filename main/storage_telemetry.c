@@ -0,0 +1,163 @@
+#include "storage_telemetry.h"
+
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs.h"
+
+#include "sdkconfig.h"
+
+#include "timer_wheel.h"
+
+static const char *TAG = "NVS_TLM";
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static storage_telemetry_t s_tlm;
+static uint32_t s_erased_entries; // total - used - free at the last sample
+static bool s_sampled;
+static timer_wheel_timer_t s_log_timer;
+
+// Entries in ERASED state are neither used nor free. They only go down when GC reclaims (erases)
+// a page, so a drop between two samples is at least one page erase. Sampling after every commit
+// keeps the window small enough that a reclaim is not hidden by the commit's own erasures.
+static void sample_nvs_stats(void)
+{
+    nvs_stats_t st;
+    if (nvs_get_stats(NULL, &st) != ESP_OK) {
+        return;
+    }
+    uint32_t erased = (uint32_t)(st.total_entries - st.used_entries - st.free_entries);
+
+    portENTER_CRITICAL(&s_lock);
+    if (s_sampled && erased < s_erased_entries) {
+        uint32_t reclaimed = s_erased_entries - erased;
+        s_tlm.erase_events += (reclaimed + STORAGE_TELEMETRY_ENTRIES_PER_PAGE - 1) / STORAGE_TELEMETRY_ENTRIES_PER_PAGE;
+    }
+    s_erased_entries = erased;
+    s_sampled = true;
+    s_tlm.used_entries = (uint16_t)st.used_entries;
+    s_tlm.free_entries = (uint16_t)st.free_entries;
+    s_tlm.total_entries = (uint16_t)st.total_entries;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+static void log_timer_cb(void *arg)
+{
+    (void)arg;
+    sample_nvs_stats();
+    storage_telemetry_t t;
+    storage_telemetry_get(&t);
+    uint32_t pages = t.total_entries / STORAGE_TELEMETRY_ENTRIES_PER_PAGE;
+    ESP_LOGI(TAG, "up=%lus commits=%lu bytes=%lu page_erases=%lu (%lu pages) entries used=%u free=%u total=%u",
+             (unsigned long)t.uptime_s, (unsigned long)t.commits, (unsigned long)t.bytes,
+             (unsigned long)t.erase_events, (unsigned long)pages,
+             (unsigned)t.used_entries, (unsigned)t.free_entries, (unsigned)t.total_entries);
+    for (uint8_t i = 0; i < t.ns_count; i++) {
+        ESP_LOGI(TAG, "  ns=%s commits=%lu bytes=%lu", t.ns[i].name, (unsigned long)t.ns[i].commits,
+                 (unsigned long)t.ns[i].bytes);
+    }
+}
+
+esp_err_t storage_telemetry_init(void)
+{
+    sample_nvs_stats();
+
+#if CONFIG_LIGHT_ALARM_STORAGE_LOG_INTERVAL_MIN > 0
+    if (!s_log_timer.cb) {
+        timer_wheel_timer_init(&s_log_timer, "nvs_tlm", log_timer_cb, NULL);
+        // A log line can wait for any wakeup within the minute.
+        return timer_wheel_start_periodic(&s_log_timer, (uint64_t)CONFIG_LIGHT_ALARM_STORAGE_LOG_INTERVAL_MIN * 60ULL * 1000000ULL,
+                                          60U * 1000000U);
+    }
+#else
+    (void)log_timer_cb;
+    (void)s_log_timer;
+#endif
+    return ESP_OK;
+}
+
+void storage_telemetry_note_commit(const char *ns, size_t bytes)
+{
+    portENTER_CRITICAL(&s_lock);
+    s_tlm.commits++;
+    s_tlm.bytes += (uint32_t)bytes;
+    storage_ns_stats_t *slot = NULL;
+    for (uint8_t i = 0; ns && i < s_tlm.ns_count; i++) {
+        if (strncmp(s_tlm.ns[i].name, ns, STORAGE_TELEMETRY_NS_NAME_MAX) == 0) {
+            slot = &s_tlm.ns[i];
+            break;
+        }
+    }
+    if (!slot && ns && s_tlm.ns_count < STORAGE_TELEMETRY_MAX_NS) {
+        slot = &s_tlm.ns[s_tlm.ns_count++];
+        strncpy(slot->name, ns, STORAGE_TELEMETRY_NS_NAME_MAX);
+        slot->name[STORAGE_TELEMETRY_NS_NAME_MAX] = 0;
+    }
+    if (slot) {
+        slot->commits++;
+        slot->bytes += (uint32_t)bytes;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    sample_nvs_stats();
+}
+
+void storage_telemetry_get(storage_telemetry_t *out)
+{
+    if (!out) {
+        return;
+    }
+    portENTER_CRITICAL(&s_lock);
+    *out = s_tlm;
+    portEXIT_CRITICAL(&s_lock);
+    out->uptime_s = (uint32_t)(esp_timer_get_time() / 1000000LL);
+}
+
+static size_t put_u16_le(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)(v & 0xFF);
+    p[1] = (uint8_t)(v >> 8);
+    return 2;
+}
+
+static size_t put_u32_le(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v & 0xFF);
+    p[1] = (uint8_t)((v >> 8) & 0xFF);
+    p[2] = (uint8_t)((v >> 16) & 0xFF);
+    p[3] = (uint8_t)(v >> 24);
+    return 4;
+}
+
+size_t storage_telemetry_encode(uint8_t *out, size_t cap)
+{
+    if (!out || cap < STORAGE_TELEMETRY_WIRE_MAX_LEN) {
+        return 0;
+    }
+    sample_nvs_stats();
+    storage_telemetry_t t;
+    storage_telemetry_get(&t);
+
+    size_t len = 0;
+    out[len++] = STORAGE_TELEMETRY_WIRE_VERSION;
+    out[len++] = t.ns_count;
+    len += put_u32_le(&out[len], t.uptime_s);
+    len += put_u32_le(&out[len], t.commits);
+    len += put_u32_le(&out[len], t.bytes);
+    len += put_u32_le(&out[len], t.erase_events);
+    len += put_u16_le(&out[len], t.used_entries);
+    len += put_u16_le(&out[len], t.free_entries);
+    len += put_u16_le(&out[len], t.total_entries);
+    for (uint8_t i = 0; i < t.ns_count; i++) {
+        size_t name_len = strnlen(t.ns[i].name, STORAGE_TELEMETRY_NS_NAME_MAX);
+        len += put_u32_le(&out[len], t.ns[i].commits);
+        len += put_u32_le(&out[len], t.ns[i].bytes);
+        out[len++] = (uint8_t)name_len;
+        memcpy(&out[len], t.ns[i].name, name_len);
+        len += name_len;
+    }
+    return len;
+}
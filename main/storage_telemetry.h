@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// NVS usage and wear counters since boot (RAM only: persisting them would add the very wear
+// they measure). Rates come from dividing by uptime; tools/nvs_wear_sim.py turns them into a
+// lifetime projection.
+
+#define STORAGE_TELEMETRY_MAX_NS (4)
+#define STORAGE_TELEMETRY_NS_NAME_MAX (15) // NVS_KEY_NAME_MAX_SIZE - 1
+// NVS page = 32 header/bitmap bytes + 126 entries of 32 bytes.
+#define STORAGE_TELEMETRY_ENTRIES_PER_PAGE (126)
+
+typedef struct {
+    char name[STORAGE_TELEMETRY_NS_NAME_MAX + 1];
+    uint32_t commits;
+    uint32_t bytes;
+} storage_ns_stats_t;
+
+typedef struct {
+    uint32_t uptime_s;
+    uint32_t commits;      // all namespaces
+    uint32_t bytes;        // payload bytes handed to nvs_set_* before those commits
+    uint32_t erase_events; // page reclaims seen as drops in erased entries (lower bound)
+    uint16_t used_entries;
+    uint16_t free_entries;
+    uint16_t total_entries;
+    uint8_t ns_count;
+    storage_ns_stats_t ns[STORAGE_TELEMETRY_MAX_NS];
+} storage_telemetry_t;
+
+// Takes the baseline nvs_get_stats() sample and starts the periodic log. Call after nvs_flash_init().
+esp_err_t storage_telemetry_init(void);
+
+// Called by NVS writers after a successful nvs_commit(); bytes is what was written in that commit.
+void storage_telemetry_note_commit(const char *ns, size_t bytes);
+
+void storage_telemetry_get(storage_telemetry_t *out);
+
+// 0xFF1B read value, little-endian:
+//   version(u8=1) ns_count(u8) uptime_s(u32) commits(u32) bytes(u32) erase_events(u32)
+//   used_entries(u16) free_entries(u16) total_entries(u16)
+//   per namespace: commits(u32) bytes(u32) name_len(u8) name[name_len]
+#define STORAGE_TELEMETRY_WIRE_VERSION (1)
+#define STORAGE_TELEMETRY_WIRE_MAX_LEN \
+    (24 + STORAGE_TELEMETRY_MAX_NS * (9 + STORAGE_TELEMETRY_NS_NAME_MAX))
+size_t storage_telemetry_encode(uint8_t *out, size_t cap);
+
+#ifdef __cplusplus
+}
+#endif
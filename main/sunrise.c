@@ -0,0 +1,83 @@
+#include "sunrise.h"
+
+#include <stddef.h>
+
+static void plan(sunrise_t *sr, int32_t pos_ms, int64_t mono_us, int64_t wall_ms)
+{
+    int64_t left_pos = (int64_t)sr->total_ms - pos_ms;
+    int64_t left_wall = sr->peak_wall_ms - wall_ms;
+    uint32_t rate;
+    if (left_pos <= 0) {
+        rate = SUNRISE_RATE_ONE_Q16;
+    } else if (left_wall <= 0 || left_pos * SUNRISE_RATE_ONE_Q16 / left_wall >= SUNRISE_RATE_MAX_Q16) {
+        rate = SUNRISE_RATE_MAX_Q16;
+    } else {
+        rate = (uint32_t)(left_pos * SUNRISE_RATE_ONE_Q16 / left_wall);
+        if (rate < SUNRISE_RATE_MIN_Q16) {
+            rate = SUNRISE_RATE_MIN_Q16;
+        }
+    }
+    sr->mono0_us = mono_us;
+    sr->pos0_ms = pos_ms;
+    sr->rate_q16 = rate;
+}
+
+void sunrise_start(sunrise_t *sr, int64_t peak_wall_ms, uint32_t total_ms, uint8_t target, int64_t mono_us,
+                   int64_t wall_ms)
+{
+    if (!sr) {
+        return;
+    }
+    sr->peak_wall_ms = peak_wall_ms;
+    sr->total_ms = (int32_t)total_ms;
+    sr->target = target;
+    // Always from dark: a late start is absorbed by the rate, not by a brightness jump.
+    plan(sr, 0, mono_us, wall_ms);
+}
+
+void sunrise_replan(sunrise_t *sr, int64_t mono_us, int64_t wall_ms)
+{
+    if (!sr) {
+        return;
+    }
+    plan(sr, sunrise_position_ms(sr, mono_us), mono_us, wall_ms);
+}
+
+int32_t sunrise_position_ms(const sunrise_t *sr, int64_t mono_us)
+{
+    if (!sr) {
+        return 0;
+    }
+    int64_t elapsed_ms = (mono_us - sr->mono0_us) / 1000;
+    if (elapsed_ms < 0) {
+        elapsed_ms = 0;
+    }
+    int64_t pos = sr->pos0_ms + ((elapsed_ms * sr->rate_q16) >> 16);
+    return (int32_t)(pos > sr->total_ms ? sr->total_ms : pos);
+}
+
+bool sunrise_done(const sunrise_t *sr, int64_t mono_us)
+{
+    return !sr || sunrise_position_ms(sr, mono_us) >= sr->total_ms;
+}
+
+uint8_t sunrise_brightness(const sunrise_t *sr, int64_t mono_us)
+{
+    if (!sr || sr->target == 0) {
+        return 0;
+    }
+    int32_t pos = sunrise_position_ms(sr, mono_us);
+    if (pos >= sr->total_ms || sr->total_ms <= 0) {
+        return sr->target;
+    }
+    // progress in Q15 (0..32768); p2 and p3 in Q15
+    uint32_t p = (uint32_t)(((uint64_t)pos << 15) / (uint64_t)sr->total_ms);
+    uint32_t p2 = (uint32_t)(((uint64_t)p * (uint64_t)p) >> 15);
+    uint32_t p3 = (uint32_t)(((uint64_t)p2 * (uint64_t)p) >> 15);
+    uint32_t b = (uint32_t)(((uint64_t)p3 * (uint64_t)sr->target + (1u << 14)) >> 15);
+    if (b > sr->target) {
+        b = sr->target;
+    }
+    // Make sure we don't stay totally dark for too long when the ramp just started.
+    return (uint8_t)(b == 0 ? 1 : b);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Sunrise ramp that peaks at the alarm's wall-clock time.
+//
+// The ramp has a position (0..total_ms along the curve) that advances linearly on the monotonic
+// clock at a planned rate. A plan is made at start and again after every wall-clock step: the rate
+// is whatever takes the current position to the end exactly at the peak wall time, clamped to
+// SUNRISE_RATE_MIN_Q16..SUNRISE_RATE_MAX_Q16 of real time. So a late start compresses the ramp
+// instead of jumping in brightness, a mid-ramp sync speeds it up or slows it down smoothly, and
+// the brightness never steps or goes backwards. Only when the remaining time is shorter than a
+// quarter of the remaining ramp does the peak arrive late.
+//
+// Between plans, each step is O(1) from the monotonic time alone.
+
+#define SUNRISE_RATE_ONE_Q16 (65536u)
+#define SUNRISE_RATE_MAX_Q16 (4u * SUNRISE_RATE_ONE_Q16)
+#define SUNRISE_RATE_MIN_Q16 (SUNRISE_RATE_ONE_Q16 / 4u)
+
+// The gradient loop re-reads the brightness and fades to it (LIGHT_MIX_FADE_MS) this often.
+#define SUNRISE_STEP_MS (500)
+
+typedef struct {
+    int64_t peak_wall_ms;
+    int32_t total_ms;
+    uint8_t target; // peak brightness 0..100
+    // Current plan: position pos0_ms at mono0_us, advancing at rate_q16.
+    int64_t mono0_us;
+    int32_t pos0_ms;
+    uint32_t rate_q16;
+} sunrise_t;
+
+void sunrise_start(sunrise_t *sr, int64_t peak_wall_ms, uint32_t total_ms, uint8_t target, int64_t mono_us,
+                   int64_t wall_ms);
+// Re-plans from the current position after the wall clock stepped.
+void sunrise_replan(sunrise_t *sr, int64_t mono_us, int64_t wall_ms);
+
+int32_t sunrise_position_ms(const sunrise_t *sr, int64_t mono_us);
+// Cubic curve (target * p^3), at least 1 while the ramp is running.
+uint8_t sunrise_brightness(const sunrise_t *sr, int64_t mono_us);
+bool sunrise_done(const sunrise_t *sr, int64_t mono_us);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,263 @@
+#include "time_persist.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "nvs.h"
+
+#include "sdkconfig.h"
+#include "storage_telemetry.h"
+#include "time_service.h"
+#include "timekeeper.h"
+#include "timer_wheel.h"
+
+static const char *TAG = "TPERSIST";
+
+static const char *NVS_NS = "rtc";
+static const char *KEY_SNAP = "last_time";
+
+#define SNAP_MAGIC (0x54534C4Bu) // "KLST"
+#define SNAP_VERSION (1)
+// Between steps the clock only drifts, so the periodic snapshot just bounds how stale the copy is after
+// an unannounced reset (panic, watchdog, brownout): at most SNAP_MAX_AGE_MS, restored from the middle
+// of that window. It may slip by the slack to share another deadline's wakeup (the battery sample).
+// Steps and deep sleep snapshot on the spot; esp_restart() writes an exact one.
+#define SNAP_PERIOD_MS (60 * 1000)
+#define SNAP_SLACK_MS (15 * 1000)
+#define SNAP_MAX_AGE_MS (SNAP_PERIOD_MS + SNAP_SLACK_MS)
+
+// Taken right before a reset of our own (esp_restart()): restored without the window bias.
+#define SNAP_FLAG_EXACT (0x01)
+
+typedef struct {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t flags;
+    uint8_t reserved[2];
+    int64_t epoch_ms;
+    uint32_t bound_ms; // error bound at epoch_ms
+    uint32_t crc;      // over the fields above
+} time_snapshot_t;
+
+// Not cleared by the startup code, so it still holds the last snapshot after a reset.
+static RTC_NOINIT_ATTR time_snapshot_t s_rtc_snap;
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static time_snapshot_t s_rtc_boot; // RTC copy as found at boot
+static bool s_rtc_boot_valid;
+static time_snapshot_t s_nvs_boot;
+static bool s_nvs_boot_valid;
+static bool s_approx;
+static uint32_t s_bound_base_ms;
+static int64_t s_bound_since_us;
+static int64_t s_last_nvs_us;
+static volatile bool s_save_pending;
+static timer_wheel_timer_t s_snap_timer;
+
+static uint32_t snap_crc(const time_snapshot_t *s)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)s, offsetof(time_snapshot_t, crc));
+}
+
+static bool snap_valid(const time_snapshot_t *s)
+{
+    return s->magic == SNAP_MAGIC && s->version == SNAP_VERSION && s->crc == snap_crc(s);
+}
+
+static uint32_t bound_grow(uint32_t bound_ms, int64_t elapsed_us)
+{
+    if (bound_ms == TIME_PERSIST_BOUND_UNKNOWN) {
+        return bound_ms;
+    }
+    int64_t b = (int64_t)bound_ms + elapsed_us * TIME_PERSIST_DRIFT_PPM / 1000000000LL;
+    return b >= (int64_t)TIME_PERSIST_BOUND_UNKNOWN ? TIME_PERSIST_BOUND_UNKNOWN - 1 : (uint32_t)b;
+}
+
+uint32_t time_persist_error_bound_ms(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    uint32_t base = s_bound_base_ms;
+    int64_t since = s_bound_since_us;
+    portEXIT_CRITICAL(&s_lock);
+    return bound_grow(base, esp_timer_get_time() - since);
+}
+
+bool time_persist_is_approximate(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    bool approx = s_approx;
+    portEXIT_CRITICAL(&s_lock);
+    return approx;
+}
+
+// Snapshot of the current clock; false while the clock is unset.
+static bool take_snapshot(time_snapshot_t *out, uint8_t flags)
+{
+    int64_t ms = time_service_wall_ms();
+    if (!timekeeper_is_time_sane((time_t)(ms / 1000))) {
+        return false;
+    }
+    memset(out, 0, sizeof(*out));
+    out->magic = SNAP_MAGIC;
+    out->version = SNAP_VERSION;
+    out->flags = flags;
+    out->epoch_ms = ms;
+    out->bound_ms = time_persist_error_bound_ms();
+    out->crc = snap_crc(out);
+    return true;
+}
+
+static void save_nvs(void)
+{
+    time_snapshot_t snap;
+    if (!take_snapshot(&snap, 0)) {
+        return;
+    }
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(NVS_NS, NVS_READWRITE, &handle);
+    if (err == ESP_OK) {
+        err = nvs_set_blob(handle, KEY_SNAP, &snap, sizeof(snap));
+        if (err == ESP_OK) {
+            err = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    if (err == ESP_OK) {
+        s_last_nvs_us = esp_timer_get_time();
+        storage_telemetry_note_commit(NVS_NS, sizeof(snap));
+    } else {
+        ESP_LOGW(TAG, "NVS save failed: %s", esp_err_to_name(err));
+    }
+}
+
+// Refreshes the RTC copy; false while the clock is unset.
+static bool save_rtc(uint8_t flags)
+{
+    time_snapshot_t snap;
+    if (!take_snapshot(&snap, flags)) {
+        return false;
+    }
+    portENTER_CRITICAL(&s_lock);
+    s_rtc_snap = snap;
+    portEXIT_CRITICAL(&s_lock);
+    return true;
+}
+
+static void snap_timer_cb(void *arg)
+{
+    (void)arg;
+    if (!save_rtc(0)) {
+        return;
+    }
+    bool due = s_save_pending;
+#if CONFIG_LIGHT_ALARM_TIME_PERSIST_NVS_MIN > 0
+    due = due || esp_timer_get_time() - s_last_nvs_us >= (int64_t)CONFIG_LIGHT_ALARM_TIME_PERSIST_NVS_MIN * 60 * 1000000LL;
+#endif
+    if (due) {
+        s_save_pending = false;
+        save_nvs();
+    }
+}
+
+// A step moves the clock by more than the window covers: record the new time right away.
+static void on_time_step(const time_step_event_t *ev, void *ctx)
+{
+    (void)ev;
+    (void)ctx;
+    (void)save_rtc(0);
+}
+
+static void shutdown_handler(void)
+{
+    save_nvs();
+    // Last, so nothing stands between it and the reset.
+    (void)save_rtc(SNAP_FLAG_EXACT);
+}
+
+void time_persist_snapshot(void)
+{
+    (void)save_rtc(0);
+}
+
+esp_err_t time_persist_init(void)
+{
+    // Copy the RTC snapshot before the timer overwrites it.
+    s_rtc_boot = s_rtc_snap;
+    s_rtc_boot_valid = snap_valid(&s_rtc_boot);
+
+    size_t len = sizeof(s_nvs_boot);
+    nvs_handle_t handle;
+    if (nvs_open(NVS_NS, NVS_READONLY, &handle) == ESP_OK) {
+        s_nvs_boot_valid = nvs_get_blob(handle, KEY_SNAP, &s_nvs_boot, &len) == ESP_OK && len == sizeof(s_nvs_boot) &&
+                           snap_valid(&s_nvs_boot);
+        nvs_close(handle);
+    }
+    ESP_LOGI(TAG, "snapshots: rtc=%d nvs=%d", (int)s_rtc_boot_valid, (int)s_nvs_boot_valid);
+
+    s_approx = false;
+    s_bound_base_ms = 0;
+    s_bound_since_us = esp_timer_get_time();
+    s_last_nvs_us = s_bound_since_us;
+
+    if (!s_snap_timer.cb) {
+        timer_wheel_timer_init(&s_snap_timer, "time_snap", snap_timer_cb, NULL);
+        (void)esp_register_shutdown_handler(shutdown_handler);
+        (void)time_service_subscribe(on_time_step, NULL);
+        return timer_wheel_start_periodic(&s_snap_timer, (uint64_t)SNAP_PERIOD_MS * 1000ULL,
+                                          (uint32_t)SNAP_SLACK_MS * 1000U);
+    }
+    return ESP_OK;
+}
+
+bool time_persist_restore(int64_t *out_epoch_ms, uint32_t *out_bound_ms)
+{
+    if (!out_epoch_ms || !out_bound_ms) {
+        return false;
+    }
+    // Time since boot is known exactly; time between the last snapshot and the reset is not.
+    int64_t uptime_us = esp_timer_get_time();
+    bool use_rtc = s_rtc_boot_valid && (!s_nvs_boot_valid || s_rtc_boot.epoch_ms >= s_nvs_boot.epoch_ms);
+    if (use_rtc) {
+        // Reset within SNAP_MAX_AGE_MS of the last write: take the middle of that window, unless the
+        // write was the one esp_restart() makes on its way down.
+        uint32_t window_ms = (s_rtc_boot.flags & SNAP_FLAG_EXACT) ? 0 : SNAP_MAX_AGE_MS / 2;
+        *out_epoch_ms = s_rtc_boot.epoch_ms + window_ms + uptime_us / 1000;
+        uint32_t b = bound_grow(s_rtc_boot.bound_ms, uptime_us);
+        *out_bound_ms = (b == TIME_PERSIST_BOUND_UNKNOWN) ? b : b + window_ms;
+        return true;
+    }
+    if (s_nvs_boot_valid) {
+        // The unit may have been unpowered for any length of time: a lower bound only.
+        *out_epoch_ms = s_nvs_boot.epoch_ms + uptime_us / 1000;
+        *out_bound_ms = TIME_PERSIST_BOUND_UNKNOWN;
+        return true;
+    }
+    return false;
+}
+
+void time_persist_note_estimate(uint32_t bound_ms)
+{
+    portENTER_CRITICAL(&s_lock);
+    s_approx = bound_ms > TIME_PERSIST_APPROX_MS;
+    s_bound_base_ms = bound_ms;
+    s_bound_since_us = esp_timer_get_time();
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void time_persist_note_sync(uint32_t bound_ms)
+{
+    portENTER_CRITICAL(&s_lock);
+    s_approx = false;
+    s_bound_base_ms = bound_ms;
+    s_bound_since_us = esp_timer_get_time();
+    portEXIT_CRITICAL(&s_lock);
+    // Saved from the snapshot timer, after the clock has been stepped and off the caller's task.
+    s_save_pending = true;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Last-known wall time across resets, so a reset that loses the RTC counter restores a close
+// estimate instead of the build time.
+//
+//  - RTC memory (RTC_NOINIT): snapshot every minute, with timer slack so it shares other wakeups,
+//    and at once on clock steps, before deep sleep and on esp_restart() (which needs no correction
+//    for the time since the snapshot). Survives software, panic, watchdog and brownout resets; lost
+//    on power-off.
+//  - NVS: every CONFIG_LIGHT_ALARM_TIME_PERSIST_NVS_MIN minutes, on each time sync and from a
+//    shutdown handler (esp_restart()). After power loss it is only a lower bound: the time spent
+//    unpowered is unknown.
+//
+// Each snapshot carries an error bound that grows with uptime at TIME_PERSIST_DRIFT_PPM. A time
+// restored with a bound above TIME_PERSIST_APPROX_MS (always, after power loss or the build-time
+// fallback) is "approximate" and shown as such on the display until the next sync.
+
+#define TIME_PERSIST_DRIFT_PPM (50)
+#define TIME_PERSIST_APPROX_MS (60 * 1000)
+#define TIME_PERSIST_BOUND_UNKNOWN (UINT32_MAX)
+
+// Loads the NVS copy, validates the RTC copy and starts the snapshot timer. Call after
+// nvs_flash_init() and rtc_drift_init().
+esp_err_t time_persist_init(void);
+
+// Best estimate of the current epoch (ms) from the snapshots, for an unset clock. out_bound_ms is
+// TIME_PERSIST_BOUND_UNKNOWN when only a lower bound is known. Returns false if there is none.
+bool time_persist_restore(int64_t *out_epoch_ms, uint32_t *out_bound_ms);
+
+// The clock is about to be set from a restored or fallback estimate / from a reference. Call before
+// time_service_step_to() so step subscribers already see the new approximate state.
+void time_persist_note_estimate(uint32_t bound_ms);
+void time_persist_note_sync(uint32_t bound_ms);
+
+// Refreshes the RTC copy now, e.g. before deep sleep.
+void time_persist_snapshot(void);
+
+bool time_persist_is_approximate(void);
+// Current error bound (ms); TIME_PERSIST_BOUND_UNKNOWN if unbounded.
+uint32_t time_persist_error_bound_ms(void);
+
+#ifdef __cplusplus
+}
+#endif
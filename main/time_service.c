@@ -0,0 +1,98 @@
+#include "time_service.h"
+
+#include "freertos/FreeRTOS.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "hal.h"
+#include "rtc_drift.h"
+
+static const char *TAG = "TIMESVC";
+
+typedef struct {
+    time_step_cb_t cb;
+    void *ctx;
+} time_subscriber_t;
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static time_subscriber_t s_subs[TIME_SERVICE_MAX_SUBSCRIBERS];
+static uint8_t s_sub_count;
+
+static int64_t raw_ms(void)
+{
+    return hal_rtc_get_ms();
+}
+
+esp_err_t time_service_subscribe(time_step_cb_t cb, void *ctx)
+{
+    if (!cb) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t err = ESP_OK;
+    portENTER_CRITICAL(&s_lock);
+    if (s_sub_count < TIME_SERVICE_MAX_SUBSCRIBERS) {
+        s_subs[s_sub_count++] = (time_subscriber_t){.cb = cb, .ctx = ctx};
+    } else {
+        err = ESP_ERR_NO_MEM;
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return err;
+}
+
+int64_t time_service_mono_us(void)
+{
+    return esp_timer_get_time();
+}
+
+int64_t time_service_wall_ms(void)
+{
+    return rtc_drift_correct_ms(raw_ms());
+}
+
+time_t time_service_wall_now(void)
+{
+    int64_t ms = time_service_wall_ms();
+    return (time_t)(ms >= 0 ? ms / 1000 : (ms - 999) / 1000);
+}
+
+int64_t time_service_mono_at(time_t wall)
+{
+    // Read both clocks back to back; the drift correction between now and wall is below a second
+    // for any realistic horizon, and the caller re-checks the wall clock when the deadline hits.
+    int64_t mono = time_service_mono_us();
+    int64_t wall_ms = time_service_wall_ms();
+    return mono + ((int64_t)wall * 1000 - wall_ms) * 1000;
+}
+
+void time_service_publish(time_step_reason_t reason, int64_t delta_ms)
+{
+    time_step_event_t ev = {.reason = reason, .delta_ms = delta_ms, .mono_us = time_service_mono_us()};
+    time_subscriber_t subs[TIME_SERVICE_MAX_SUBSCRIBERS];
+    portENTER_CRITICAL(&s_lock);
+    uint8_t n = s_sub_count;
+    for (uint8_t i = 0; i < n; i++) {
+        subs[i] = s_subs[i];
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    ESP_LOGI(TAG, "time step: reason=%d delta=%+lldms -> %u subscribers", (int)reason, (long long)delta_ms, (unsigned)n);
+    for (uint8_t i = 0; i < n; i++) {
+        subs[i].cb(&ev, subs[i].ctx);
+    }
+}
+
+void time_service_step_to(int64_t wall_ms, time_step_reason_t reason, uint32_t unc_ms)
+{
+    int64_t raw = raw_ms();
+    int64_t old = rtc_drift_correct_ms(raw);
+    if (reason == TIME_STEP_SYNC) {
+        rtc_drift_on_sync(raw, wall_ms, unc_ms);
+    } else {
+        rtc_drift_on_clock_step();
+    }
+
+    hal_rtc_set_ms(wall_ms);
+
+    time_service_publish(reason, wall_ms - old);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// One place for both clocks and the link between them.
+//
+//  - Monotonic: esp_timer_get_time(), microseconds since boot. Never jumps; use it for durations,
+//    timeouts and deadlines (fades, gradients, "fire at").
+//  - Wall: UTC epoch from the system clock with the rtc_drift.h correction applied. Jumps when
+//    the clock is set; use it only to derive calendar times.
+//
+// Every wall-clock step goes through time_service_step_to(), which notifies subscribers with the
+// size of the jump. Deadlines derived from wall time (next alarm, next display minute) are held on
+// the monotonic clock and recomputed from that event instead of comparing against time() each tick.
+
+typedef enum {
+    TIME_STEP_SYNC = 0, // reference time from the phone (0xFF12, 0xFF1C)
+    TIME_STEP_RESTORE,  // unset clock restored from a snapshot or the build time
+    TIME_STEP_ZONE,     // UTC unchanged, local offset changed (zone selected)
+} time_step_reason_t;
+
+typedef struct {
+    time_step_reason_t reason;
+    int64_t delta_ms; // new - old wall time (TIME_STEP_ZONE: new - old local offset)
+    int64_t mono_us;  // monotonic time of the step
+} time_step_event_t;
+
+// Runs in the context of the task that stepped the clock: keep it short (set a flag, notify).
+typedef void (*time_step_cb_t)(const time_step_event_t *ev, void *ctx);
+
+#define TIME_SERVICE_MAX_SUBSCRIBERS (4)
+
+esp_err_t time_service_subscribe(time_step_cb_t cb, void *ctx);
+
+int64_t time_service_mono_us(void);
+int64_t time_service_wall_ms(void);
+time_t time_service_wall_now(void);
+
+// Monotonic time (us) at which the wall clock will read wall, assuming no further step.
+int64_t time_service_mono_at(time_t wall);
+
+// Sets the wall clock to wall_ms and publishes the step. For TIME_STEP_SYNC the previous reading is
+// handed to rtc_drift as a reference point good to +-unc_ms; for TIME_STEP_RESTORE the drift chain
+// is broken and unc_ms is ignored.
+void time_service_step_to(int64_t wall_ms, time_step_reason_t reason, uint32_t unc_ms);
+
+// Publishes a step the clock itself did not take (TIME_STEP_ZONE).
+void time_service_publish(time_step_reason_t reason, int64_t delta_ms);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,148 @@
+#include "time_sync.h"
+
+#include <string.h>
+
+#include "esp_log.h"
+
+static const char *TAG = "TSYNC";
+
+#define TIME_SYNC_XCHG_LEN (1 + 1 + 8)
+
+static int64_t get_i64_le(const uint8_t *p)
+{
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) {
+        v = (v << 8) | p[i];
+    }
+    return (int64_t)v;
+}
+
+void time_sync_reset(time_sync_t *ts)
+{
+    if (!ts) {
+        return;
+    }
+    memset(ts, 0, sizeof(*ts));
+}
+
+static esp_err_t drop_exchange(time_sync_t *ts, esp_err_t err, const char *why)
+{
+    ESP_LOGW(TAG, "exchange %u dropped: %s", (unsigned)ts->seq, why);
+    ts->have_t2 = false;
+    ts->have_t3 = false;
+    return err;
+}
+
+static esp_err_t finish(time_sync_t *ts, uint8_t seq, int64_t t4_ms)
+{
+    if (!ts->have_t2 || seq != ts->seq) {
+        return drop_exchange(ts, ESP_ERR_INVALID_STATE, "no matching request");
+    }
+    if (!ts->have_t3) {
+        return drop_exchange(ts, ESP_ERR_INVALID_STATE, "not read back");
+    }
+    int64_t phone_us = (t4_ms - ts->t1_ms) * 1000;
+    int64_t device_us = ts->t3_us - ts->t2_us;
+    if (phone_us < 0 || phone_us > (int64_t)TIME_SYNC_MAX_DELAY_MS * 1000 * 2) {
+        return drop_exchange(ts, ESP_ERR_INVALID_ARG, "phone times out of order");
+    }
+    int64_t delay_us = phone_us - device_us;
+    if (delay_us < 0) {
+        // t1/t4 are whole ms: a fast exchange can come out slightly negative.
+        delay_us = 0;
+    }
+    if (delay_us > (int64_t)TIME_SYNC_MAX_DELAY_MS * 1000) {
+        return drop_exchange(ts, ESP_ERR_INVALID_ARG, "too slow");
+    }
+
+    ts->have_t2 = false;
+    ts->have_t3 = false;
+    if (ts->samples < UINT8_MAX) {
+        ts->samples++;
+    }
+    if (!ts->best_valid || (uint32_t)delay_us < ts->best_delay_us) {
+        ts->best_valid = true;
+        ts->best_delay_us = (uint32_t)delay_us;
+        ts->best_mono_us = ts->t2_us + device_us / 2;
+        ts->best_ref_us = ts->t1_ms * 1000 + phone_us / 2;
+    }
+    ESP_LOGI(TAG, "exchange %u: delay %lu us (best %lu us of %u)", (unsigned)seq, (unsigned long)delay_us,
+             (unsigned long)ts->best_delay_us, (unsigned)ts->samples);
+    return ESP_OK;
+}
+
+esp_err_t time_sync_feed(time_sync_t *ts, const uint8_t *data, size_t len, int64_t rx_us, time_sync_result_t *out,
+                         bool *out_ready)
+{
+    if (!ts || !data || len == 0 || !out || !out_ready) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out_ready = false;
+
+    switch (data[0]) {
+    case TIME_SYNC_OP_ABORT:
+        time_sync_reset(ts);
+        return ESP_OK;
+
+    case TIME_SYNC_OP_REQUEST:
+        if (len != TIME_SYNC_XCHG_LEN) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        ts->seq = data[1];
+        ts->t1_ms = get_i64_le(&data[2]);
+        ts->t2_us = rx_us;
+        ts->have_t2 = true;
+        ts->have_t3 = false;
+        return ESP_OK;
+
+    case TIME_SYNC_OP_FINISH:
+        if (len != TIME_SYNC_XCHG_LEN) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        return finish(ts, data[1], get_i64_le(&data[2]));
+
+    case TIME_SYNC_OP_COMMIT:
+        if (len != 1) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        if (!ts->best_valid) {
+            return ESP_ERR_INVALID_STATE;
+        }
+        *out = (time_sync_result_t){
+            .mono_us = ts->best_mono_us,
+            .ref_us = ts->best_ref_us,
+            // Half the delay (unknown split between the legs), rounded up, plus the truncation of the
+            // whole-ms t1/t4 (up to 1 ms on the midpoint, 1 ms on the delay).
+            .unc_ms = (ts->best_delay_us / 2 + 999) / 1000 + 2,
+            .delay_us = ts->best_delay_us,
+            .samples = ts->samples,
+        };
+        *out_ready = true;
+        time_sync_reset(ts);
+        return ESP_OK;
+
+    default:
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+}
+
+size_t time_sync_read(time_sync_t *ts, int64_t at_us, uint8_t *out, size_t cap)
+{
+    if (!ts || !out || cap < TIME_SYNC_STATUS_LEN) {
+        return 0;
+    }
+    // A repeated read restamps: t4 belongs to whichever response the phone saw last.
+    if (ts->have_t2) {
+        ts->t3_us = at_us;
+        ts->have_t3 = true;
+    }
+    uint32_t best_ms = ts->best_valid ? (ts->best_delay_us + 500) / 1000 : UINT16_MAX;
+    if (best_ms > UINT16_MAX) {
+        best_ms = UINT16_MAX;
+    }
+    out[0] = ts->seq;
+    out[1] = ts->samples;
+    out[2] = (uint8_t)(best_ms & 0xFF);
+    out[3] = (uint8_t)(best_ms >> 8);
+    return TIME_SYNC_STATUS_LEN;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Two-way timed sync (0xFF1C), NTP-style. One exchange:
+//   phone writes 0x01 seq(u8) t1(i64)   t1 = phone UTC ms just before the write
+//                                       device: t2 = esp_timer_get_time() as the write arrives
+//   phone reads                         device: t3 = esp_timer_get_time() as it answers
+//   phone writes 0x02 seq(u8) t4(i64)   t4 = phone UTC ms as the read response arrived
+// The phone clock read (t1 + t4) / 2 at device time (t2 + t3) / 2, give or take half the link delay
+// (t4 - t1) - (t3 - t2): a connection interval or two, not the whole write latency as with 0xFF12.
+// Exchanges repeat; only the one with the smallest delay is kept, since queueing and retransmissions
+// only ever add delay. 0x03 commits it; 0x00 drops the session.
+//
+// Read: seq(u8) samples(u8) best_delay_ms(u16), all LE; seq echoes the exchange in flight.
+#define TIME_SYNC_OP_ABORT   (0x00)
+#define TIME_SYNC_OP_REQUEST (0x01)
+#define TIME_SYNC_OP_FINISH  (0x02)
+#define TIME_SYNC_OP_COMMIT  (0x03)
+
+#define TIME_SYNC_STATUS_LEN (4)
+// Exchanges slower than this say more about the link than the clock and are dropped.
+#define TIME_SYNC_MAX_DELAY_MS (2000)
+
+typedef struct {
+    // Exchange in flight.
+    uint8_t seq;
+    bool have_t2;
+    bool have_t3;
+    int64_t t1_ms;
+    int64_t t2_us;
+    int64_t t3_us;
+    // Smallest-delay exchange so far.
+    uint8_t samples;
+    bool best_valid;
+    int64_t best_mono_us; // (t2 + t3) / 2
+    int64_t best_ref_us;  // (t1 + t4) / 2, phone UTC
+    uint32_t best_delay_us;
+} time_sync_t;
+
+typedef struct {
+    int64_t mono_us; // esp_timer_get_time() at which ...
+    int64_t ref_us;  // ... the phone's UTC clock read this
+    uint32_t unc_ms; // error bound: half the delay plus the ms quantization of t1/t4
+    uint32_t delay_us;
+    uint8_t samples;
+} time_sync_result_t;
+
+void time_sync_reset(time_sync_t *ts);
+
+// Feeds one write; rx_us is esp_timer_get_time() taken when the write event arrived. Returns ESP_OK
+// when accepted; *out_ready is set (and out filled) only by a commit with at least one exchange.
+// A bad exchange is dropped without losing the samples already taken.
+esp_err_t time_sync_feed(time_sync_t *ts, const uint8_t *data, size_t len, int64_t rx_us, time_sync_result_t *out,
+                         bool *out_ready);
+
+// Answers a read (t3 = at_us) into out[TIME_SYNC_STATUS_LEN]; returns the length.
+size_t time_sync_read(time_sync_t *ts, int64_t at_us, uint8_t *out, size_t cap);
+
+// Phone UTC ms at monotonic time mono_us, per the committed exchange.
+static inline int64_t time_sync_utc_ms_at(const time_sync_result_t *res, int64_t mono_us)
+{
+    return (res->ref_us + (mono_us - res->mono_us)) / 1000;
+}
+
+#ifdef __cplusplus
+}
+#endif
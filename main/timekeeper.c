@@ -6,9 +6,15 @@
 #include "esp_log.h"
 #include "sys/time.h"
 
+#include "civil_time.h"
+#include "rtc_drift.h"
+#include "time_persist.h"
+#include "time_service.h"
+#include "tz.h"
+
 static const char *TAG = "TIME";
 
-static bool parse_build_time(struct tm *out)
+static bool parse_build_time(civil_time_t *out)
 {
     if (!out) {
         return false;
@@ -37,16 +43,20 @@ static bool parse_build_time(struct tm *out)
     int mon = (int)((p - months) / 3);
 
     memset(out, 0, sizeof(*out));
-    out->tm_year = year - 1900;
-    out->tm_mon = mon;
-    out->tm_mday = day;
-    out->tm_hour = hour;
-    out->tm_min = minute;
-    out->tm_sec = second;
-    out->tm_isdst = -1;
+    out->year = year;
+    out->month = (uint8_t)(mon + 1);
+    out->day = (uint8_t)day;
+    out->hour = (uint8_t)hour;
+    out->minute = (uint8_t)minute;
+    out->second = (uint8_t)second;
     return true;
 }
 
+time_t timekeeper_now(void)
+{
+    return time_service_wall_now();
+}
+
 bool timekeeper_is_time_sane(time_t now)
 {
     // 2023-01-01 00:00:00 UTC
@@ -55,66 +65,68 @@ bool timekeeper_is_time_sane(time_t now)
 
 void timekeeper_init_if_unset(void)
 {
-    time_t now = time(NULL);
+    time_t now = timekeeper_now();
     if (timekeeper_is_time_sane(now)) {
         return;
     }
 
-    struct tm tm_build;
-    if (!parse_build_time(&tm_build)) {
-        ESP_LOGW(TAG, "Time not set and build time parse failed");
+    // A snapshot from before the reset beats the build time by however long the firmware has been
+    // in the field; even the NVS one (power loss) is a tighter lower bound.
+    int64_t est_ms = 0;
+    uint32_t bound_ms = 0;
+    if (time_persist_restore(&est_ms, &bound_ms)) {
+        time_persist_note_estimate(bound_ms);
+        time_service_step_to(est_ms, TIME_STEP_RESTORE, 0);
+        if (bound_ms == TIME_PERSIST_BOUND_UNKNOWN) {
+            ESP_LOGW(TAG, "RTC time was unset; restored last saved time (lower bound, approximate)");
+        } else {
+            ESP_LOGW(TAG, "RTC time was unset; restored last snapshot (+/-%lu ms)", (unsigned long)bound_ms);
+        }
         return;
     }
 
-    time_t t = mktime(&tm_build);
-    if (t < 0) {
-        ESP_LOGW(TAG, "Time not set and build time mktime failed");
+    civil_time_t build;
+    if (!parse_build_time(&build)) {
+        ESP_LOGW(TAG, "Time not set and build time parse failed");
         return;
     }
 
-    struct timeval tv = {.tv_sec = t, .tv_usec = 0};
-    settimeofday(&tv, NULL);
+    // The build wall-clock time is taken as local time in the selected zone.
+    time_persist_note_estimate(TIME_PERSIST_BOUND_UNKNOWN);
+    time_service_step_to((int64_t)tz_local_to_utc((time_t)civil_to_seconds(&build)) * 1000, TIME_STEP_RESTORE, 0);
     ESP_LOGW(TAG, "RTC time was unset; set to build time");
 }
 
-int64_t timekeeper_seconds_until_next_alarm(const device_config_t *cfg, time_t now)
+int64_t timekeeper_seconds_until_next_alarm(const alarm_sched_t *sched, time_t now, uint8_t *out_slot, bool *out_skip)
 {
-    if (!cfg || !timekeeper_is_time_sane(now)) {
-        return 60;
+    if (alarm_sched_is_empty(sched)) {
+        return -1;
     }
-
-    uint8_t sunrise_min = cfg->sunrise_duration;
-    if (sunrise_min < 1 || sunrise_min > 60) {
-        sunrise_min = DEVICE_CONFIG_DEFAULT_SUNRISE_DURATION_MINUTES;
-        if (sunrise_min < 1) sunrise_min = 1;
-        if (sunrise_min > 60) sunrise_min = 60;
-    }
-
-    struct tm local;
-    localtime_r(&now, &local);
-
-    struct tm target = local;
-    target.tm_hour = cfg->alarm_hour;
-    target.tm_min = cfg->alarm_minute;
-    target.tm_sec = 0;
-
-    time_t target_t = mktime(&target);
-    if (target_t < 0) {
+    if (!timekeeper_is_time_sane(now)) {
         return 60;
     }
 
-    if (target_t <= now) {
-        target_t += 24 * 60 * 60;
+    // Pure integer arithmetic on local epoch seconds: no struct tm, no mktime/localtime_r.
+    int64_t local = (int64_t)tz_utc_to_local(now);
+    alarm_sched_hit_t hit;
+    if (!alarm_sched_next_at(sched, local, &hit)) {
+        return -1;
     }
 
-    // Sunrise starts before the alarm.
-    time_t sunrise_t = target_t - (time_t)sunrise_min * 60;
+    // The schedule works in local wall-clock minutes. Map the target local time back through the zone
+    // so a DST change between now and the sunrise start shifts the result by the offset change.
+    time_t sunrise_t = tz_local_to_utc((time_t)hit.start_local);
     if (sunrise_t <= now) {
-        // If we are already past today's sunrise start, schedule the next day.
-        // This avoids immediate re-trigger loops after the user cancels the sunrise simulation.
-        sunrise_t += 24 * 60 * 60;
+        // Fall-back hour repeats local times; the occurrence is already behind us.
+        sunrise_t = now + (time_t)(hit.start_local - local);
     }
 
+    if (out_slot) {
+        *out_slot = hit.slot;
+    }
+    if (out_skip) {
+        *out_skip = hit.skip;
+    }
     int64_t delta = (int64_t)(sunrise_t - now);
     if (delta < 1) {
         delta = 1;
@@ -131,28 +143,61 @@ bool timekeeper_set_local_hhmmss(uint8_t hour, uint8_t minute, uint8_t second)
     // Ensure we have at least a sane date.
     timekeeper_init_if_unset();
 
-    time_t now = time(NULL);
+    time_t now = timekeeper_now();
     if (!timekeeper_is_time_sane(now)) {
         ESP_LOGW(TAG, "time still not sane after init; refusing to set HHMMSS");
         return false;
     }
 
-    struct tm local;
-    localtime_r(&now, &local);
-
-    local.tm_hour = hour;
-    local.tm_min = minute;
-    local.tm_sec = second;
-    local.tm_isdst = -1;
+    // HHMMSS has no date: take the local day (yesterday, today or tomorrow) that puts the new time
+    // nearest the current one, so a sync across local midnight does not move the clock by a day.
+    int64_t local = (int64_t)tz_utc_to_local(now);
+    int64_t midnight = (int64_t)civil_days_of(local) * CIVIL_SECS_PER_DAY;
+    int64_t tod = (int64_t)hour * 3600 + (int64_t)minute * 60 + second;
+    time_t t = 0;
+    int64_t best = INT64_MAX;
+    for (int64_t day = -1; day <= 1; day++) {
+        time_t cand = tz_local_to_utc((time_t)(midnight + day * CIVIL_SECS_PER_DAY + tod));
+        int64_t dist = (int64_t)cand - (int64_t)now;
+        if (dist < 0) {
+            dist = -dist;
+        }
+        if (dist < best) {
+            best = dist;
+            t = cand;
+        }
+    }
+
+    // The reference only has whole seconds and the phone truncates; centre the quantization error.
+    time_persist_note_sync(RTC_DRIFT_HHMMSS_UNC_MS);
+    time_service_step_to((int64_t)t * 1000 + 500, TIME_STEP_SYNC, RTC_DRIFT_HHMMSS_UNC_MS);
+    ESP_LOGI(TAG, "RTC time set to %02u:%02u:%02u (local, %s)", (unsigned)hour, (unsigned)minute, (unsigned)second,
+             tz_zone_name(tz_get_zone()));
+    return true;
+}
 
-    time_t t = mktime(&local);
-    if (t < 0) {
-        ESP_LOGW(TAG, "mktime failed while setting HHMMSS");
+bool timekeeper_set_utc_ms(int64_t utc_ms, uint32_t unc_ms)
+{
+    if (!timekeeper_is_time_sane((time_t)(utc_ms / 1000))) {
+        ESP_LOGW(TAG, "refusing reference time %lld ms", (long long)utc_ms);
         return false;
     }
-
-    struct timeval tv = {.tv_sec = t, .tv_usec = 0};
-    settimeofday(&tv, NULL);
-    ESP_LOGI(TAG, "RTC time set to %02u:%02u:%02u (local)", (unsigned)hour, (unsigned)minute, (unsigned)second);
+    time_persist_note_sync(unc_ms);
+    time_service_step_to(utc_ms, TIME_STEP_SYNC, unc_ms);
+    ESP_LOGI(TAG, "RTC time set to %lld ms UTC (+-%lu ms)", (long long)utc_ms, (unsigned long)unc_ms);
     return true;
 }
+
+bool timekeeper_get_local(time_t now, timekeeper_local_t *out)
+{
+    if (!out) {
+        return false;
+    }
+    civil_time_t ct;
+    civil_from_seconds((int64_t)tz_utc_to_local(now), &ct);
+    out->hour = ct.hour;
+    out->minute = ct.minute;
+    out->second = ct.second;
+    out->wday = ct.wday;
+    return timekeeper_is_time_sane(now);
+}
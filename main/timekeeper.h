@@ -4,25 +4,47 @@
 #include <stdint.h>
 #include <time.h>
 
-#include "device_config.h"
+#include "alarm_sched.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-// If RTC time looks unset, set it to build time (best-effort).
+// System time is UTC; local time comes from the zone selected in tz.h.
+// If RTC time looks unset, restore the last-known time from time_persist.h, or else set it to
+// build time (best-effort). Either way the time is then marked approximate until the next sync.
 void timekeeper_init_if_unset(void);
 
 bool timekeeper_is_time_sane(time_t now);
 
-// Returns seconds until next sunrise-start time (>=1), i.e. alarm time minus cfg->sunrise_duration minutes.
-// Falls back to 60s if time is not sane.
-int64_t timekeeper_seconds_until_next_alarm(const device_config_t *cfg, time_t now);
+// Current UTC time with the RTC drift correction applied (time_service_wall_now()). Use instead of time().
+time_t timekeeper_now(void);
 
-// Sets current local time-of-day (HH:MM:SS) while keeping the current date.
-// If RTC time looks unset, this will first set it to build time and then apply HHMMSS.
+// Returns seconds until the next sunrise-start time (>=1) over all scheduled alarms (weekly and one-shot,
+// skip dates applied), i.e. an alarm time minus that alarm's sunrise_duration. out_slot (optional) receives
+// the alarm slot; out_skip (optional) is set when that occurrence is consumed by the slot's skip_next.
+// Returns -1 if no alarm is scheduled; falls back to 60s if time is not sane.
+int64_t timekeeper_seconds_until_next_alarm(const alarm_sched_t *sched, time_t now, uint8_t *out_slot, bool *out_skip);
+
+// Sets current local time-of-day (HH:MM:SS, in the tz.h zone) while keeping the current local date.
+// The system clock itself stays UTC. Each call is also a reference point for drift estimation. If RTC time looks unset, this will first set it to build time
+// and then apply HHMMSS.
 bool timekeeper_set_local_hhmmss(uint8_t hour, uint8_t minute, uint8_t second);
 
+// Sets the clock to a full UTC reference good to +-unc_ms (timed exchange, time_sync.h). Also a drift
+// reference point, weighted by unc_ms. Returns false for an insane time.
+bool timekeeper_set_utc_ms(int64_t utc_ms, uint32_t unc_ms);
+
+typedef struct {
+    uint8_t hour;
+    uint8_t minute;
+    uint8_t second;
+    uint8_t wday; // 0 = Sunday
+} timekeeper_local_t;
+
+// Local wall-clock fields of now in the selected zone. Returns false if now is not a sane time.
+bool timekeeper_get_local(time_t now, timekeeper_local_t *out);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,240 @@
+#include "timer_wheel.h"
+
+#include <stddef.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "TWHEEL";
+
+#define STATS_PERIOD_US (60ULL * 60ULL * 1000000ULL)
+#define STATS_SLACK_US (60U * 1000000U)
+
+static SemaphoreHandle_t s_lock;
+static esp_timer_handle_t s_hw;
+static int64_t s_hw_at = INT64_MAX; // window end the hardware timer is armed for
+static bool s_dispatching;
+static timer_wheel_timer_t *s_head; // sorted by due_us
+static timer_wheel_stats_t s_stats;
+
+static timer_wheel_timer_t s_stats_timer;
+static timer_wheel_stats_t s_stats_last;
+
+static void unlink_locked(timer_wheel_timer_t *t)
+{
+    for (timer_wheel_timer_t **pp = &s_head; *pp; pp = &(*pp)->next) {
+        if (*pp == t) {
+            *pp = t->next;
+            break;
+        }
+    }
+    t->next = NULL;
+    t->armed = false;
+}
+
+static void insert_locked(timer_wheel_timer_t *t)
+{
+    timer_wheel_timer_t **pp = &s_head;
+    // Equal deadlines keep arming order.
+    while (*pp && (*pp)->due_us <= t->due_us) {
+        pp = &(*pp)->next;
+    }
+    t->next = *pp;
+    *pp = t;
+    t->armed = true;
+}
+
+static void rearm_locked(void)
+{
+    if (s_dispatching) {
+        // The dispatch loop re-arms once it is done.
+        return;
+    }
+    int64_t at = INT64_MAX;
+    for (const timer_wheel_timer_t *t = s_head; t; t = t->next) {
+        int64_t end = t->due_us + (int64_t)t->slack_us;
+        if (end < at) {
+            at = end;
+        }
+        if (t->due_us >= at) {
+            // Sorted by due: no later timer can close its window earlier.
+            break;
+        }
+    }
+    if (at == s_hw_at) {
+        return;
+    }
+    (void)esp_timer_stop(s_hw);
+    s_hw_at = at;
+    if (at == INT64_MAX) {
+        return;
+    }
+    int64_t delay_us = at - esp_timer_get_time();
+    esp_err_t err = esp_timer_start_once(s_hw, delay_us > 0 ? (uint64_t)delay_us : 0);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "hw timer start failed: %s", esp_err_to_name(err));
+        s_hw_at = INT64_MAX;
+    }
+}
+
+static void hw_timer_cb(void *arg)
+{
+    (void)arg;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_hw_at = INT64_MAX;
+    s_dispatching = true;
+    s_stats.wakeups++;
+    uint32_t n = 0;
+    for (;;) {
+        int64_t now = esp_timer_get_time();
+        timer_wheel_timer_t *t = s_head;
+        if (!t || t->due_us > now) {
+            break;
+        }
+        unlink_locked(t);
+        if (t->period_us) {
+            // Skip missed periods rather than firing a burst of them.
+            int64_t late = now - t->due_us;
+            t->due_us += ((late / t->period_us) + 1) * (int64_t)t->period_us;
+            insert_locked(t);
+        }
+        timer_wheel_cb_t cb = t->cb;
+        void *cb_arg = t->arg;
+        xSemaphoreGive(s_lock);
+        cb(cb_arg);
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        n++;
+    }
+    s_stats.fired += n;
+    if (n > 1) {
+        s_stats.coalesced += n - 1;
+    }
+    s_dispatching = false;
+    rearm_locked();
+    xSemaphoreGive(s_lock);
+}
+
+static void stats_timer_cb(void *arg)
+{
+    (void)arg;
+    timer_wheel_stats_t st;
+    timer_wheel_get_stats(&st);
+    uint32_t wakeups = st.wakeups - s_stats_last.wakeups;
+    uint32_t fired = st.fired - s_stats_last.fired;
+    s_stats_last = st;
+    ESP_LOGI(TAG, "last hour: %lu callbacks in %lu wakeups (%lu saved), %u armed",
+             (unsigned long)fired, (unsigned long)wakeups, (unsigned long)(fired - wakeups), (unsigned)st.armed);
+}
+
+esp_err_t timer_wheel_init(void)
+{
+    if (s_lock) {
+        return ESP_OK;
+    }
+    s_lock = xSemaphoreCreateMutex();
+    if (!s_lock) {
+        return ESP_ERR_NO_MEM;
+    }
+    const esp_timer_create_args_t args = {
+        .callback = &hw_timer_cb,
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "twheel",
+        .skip_unhandled_events = true,
+    };
+    esp_err_t err = esp_timer_create(&args, &s_hw);
+    if (err != ESP_OK) {
+        vSemaphoreDelete(s_lock);
+        s_lock = NULL;
+        return err;
+    }
+    timer_wheel_timer_init(&s_stats_timer, "tw_stats", stats_timer_cb, NULL);
+    return timer_wheel_start_periodic(&s_stats_timer, STATS_PERIOD_US, STATS_SLACK_US);
+}
+
+void timer_wheel_timer_init(timer_wheel_timer_t *t, const char *name, timer_wheel_cb_t cb, void *arg)
+{
+    if (!t) {
+        return;
+    }
+    *t = (timer_wheel_timer_t){.cb = cb, .arg = arg, .name = name};
+}
+
+static esp_err_t start(timer_wheel_timer_t *t, int64_t due_us, uint64_t period_us, uint32_t slack_us)
+{
+    if (!t || !t->cb || period_us > UINT32_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_lock) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (t->armed) {
+        unlink_locked(t);
+    }
+    t->due_us = due_us;
+    t->period_us = (uint32_t)period_us;
+    t->slack_us = slack_us;
+    insert_locked(t);
+    rearm_locked();
+    xSemaphoreGive(s_lock);
+    return ESP_OK;
+}
+
+esp_err_t timer_wheel_start_at(timer_wheel_timer_t *t, int64_t due_us, uint32_t slack_us)
+{
+    return start(t, due_us, 0, slack_us);
+}
+
+esp_err_t timer_wheel_start_once(timer_wheel_timer_t *t, uint64_t delay_us, uint32_t slack_us)
+{
+    return start(t, esp_timer_get_time() + (int64_t)delay_us, 0, slack_us);
+}
+
+esp_err_t timer_wheel_start_periodic(timer_wheel_timer_t *t, uint64_t period_us, uint32_t slack_us)
+{
+    if (period_us == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return start(t, esp_timer_get_time() + (int64_t)period_us, period_us, slack_us);
+}
+
+void timer_wheel_stop(timer_wheel_timer_t *t)
+{
+    if (!t || !s_lock) {
+        return;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (t->armed) {
+        unlink_locked(t);
+        rearm_locked();
+    }
+    xSemaphoreGive(s_lock);
+}
+
+bool timer_wheel_is_armed(const timer_wheel_timer_t *t)
+{
+    return t && t->armed;
+}
+
+void timer_wheel_get_stats(timer_wheel_stats_t *out)
+{
+    if (!out) {
+        return;
+    }
+    if (!s_lock) {
+        *out = (timer_wheel_stats_t){0};
+        return;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    *out = s_stats;
+    uint8_t armed = 0;
+    for (const timer_wheel_timer_t *t = s_head; t; t = t->next) {
+        armed++;
+    }
+    out->armed = armed;
+    xSemaphoreGive(s_lock);
+}
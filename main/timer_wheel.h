@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// All firmware deadlines on one hardware one-shot timer.
+//
+// Timers are caller-owned structs kept in one list sorted by deadline. Each has a coalescing
+// window: it may fire anywhere in [due, due + slack]. The hardware timer is armed for the earliest
+// window end, and when it fires every timer whose window has opened runs in the same wakeup. So a
+// 60 s battery sample with 5 s of slack and the time snapshot (60 s, 15 s of slack) share one wakeup
+// instead of waking the CPU twice a minute.
+//
+// Callbacks run in the esp_timer task (like ESP_TIMER_TASK callbacks did) without the wheel lock
+// held: they may start or stop any timer, including their own. Keep them short.
+
+typedef void (*timer_wheel_cb_t)(void *arg);
+
+typedef struct timer_wheel_timer {
+    // Private: set up with timer_wheel_timer_init() and left to the wheel.
+    struct timer_wheel_timer *next;
+    timer_wheel_cb_t cb;
+    void *arg;
+    const char *name;
+    int64_t due_us;     // monotonic (esp_timer_get_time)
+    uint32_t period_us; // 0: one-shot
+    uint32_t slack_us;
+    bool armed;
+} timer_wheel_timer_t;
+
+typedef struct {
+    uint32_t wakeups;   // hardware timer expirations
+    uint32_t fired;     // callbacks run; without coalescing each would have been a wakeup
+    uint32_t coalesced; // callbacks that ran in a wakeup armed for another timer
+    uint8_t armed;      // timers currently armed
+} timer_wheel_stats_t;
+
+// Creates the hardware timer and the hourly stats log. Call once, before the first start.
+esp_err_t timer_wheel_init(void);
+
+void timer_wheel_timer_init(timer_wheel_timer_t *t, const char *name, timer_wheel_cb_t cb, void *arg);
+
+// (Re)arms t; an armed timer is moved, not duplicated.
+esp_err_t timer_wheel_start_at(timer_wheel_timer_t *t, int64_t due_us, uint32_t slack_us);
+esp_err_t timer_wheel_start_once(timer_wheel_timer_t *t, uint64_t delay_us, uint32_t slack_us);
+// Periodic timers keep their phase: the next deadline is due + period, not "fired + period".
+esp_err_t timer_wheel_start_periodic(timer_wheel_timer_t *t, uint64_t period_us, uint32_t slack_us);
+
+void timer_wheel_stop(timer_wheel_timer_t *t);
+bool timer_wheel_is_armed(const timer_wheel_timer_t *t);
+
+void timer_wheel_get_stats(timer_wheel_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,211 @@
+#include "tz.h"
+
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+
+#include "esp_log.h"
+
+#include "civil_time.h"
+
+static const char *TAG = "TZ";
+
+typedef struct {
+    uint8_t month; // 1..12
+    uint8_t week;  // 1..4, 5 = last
+    uint8_t wday;  // 0 = Sunday
+    bool utc;      // at_min is UTC instead of local wall time before the change
+    uint16_t at_min;
+} tz_when_t;
+
+typedef struct {
+    tz_when_t start; // standard -> daylight
+    tz_when_t end;   // daylight -> standard
+} tz_rule_t;
+
+typedef enum {
+    TZ_RULE_NONE = 0,
+    TZ_RULE_EU,
+    TZ_RULE_US,
+    TZ_RULE_AU,
+    TZ_RULE_NZ,
+} tz_rule_id_t;
+
+static const tz_rule_t s_rules[] = {
+    [TZ_RULE_EU] = {.start = {3, 5, 0, true, 60}, .end = {10, 5, 0, true, 60}},      // M3.5.0/1 UTC, M10.5.0/1 UTC
+    [TZ_RULE_US] = {.start = {3, 2, 0, false, 120}, .end = {11, 1, 0, false, 120}},   // M3.2.0/2, M11.1.0/2
+    [TZ_RULE_AU] = {.start = {10, 1, 0, false, 120}, .end = {4, 1, 0, false, 180}},   // M10.1.0/2, M4.1.0/3
+    [TZ_RULE_NZ] = {.start = {9, 5, 0, false, 120}, .end = {4, 1, 0, false, 180}},    // M9.5.0/2, M4.1.0/3
+};
+
+typedef struct {
+    const char *name;
+    int16_t std_min;
+    uint8_t dst_delta_min;
+    uint8_t rule; // tz_rule_id_t
+} tz_zone_def_t;
+
+static const tz_zone_def_t s_zones[TZ_ZONE_COUNT] = {
+#define TZ_X_DEF(id_, name_, std_, dst_, rule_) \
+    [TZ_ZONE_##id_] = {.name = (name_), .std_min = (std_), .dst_delta_min = (dst_), .rule = TZ_RULE_##rule_},
+    TZ_ZONES(TZ_X_DEF)
+#undef TZ_X_DEF
+};
+
+#define TZ_MAX_TRANSITIONS (2 * (TZ_TABLE_LAST_YEAR - TZ_TABLE_FIRST_YEAR + 1))
+
+// Transitions alternate strictly between standard and daylight time, so the table only stores the
+// instants; the offset of interval i follows from its parity.
+typedef struct {
+    uint8_t zone;
+    uint16_t count;
+    bool first_is_dst; // state entered at at[0]
+    int32_t std_s;
+    int32_t dst_s;
+    // Interval hint: index of the last transition at or before the previous query (-1 = before at[0]).
+    int32_t hint;
+    uint32_t at[TZ_MAX_TRANSITIONS];
+} tz_table_t;
+
+// A zone change builds its table aside and swaps it in under s_lock; lookups hold s_lock too, so
+// they never see a table (or a hint) from two different zones, whichever task changes the zone.
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static tz_table_t s_table = {.hint = -1};
+
+static int32_t rule_day(int32_t year, const tz_when_t *w)
+{
+    int32_t first = civil_days_from_date(year, w->month, 1);
+    int32_t day = 1 + (w->wday - civil_weekday(first) + 7) % 7 + 7 * (w->week - 1);
+    int32_t last = civil_days_in_month(year, w->month);
+    while (day > last) {
+        day -= 7;
+    }
+    return first + day - 1;
+}
+
+// before_s is the offset in force just before the change (for wall-clock rules).
+static uint32_t rule_utc(int32_t year, const tz_when_t *w, int32_t before_s)
+{
+    int64_t t = (int64_t)rule_day(year, w) * 86400 + (int64_t)w->at_min * 60;
+    if (!w->utc) {
+        t -= before_s;
+    }
+    return (uint32_t)t;
+}
+
+static void build_table(uint8_t zone, tz_table_t *t)
+{
+    const tz_zone_def_t *z = &s_zones[zone];
+    t->zone = zone;
+    t->std_s = (int32_t)z->std_min * 60;
+    t->dst_s = t->std_s + (int32_t)z->dst_delta_min * 60;
+    t->count = 0;
+    t->hint = -1;
+    t->first_is_dst = false;
+    if (z->rule == TZ_RULE_NONE || z->dst_delta_min == 0) {
+        return;
+    }
+
+    const tz_rule_t *r = &s_rules[z->rule];
+    // Northern rules start DST earlier in the year than they end it; southern ones the reverse.
+    bool southern = r->start.month > r->end.month;
+    t->first_is_dst = !southern;
+    for (int32_t y = TZ_TABLE_FIRST_YEAR; y <= TZ_TABLE_LAST_YEAR; y++) {
+        uint32_t start = rule_utc(y, &r->start, t->std_s);
+        uint32_t end = rule_utc(y, &r->end, t->dst_s);
+        t->at[t->count++] = southern ? end : start;
+        t->at[t->count++] = southern ? start : end;
+    }
+}
+
+bool tz_set_zone(uint8_t zone)
+{
+    bool ok = zone < TZ_ZONE_COUNT;
+    tz_table_t next;
+    build_table(ok ? zone : TZ_ZONE_UTC, &next);
+    portENTER_CRITICAL(&s_lock);
+    s_table = next;
+    portEXIT_CRITICAL(&s_lock);
+    ESP_LOGI(TAG, "zone %u %s std=%+ldmin dst=%+ldmin transitions=%u", (unsigned)next.zone, s_zones[next.zone].name,
+             (long)(next.std_s / 60), (long)(next.dst_s / 60), (unsigned)next.count);
+    return ok;
+}
+
+uint8_t tz_get_zone(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    uint8_t zone = s_table.zone;
+    portEXIT_CRITICAL(&s_lock);
+    return zone;
+}
+
+const char *tz_zone_name(uint8_t zone)
+{
+    return zone < TZ_ZONE_COUNT ? s_zones[zone].name : NULL;
+}
+
+static int32_t interval_offset(const tz_table_t *t, int32_t idx)
+{
+    // idx = -1 is the state before the first transition, i.e. the opposite of what at[0] enters.
+    bool dst = ((idx & 1) == 0) ? t->first_is_dst : !t->first_is_dst;
+    return dst ? t->dst_s : t->std_s;
+}
+
+// True if utc lies in interval idx: [at[idx], at[idx + 1]), open-ended at both table ends.
+static bool in_interval(const tz_table_t *t, int32_t idx, int64_t utc)
+{
+    return (idx < 0 || utc >= (int64_t)t->at[idx]) && (idx + 1 >= (int32_t)t->count || utc < (int64_t)t->at[idx + 1]);
+}
+
+// Called with s_lock held.
+static int32_t offset_at_locked(tz_table_t *t, time_t utc)
+{
+    if (t->count == 0) {
+        return t->std_s;
+    }
+    // Queries come from "now" and nearby alarm times, so the previous or next interval almost
+    // always matches; the binary search only runs after a zone change or a clock jump.
+    int32_t i = t->hint;
+    if (!in_interval(t, i, utc)) {
+        if (i + 1 < (int32_t)t->count && in_interval(t, i + 1, utc)) {
+            i++;
+        } else {
+            int32_t lo = 0, hi = (int32_t)t->count;
+            while (lo < hi) {
+                int32_t mid = (lo + hi) / 2;
+                if ((int64_t)t->at[mid] <= (int64_t)utc) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+            i = lo - 1;
+        }
+        t->hint = i;
+    }
+    return interval_offset(t, i);
+}
+
+int32_t tz_offset_at(time_t utc)
+{
+    portENTER_CRITICAL(&s_lock);
+    int32_t off = offset_at_locked(&s_table, utc);
+    portEXIT_CRITICAL(&s_lock);
+    return off;
+}
+
+time_t tz_local_to_utc(time_t local)
+{
+    portENTER_CRITICAL(&s_lock);
+    tz_table_t *t = &s_table;
+    // A local time is valid for offset o iff the offset in force at (local - o) is o.
+    // Try daylight first so a repeated (fall-back) local time resolves to its first occurrence.
+    // Spring-forward gap: local does not exist, and local - std lands after the change, shifted
+    // forward by the gap length.
+    time_t utc = local - t->dst_s;
+    if (offset_at_locked(t, utc) != t->dst_s) {
+        utc = local - t->std_s;
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return utc;
+}
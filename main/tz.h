@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Timezone subsystem. The system clock (time(), settimeofday()) always holds UTC; local time is
+// UTC plus the offset of the selected zone, looked up from a transition table that is built once
+// when the zone is selected. newlib's TZ/localtime_r/mktime are not used for local time.
+//
+// DST rules use the POSIX "Mm.w.d/time" form: month, week (5 = last), weekday, at a wall-clock
+// minute that is either UTC (EU) or the local time in force just before the change.
+//
+//   X(ID, name, std_offset_min, dst_delta_min, rule)
+#define TZ_ZONES(X)                                          \
+    X(UTC,              "UTC",                    0,  0, NONE) \
+    X(EUROPE_LONDON,    "Europe/London",          0, 60, EU)   \
+    X(EUROPE_BERLIN,    "Europe/Berlin",         60, 60, EU)   \
+    X(EUROPE_ATHENS,    "Europe/Athens",        120, 60, EU)   \
+    X(EUROPE_MOSCOW,    "Europe/Moscow",        180,  0, NONE) \
+    X(ASIA_DUBAI,       "Asia/Dubai",           240,  0, NONE) \
+    X(ASIA_KOLKATA,     "Asia/Kolkata",         330,  0, NONE) \
+    X(ASIA_SHANGHAI,    "Asia/Shanghai",        480,  0, NONE) \
+    X(ASIA_TOKYO,       "Asia/Tokyo",           540,  0, NONE) \
+    X(AUSTRALIA_SYDNEY, "Australia/Sydney",     600, 60, AU)   \
+    X(PACIFIC_AUCKLAND, "Pacific/Auckland",     720, 60, NZ)   \
+    X(AMERICA_SAO_PAULO, "America/Sao_Paulo",  -180,  0, NONE) \
+    X(AMERICA_NEW_YORK, "America/New_York",    -300, 60, US)   \
+    X(AMERICA_CHICAGO,  "America/Chicago",     -360, 60, US)   \
+    X(AMERICA_DENVER,   "America/Denver",      -420, 60, US)   \
+    X(AMERICA_PHOENIX,  "America/Phoenix",     -420,  0, NONE) \
+    X(AMERICA_LOS_ANGELES, "America/Los_Angeles", -480, 60, US)
+
+typedef enum {
+#define TZ_X_ENUM(id_, name_, std_, dst_, rule_) TZ_ZONE_##id_,
+    TZ_ZONES(TZ_X_ENUM)
+#undef TZ_X_ENUM
+    TZ_ZONE_COUNT,
+} tz_zone_t;
+
+// Transition tables cover these years; outside them the nearest table state is held.
+#define TZ_TABLE_FIRST_YEAR (2023)
+#define TZ_TABLE_LAST_YEAR  (2063)
+
+// Selects a zone and rebuilds its transition table. Unknown ids fall back to UTC (returns false).
+// Safe against lookups on other tasks: they see either the old zone or the new one.
+bool tz_set_zone(uint8_t zone);
+uint8_t tz_get_zone(void);
+const char *tz_zone_name(uint8_t zone);
+
+// Offset (seconds) of local time from UTC at utc. O(1) for successive nearby queries.
+int32_t tz_offset_at(time_t utc);
+
+static inline time_t tz_utc_to_local(time_t utc)
+{
+    return utc + tz_offset_at(utc);
+}
+
+// Local wall-clock seconds (same epoch as UTC) to UTC. A local time skipped by a spring-forward
+// gap maps to the same distance after the gap; a repeated local time maps to its first occurrence.
+time_t tz_local_to_utc(time_t local);
+
+#ifdef __cplusplus
+}
+#endif
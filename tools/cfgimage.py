@@ -0,0 +1,347 @@
+#!/usr/bin/env python3
+"""Builds, validates and dumps LightClock config images (characteristic 0xFF1A).
+
+The image is the firmware's config blob (main/device_config.c), little-endian:
+  magic(u16 0x434C) version(u8) reserved(u8, 0 from v3) crc32(u32, over payload)
+  payload v5:
+    color_temp(u8) wake_bright(u8) used_alarms(u16 bitmap)
+    per used alarm, in slot order, one packed u32:
+      [0..10] minute of day  [11] enabled  [12..18] weekdays  [19..24] sunrise  [25..31] wake_bright
+    used_presets(u8 bitmap)
+    per used preset, in slot order:
+      brightness(u8) color_temp(u8) curve(u8) fade_ds(u8) name_len(u8) name[name_len]
+    tz_zone(u8, index into ZONES)
+    dated_alarms(u16 bitmap), per dated alarm in slot order: year-2000(u8) month(u8) day(u8)
+    skip_next(u16 bitmap)
+    used_skips(u8 bitmap), per used skip entry in order: year-2000(u8) month(u8) day(u8) slots(u16)
+
+An alarm with a "date" (YYYY-MM-DD) is a one-shot: it rings on that date only and the device
+disables it afterwards; its weekdays are ignored. "skip_next": true cancels the next occurrence.
+"skips" lists dates on which the given alarm slots (default all) stay silent.
+
+Value ranges mirror main/config_schema.h; keep both in sync.
+
+  cfgimage.py build fleet.json -o fleet.bin
+  cfgimage.py validate fleet.bin
+  cfgimage.py dump fleet.bin > fleet.json
+  cfgimage.py chunks fleet.bin --mtu 23    # hex of each 0xFF1A write, in order
+"""
+import argparse
+import calendar
+import json
+import struct
+import sys
+import zlib
+
+MAGIC = 0x434C
+VERSION = 5
+HDR_LEN = 8
+MAX_PAYLOAD = 384
+MAX_ALARMS = 16
+MAX_PRESETS = 8
+MAX_SKIPS = 8
+PRESET_NAME_MAX = 11
+PRESET_FMT = '<BBBBB'  # brightness, color_temp, curve, fade_ds, name_len
+
+CURVES = ['linear', 'ease_in', 'ease_out']
+# Zone ids, in TZ_ZONES order (main/tz.h).
+ZONES = ['UTC', 'Europe/London', 'Europe/Berlin', 'Europe/Athens', 'Europe/Moscow', 'Asia/Dubai', 'Asia/Kolkata',
+         'Asia/Shanghai', 'Asia/Tokyo', 'Australia/Sydney', 'Pacific/Auckland', 'America/Sao_Paulo',
+         'America/New_York', 'America/Chicago', 'America/Denver', 'America/Phoenix', 'America/Los_Angeles']
+WEEKDAYS = ['sun', 'mon', 'tue', 'wed', 'thu', 'fri', 'sat']  # bit 0 = Sunday (tm_wday)
+
+# (min, max) per field, from CONFIG_SCHEMA_FIELDS.
+RANGES = {
+    'color_temp': (0, 100),
+    'wake_bright': (0, 100),
+    'tz_zone': (0, len(ZONES) - 1),
+    'alarm.hour': (0, 23),
+    'alarm.minute': (0, 59),
+    'alarm.weekdays': (1, 0x7F),  # 0 means "slot unused" and is not stored
+    'alarm.sunrise': (1, 60),
+    'alarm.wake_bright': (0, 100),
+    'preset.brightness': (0, 100),
+    'preset.color_temp': (0, 100),
+    'preset.curve': (0, len(CURVES) - 1),
+    'preset.fade_ds': (0, 255),
+    'date.year': (2001, 2099),
+    'date.month': (1, 12),
+}
+
+# Chunked upload commands (main/config_image.h).
+OP_BEGIN = 0x01
+OP_DATA = 0x02
+OP_COMMIT = 0x03
+
+
+class ImageError(Exception):
+    pass
+
+
+def check(field: str, value: int) -> int:
+    lo, hi = RANGES[field]
+    if not isinstance(value, int) or isinstance(value, bool) or not lo <= value <= hi:
+        raise ImageError(f'{field}={value!r} outside {lo}..{hi}')
+    return value
+
+
+def parse_weekdays(v) -> int:
+    if isinstance(v, int):
+        return v
+    mask = 0
+    for day in v:
+        try:
+            mask |= 1 << WEEKDAYS.index(day.lower()[:3])
+        except ValueError:
+            raise ImageError(f'unknown weekday {day!r}')
+    return mask
+
+
+def parse_date(v: str) -> tuple:
+    try:
+        y, m, d = (int(x) for x in v.split('-'))
+    except ValueError:
+        raise ImageError(f'bad date {v!r}, expected YYYY-MM-DD')
+    check('date.year', y)
+    check('date.month', m)
+    if not 1 <= d <= calendar.monthrange(y, m)[1]:
+        raise ImageError(f'bad date {v!r}: no day {d} in that month')
+    return y - 2000, m, d
+
+
+def format_date(y: int, m: int, d: int) -> str:
+    text = f'{2000 + y:04d}-{m:02d}-{d:02d}'
+    parse_date(text)  # range and calendar check
+    return text
+
+
+def encode_dates(cfg: dict) -> bytes:
+    dated = {}
+    skip_next = 0
+    for a in cfg.get('alarms', []):
+        if 'date' in a:
+            dated[a['slot']] = parse_date(a['date'])
+        if a.get('skip_next', False):
+            skip_next |= 1 << a['slot']
+    out = bytearray(struct.pack('<H', sum(1 << s for s in dated)))
+    for slot in sorted(dated):
+        out += bytes(dated[slot])
+    out += struct.pack('<H', skip_next)
+
+    skips = cfg.get('skips', [])
+    if len(skips) > MAX_SKIPS:
+        raise ImageError(f'at most {MAX_SKIPS} skip dates')
+    out += struct.pack('<B', (1 << len(skips)) - 1)
+    for k in skips:
+        slots = k.get('slots', 'all')
+        if slots == 'all':
+            mask = 0xFFFF
+        else:
+            if any(not 0 <= s < MAX_ALARMS for s in slots):
+                raise ImageError(f'bad skip slots {slots!r}')
+            mask = sum(1 << s for s in set(slots))
+        out += bytes(parse_date(k['date'])) + struct.pack('<H', mask)
+    return bytes(out)
+
+
+def decode_dates(cfg: dict, payload: bytes, off: int) -> int:
+    def take(n: int) -> bytes:
+        nonlocal off
+        if off + n > len(payload):
+            raise ImageError('truncated date tables')
+        off += n
+        return payload[off - n:off]
+
+    alarms = {a['slot']: a for a in cfg['alarms']}
+    (dated,) = struct.unpack('<H', take(2))
+    for slot in range(MAX_ALARMS):
+        if dated & (1 << slot):
+            date = format_date(*take(3))
+            if slot in alarms:
+                alarms[slot]['date'] = date
+    (skip_next,) = struct.unpack('<H', take(2))
+    for slot, a in alarms.items():
+        if skip_next & (1 << slot):
+            a['skip_next'] = True
+    used = take(1)[0]
+    cfg['skips'] = []
+    for i in range(MAX_SKIPS):
+        if used & (1 << i):
+            y, m, d, mask = struct.unpack('<BBBH', take(5))
+            slots = 'all' if mask == 0xFFFF else [s for s in range(MAX_ALARMS) if mask & (1 << s)]
+            cfg['skips'].append({'date': format_date(y, m, d), 'slots': slots})
+    return off
+
+
+def encode(cfg: dict) -> bytes:
+    payload = bytearray(struct.pack('<BB', check('color_temp', cfg.get('color_temp', 50)),
+                                    check('wake_bright', cfg.get('wake_bright', 100))))
+    alarms = {}
+    for a in cfg.get('alarms', []):
+        slot = a['slot']
+        if not 0 <= slot < MAX_ALARMS or slot in alarms:
+            raise ImageError(f'bad or duplicate alarm slot {slot}')
+        hh, mm = (int(x) for x in a['time'].split(':'))
+        alarms[slot] = ((check('alarm.hour', hh) * 60 + check('alarm.minute', mm)) |
+                        (int(bool(a.get('enabled', True))) << 11) |
+                        (check('alarm.weekdays', parse_weekdays(a['weekdays'])) << 12) |
+                        (check('alarm.sunrise', a.get('sunrise', 30)) << 19) |
+                        (check('alarm.wake_bright', a.get('wake_bright', 100)) << 25))
+    payload += struct.pack('<H', sum(1 << s for s in alarms))
+    for slot in sorted(alarms):
+        payload += struct.pack('<I', alarms[slot])
+
+    presets = {}
+    for p in cfg.get('presets', []):
+        slot = p['slot']
+        if not 0 <= slot < MAX_PRESETS or slot in presets:
+            raise ImageError(f'bad or duplicate preset slot {slot}')
+        name = p['name'].encode('ascii')
+        if not 1 <= len(name) <= PRESET_NAME_MAX:
+            raise ImageError(f'preset name {p["name"]!r} must be 1..{PRESET_NAME_MAX} chars')
+        curve = p.get('curve', 'linear')
+        curve = CURVES.index(curve) if isinstance(curve, str) else curve
+        presets[slot] = struct.pack(PRESET_FMT, check('preset.brightness', p['brightness']),
+                                    check('preset.color_temp', p['color_temp']), check('preset.curve', curve),
+                                    check('preset.fade_ds', p.get('fade_ds', 5)), len(name)) + name
+    payload += struct.pack('<B', sum(1 << s for s in presets))
+    for slot in sorted(presets):
+        payload += presets[slot]
+
+    zone = cfg.get('tz_zone', 0)
+    if isinstance(zone, str):
+        if zone not in ZONES:
+            raise ImageError(f'unknown zone {zone!r}')
+        zone = ZONES.index(zone)
+    payload += struct.pack('<B', check('tz_zone', zone))
+    payload += encode_dates(cfg)
+
+    if len(payload) > MAX_PAYLOAD:
+        raise ImageError(f'payload {len(payload)} bytes exceeds {MAX_PAYLOAD}')
+    return struct.pack('<HBBI', MAGIC, VERSION, 0, zlib.crc32(payload) & 0xFFFFFFFF) + bytes(payload)
+
+
+def decode(image: bytes) -> dict:
+    if len(image) < HDR_LEN or len(image) > HDR_LEN + MAX_PAYLOAD:
+        raise ImageError(f'bad image length {len(image)}')
+    magic, version, _, crc = struct.unpack_from('<HBBI', image)
+    payload = image[HDR_LEN:]
+    if magic != MAGIC:
+        raise ImageError(f'bad magic 0x{magic:04x}')
+    if version != VERSION:
+        # Devices still import v1/v2 images, but this tool only produces and checks the current one.
+        raise ImageError(f'unsupported version {version}')
+    if zlib.crc32(payload) & 0xFFFFFFFF != crc:
+        raise ImageError('CRC mismatch')
+
+    ct, wb, used = struct.unpack_from('<BBH', payload)
+    cfg = {'color_temp': check('color_temp', ct), 'wake_bright': check('wake_bright', wb), 'alarms': [], 'presets': []}
+    off = 4
+    for slot in range(MAX_ALARMS):
+        if not used & (1 << slot):
+            continue
+        if off + 4 > len(payload):
+            raise ImageError('truncated alarm table')
+        (v,) = struct.unpack_from('<I', payload, off)
+        off += 4
+        mod = v & 0x7FF
+        if mod >= 24 * 60:
+            raise ImageError(f'alarm slot {slot}: minute of day {mod} out of range')
+        days = (v >> 12) & 0x7F
+        cfg['alarms'].append({
+            'slot': slot,
+            'time': f'{mod // 60:02d}:{mod % 60:02d}',
+            'weekdays': [d for i, d in enumerate(WEEKDAYS) if days & (1 << i)],
+            'enabled': bool((v >> 11) & 1),
+            'sunrise': check('alarm.sunrise', (v >> 19) & 0x3F),
+            'wake_bright': check('alarm.wake_bright', (v >> 25) & 0x7F),
+        })
+
+    if off >= len(payload):
+        raise ImageError('missing preset table')
+    used = payload[off]
+    off += 1
+    hdr = struct.calcsize(PRESET_FMT)
+    for slot in range(MAX_PRESETS):
+        if not used & (1 << slot):
+            continue
+        if off + hdr > len(payload):
+            raise ImageError('truncated preset table')
+        bright, ct, curve, fade, name_len = struct.unpack_from(PRESET_FMT, payload, off)
+        if not 1 <= name_len <= PRESET_NAME_MAX or off + hdr + name_len > len(payload):
+            raise ImageError(f'preset slot {slot}: bad name length {name_len}')
+        name = payload[off + hdr:off + hdr + name_len].decode('ascii')
+        off += hdr + name_len
+        cfg['presets'].append({
+            'slot': slot,
+            'name': name,
+            'brightness': check('preset.brightness', bright),
+            'color_temp': check('preset.color_temp', ct),
+            'curve': CURVES[check('preset.curve', curve)],
+            'fade_ds': fade,
+        })
+
+    if off >= len(payload):
+        raise ImageError('missing zone')
+    cfg['tz_zone'] = ZONES[check('tz_zone', payload[off])]
+    if decode_dates(cfg, payload, off + 1) != len(payload):
+        raise ImageError('trailing bytes')
+    return cfg
+
+
+def upload_commands(image: bytes, mtu: int) -> list:
+    # ATT write value is MTU - 3; each data command spends 3 more bytes on op + offset.
+    chunk = mtu - 3 - 3
+    if chunk <= 0:
+        raise ImageError(f'MTU {mtu} too small')
+    cmds = [struct.pack('<BH', OP_BEGIN, len(image))]
+    for off in range(0, len(image), chunk):
+        cmds.append(struct.pack('<BH', OP_DATA, off) + image[off:off + chunk])
+    cmds.append(bytes([OP_COMMIT]))
+    return cmds
+
+
+def main() -> int:
+    p = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = p.add_subparsers(dest='cmd', required=True)
+    b = sub.add_parser('build', help='JSON -> image')
+    b.add_argument('json')
+    b.add_argument('-o', '--output', required=True)
+    v = sub.add_parser('validate', help='check an image')
+    v.add_argument('image')
+    d = sub.add_parser('dump', help='image -> JSON')
+    d.add_argument('image')
+    c = sub.add_parser('chunks', help='print the 0xFF1A write sequence as hex')
+    c.add_argument('image')
+    c.add_argument('--mtu', type=int, default=23)
+    args = p.parse_args()
+
+    try:
+        if args.cmd == 'build':
+            with open(args.json) as f:
+                image = encode(json.load(f))
+            decode(image)  # round-trip guard
+            with open(args.output, 'wb') as f:
+                f.write(image)
+            print(f'{args.output}: {len(image)} bytes')
+            return 0
+
+        with open(args.image, 'rb') as f:
+            image = f.read()
+        cfg = decode(image)
+        if args.cmd == 'validate':
+            print(f'{args.image}: OK, {len(cfg["alarms"])} alarms, {len(cfg["presets"])} presets')
+        elif args.cmd == 'dump':
+            json.dump(cfg, sys.stdout, indent=2)
+            print()
+        else:
+            for cmd in upload_commands(image, args.mtu):
+                print(cmd.hex())
+    except (ImageError, KeyError, ValueError) as e:
+        print(f'error: {e}', file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,66 @@
+#!/usr/bin/env python3
+"""Builds the per-unit provisioning record for the "prov" partition.
+
+Layout must match main/provisioning.h (little-endian):
+  magic(u32 "PROV") version(u8) payload_len(u8) reserved(u16) crc32(u32, over payload)
+  payload: board_rev(u8) bat_en(u8) batt_gain_q12(u16) batt_offset_mv(i16)
+           led_warm_gain_q12(u16) led_cool_gain_q12(u16) name_suffix(8 bytes, NUL-padded)
+
+The image is padded with 0xFF to the partition size so it can be flashed as-is:
+  esptool.py write_flash 0x10000 prov.bin
+"""
+import argparse
+import struct
+import sys
+import zlib
+
+MAGIC = 0x564F5250  # "PROV"
+VERSION = 1
+PARTITION_SIZE = 0x1000
+NAME_SUFFIX_MAX = 8
+GAIN_ONE = 4096
+BAT_EN = {'low': 0, 'high': 1, 'auto': 0xFF}
+
+
+def gain_q12(text: str) -> int:
+    q12 = round(float(text) * GAIN_ONE)
+    # Same sanity window as the firmware (0.5x..1.5x).
+    if not GAIN_ONE // 2 <= q12 <= GAIN_ONE + GAIN_ONE // 2:
+        raise argparse.ArgumentTypeError(f'gain {text} outside 0.5..1.5')
+    return q12
+
+
+def build(args: argparse.Namespace) -> bytes:
+    suffix = args.name_suffix.encode('ascii')
+    if len(suffix) > NAME_SUFFIX_MAX or any(c < 0x21 or c > 0x7E for c in suffix):
+        raise SystemExit(f'name suffix must be 0..{NAME_SUFFIX_MAX} printable ASCII chars')
+    payload = struct.pack('<BBHhHH8s', args.board_rev, BAT_EN[args.bat_en], args.batt_gain,
+                          args.batt_offset_mv, args.led_warm_gain, args.led_cool_gain, suffix)
+    # esp_rom_crc32_le(0, ...) is the standard reflected CRC-32, same as zlib.
+    header = struct.pack('<IBBHI', MAGIC, VERSION, len(payload), 0, zlib.crc32(payload) & 0xFFFFFFFF)
+    record = header + payload
+    return record + b'\xff' * (PARTITION_SIZE - len(record))
+
+
+def main() -> int:
+    p = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    p.add_argument('--board-rev', type=int, required=True)
+    p.add_argument('--bat-en', choices=sorted(BAT_EN), default='auto', help='BAT_ADC_EN active level')
+    p.add_argument('--batt-gain', type=gain_q12, default=GAIN_ONE, help='battery mV scale, e.g. 1.012')
+    p.add_argument('--batt-offset-mv', type=int, default=0)
+    p.add_argument('--led-warm-gain', type=gain_q12, default=GAIN_ONE)
+    p.add_argument('--led-cool-gain', type=gain_q12, default=GAIN_ONE)
+    p.add_argument('--name-suffix', default='', help='advertised as LightClock_<suffix>')
+    p.add_argument('-o', '--output', required=True)
+    args = p.parse_args()
+
+    if not 0 <= args.board_rev <= 0xFF or not -32768 <= args.batt_offset_mv <= 32767:
+        p.error('board rev / offset out of range')
+
+    with open(args.output, 'wb') as f:
+        f.write(build(args))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+"""Projects NVS flash lifetime from a config-write usage profile.
+
+Simulates the NVS page ring the way ESP-IDF uses it: 4 KiB pages of 126 32-byte entries, writes
+append to the active page, an overwrite marks the old entries erased, and when only the reserve
+page is left the oldest page is garbage-collected (live entries copied forward, page erased).
+Erase counts per physical page give the wear rate; lifetime = endurance / worst page rate.
+
+Usage profile, either explicit:
+  nvs_wear_sim.py --commits-per-day 40 --record-bytes 220
+or from a unit's 0xFF1B telemetry read (hex), which supplies commits and bytes per uptime:
+  nvs_wear_sim.py --telemetry 0101....
+"""
+import argparse
+import struct
+import sys
+
+PAGE_SIZE = 4096
+ENTRIES_PER_PAGE = 126
+ENTRY_SIZE = 32
+
+
+def blob_entries(nbytes: int) -> int:
+    # Blob v2: one BLOB_IDX entry + one BLOB_DATA header entry + the data span.
+    return 2 + (nbytes + ENTRY_SIZE - 1) // ENTRY_SIZE
+
+
+class NvsSim:
+    def __init__(self, partition_size: int):
+        self.n_pages = partition_size // PAGE_SIZE
+        if self.n_pages < 3:
+            raise ValueError('NVS needs at least 3 pages')
+        self.erases = [0] * self.n_pages
+        # ring of used physical pages (oldest first); last one is active
+        self.free = list(range(1, self.n_pages))
+        self.ring = [0]
+        self.fill = {0: 0}           # entries consumed (written or erased) per page
+        self.live = {0: {}}          # page -> {key: entries}
+        self.where = {}              # key -> page holding its live copy
+
+    def _new_page(self):
+        moved = {}
+        if len(self.free) <= 1:
+            # Only the reserve is left: reclaim the oldest page, its live items go to the new page.
+            victim = self.ring.pop(0)
+            moved = self.live.pop(victim)
+            self.fill.pop(victim)
+            self.erases[victim] += 1
+            self.free.append(victim)
+            for key in moved:
+                del self.where[key]
+        page = self.free.pop(0)
+        self.ring.append(page)
+        self.fill[page] = 0
+        self.live[page] = {}
+        for key, n in moved.items():
+            self._append(key, n)
+
+    def _append(self, key: str, n: int):
+        active = self.ring[-1]
+        if self.fill[active] + n > ENTRIES_PER_PAGE:
+            self._new_page()
+            active = self.ring[-1]
+        self.fill[active] += n
+        self.live[active][key] = n
+        self.where[key] = active
+
+    def write(self, key: str, nbytes: int):
+        old = self.where.pop(key, None)
+        if old is not None:
+            self.live[old].pop(key)
+        self._append(key, blob_entries(nbytes))
+
+
+def parse_telemetry(hexstr: str):
+    raw = bytes.fromhex(hexstr)
+    version, _, uptime, commits, nbytes, erases, used, free, total = struct.unpack_from('<BBIIIIHHH', raw)
+    if version != 1:
+        raise ValueError(f'unsupported telemetry version {version}')
+    if uptime == 0 or commits == 0:
+        raise ValueError('telemetry has no commits yet')
+    return {
+        'commits_per_day': commits * 86400.0 / uptime,
+        'record_bytes': nbytes // commits,
+        'partition_size': (total // ENTRIES_PER_PAGE) * PAGE_SIZE,  # total_entries includes the reserve page
+        'observed_erases': erases,
+        'uptime_s': uptime,
+    }
+
+
+def main() -> int:
+    p = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    p.add_argument('--partition-size', type=lambda s: int(s, 0), default=0x6000, help='nvs size (partitions.csv)')
+    p.add_argument('--commits-per-day', type=float, default=20.0)
+    p.add_argument('--record-bytes', type=int, default=220, help='journal record size per commit')
+    p.add_argument('--telemetry', help='hex dump of the 0xFF1B value; overrides the profile options')
+    p.add_argument('--endurance', type=int, default=100000, help='rated erase cycles per sector')
+    p.add_argument('--commits', type=int, default=200000, help='commits to simulate')
+    args = p.parse_args()
+
+    if args.telemetry:
+        t = parse_telemetry(args.telemetry)
+        args.commits_per_day = t['commits_per_day']
+        args.record_bytes = t['record_bytes']
+        args.partition_size = t['partition_size']
+        print(f'telemetry: {t["uptime_s"]}s uptime, {t["observed_erases"]} page erases observed')
+
+    sim = NvsSim(args.partition_size)
+    # device_config alternates the A/B journal slots on every commit.
+    for i in range(args.commits):
+        sim.write('cfg_a' if i % 2 == 0 else 'cfg_b', args.record_bytes)
+
+    worst = max(sim.erases)
+    per_commit = worst / args.commits
+    days = args.endurance / (per_commit * args.commits_per_day) if per_commit else float('inf')
+    print(f'profile: {args.commits_per_day:.1f} commits/day, {args.record_bytes} B/record, '
+          f'{sim.n_pages} pages ({blob_entries(args.record_bytes)} entries/record)')
+    print(f'erases per page per 1000 commits: '
+          + ' '.join(f'{1000.0 * e / args.commits:.1f}' for e in sim.erases))
+    print(f'worst page: {per_commit * 1000:.2f} erases / 1000 commits')
+    print(f'projected lifetime: {days:,.0f} days ({days / 365.25:,.1f} years) at {args.endurance} cycles')
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())